@@ -15,37 +15,40 @@
 #include <string.h>
 #include <stdbool.h>
 #include <zephyr/drivers/uart.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/pm/device.h>
+#include <zephyr/pm/device_runtime.h>
 #include <zephyr/logging/log.h>
 
 #include "m6e_nano.h"
+#include "m6e_nano_internal.h"
 
 LOG_MODULE_REGISTER(M6E_NANO, CONFIG_M6E_NANO_LOG_LEVEL);
 
-static const uint16_t crc_table[] = {
-	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
-	0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
-};
+#ifdef CONFIG_M6E_NANO_WORKQUEUE
+static K_KERNEL_STACK_DEFINE(m6e_nano_workq_stack, CONFIG_M6E_NANO_WORKQUEUE_STACK_SIZE);
+struct k_work_q m6e_nano_workq;
 
 /**
- * @brief Calculate the CRC of the command being transmitted.
- *
- * @param u8Buf Partial of the command to calculate the CRC for.
- * @param len Length of the partial command.
- * @return uint16_t CRC of the command. To be appended as the last two bytes of the outbound
- * command.
+ * @brief Start the work queue shared by all M6E Nano instances. Runs before the devices are
+ * initialized.
  */
-static uint16_t _calculate_crc(uint8_t *u8Buf, uint8_t len)
+static int m6e_nano_workq_init(void)
 {
-	uint16_t crc = 0xFFFF;
+	const struct k_work_queue_config cfg = {
+		.name = "m6e_nano_workq",
+	};
 
-	for (uint8_t i = 0; i < len; i++) {
-		crc = ((crc << 4) | (u8Buf[i] >> 4)) ^ crc_table[crc >> 12];
-		crc = ((crc << 4) | (u8Buf[i] & 0x0F)) ^ crc_table[crc >> 12];
-	}
+	k_work_queue_start(&m6e_nano_workq, m6e_nano_workq_stack,
+			   K_KERNEL_STACK_SIZEOF(m6e_nano_workq_stack),
+			   CONFIG_M6E_NANO_WORKQUEUE_PRIORITY, &cfg);
 
-	return crc;
+	return 0;
 }
 
+SYS_INIT(m6e_nano_workq_init, POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+#endif
+
 /**
  * @brief Set callback function to be called when a string is received.
  *
@@ -61,6 +64,84 @@ static void user_set_command_callback(const struct device *dev, m6e_nano_callbac
 	data->user_data = user_data;
 }
 
+/**
+ * @brief Set callback function to be called on driver events.
+ *
+ * @param dev UART peripheral device.
+ * @param callback New callback function.
+ * @param user_data Data to be passed to the callback function.
+ */
+static void user_set_event_callback(const struct device *dev, m6e_nano_event_callback_t callback,
+				    void *user_data)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	data->event_callback = callback;
+	data->event_user_data = user_data;
+}
+
+/**
+ * @brief Report an event to the application, if it registered for them.
+ *
+ * @param dev UART peripheral device.
+ * @param event One of M6E_NANO_EVENT_*.
+ */
+void _m6e_nano_notify(const struct device *dev, uint8_t event)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	m6e_nano_event_callback_t callback = data->event_callback;
+
+	if (callback != NULL) {
+		callback(dev, event, data->event_user_data);
+	}
+}
+
+/**
+ * @brief Handle a startup message from the module. The module has rebooted into its default
+ * configuration, so anything configured since is lost. Called from ISR context.
+ *
+ * @param dev Driver device.
+ */
+static void _m6e_nano_on_startup(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	if (data->expect_startup) {
+		data->expect_startup = false;
+		return; // Powered on by the driver
+	}
+
+	if (data->settings.valid == 0 && !data->reading) {
+		return; // Power-on, nothing was lost
+	}
+
+	data->stats.resets++;
+
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	data->reset_pending = true;
+	k_work_submit_to_queue(&m6e_nano_workq, &data->recover_work);
+#endif
+}
+
+/**
+ * @brief Arm the keep-alive watchdog for a read stream that just started.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _m6e_nano_watchdog_start(const struct device *dev)
+{
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	if (data->supervised) {
+		data->last_frame_ms = k_uptime_get_32();
+		k_work_reschedule_for_queue(&m6e_nano_workq, &data->watchdog_work,
+					    K_MSEC(CONFIG_M6E_NANO_KEEPALIVE_TIMEOUT_MS / 2));
+	}
+#else
+	ARG_UNUSED(dev);
+#endif
+}
+
 /**
  * @brief Empty the RX buffer of the UART peripheral.
  *
@@ -89,22 +170,7 @@ static int m6e_nano_construct_command(const struct device *dev, uint8_t opcode,
 				      uint8_t size, bool timeout)
 {
 	uint8_t command[size + 5];
-	command[0] = TMR_START_HEADER;
-	command[1] = size; // load the length of this operation into msg array
-	command[2] = opcode;
-	command[3] = *data;
-
-	// Copy the data into msg array
-	for (uint8_t x = 0; x < size; x++) {
-		command[3 + x] = data[x];
-	}
-
-	// calculate the CRC
-	uint16_t crc = _calculate_crc(&command[1], size + 2);
-	command[size + 3] = crc >> 8;
-	command[size + 4] = crc & 0xFF;
-
-	size_t length = sizeof(command) / sizeof(*command);
+	int length = m6e_nano_frame_encode(command, sizeof(command), opcode, data, size);
 
 	return user_send_command(dev, command, length, timeout); // Send and wait for response
 }
@@ -115,8 +181,9 @@ static int m6e_nano_construct_command(const struct device *dev, uint8_t opcode,
  * @param dev UART peripheral device.
  * @param option1 Byte 1 of the configuration.
  * @param option2 Byte 2 of the configuration.
+ * @return int 0 on success, negative errno otherwise.
  */
-static void _m6e_nano_set_config(const struct device *dev, uint8_t option1, uint8_t option2)
+static int _m6e_nano_set_config(const struct device *dev, uint8_t option1, uint8_t option2)
 {
 	uint8_t data[3];
 
@@ -126,8 +193,8 @@ static void _m6e_nano_set_config(const struct device *dev, uint8_t option1, uint
 	data[1] = option1;
 	data[2] = option2;
 
-	m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_READER_OPTIONAL_PARAMS, data,
-				   sizeof(data), true);
+	return m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_READER_OPTIONAL_PARAMS, data,
+					  sizeof(data), true);
 }
 
 /**
@@ -139,7 +206,7 @@ static void _m6e_nano_set_config(const struct device *dev, uint8_t option1, uint
 static uint8_t _get_tag_data_bytes(const struct device *dev)
 {
 	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
-	uint8_t *msg = data->response.data;
+	uint8_t *msg = data->frame;
 	// Number of bits of embedded tag data
 	uint8_t tagDataLength = 0;
 	for (uint8_t x = 0; x < 2; x++) {
@@ -154,7 +221,140 @@ static uint8_t _get_tag_data_bytes(const struct device *dev)
 }
 
 /**
- * @brief Handler for when the UART peripheral receives data.
+ * @brief Count a tag read against the channel it was read on. Called from the UART ISR.
+ *
+ * @param dev UART peripheral device.
+ * @param freq Channel frequency in kHz.
+ */
+static void _m6e_nano_count_channel(const struct device *dev, uint32_t freq)
+{
+#ifdef CONFIG_M6E_NANO_CHANNEL_STATS
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->channel_lock);
+	uint8_t i;
+
+	for (i = 0; i < data->channel_count; i++) {
+		if (data->channels[i].freq == freq) {
+			data->channels[i].reads++;
+			break;
+		}
+	}
+
+	if (i == data->channel_count) {
+		if (data->channel_count < M6E_NANO_MAX_HOP_CHANNELS) {
+			data->channels[data->channel_count].freq = freq;
+			data->channels[data->channel_count].reads = 1;
+			data->channel_count++;
+		} else {
+			data->channel_overflows++;
+		}
+	}
+	k_spin_unlock(&data->channel_lock, key);
+#else
+	ARG_UNUSED(dev);
+	ARG_UNUSED(freq);
+#endif
+}
+
+/**
+ * @brief Account for a CRC-valid frame as it completes, whether or not the application parses
+ * it: keep-alives anchor the clock, and tag reads are timed and counted in the driver, channel
+ * and antenna statistics.
+ *
+ * @param dev UART peripheral device.
+ * @param frame Frame, from the header to the CRC.
+ * @param arrival_us Uptime the frame started arriving.
+ * @return int64_t Uptime the tag was read for a tag read, arrival_us for other frames.
+ */
+static int64_t _m6e_nano_account_frame(const struct device *dev, const uint8_t *frame,
+				       int64_t arrival_us)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	uint32_t timestamp = 0;
+	uint32_t freq = 0;
+
+	if (frame[2] == TMR_SR_OPCODE_READ_TAG_ID_MULTIPLE && frame[1] == 0 &&
+	    m6e_nano_frame_status(frame) == M6E_NANO_STATUS_KEEPALIVE) {
+		m6e_nano_clock_keepalive(&data->clock, arrival_us);
+		return arrival_us;
+	}
+	if (!m6e_nano_frame_is_tag(frame)) {
+		return arrival_us;
+	}
+
+	for (uint8_t x = 0; x < 3; x++) {
+		freq |= (uint32_t)frame[14 + x] << (8 * (2 - x));
+	}
+	for (uint8_t x = 0; x < 4; x++) {
+		timestamp |= (uint32_t)frame[17 + x] << (8 * (3 - x));
+	}
+
+	data->stats.tag_reads++;
+	_m6e_nano_count_channel(dev, freq);
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+	m6e_nano_antenna_tag(dev, frame[13]);
+#endif
+
+	return m6e_nano_clock_tag(&data->clock, timestamp, arrival_us);
+}
+
+/**
+ * @brief Handle a frame received in full: wake the command waiting for it, account for it and
+ * hand it to the application. Called from the UART ISR.
+ *
+ * @param dev UART peripheral device.
+ * @param dev_m6e Driver device.
+ */
+static void _m6e_nano_frame_done(const struct device *dev, void *dev_m6e)
+{
+	const struct device *m6e_nano_dev = dev_m6e;
+	struct m6e_nano_data *drv_data = m6e_nano_dev->data;
+	m6e_nano_callback_t callback = drv_data->callback;
+	bool valid;
+
+	drv_data->response.len = 0;
+	drv_data->status = RESPONSE_SUCCESS;
+	drv_data->last_frame_ms = k_uptime_get_32();
+	drv_data->stats.frames++;
+	M6E_NANO_TRACE(m6e_nano_dev, FRAME_END);
+	M6E_NANO_CAPTURE(m6e_nano_dev, M6E_NANO_CAPTURE_RX, drv_data->response.data,
+			 drv_data->response.msg_len);
+	valid = m6e_nano_frame_crc_ok(drv_data->response.data);
+	if (!valid) {
+		drv_data->stats.crc_errors++;
+		return; // Never reaches the callback
+	}
+
+	// Tag frames still streaming and late answers are not the response to the command sent
+	if (drv_data->response.data[2] == drv_data->wait_opcode) {
+		k_sem_give(&drv_data->response_sem);
+	}
+
+	drv_data->read_us =
+		_m6e_nano_account_frame(m6e_nano_dev, drv_data->response.data, drv_data->frame_us);
+#ifdef CONFIG_M6E_NANO_RTIO
+	m6e_nano_rtio_frame(m6e_nano_dev, drv_data->response.data);
+#endif
+#ifdef CONFIG_M6E_NANO_ZBUS
+	m6e_nano_zbus_frame(m6e_nano_dev, drv_data->response.data);
+#endif
+
+	if (callback != NULL) {
+#ifdef CONFIG_M6E_NANO_COALESCE
+		m6e_nano_coalesce_frame(m6e_nano_dev, drv_data->response.data);
+#else
+		M6E_NANO_TRACE(m6e_nano_dev, DISPATCH);
+		drv_data->frame_ready = true;
+		drv_data->frame_time_us = drv_data->read_us;
+		callback(dev, dev_m6e);
+		drv_data->frame_ready = false;
+#endif
+	}
+}
+
+/**
+ * @brief Handler for when the UART peripheral receives data. Reads never go past the end of the
+ * frame being received, so a burst holding several frames is parsed one frame at a time.
  *
  * @param dev UART peripheral device.
  * @param dev_m6e Driver device passed to provide access to buffers.
@@ -166,99 +366,173 @@ static void uart_rx_handler(const struct device *dev, void *dev_m6e)
 
 	int len = 0;
 	int offset = 0;
+	int want;
+
+#ifdef CONFIG_M6E_NANO_BRIDGE
+	if (drv_data->bridge.host != NULL) {
+		m6e_nano_bridge_isr(m6e_nano_dev);
+		return;
+	}
+#endif
 
 	if (drv_data->status == RESPONSE_CLEAR) {
 		drv_data->response.len = 0;
 	}
 
 	offset = drv_data->response.len;
-	m6e_nano_callback_t callback = drv_data->callback;
 
-	if ((uart_irq_update(dev) > 0) && (uart_irq_is_pending(dev) > 0)) {
-		while (uart_irq_rx_ready(dev)) {
-
-			len = uart_fifo_read(dev, &drv_data->response.data[offset], 255 - offset);
-			LOG_DBG("Received %d bytes", len);
-
-			while (len > 0) {
-				LOG_DBG("Data: %X | Offset: %d", drv_data->response.data[offset],
-					offset);
-				switch (offset) {
-				case 0:
-					if (drv_data->response.data[offset] == TMR_START_HEADER) {
-						LOG_DBG("Msg Header: %X",
-							drv_data->response.data[offset]);
-						drv_data->status = RESPONSE_PENDING;
-					} else if (drv_data->response.data[offset] ==
-						   ERROR_COMMAND_RESPONSE_TIMEOUT) {
-						drv_data->status = ERROR_COMMAND_RESPONSE_TIMEOUT;
-					}
-					break;
-				case 1:
-					drv_data->response.msg_len =
-						drv_data->response.data[offset] + 7;
-					LOG_DBG("Msg Total Len: %d", drv_data->response.msg_len);
-					break;
-				case 2:
-					LOG_DBG("Msg Opcode: %x", drv_data->response.data[offset]);
-					if (drv_data->response.data[offset] ==
-					    TMR_SR_OPCODE_VERSION_STARTUP) {
-						drv_data->status = RESPONSE_CLEAR;
-					};
-					break;
-				default:
-					break;
-				}
-
-				if (drv_data->status == ERROR_COMMAND_RESPONSE_TIMEOUT) {
-					len = 0;
-					offset = 0;
-					break;
-				}
-
-				offset++;
-				len--;
-				drv_data->response.len = offset;
+	if ((uart_irq_update(dev) <= 0) || (uart_irq_is_pending(dev) <= 0)) {
+		return;
+	}
+
+	while (uart_irq_rx_ready(dev)) {
+		// Header and length one byte at a time, then the rest of the frame
+		want = offset < 2 ? 1 : drv_data->response.msg_len - offset;
+		len = uart_fifo_read(dev, &drv_data->response.data[offset], want);
+		if (len <= 0) {
+			break;
+		}
+
+		switch (offset) {
+		case 0:
+			if (drv_data->response.data[offset] == TMR_START_HEADER) {
+				M6E_NANO_TRACE(m6e_nano_dev, FRAME_START);
+				drv_data->frame_us = k_ticks_to_us_floor64(k_uptime_ticks());
+				drv_data->status = RESPONSE_PENDING;
+			} else if (drv_data->response.data[offset] ==
+				   ERROR_COMMAND_RESPONSE_TIMEOUT) {
+				drv_data->status = ERROR_COMMAND_RESPONSE_TIMEOUT;
+			} else {
+				continue; // Not a frame start, resynchronize on the next header
+			}
+			break;
+		case 1:
+			drv_data->response.msg_len =
+				drv_data->response.data[offset] + M6E_NANO_FRAME_OVERHEAD;
+			break;
+		default:
+			// Opcode in the first read after the length. The frame still completes, it
+			// answers TMR_SR_OPCODE_BOOT_FIRMWARE
+			if (offset == 2 &&
+			    drv_data->response.data[offset] == TMR_SR_OPCODE_VERSION_STARTUP) {
+				_m6e_nano_on_startup(m6e_nano_dev);
 			}
+			break;
+		}
+
+		if (drv_data->status == ERROR_COMMAND_RESPONSE_TIMEOUT) {
+			drv_data->response.len = 0;
+			drv_data->status = RESPONSE_FAIL;
+			m6e_nano_uart_flush(dev);
+			LOG_WRN("Command response timeout.");
+			return;
+		}
+
+		offset += len;
+		drv_data->response.len = offset;
+
+		if (offset == 2 && drv_data->response.msg_len > M6E_NANO_BUF_SIZE) {
+			drv_data->response.len = 0;
+			drv_data->status = RESPONSE_FAIL;
+			M6E_NANO_CAPTURE(m6e_nano_dev,
+					 M6E_NANO_CAPTURE_RX | M6E_NANO_CAPTURE_TRUNCATED,
+					 drv_data->response.data, offset);
+			m6e_nano_uart_flush(dev);
+			LOG_WRN("Response exceeds buffer, %d.", (int)drv_data->response.msg_len);
+			return;
+		}
+
+		if (offset >= 2 && offset == drv_data->response.msg_len) {
+			_m6e_nano_frame_done(dev, dev_m6e);
+			offset = 0;
 		}
 	}
+}
+
+/**
+ * @brief Account for the outcome of a command that waited for a response. Repeated timeouts
+ * mean the module is unresponsive and, when supervised, trigger a recovery.
+ *
+ * @param dev Driver device.
+ * @param ret Result of the command.
+ */
+static void _m6e_nano_command_done(const struct device *dev, int ret)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	if (ret == 0) {
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+		data->cmd_timeout_streak = 0;
+#endif
+		return;
+	}
 
-	if (offset > drv_data->response.msg_len - 1) {
-		drv_data->response.len = 0;
-		drv_data->status = RESPONSE_SUCCESS;
-		LOG_DBG("Response success.");
-	} else if (offset > M6E_NANO_BUF_SIZE) {
-		drv_data->response.len = 0;
-		drv_data->status = RESPONSE_FAIL;
-		m6e_nano_uart_flush(dev);
-		LOG_WRN("Response exceeds buffer, %d.", offset);
-	} else if (drv_data->status == ERROR_COMMAND_RESPONSE_TIMEOUT) {
-		drv_data->response.len = 0;
-		drv_data->status = RESPONSE_FAIL;
-		m6e_nano_uart_flush(dev);
-		LOG_WRN("Command response timeout.");
+	data->stats.cmd_timeouts++;
+
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	if (data->cmd_timeout_streak < UINT8_MAX) {
+		data->cmd_timeout_streak++;
 	}
+	if (data->supervised && !data->recovering &&
+	    data->cmd_timeout_streak >= CONFIG_M6E_NANO_CMD_TIMEOUT_LIMIT) {
+		k_work_submit_to_queue(&m6e_nano_workq, &data->recover_work);
+	}
+#endif
+}
 
-	if (callback != NULL) {
-		callback(dev, dev_m6e);
+/**
+ * @brief Wait for the response to the command last sent.
+ *
+ * @param dev UART peripheral device.
+ * @param timeout_ms Longest wait for the response.
+ * @return int 0 on success, -ETIMEDOUT if no response arrived.
+ */
+static int _m6e_nano_wait_response(const struct device *dev, int32_t timeout_ms)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	int ret = 0;
+
+	// Given by the RX interrupt once a CRC-valid frame with the opcode of the command completes
+	if (k_sem_take(&data->response_sem, K_MSEC(MAX(timeout_ms, 0))) != 0) {
+		LOG_WRN("Command timeout.");
+		data->status = RESPONSE_CLEAR;
+		ret = -ETIMEDOUT;
 	}
+	if (ret == 0) {
+		M6E_NANO_TRACE(dev, RESPONSE);
+	}
+	_m6e_nano_command_done(dev, ret);
+
+	return ret;
 }
 
 /**
- * @brief Set the command to be transmitted by the UART peripheral.
+ * @brief Transmit a command and optionally wait for the response.
  *
  * @param dev UART peripheral device.
  * @param command Command to be transmitted.
  * @param length Length of the command.
- * @return int32_t Status of the response.
+ * @param wait Wait for the response.
+ * @param timeout_ms Longest wait for the response.
+ * @return int 0 on success, -ETIMEDOUT if no response arrived, -EBUSY while the bridge is on.
  */
-int user_send_command(const struct device *dev, uint8_t *command, const uint8_t length,
-		      const bool timeout)
+static int _m6e_nano_send_command(const struct device *dev, uint8_t *command,
+				  const uint8_t length, const bool wait, int32_t timeout_ms)
 {
-	int32_t timeout_in_ms = CFG_M6E_NANO_SERIAL_TIMEOUT;
 	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
 	const struct m6e_nano_config *cfg = dev->config;
 	struct m6e_nano_buf *tx = &data->command;
+	int ret = 0;
+
+	k_mutex_lock(&data->lock, K_FOREVER);
+
+#ifdef CONFIG_M6E_NANO_BRIDGE
+	// The module belongs to the bridged host until the bridge stops
+	if (data->bridge.host != NULL) {
+		k_mutex_unlock(&data->lock);
+		return -EBUSY;
+	}
+#endif
 
 	memset(tx->data, 0, M6E_NANO_BUF_SIZE);
 
@@ -269,56 +543,46 @@ int user_send_command(const struct device *dev, uint8_t *command, const uint8_t
 	__ASSERT(tx->len <= 255, "Command length too long.");
 
 	while (data->status == RESPONSE_STARTUP) {
-		if (timeout_in_ms < 0) {
+		if (timeout_ms < 0) {
 			LOG_DBG("Startup event missed...");
 			data->status = RESPONSE_CLEAR;
 			break;
 		}
-		timeout_in_ms -= 10;
+		timeout_ms -= 10;
 		k_msleep(10);
 	}
 
-	if (CONFIG_M6E_NANO_LOG_LEVEL >= LOG_LEVEL_DBG) {
-		for (size_t i = 0; i < length; i++) {
-			switch (i) {
-			case 0:
-				LOG_DBG("Header: %X", tx->data[i]);
-				break;
-			case 1:
-				LOG_DBG("Data Length: %X", tx->data[i]);
-				break;
-			case 2:
-				LOG_DBG("Opcode: %X", tx->data[i]);
-				break;
-			default:
-				if (length - 2 <= i) {
-					LOG_DBG("CRC[%u]: %X", i - (length - 2), tx->data[i]);
-				} else {
-					LOG_DBG("Data: %X", tx->data[i]);
-				}
-				break;
-			}
-		}
-	}
-
+	// Frames completed before the command are not its response
+	data->wait_opcode = tx->data[2];
+	k_sem_reset(&data->response_sem);
 	for (size_t i = 0; i < tx->len; i++) {
 		data->status = RESPONSE_CLEAR;
 		uart_poll_out(cfg->uart_dev, tx->data[i]);
 	}
+	M6E_NANO_TRACE(dev, CMD_SENT);
+	M6E_NANO_CAPTURE(dev, M6E_NANO_CAPTURE_TX, tx->data, tx->len);
 
-	if (timeout) {
-		while (data->status != RESPONSE_SUCCESS) {
-			if (timeout_in_ms < 0) {
-				LOG_WRN("Command timeout.");
-				data->status = RESPONSE_CLEAR;
-				return -ETIMEDOUT;
-			}
-			timeout_in_ms -= 10;
-			k_msleep(10);
-		}
-		return 0;
+	if (wait) {
+		ret = _m6e_nano_wait_response(dev, timeout_ms);
 	}
-	return 0;
+
+	k_mutex_unlock(&data->lock);
+
+	return ret;
+}
+
+/**
+ * @brief Set the command to be transmitted by the UART peripheral.
+ *
+ * @param dev UART peripheral device.
+ * @param command Command to be transmitted.
+ * @param length Length of the command.
+ * @return int32_t Status of the response.
+ */
+int user_send_command(const struct device *dev, uint8_t *command, const uint8_t length,
+		      const bool timeout)
+{
+	return _m6e_nano_send_command(dev, command, length, timeout, CFG_M6E_NANO_SERIAL_TIMEOUT);
 }
 
 /**
@@ -330,7 +594,7 @@ int user_send_command(const struct device *dev, uint8_t *command, const uint8_t
 uint8_t m6e_nano_get_tag_epc_bytes(const struct device *dev)
 {
 	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
-	uint8_t *msg = data->response.data;
+	uint8_t *msg = data->frame;
 
 	uint16_t epcBits = 0; // Number of bits of EPC (including PC, EPC, and EPC CRC)
 
@@ -349,26 +613,27 @@ uint8_t m6e_nano_get_tag_epc_bytes(const struct device *dev)
  * @brief Retrieve the RSSI of the tag.
  *
  * @param dev UART peripheral device.
- * @return uint8_t RSSI of the tag.
+ * @return int8_t RSSI of the tag in dBm.
  */
-uint8_t m6e_nano_get_tag_rssi(const struct device *dev)
+int8_t m6e_nano_get_tag_rssi(const struct device *dev)
 {
 	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
-	uint8_t *msg = data->response.data;
-	uint8_t rssi = msg[12] - 256;
+	uint8_t *msg = data->frame;
+	// Two's complement dBm
+	int8_t rssi = (int8_t)msg[12];
 	return rssi;
 }
 
 /**
- * @brief Retrieve the timestamp of the tag.
+ * @brief Retrieve the timestamp of the tag, in ms since the last keep-alive of the module.
  *
  * @param dev UART peripheral device.
- * @return uint16_t Timestamp of the tag.
+ * @return uint32_t Timestamp of the tag.
  */
-uint16_t m6e_nano_get_tag_timestamp(const struct device *dev)
+uint32_t m6e_nano_get_tag_timestamp(const struct device *dev)
 {
 	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
-	uint8_t *msg = data->response.data;
+	uint8_t *msg = data->frame;
 	// Timestamp since last Keep-Alive message
 	uint32_t timeStamp = 0;
 	for (uint8_t x = 0; x < 4; x++) {
@@ -378,6 +643,36 @@ uint16_t m6e_nano_get_tag_timestamp(const struct device *dev)
 	return timeStamp;
 }
 
+/**
+ * @brief Retrieve the time the tag last parsed by m6e_nano_parse_response() was read, in the
+ * uptime of the host. The module timestamp is anchored on its keep-alives and corrected for
+ * the drift between the two clocks, so reads from a stream of any length, and from several
+ * readers, compare directly with each other and with k_uptime_get().
+ *
+ * @param dev UART peripheral device.
+ * @return int64_t Uptime of the read in ms.
+ */
+int64_t m6e_nano_get_tag_uptime(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	return data->tag_time_us / 1000;
+}
+
+/**
+ * @brief Set a fixed offset added to the tag times of a reader, to align readers whose frames
+ * reach the host with different latencies.
+ *
+ * @param dev UART peripheral device.
+ * @param offset_us Offset in us.
+ */
+void m6e_nano_set_time_offset(const struct device *dev, int32_t offset_us)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	data->clock.offset_us = offset_us;
+}
+
 /**
  * @brief Retrieve the frequency of the tag.
  *
@@ -387,7 +682,7 @@ uint16_t m6e_nano_get_tag_timestamp(const struct device *dev)
 uint32_t m6e_nano_get_tag_freq(const struct device *dev)
 {
 	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
-	uint8_t *msg = data->response.data;
+	uint8_t *msg = data->frame;
 	// Frequency of the tag detected is loaded over three bytes
 	uint32_t freq = 0;
 	for (uint8_t x = 0; x < 3; x++) {
@@ -398,136 +693,1491 @@ uint32_t m6e_nano_get_tag_freq(const struct device *dev)
 }
 
 /**
- * @brief Disable the read filter.
+ * @brief Retrieve the phase of the tag's backscatter.
  *
  * @param dev UART peripheral device.
+ * @return uint16_t Phase in degrees, 0 to 180.
  */
-void m6e_nano_disable_read_filter(const struct device *dev)
+uint16_t m6e_nano_get_tag_phase(const struct device *dev)
 {
-	_m6e_nano_set_config(dev, 0x0C, 0x00); // Disable read filter
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	uint8_t *msg = data->frame;
+	uint16_t phase = 0;
+	for (uint8_t x = 0; x < 2; x++) {
+		phase |= (uint16_t)msg[21 + x] << (8 * (1 - x));
+	}
+
+	return phase;
 }
 
 /**
- * @brief Stop a continuous read operation.
+ * @brief Retrieve the antenna the tag was read on.
  *
  * @param dev UART peripheral device.
- * @brief Stop a continuous read operation. No timeout required.
+ * @return uint8_t TX port in the 4 MSB, RX port in the 4 LSB.
  */
-void m6e_nano_stop_reading(const struct device *dev)
+uint8_t m6e_nano_get_tag_antenna(const struct device *dev)
 {
-	uint8_t data[] = {0x00, 0x00, 0x02};
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
 
-	m6e_nano_construct_command(dev, TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP, data, sizeof(data),
-				   false);
+	return data->frame[13];
 }
 
 /**
- * @brief Set the power mode of the M6E Nano.
+ * @brief Decode every field of a tag read at once.
  *
  * @param dev UART peripheral device.
- * @param mode Power mode to set. See docs for valid modes.
+ * @param tag Decoded tag read.
+ * @return int 0 on success, -EBADMSG if the EPC runs past the frame.
  */
-void m6e_nano_set_power_mode(const struct device *dev, uint8_t mode)
+int m6e_nano_get_tag(const struct device *dev, struct m6e_nano_tag *tag)
 {
-	uint8_t data[1] = {mode};
-	m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_POWER_MODE, data, sizeof(data), true);
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	return m6e_nano_decode_tag(data->frame, tag);
 }
 
 /**
- * @brief Set the antenna port of the M6E Nano.
+ * @brief Disable the read filter.
  *
  * @param dev UART peripheral device.
  */
-void m6e_nano_set_antenna_port(const struct device *dev)
+void m6e_nano_disable_read_filter(const struct device *dev)
 {
-	uint8_t data[2] = {0x01, 0x01};
-	m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_ANTENNA_PORT, data, sizeof(data), true);
+	_m6e_nano_set_config(dev, TMR_SR_CONFIGURATION_ENABLE_READ_FILTER, 0x00);
 }
 
 /**
- * @brief Set the read power of the M6E Nano.
+ * @brief Stop a continuous read operation and wait until the module acknowledges it, so the
+ * next command is not sent while tags are still streaming.
  *
  * @param dev UART peripheral device.
- * @param power Power to set. Between 0 and 27dBm.
+ * @return int 0 on success, negative errno otherwise.
  */
-void m6e_nano_set_read_power(const struct device *dev, uint16_t power)
+int _m6e_nano_stop_reading(const struct device *dev)
 {
-	if (power > 2700) {
-		LOG_DBG("Limit exceeded (27dBm), restricting to 27dBm.");
-		power = 2700;
-	}
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t data[] = {0x00, 0x00, 0x02};
 
-	uint8_t size = sizeof(power);
-	uint8_t data[size];
-	for (uint8_t x = 0; x < size; x++) {
-		data[x] = (uint8_t)(power >> (8 * (size - 1 - x)));
-	}
+	drv_data->reading = false;
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+	m6e_nano_antenna_reading(dev, false);
+#endif
 
-	m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_READ_TX_POWER, data, size, true);
+	return _m6e_nano_command(dev, TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP, data, sizeof(data));
 }
 
 /**
- * @brief Start a continuous read operation.
+ * @brief Stop a continuous read operation, waiting until the module acknowledges it.
  *
  * @param dev UART peripheral device.
  */
-void m6e_nano_start_reading(const struct device *dev)
+void m6e_nano_stop_reading(const struct device *dev)
 {
-	m6e_nano_disable_read_filter(dev);
-
-	uint8_t data[] = {0x00, 0x00, 0x01, 0x22, 0x00, 0x00, 0x05, 0x07,
-			  0x22, 0x10, 0x00, 0x1B, 0x03, 0xE8, 0x01, 0xFF};
+	int ret = _m6e_nano_stop_reading(dev);
 
-	/*
-SETU16(newMsg, i, 0);
-SETU8(newMsg, i, (uint8_t)0x1); // TM Option 1, for continuous reading
-SETU8(newMsg, i, (uint8_t)TMR_SR_OPCODE_READ_TAG_ID_MULTIPLE); // sub command opcode
-SETU16(newMsg, i, (uint16_t)0x0000); // search flags, only 0x0001 is supported
-SETU8(newMsg, i, (uint8_t)TMR_TAG_PROTOCOL_GEN2); // protocol ID
-*/
-
-	m6e_nano_construct_command(dev, TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP, data, sizeof(data),
-				   true);
+	if (ret < 0) {
+		LOG_WRN("Failed to stop reading (%d).", ret);
+	}
 }
 
 /**
- * @brief Set the operating region of the M6E Nano. This controls the transmission frequency of the
- * RFID reader.
+ * @brief Send a power mode command without remembering it as the configured mode.
  *
  * @param dev UART peripheral device.
- * @param region Operating region to set.
+ * @param mode Power mode to send.
+ * @return int 0 on success, negative errno otherwise.
  */
-void m6e_nano_set_region(const struct device *dev, uint8_t region)
+static int _m6e_nano_send_power_mode(const struct device *dev, uint8_t mode)
 {
+	uint8_t data[1] = {mode};
 
-	m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_REGION, &region, sizeof(region), true);
+	return m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_POWER_MODE, data, sizeof(data),
+					  true);
 }
 
 /**
- * @brief Retrieve the firmware version of the M6E Nano.
+ * @brief Set the power mode of the M6E Nano.
  *
  * @param dev UART peripheral device.
+ * @param mode Power mode to set. See docs for valid modes.
  */
-int m6e_nano_get_version(const struct device *dev)
+int m6e_nano_set_power_mode(const struct device *dev, uint8_t mode)
 {
-	uint8_t data[] = {};
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+
+	drv_data->settings.power_mode = mode;
+	drv_data->settings.valid |= M6E_NANO_SETTING_POWER_MODE;
 
-	return m6e_nano_construct_command(dev, TMR_SR_OPCODE_VERSION, data, sizeof(data), true);
+	return _m6e_nano_send_power_mode(dev, mode);
 }
 
 /**
- * @brief Set the tag protocol of the M6E Nano.
+ * @brief Wake a module sleeping in one of the power save modes. The module drops the first
+ * bytes received while asleep, so a short run of header bytes is sent first.
  *
  * @param dev UART peripheral device.
- * @param protocol Tag protocol to set.
  */
-void m6e_nano_set_tag_protocol(const struct device *dev, uint8_t protocol)
+static void _m6e_nano_wake(const struct device *dev)
 {
-	uint8_t data[2];
-	data[0] = 0; // Opcode expects padding for 16-bits
-	data[1] = protocol;
+	const struct m6e_nano_config *cfg = dev->config;
 
-	m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_TAG_PROTOCOL, data, sizeof(data), true);
+	// The module discards bytes until it is awake, header bytes are ignored by its parser
+	for (uint8_t i = 0; i < M6E_NANO_WAKE_PREAMBLE_LEN; i++) {
+		uart_poll_out(cfg->uart_dev, TMR_START_HEADER);
+	}
+	k_msleep(M6E_NANO_WAKE_DELAY_MS);
+}
+
+/**
+ * @brief Prepare for a startup message caused by the driver powering the module on, so it is
+ * not mistaken for a reset.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _m6e_nano_expect_startup(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	data->expect_startup = true;
+	data->status = RESPONSE_STARTUP;
+}
+
+/**
+ * @brief Put the module to sleep. Does nothing if it is already asleep.
+ *
+ * @param dev UART peripheral device.
+ * @param method One of M6E_NANO_SLEEP_*.
+ * @return int 0 on success, -ENOTSUP without enable-gpios, negative errno otherwise.
+ */
+int _m6e_nano_sleep(const struct device *dev, uint8_t method)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	int ret;
+
+	if (data->asleep) {
+		return 0;
+	}
+
+	if (method == M6E_NANO_SLEEP_DISABLE) {
+#ifdef CONFIG_GPIO
+		const struct m6e_nano_config *cfg = dev->config;
+
+		if (cfg->enable_gpio.port == NULL) {
+			return -ENOTSUP;
+		}
+		ret = gpio_pin_set_dt(&cfg->enable_gpio, 0);
+#else
+		return -ENOTSUP;
+#endif
+	} else {
+		ret = _m6e_nano_send_power_mode(dev, TMR_SR_POWER_MODE_MAX_SAVE);
+	}
+
+	if (ret == 0) {
+		data->asleep = true;
+		data->sleep_method = method;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Put the UART back to its rate at init, which a module runs at after a reset, so the
+ * remembered baud rate can be sent to it again.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _m6e_nano_reset_baud(const struct device *dev)
+{
+#ifdef CONFIG_UART_USE_RUNTIME_CONFIGURE
+	const struct m6e_nano_config *cfg = dev->config;
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct uart_config uart_cfg;
+
+	if (data->boot_baud == 0 || uart_config_get(cfg->uart_dev, &uart_cfg) < 0 ||
+	    uart_cfg.baudrate == data->boot_baud) {
+		return;
+	}
+
+	uart_cfg.baudrate = data->boot_baud;
+	if (uart_configure(cfg->uart_dev, &uart_cfg) < 0) {
+		LOG_WRN("Failed to reset the UART baud rate.");
+	}
+#else
+	ARG_UNUSED(dev);
+#endif
+}
+
+/**
+ * @brief Wake the module from _m6e_nano_sleep(). A module that was powered down boots with its
+ * defaults and gets all remembered settings again, otherwise the configured power mode (full
+ * power by default) is restored. Does nothing if the module is awake.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int _m6e_nano_resume(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	uint8_t mode = TMR_SR_POWER_MODE_FULL;
+
+	if (!data->asleep) {
+		return 0;
+	}
+	data->asleep = false;
+
+	if (data->sleep_method == M6E_NANO_SLEEP_DISABLE) {
+#ifdef CONFIG_GPIO
+		const struct m6e_nano_config *cfg = dev->config;
+
+		// The startup wait is done by the first command
+		_m6e_nano_expect_startup(dev);
+		gpio_pin_set_dt(&cfg->enable_gpio, 1);
+#endif
+		_m6e_nano_reset_baud(dev);
+		return _m6e_nano_apply_settings(dev, false);
+	}
+
+	if (data->settings.valid & M6E_NANO_SETTING_POWER_MODE) {
+		mode = data->settings.power_mode;
+	}
+
+	_m6e_nano_wake(dev);
+
+	return _m6e_nano_send_power_mode(dev, mode);
+}
+
+/**
+ * @brief Set the antenna port of the M6E Nano.
+ *
+ * @param dev UART peripheral device.
+ */
+int m6e_nano_set_antenna_port(const struct device *dev)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t antenna = drv_data->settings.antenna;
+	uint8_t data[2] = {0x01, 0x01};
+
+	// TX and RX port, port 1 unless configured otherwise
+	if (antenna != 0) {
+		data[0] = antenna >> 4;
+		data[1] = antenna & 0x0F;
+	}
+	drv_data->settings.valid |= M6E_NANO_SETTING_ANTENNA;
+
+	return m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_ANTENNA_PORT, data, sizeof(data),
+					  true);
+}
+
+/**
+ * @brief Measure the return loss of the antenna ports of the module.
+ *
+ * @param dev UART peripheral device.
+ * @param loss Return loss in dB, indexed by port number - 1. Ports the module does not report
+ * are set to 0.
+ * @param count Number of entries of loss.
+ * @return int Number of ports reported on success, negative errno otherwise.
+ */
+int m6e_nano_get_return_loss(const struct device *dev, uint8_t *loss, uint8_t count)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t *msg = drv_data->response.data;
+	uint8_t data[] = {0x06}; // Return loss of every port
+	int reported = 0;
+	int ret;
+
+	ret = _m6e_nano_command(dev, TMR_SR_OPCODE_GET_ANTENNA_PORT, data, sizeof(data));
+	if (ret < 0) {
+		return ret;
+	}
+
+	memset(loss, 0, count);
+
+	// [5] option, then one (port, return loss) pair per port
+	for (uint8_t x = 1; x + 1 < msg[1]; x += 2) {
+		uint8_t port = msg[5 + x];
+
+		if (port >= 1 && port <= count) {
+			loss[port - 1] = msg[5 + x + 1];
+			reported++;
+		}
+	}
+
+	return reported;
+}
+
+/**
+ * @brief Set the read power of the M6E Nano.
+ *
+ * @param dev UART peripheral device.
+ * @param power Power to set in centi-dBm, up to the maximum of the module (27dBm for the Nano).
+ */
+int m6e_nano_set_read_power(const struct device *dev, uint16_t power)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+
+	if (power > drv_data->caps.max_read_power) {
+		LOG_DBG("Limit exceeded (%u), restricting to %u.", power,
+			drv_data->caps.max_read_power);
+		power = drv_data->caps.max_read_power;
+	}
+
+	drv_data->settings.read_power = power;
+	drv_data->settings.valid |= M6E_NANO_SETTING_READ_POWER;
+
+	uint8_t size = sizeof(power);
+	uint8_t data[size];
+	for (uint8_t x = 0; x < size; x++) {
+		data[x] = (uint8_t)(power >> (8 * (size - 1 - x)));
+	}
+
+	return m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_READ_TX_POWER, data, size, true);
+}
+
+/**
+ * @brief Set the write power of the M6E Nano, used for tag write, lock and kill operations.
+ *
+ * @param dev UART peripheral device.
+ * @param power Power to set in centi-dBm, up to the maximum read power of the module.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_write_power(const struct device *dev, uint16_t power)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t data[2];
+
+	if (power > drv_data->caps.max_read_power) {
+		LOG_DBG("Limit exceeded (%u), restricting to %u.", power,
+			drv_data->caps.max_read_power);
+		power = drv_data->caps.max_read_power;
+	}
+
+	drv_data->settings.write_power = power;
+	drv_data->settings.valid |= M6E_NANO_SETTING_WRITE_POWER;
+
+	data[0] = power >> 8;
+	data[1] = power & 0xFF;
+
+	return m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_WRITE_TX_POWER, data,
+					  sizeof(data), true);
+}
+
+/**
+ * @brief Start a continuous search on the module.
+ *
+ * @param dev UART peripheral device.
+ * @param tm_option TM option byte, a combination of TMR_SR_TM_OPTION_*.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _m6e_nano_start_search(const struct device *dev, uint8_t tm_option)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	int ret;
+
+	m6e_nano_disable_read_filter(dev);
+
+	// Timestamps of the new stream count from 0 again, the drift of the module clock holds
+	drv_data->clock.anchored = false;
+
+	uint8_t data[M6E_NANO_START_SEARCH_LEN];
+	uint8_t size = m6e_nano_encode_start_search(data, tm_option);
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP, data, size,
+					 true);
+	if (ret == 0) {
+		drv_data->reading = true;
+		_m6e_nano_watchdog_start(dev);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Start a continuous read operation.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_start_reading(const struct device *dev)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+
+	int ret;
+
+	drv_data->settings.valid &= ~M6E_NANO_SETTING_TRIGGER;
+
+	ret = _m6e_nano_start_search(dev, TMR_SR_TM_OPTION_CONTINUOUS);
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+	if (ret == 0) {
+		m6e_nano_antenna_reading(dev, true);
+	}
+#endif
+
+	return ret;
+}
+
+/**
+ * @brief Check that the last response answers the given opcode with a success status.
+ *
+ * @param dev UART peripheral device.
+ * @param opcode Opcode of the command that was sent.
+ * @return int 0 on success, -EBADMSG for a response to another opcode, -EIO if the module
+ * reported an error.
+ */
+static int _m6e_nano_check_response(const struct device *dev, uint8_t opcode)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	uint8_t *msg = data->response.data;
+
+	if (msg[2] != opcode) {
+		return -EBADMSG;
+	}
+	if (msg[3] != 0x00 || msg[4] != 0x00) {
+		LOG_WRN("Opcode %X failed, status %02X%02X.", opcode, msg[3], msg[4]);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Send a command and check that the module accepted it. The response is left in the
+ * response buffer.
+ *
+ * @param dev UART peripheral device.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param size Length of the command data.
+ * @return int 0 on success, -EIO if the module reported an error, negative errno otherwise.
+ */
+int _m6e_nano_command(const struct device *dev, uint8_t opcode, const uint8_t *data,
+		      uint8_t size)
+{
+	int ret;
+
+	ret = m6e_nano_construct_command(dev, opcode, (uint8_t *)data, size, true);
+	if (ret == 0) {
+		ret = _m6e_nano_check_response(dev, opcode);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Send a command without waiting for its response, to do other work while the module
+ * processes it. Hold data->lock until _m6e_nano_command_wait(), so no other command is sent in
+ * between.
+ *
+ * @param dev UART peripheral device.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param size Length of the command data.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int _m6e_nano_command_send(const struct device *dev, uint8_t opcode, const uint8_t *data,
+			   uint8_t size)
+{
+	uint8_t command[M6E_NANO_BUF_SIZE];
+	int length;
+
+	length = m6e_nano_frame_encode(command, sizeof(command), opcode, data, size);
+	if (length < 0) {
+		return length;
+	}
+
+	return _m6e_nano_send_command(dev, command, length, false, 0);
+}
+
+/**
+ * @brief Wait for the response to a command sent with _m6e_nano_command_send() and check that
+ * the module accepted it. The response is left in the response buffer.
+ *
+ * @param dev UART peripheral device.
+ * @param opcode Opcode of the command.
+ * @param timeout_ms Longest wait for the response.
+ * @return int 0 on success, -EIO if the module reported an error, negative errno otherwise.
+ */
+int _m6e_nano_command_wait(const struct device *dev, uint8_t opcode, int32_t timeout_ms)
+{
+	int ret;
+
+	ret = _m6e_nano_wait_response(dev, timeout_ms);
+	if (ret == 0) {
+		ret = _m6e_nano_check_response(dev, opcode);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Switch the module, then the UART, to a baud rate, limited to the maximum of the
+ * module.
+ *
+ * @param dev UART peripheral device.
+ * @param baud Baud rate.
+ * @return int 0 on success, -ENOTSUP without runtime UART configuration, negative errno
+ * otherwise.
+ */
+int _m6e_nano_switch_baud(const struct device *dev, uint32_t baud)
+{
+#ifdef CONFIG_UART_USE_RUNTIME_CONFIGURE
+	const struct m6e_nano_config *cfg = dev->config;
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct uart_config uart_cfg;
+	int ret;
+
+	ret = uart_config_get(cfg->uart_dev, &uart_cfg);
+	if (ret < 0) {
+		return ret;
+	}
+
+	baud = MIN(baud, data->caps.max_baud);
+	if (uart_cfg.baudrate == baud) {
+		return 0;
+	}
+
+	uint8_t rate[] = {baud >> 24, baud >> 16, baud >> 8, baud};
+
+	// The module answers at the old rate, then listens at the new one
+	ret = _m6e_nano_command(dev, TMR_SR_OPCODE_SET_BAUD_RATE, rate, sizeof(rate));
+	if (ret < 0) {
+		return ret;
+	}
+	uart_cfg.baudrate = baud;
+
+	ret = uart_configure(cfg->uart_dev, &uart_cfg);
+	if (ret == 0) {
+		data->settings.baud = baud;
+		data->settings.valid |= M6E_NANO_SETTING_BAUD;
+	}
+
+	return ret;
+#else
+	ARG_UNUSED(dev);
+	ARG_UNUSED(baud);
+
+	return -ENOTSUP;
+#endif
+}
+
+/**
+ * @brief Read a single tag, blocking until the module finds one or timeout_ms elapses. Faster
+ * to a first read than starting a continuous search, for point-of-use scanning. Call it while
+ * not reading.
+ *
+ * @param dev UART peripheral device.
+ * @param timeout_ms Time the module searches for a tag.
+ * @param metadata Tag read metadata to return, bitmask of M6E_NANO_METADATA_*. Flags the module
+ * does not support are dropped.
+ * @param select Tags to read, NULL for any tag.
+ * @param tag Tag read.
+ * @return int 0 on success, -ENODATA if no tag was found, -EBUSY while reading, -EINVAL for an
+ * invalid select, negative errno otherwise.
+ */
+int m6e_nano_read_single(const struct device *dev, uint16_t timeout_ms, uint16_t metadata,
+			 const struct m6e_nano_select *select, struct m6e_nano_tag *tag)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t *msg = drv_data->response.data;
+	uint8_t data[M6E_NANO_BUF_SIZE - 5];
+	uint8_t command[M6E_NANO_BUF_SIZE];
+	int length;
+	int ret;
+
+	if (drv_data->reading) {
+		return -EBUSY;
+	}
+
+	length = m6e_nano_encode_read_single(data, sizeof(data), timeout_ms,
+					     metadata & drv_data->caps.metadata, select);
+	if (length < 0) {
+		return length;
+	}
+	length = m6e_nano_frame_encode(command, sizeof(command), TMR_SR_OPCODE_READ_TAG_ID_SINGLE,
+				       data, length);
+
+	// The module answers once it found a tag or searched for timeout_ms
+	ret = _m6e_nano_send_command(dev, command, length, true,
+				     timeout_ms + CFG_M6E_NANO_SERIAL_TIMEOUT);
+	if (ret < 0) {
+		return ret;
+	}
+	if (msg[2] == TMR_SR_OPCODE_READ_TAG_ID_SINGLE &&
+	    ((msg[3] << 8) | msg[4]) == M6E_NANO_STATUS_NO_TAG) {
+		return -ENODATA;
+	}
+	ret = _m6e_nano_check_response(dev, TMR_SR_OPCODE_READ_TAG_ID_SINGLE);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return m6e_nano_decode_single(msg, tag);
+}
+
+/**
+ * @brief Read the level of the module's user GPIO pins.
+ *
+ * @param dev UART peripheral device.
+ * @param states Bitmask of pin levels, bit 0 is GPIO1.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_get_gpi(const struct device *dev, uint8_t *states)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t *msg = drv_data->response.data;
+	uint8_t data[] = {0x01}; // Report id, direction and level of every pin
+	int ret;
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_GET_USER_GPIO_INPUTS, data,
+					 sizeof(data), true);
+	if (ret == 0) {
+		ret = _m6e_nano_check_response(dev, TMR_SR_OPCODE_GET_USER_GPIO_INPUTS);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	// [5] option, then one (id, direction, level) triplet per pin
+	*states = 0;
+	for (uint8_t x = 1; x + 2 < msg[1]; x += 3) {
+		uint8_t pin = msg[5 + x];
+
+		if (pin >= 1 && pin <= 8 && msg[5 + x + 2]) {
+			*states |= BIT(pin - 1);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Drive one of the module's user GPIO pins.
+ *
+ * @param dev UART peripheral device.
+ * @param pin Pin number, 1 to M6E_NANO_GPIO_COUNT.
+ * @param level Level to drive.
+ * @return int 0 on success, -EINVAL for an invalid pin, negative errno otherwise.
+ */
+int m6e_nano_set_gpo(const struct device *dev, uint8_t pin, bool level)
+{
+	uint8_t data[] = {pin, level ? 0x01 : 0x00};
+	int ret;
+
+	if (pin < 1 || pin > M6E_NANO_GPIO_COUNT) {
+		return -EINVAL;
+	}
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_USER_GPIO_OUTPUTS, data,
+					 sizeof(data), true);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return _m6e_nano_check_response(dev, TMR_SR_OPCODE_SET_USER_GPIO_OUTPUTS);
+}
+
+/**
+ * @brief Configure one of the module's user GPIO pins as an input or an output.
+ *
+ * @param dev UART peripheral device.
+ * @param pin Pin number, 1 to M6E_NANO_GPIO_COUNT.
+ * @param output Whether the pin is an output.
+ * @param level Initial level of an output.
+ * @return int 0 on success, -EINVAL for an invalid pin, negative errno otherwise.
+ */
+int m6e_nano_configure_gpio(const struct device *dev, uint8_t pin, bool output, bool level)
+{
+	uint8_t data[] = {0x01, pin, output ? 0x01 : 0x00, level ? 0x01 : 0x00};
+	int ret;
+
+	if (pin < 1 || pin > M6E_NANO_GPIO_COUNT) {
+		return -EINVAL;
+	}
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_USER_GPIO_OUTPUTS, data,
+					 sizeof(data), true);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return _m6e_nano_check_response(dev, TMR_SR_OPCODE_SET_USER_GPIO_OUTPUTS);
+}
+
+/**
+ * @brief Arm a GPI-triggered continuous read.
+ *
+ * @param dev UART peripheral device.
+ * @param pin Module input that starts reading, 1 to M6E_NANO_GPIO_COUNT.
+ * @return int 0 on success, -EINVAL for an invalid pin, negative errno otherwise.
+ */
+int m6e_nano_start_triggered_reading(const struct device *dev, uint8_t pin)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	int ret;
+
+	if (pin < 1 || pin > M6E_NANO_GPIO_COUNT) {
+		return -EINVAL;
+	}
+
+	ret = m6e_nano_configure_gpio(dev, pin, false, false);
+	if (ret == 0) {
+		ret = _m6e_nano_set_config(dev, TMR_SR_CONFIGURATION_TRIGGER_READ_GPIO, pin);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	drv_data->settings.trigger_pin = pin;
+	drv_data->settings.valid |= M6E_NANO_SETTING_TRIGGER;
+
+	return _m6e_nano_start_search(dev, TMR_SR_TM_OPTION_CONTINUOUS |
+						   TMR_SR_TM_OPTION_TRIGGER_READ);
+}
+
+/**
+ * @brief Set the operating region of the M6E Nano. This controls the transmission frequency of the
+ * RFID reader.
+ *
+ * @param dev UART peripheral device.
+ * @param region Operating region to set.
+ */
+int m6e_nano_set_region(const struct device *dev, uint8_t region)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+
+	drv_data->settings.region = region;
+	drv_data->settings.valid |= M6E_NANO_SETTING_REGION;
+	// The module loads the region's default hop table and LBT settings
+	drv_data->settings.valid &= ~(M6E_NANO_SETTING_HOP_TABLE | M6E_NANO_SETTING_LBT);
+
+	return m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_REGION, &region, sizeof(region),
+					  true);
+}
+
+/**
+ * @brief Retrieve the operating region of the M6E Nano.
+ *
+ * @param dev UART peripheral device.
+ * @param region Current region.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_get_region(const struct device *dev, uint8_t *region)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t data[] = {};
+	int ret;
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_GET_REGION, data, sizeof(data), true);
+	if (ret == 0) {
+		ret = _m6e_nano_check_response(dev, TMR_SR_OPCODE_GET_REGION);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	*region = drv_data->response.data[5];
+
+	return 0;
+}
+
+/**
+ * @brief Retrieve the frequency hop table of the M6E Nano.
+ *
+ * @param dev UART peripheral device.
+ * @param freqs Channel frequencies in kHz.
+ * @param count Capacity of freqs on entry, number of channels on return.
+ * @return int 0 on success, -ENOMEM if freqs is too small, negative errno otherwise.
+ */
+int m6e_nano_get_hop_table(const struct device *dev, uint32_t *freqs, size_t *count)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t *msg = drv_data->response.data;
+	uint8_t data[] = {};
+	uint8_t channels;
+	int ret;
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_GET_FREQ_HOP_TABLE, data, sizeof(data),
+					 true);
+	if (ret == 0) {
+		ret = _m6e_nano_check_response(dev, TMR_SR_OPCODE_GET_FREQ_HOP_TABLE);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	channels = msg[1] / 4;
+	if (channels > *count) {
+		return -ENOMEM;
+	}
+
+	for (uint8_t i = 0; i < channels; i++) {
+		freqs[i] = 0;
+		for (uint8_t x = 0; x < 4; x++) {
+			freqs[i] |= (uint32_t)msg[5 + (i * 4) + x] << (8 * (3 - x));
+		}
+	}
+	*count = channels;
+
+	return 0;
+}
+
+/**
+ * @brief Set the frequency hop table of the M6E Nano.
+ *
+ * @param dev UART peripheral device.
+ * @param freqs Channel frequencies in kHz.
+ * @param count Number of channels, 1 to M6E_NANO_MAX_HOP_CHANNELS.
+ * @return int 0 on success, -EINVAL for an invalid count, negative errno otherwise.
+ */
+int m6e_nano_set_hop_table(const struct device *dev, const uint32_t *freqs, size_t count)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t data[M6E_NANO_MAX_HOP_CHANNELS * 4];
+	int ret;
+
+	if (count == 0 || count > M6E_NANO_MAX_HOP_CHANNELS) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		for (uint8_t x = 0; x < 4; x++) {
+			data[(i * 4) + x] = (uint8_t)(freqs[i] >> (8 * (3 - x)));
+		}
+	}
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_FREQ_HOP_TABLE, data, count * 4,
+					 true);
+	if (ret == 0) {
+		ret = _m6e_nano_check_response(dev, TMR_SR_OPCODE_SET_FREQ_HOP_TABLE);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (freqs != drv_data->settings.hop_table) {
+		memcpy(drv_data->settings.hop_table, freqs, count * sizeof(*freqs));
+	}
+	drv_data->settings.hop_count = count;
+	drv_data->settings.valid |= M6E_NANO_SETTING_HOP_TABLE;
+
+	return 0;
+}
+
+/**
+ * @brief Retrieve the time spent on each channel before hopping.
+ *
+ * @param dev UART peripheral device.
+ * @param hop_time Hop time in ms.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_get_hop_time(const struct device *dev, uint32_t *hop_time)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t *msg = drv_data->response.data;
+	uint8_t data[] = {TMR_SR_HOP_TABLE_OPTION_HOP_TIME};
+	int ret;
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_GET_FREQ_HOP_TABLE, data, sizeof(data),
+					 true);
+	if (ret == 0) {
+		ret = _m6e_nano_check_response(dev, TMR_SR_OPCODE_GET_FREQ_HOP_TABLE);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	// [5] option, [6 to 9] hop time
+	*hop_time = 0;
+	for (uint8_t x = 0; x < 4; x++) {
+		*hop_time |= (uint32_t)msg[6 + x] << (8 * (3 - x));
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Set the time spent on each channel before hopping.
+ *
+ * @param dev UART peripheral device.
+ * @param hop_time Hop time in ms.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_hop_time(const struct device *dev, uint32_t hop_time)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t data[5];
+	int ret;
+
+	data[0] = TMR_SR_HOP_TABLE_OPTION_HOP_TIME;
+	for (uint8_t x = 0; x < 4; x++) {
+		data[1 + x] = (uint8_t)(hop_time >> (8 * (3 - x)));
+	}
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_FREQ_HOP_TABLE, data, sizeof(data),
+					 true);
+	if (ret == 0) {
+		ret = _m6e_nano_check_response(dev, TMR_SR_OPCODE_SET_FREQ_HOP_TABLE);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	drv_data->settings.hop_time = hop_time;
+	drv_data->settings.valid |= M6E_NANO_SETTING_HOP_TIME;
+
+	return 0;
+}
+
+/**
+ * @brief Configure listen-before-talk for the current region.
+ *
+ * @param dev UART peripheral device.
+ * @param enable Whether to listen before transmitting.
+ * @param threshold Channel busy threshold in dBm.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_lbt(const struct device *dev, bool enable, int8_t threshold)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t region = drv_data->settings.region;
+	int ret = 0;
+
+	if (!(drv_data->settings.valid & M6E_NANO_SETTING_REGION)) {
+		ret = m6e_nano_get_region(dev, &region);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	uint8_t data_enable[] = {region, TMR_SR_REGION_CONFIGURATION_LBT_ENABLED, enable};
+	uint8_t data_threshold[] = {region, TMR_SR_REGION_CONFIGURATION_LBT_THRESHOLD,
+				    (uint8_t)threshold};
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_REGION, data_enable,
+					 sizeof(data_enable), true);
+	if (ret == 0) {
+		ret = _m6e_nano_check_response(dev, TMR_SR_OPCODE_SET_REGION);
+	}
+	if (ret == 0 && enable) {
+		ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_REGION, data_threshold,
+						 sizeof(data_threshold), true);
+	}
+	if (ret == 0 && enable) {
+		ret = _m6e_nano_check_response(dev, TMR_SR_OPCODE_SET_REGION);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	drv_data->settings.lbt = enable;
+	drv_data->settings.lbt_threshold = threshold;
+	drv_data->settings.valid |= M6E_NANO_SETTING_LBT;
+
+	return 0;
+}
+
+#ifdef CONFIG_M6E_NANO_WATCHLIST
+/**
+ * @brief Match a tag read against the watchlist.
+ *
+ * @param dev UART peripheral device.
+ * @param epc EPC of the read.
+ * @param len EPC length, 0 if the frame holds no valid EPC.
+ * @return true if the read is passed on, always without a watchlist.
+ */
+static bool _m6e_nano_watch_tag(const struct device *dev, const uint8_t *epc, uint8_t len)
+{
+	struct m6e_nano_watch *watch = &((struct m6e_nano_data *)dev->data)->watch;
+	k_spinlock_key_t key = k_spin_lock(&watch->lock);
+	bool hit = true;
+
+	if (watch->list.header != NULL) {
+		hit = m6e_nano_watchlist_find(&watch->list, epc, len, &watch->data) == 0;
+		if (hit) {
+			watch->hits++;
+		} else {
+			watch->misses++;
+		}
+	}
+	k_spin_unlock(&watch->lock, key);
+
+	return hit;
+}
+
+/**
+ * @brief Only pass the tag reads of a watchlist on. m6e_nano_parse_response() returns
+ * RESPONSE_IS_TAGFILTERED for the other reads, before they reach inventory rounds. The index is
+ * built by the host tool m6e_nano_index and used in place, so it can stay in memory-mapped
+ * flash. Requires CONFIG_M6E_NANO_WATCHLIST.
+ *
+ * @param dev UART peripheral device.
+ * @param index Index, 4-byte aligned, valid until replaced. NULL to pass every read on.
+ * @param size Size of the index.
+ * @return int 0 on success, -EINVAL for a malformed index.
+ */
+int m6e_nano_set_watchlist(const struct device *dev, const void *index, size_t size)
+{
+	struct m6e_nano_watch *watch = &((struct m6e_nano_data *)dev->data)->watch;
+	struct m6e_nano_watchlist list = {0};
+	k_spinlock_key_t key;
+
+	if (index != NULL) {
+		int ret = m6e_nano_watchlist_open(&list, index, size);
+
+		if (ret < 0) {
+			return ret;
+		}
+		LOG_DBG("Watchlist of %u EPCs.", list.header->count);
+	}
+
+	key = k_spin_lock(&watch->lock);
+	watch->list = list;
+	watch->hits = 0;
+	watch->misses = 0;
+	k_spin_unlock(&watch->lock, key);
+
+	return 0;
+}
+
+/**
+ * @brief Retrieve the value stored with the watchlist entry of the tag last parsed by
+ * m6e_nano_parse_response(). Requires CONFIG_M6E_NANO_WATCHLIST.
+ *
+ * @param dev UART peripheral device.
+ * @return uint32_t Value of the entry.
+ */
+uint32_t m6e_nano_get_tag_watch_data(const struct device *dev)
+{
+	return ((struct m6e_nano_data *)dev->data)->watch.data;
+}
+
+/**
+ * @brief Retrieve the watchlist counters. Requires CONFIG_M6E_NANO_WATCHLIST.
+ *
+ * @param dev UART peripheral device.
+ * @param stats Destination for the counters.
+ */
+void m6e_nano_get_watchlist_stats(const struct device *dev,
+				  struct m6e_nano_watchlist_stats *stats)
+{
+	struct m6e_nano_watch *watch = &((struct m6e_nano_data *)dev->data)->watch;
+	k_spinlock_key_t key = k_spin_lock(&watch->lock);
+
+	stats->entries = watch->list.header != NULL ? watch->list.header->count : 0;
+	stats->hits = watch->hits;
+	stats->misses = watch->misses;
+	k_spin_unlock(&watch->lock, key);
+}
+#endif
+
+#ifdef CONFIG_M6E_NANO_GS1
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_M6E_NANO_GS1_SKUS),
+	     "CONFIG_M6E_NANO_GS1_SKUS must be a power of two");
+
+/**
+ * @brief Count an SGTIN-96 read against its GTIN. Other EPCs are not counted.
+ *
+ * @param dev UART peripheral device.
+ * @param epc EPC of the read.
+ * @param len EPC length in bytes.
+ */
+static void _m6e_nano_count_sku(const struct device *dev, const uint8_t *epc, uint8_t len)
+{
+	struct m6e_nano_skus *skus = &((struct m6e_nano_data *)dev->data)->skus;
+	struct m6e_nano_gs1 gs1;
+	k_spinlock_key_t key;
+
+	// Check the header first, most reads in a store are of a single scheme
+	if (len != M6E_NANO_GS1_EPC_LEN || epc[0] != M6E_NANO_GS1_SGTIN_96 ||
+	    m6e_nano_gs1_decode(epc, len, &gs1) < 0) {
+		return;
+	}
+
+	key = k_spin_lock(&skus->lock);
+	if (m6e_nano_sku_count(skus->skus, CONFIG_M6E_NANO_GS1_SKUS, m6e_nano_gs1_key(&gs1)) < 0) {
+		skus->dropped++;
+	}
+	k_spin_unlock(&skus->lock, key);
+}
+
+/**
+ * @brief Decode the EPC of the tag last parsed by m6e_nano_parse_response() as a GS1 EPC, taking
+ * its length from the PC word. Requires CONFIG_M6E_NANO_GS1.
+ *
+ * @param dev UART peripheral device.
+ * @param gs1 Decoded fields, see m6e_nano_gs1_key() for the GTIN of an SGTIN.
+ * @return int 0 on success, -EBADMSG for a malformed read or GS1 EPC, -ENOTSUP if the EPC is not
+ * of a 96-bit GS1 scheme.
+ */
+int m6e_nano_get_tag_gs1(const struct device *dev, struct m6e_nano_gs1 *gs1)
+{
+	struct m6e_nano_tag tag;
+	int ret;
+
+	ret = m6e_nano_get_tag(dev, &tag);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return m6e_nano_gs1_decode(tag.epc, tag.epc_len, gs1);
+}
+
+/**
+ * @brief Retrieve the read counters per GTIN, counted by m6e_nano_parse_response() for the
+ * SGTIN-96 reads it passes on. Requires CONFIG_M6E_NANO_GS1.
+ *
+ * @param dev UART peripheral device.
+ * @param skus Destination for the counters, in no particular order.
+ * @param max Size of skus.
+ * @param dropped Reads of GTINs that found every counter taken, may be NULL.
+ * @param reset Clear every counter, those past max included.
+ * @return size_t Number of counters copied.
+ */
+size_t m6e_nano_get_skus(const struct device *dev, struct m6e_nano_sku *skus, size_t max,
+			 uint32_t *dropped, bool reset)
+{
+	struct m6e_nano_skus *table = &((struct m6e_nano_data *)dev->data)->skus;
+	k_spinlock_key_t key = k_spin_lock(&table->lock);
+	size_t count = 0;
+
+	for (size_t i = 0; i < CONFIG_M6E_NANO_GS1_SKUS && count < max; i++) {
+		if (table->skus[i].key != 0) {
+			skus[count++] = table->skus[i];
+		}
+	}
+	if (dropped != NULL) {
+		*dropped = table->dropped;
+	}
+	if (reset) {
+		memset(table->skus, 0, sizeof(table->skus));
+		table->dropped = 0;
+	}
+	k_spin_unlock(&table->lock, key);
+
+	return count;
+}
+#endif
+
+/**
+ * @brief Retrieve the number of tag reads per channel.
+ *
+ * @param dev UART peripheral device.
+ * @param stats Per-channel statistics, in order of first read.
+ * @param count Capacity of stats on entry, number of channels on return.
+ * @return int 0 on success, -ENOTSUP if channel statistics are disabled.
+ */
+int m6e_nano_get_channel_stats(const struct device *dev, struct m6e_nano_channel_stats *stats,
+			       size_t *count)
+{
+#ifdef CONFIG_M6E_NANO_CHANNEL_STATS
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->channel_lock);
+
+	*count = MIN(*count, data->channel_count);
+	memcpy(stats, data->channels, *count * sizeof(*stats));
+	k_spin_unlock(&data->channel_lock, key);
+
+	return 0;
+#else
+	ARG_UNUSED(dev);
+	ARG_UNUSED(stats);
+	*count = 0;
+
+	return -ENOTSUP;
+#endif
+}
+
+/**
+ * @brief Clear the per-channel statistics.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_reset_channel_stats(const struct device *dev)
+{
+#ifdef CONFIG_M6E_NANO_CHANNEL_STATS
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->channel_lock);
+
+	data->channel_count = 0;
+	data->channel_overflows = 0;
+	k_spin_unlock(&data->channel_lock, key);
+#else
+	ARG_UNUSED(dev);
+#endif
+}
+
+/**
+ * @brief Restrict the hop table to the channels that produced at least min_reads tag reads.
+ *
+ * @param dev UART peripheral device.
+ * @param min_reads Reads a channel needs to be kept.
+ * @return int Number of channels kept, -ENODATA if no channel qualifies, negative errno
+ * otherwise.
+ */
+int m6e_nano_prune_hop_table(const struct device *dev, uint32_t min_reads)
+{
+#ifdef CONFIG_M6E_NANO_CHANNEL_STATS
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	uint32_t table[M6E_NANO_MAX_HOP_CHANNELS];
+	size_t count = ARRAY_SIZE(table);
+	size_t kept = 0;
+	int ret;
+
+	ret = m6e_nano_get_hop_table(dev, table, &count);
+	if (ret < 0) {
+		return ret;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		k_spinlock_key_t key = k_spin_lock(&data->channel_lock);
+		uint32_t reads = 0;
+
+		for (uint8_t c = 0; c < data->channel_count; c++) {
+			if (data->channels[c].freq == table[i]) {
+				reads = data->channels[c].reads;
+				break;
+			}
+		}
+		k_spin_unlock(&data->channel_lock, key);
+
+		if (reads >= min_reads) {
+			table[kept++] = table[i];
+		}
+	}
+
+	if (kept == 0) {
+		return -ENODATA;
+	}
+
+	ret = m6e_nano_set_hop_table(dev, table, kept);
+
+	return ret < 0 ? ret : (int)kept;
+#else
+	ARG_UNUSED(dev);
+	ARG_UNUSED(min_reads);
+
+	return -ENOTSUP;
+#endif
+}
+
+/**
+ * @brief Derive the capabilities of the module from its version, or conservative defaults that
+ * every M6E family module supports if the version is unknown.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _m6e_nano_update_capabilities(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_capabilities *caps = &data->caps;
+
+	caps->max_baud = 115200;
+	caps->max_read_power = 2700;
+	caps->metadata = M6E_NANO_METADATA_READ_COUNT | M6E_NANO_METADATA_RSSI |
+			 M6E_NANO_METADATA_ANTENNA | M6E_NANO_METADATA_FREQUENCY |
+			 M6E_NANO_METADATA_TIMESTAMP | M6E_NANO_METADATA_PHASE |
+			 M6E_NANO_METADATA_PROTOCOL | M6E_NANO_METADATA_DATA;
+	caps->tag_buffer = false;
+	caps->embedded_tagop = false;
+
+	if (!data->has_version) {
+		return;
+	}
+
+	switch (data->version.hardware >> 24) {
+	case TMR_SR_MODEL_M6E:
+		caps->max_read_power = 3150;
+		break;
+	case TMR_SR_MODEL_M6E_MICRO:
+		caps->max_read_power = 3000;
+		break;
+	case TMR_SR_MODEL_M6E_NANO:
+		break;
+	default:
+		LOG_WRN("Unknown module %08X, using default capabilities.", data->version.hardware);
+		return;
+	}
+
+	caps->max_baud = 921600;
+	caps->tag_buffer = true;
+	caps->embedded_tagop = true;
+
+	if (data->version.fw_version >= M6E_NANO_FW_EXTENDED_METADATA) {
+		caps->metadata |= M6E_NANO_METADATA_GPIO | M6E_NANO_METADATA_GEN2_Q |
+				  M6E_NANO_METADATA_GEN2_LF | M6E_NANO_METADATA_GEN2_TARGET;
+	}
+}
+
+/**
+ * @brief Retrieve the version of the M6E Nano and update the capabilities derived from it.
+ *
+ * @param dev UART peripheral device.
+ * @param version Decoded version, may be NULL.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_get_version(const struct device *dev, struct m6e_nano_version *version)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t data[] = {};
+	int ret;
+
+	ret = m6e_nano_construct_command(dev, TMR_SR_OPCODE_VERSION, data, sizeof(data), true);
+	if (ret == 0) {
+		ret = _m6e_nano_check_response(dev, TMR_SR_OPCODE_VERSION);
+	}
+	if (ret == 0) {
+		ret = m6e_nano_decode_version(drv_data->response.data, &drv_data->version);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	drv_data->has_version = true;
+	_m6e_nano_update_capabilities(dev);
+
+	if (version != NULL) {
+		*version = drv_data->version;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Get the capabilities of the M6E Nano, from the version cached at init. The module is
+ * asked for its version if that failed.
+ *
+ * @param dev UART peripheral device.
+ * @param caps Capabilities of the module.
+ * @return int 0 on success, negative errno if the version could not be read. caps then holds
+ * conservative defaults.
+ */
+int m6e_nano_get_capabilities(const struct device *dev, struct m6e_nano_capabilities *caps)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	int ret = 0;
+
+	if (!data->has_version) {
+		ret = m6e_nano_get_version(dev, NULL);
+	}
+
+	*caps = data->caps;
+
+	return ret;
+}
+
+/**
+ * @brief Set the tag protocol of the M6E Nano.
+ *
+ * @param dev UART peripheral device.
+ * @param protocol Tag protocol to set.
+ */
+int m6e_nano_set_tag_protocol(const struct device *dev, uint8_t protocol)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	uint8_t data[2];
+	data[0] = 0; // Opcode expects padding for 16-bits
+	data[1] = protocol;
+
+	drv_data->settings.protocol = protocol;
+	drv_data->settings.valid |= M6E_NANO_SETTING_PROTOCOL;
+
+	return m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_TAG_PROTOCOL, data, sizeof(data),
+					  true);
+}
+
+/**
+ * @brief Set a Gen2 protocol parameter.
+ *
+ * @param dev UART peripheral device.
+ * @param param One of TMR_SR_GEN2_CONFIGURATION_*.
+ * @param value Parameter value.
+ * @param len Length of the value, at most 2.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _m6e_nano_set_gen2_param(const struct device *dev, uint8_t param, const uint8_t *value,
+				    uint8_t len)
+{
+	uint8_t data[4];
+
+	data[0] = TMR_TAG_PROTOCOL_GEN2;
+	data[1] = param;
+	memcpy(&data[2], value, len);
+
+	return m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_PROTOCOL_PARAM, data, len + 2,
+					  true);
+}
+
+/**
+ * @brief Set the Gen2 session used for inventory.
+ *
+ * @param dev UART peripheral device.
+ * @param session Session, 0 to 3.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_gen2_session(const struct device *dev, uint8_t session)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+
+	if (session > 3) {
+		return -EINVAL;
+	}
+
+	drv_data->settings.gen2_session = session;
+	drv_data->settings.valid |= M6E_NANO_SETTING_GEN2_SESSION;
+
+	return _m6e_nano_set_gen2_param(dev, TMR_SR_GEN2_CONFIGURATION_SESSION, &session, 1);
+}
+
+/**
+ * @brief Set the Gen2 inventory target flag.
+ *
+ * @param dev UART peripheral device.
+ * @param target One of M6E_NANO_GEN2_TARGET_*.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_gen2_target(const struct device *dev, uint8_t target)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	// Single target or both, then the target to start from
+	static const uint8_t values[][2] = {
+		[M6E_NANO_GEN2_TARGET_A] = {0x01, 0x00},
+		[M6E_NANO_GEN2_TARGET_B] = {0x01, 0x01},
+		[M6E_NANO_GEN2_TARGET_AB] = {0x00, 0x00},
+		[M6E_NANO_GEN2_TARGET_BA] = {0x00, 0x01},
+	};
+
+	if (target >= ARRAY_SIZE(values)) {
+		return -EINVAL;
+	}
+
+	drv_data->settings.gen2_target = target;
+	drv_data->settings.valid |= M6E_NANO_SETTING_GEN2_TARGET;
+
+	return _m6e_nano_set_gen2_param(dev, TMR_SR_GEN2_CONFIGURATION_TARGET, values[target], 2);
+}
+
+/**
+ * @brief Set the Gen2 Q algorithm.
+ *
+ * @param dev UART peripheral device.
+ * @param q Static Q, 0 to 15, or negative for dynamic Q.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_gen2_q(const struct device *dev, int8_t q)
+{
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+	// Dynamic, or static followed by the initial Q
+	uint8_t value[2] = {q < 0 ? 0x00 : 0x01, q};
+
+	if (q > 15) {
+		return -EINVAL;
+	}
+
+	drv_data->settings.gen2_q = q;
+	drv_data->settings.valid |= M6E_NANO_SETTING_GEN2_Q;
+
+	return _m6e_nano_set_gen2_param(dev, TMR_SR_GEN2_CONFIGURATION_Q, value, q < 0 ? 1 : 2);
 }
 
 /**
@@ -544,13 +2194,21 @@ void m6e_nano_get_write_power(const struct device *dev)
 }
 
 /**
- * @brief Set the baudrate of the M6E Nano.
+ * @brief Set the baudrate of the M6E Nano. The UART is left as is; the rate is remembered and
+ * sent first when the settings are restored.
  *
  * @param dev UART peripheral device.
- * @param baud_rate baudrate to set.
+ * @param baud_rate baudrate to set, limited to the maximum of the module.
  */
 void m6e_nano_set_baud(const struct device *dev, long baud_rate)
 {
+	struct m6e_nano_data *drv_data = (struct m6e_nano_data *)dev->data;
+
+	if (baud_rate > drv_data->caps.max_baud) {
+		LOG_WRN("Baud rate %ld unsupported, using %u.", baud_rate, drv_data->caps.max_baud);
+		baud_rate = drv_data->caps.max_baud;
+	}
+
 	uint8_t size = sizeof(baud_rate);
 	uint8_t data[size];
 	for (uint8_t x = 0; x < size; x++) {
@@ -559,6 +2217,9 @@ void m6e_nano_set_baud(const struct device *dev, long baud_rate)
 
 	LOG_DBG("Baud rate: %ld", baud_rate);
 
+	drv_data->settings.baud = baud_rate;
+	drv_data->settings.valid |= M6E_NANO_SETTING_BAUD;
+
 	m6e_nano_construct_command(dev, TMR_SR_OPCODE_SET_BAUD_RATE, data, size, true);
 }
 
@@ -580,6 +2241,243 @@ uint8_t m6e_nano_get_status(const struct device *dev)
 	return data->status;
 }
 
+/**
+ * @brief Send every remembered setting to the module, optionally restarting reading.
+ *
+ * @param dev UART peripheral device.
+ * @param start Whether to start continuous reading afterwards.
+ * @return int 0 on success, the first failing command's error otherwise.
+ */
+int _m6e_nano_apply_settings(const struct device *dev, bool start)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	const struct m6e_nano_settings settings = data->settings;
+	int ret = 0;
+
+	// First, as every other command is sent at this rate
+	if (settings.valid & M6E_NANO_SETTING_BAUD) {
+		ret = _m6e_nano_switch_baud(dev, settings.baud);
+		if (ret == -ENOTSUP) {
+			ret = 0; // The UART cannot follow, stay at the rate the module answers
+		}
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_PROTOCOL)) {
+		ret = m6e_nano_set_tag_protocol(dev, settings.protocol);
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_GEN2_SESSION)) {
+		ret = m6e_nano_set_gen2_session(dev, settings.gen2_session);
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_GEN2_TARGET)) {
+		ret = m6e_nano_set_gen2_target(dev, settings.gen2_target);
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_GEN2_Q)) {
+		ret = m6e_nano_set_gen2_q(dev, settings.gen2_q);
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_ANTENNA)) {
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+		ret = m6e_nano_antenna_apply(dev);
+#else
+		ret = m6e_nano_set_antenna_port(dev);
+#endif
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_REGION)) {
+		ret = m6e_nano_set_region(dev, settings.region);
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_HOP_TABLE)) {
+		ret = m6e_nano_set_hop_table(dev, settings.hop_table, settings.hop_count);
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_HOP_TIME)) {
+		ret = m6e_nano_set_hop_time(dev, settings.hop_time);
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_LBT)) {
+		ret = m6e_nano_set_lbt(dev, settings.lbt, settings.lbt_threshold);
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_READ_POWER)) {
+		ret = m6e_nano_set_read_power(dev, settings.read_power);
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_WRITE_POWER)) {
+		ret = m6e_nano_set_write_power(dev, settings.write_power);
+	}
+	if (ret == 0 && (settings.valid & M6E_NANO_SETTING_POWER_MODE)) {
+		ret = m6e_nano_set_power_mode(dev, settings.power_mode);
+	}
+	if (ret == 0 && start) {
+		if (settings.valid & M6E_NANO_SETTING_TRIGGER) {
+			ret = m6e_nano_start_triggered_reading(dev, settings.trigger_pin);
+		} else {
+			ret = m6e_nano_start_reading(dev);
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Re-apply the remembered settings and restart reading if it was active.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_restore_settings(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	bool reading = data->reading;
+
+	m6e_nano_stop_reading(dev);
+
+	return _m6e_nano_apply_settings(dev, reading);
+}
+
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+/**
+ * @brief Bring a reset or unresponsive module back to its configured state. Runs on the driver
+ * work queue, so it is serialized with the keep-alive watchdog.
+ *
+ * @param work Recovery work item of the driver instance.
+ */
+static void m6e_nano_recover_work_handler(struct k_work *work)
+{
+	struct m6e_nano_data *data = CONTAINER_OF(work, struct m6e_nano_data, recover_work);
+	const struct device *dev = data->dev;
+	bool reading = data->reading;
+	int ret = -EIO;
+
+	if (data->reset_pending) {
+		data->reset_pending = false;
+		LOG_WRN("Module reset detected.");
+		_m6e_nano_reset_baud(dev);
+		_m6e_nano_notify(dev, M6E_NANO_EVENT_RESET);
+	}
+
+	if (!data->supervised) {
+		return;
+	}
+
+	data->recovering = true;
+
+	for (uint8_t attempt = 0; attempt < CONFIG_M6E_NANO_RECOVERY_RETRIES; attempt++) {
+		m6e_nano_stop_reading(dev);
+		ret = _m6e_nano_apply_settings(dev, reading);
+		if (ret == 0) {
+			break;
+		}
+		LOG_WRN("Recovery attempt %u failed (%d).", attempt + 1, ret);
+	}
+
+	data->recovering = false;
+	data->cmd_timeout_streak = 0;
+
+	if (ret == 0) {
+		data->stats.recoveries++;
+		LOG_INF("Module recovered.");
+		_m6e_nano_notify(dev, M6E_NANO_EVENT_RECOVERED);
+		return;
+	}
+
+	data->stats.recovery_failures++;
+	LOG_ERR("Module recovery failed (%d).", ret);
+	_m6e_nano_notify(dev, M6E_NANO_EVENT_RECOVERY_FAILED);
+
+	// Keep the stream marked active so the watchdog tries again after a full timeout
+	if (reading) {
+		data->reading = true;
+		data->last_frame_ms = k_uptime_get_32();
+		_m6e_nano_watchdog_start(dev);
+	}
+}
+
+/**
+ * @brief Check that frames keep arriving while reading. A streaming module sends a keep-alive
+ * at least once per read cycle.
+ *
+ * @param work Watchdog work item of the driver instance.
+ */
+static void m6e_nano_watchdog_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct m6e_nano_data *data = CONTAINER_OF(dwork, struct m6e_nano_data, watchdog_work);
+
+	// A triggered read is silent until its input fires
+	if (!data->supervised || !data->reading ||
+	    (data->settings.valid & M6E_NANO_SETTING_TRIGGER)) {
+		return;
+	}
+
+	if ((k_uptime_get_32() - data->last_frame_ms) > CONFIG_M6E_NANO_KEEPALIVE_TIMEOUT_MS) {
+		data->stats.keepalive_misses++;
+		LOG_WRN("Keep-alive missed.");
+		_m6e_nano_notify(data->dev, M6E_NANO_EVENT_KEEPALIVE_LOST);
+		k_work_submit_to_queue(&m6e_nano_workq, &data->recover_work);
+		return; // Restarted by the recovery
+	}
+
+	k_work_reschedule_for_queue(&m6e_nano_workq, dwork,
+				    K_MSEC(CONFIG_M6E_NANO_KEEPALIVE_TIMEOUT_MS / 2));
+}
+#endif
+
+/**
+ * @brief Enable or disable supervision of the module.
+ *
+ * @param dev UART peripheral device.
+ * @param enable Whether to supervise the module.
+ * @return int 0 on success, -ENOTSUP if CONFIG_M6E_NANO_SUPERVISOR is disabled.
+ */
+int m6e_nano_set_supervised(const struct device *dev, bool enable)
+{
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	data->supervised = enable;
+	if (enable && data->reading) {
+		_m6e_nano_watchdog_start(dev);
+	} else if (!enable) {
+		k_work_cancel_delayable(&data->watchdog_work);
+	}
+
+	return 0;
+#else
+	ARG_UNUSED(dev);
+	ARG_UNUSED(enable);
+
+	return -ENOTSUP;
+#endif
+}
+
+/**
+ * @brief Retrieve a snapshot of the driver statistics.
+ *
+ * @param dev UART peripheral device.
+ * @param stats Destination for the statistics.
+ */
+void m6e_nano_get_stats(const struct device *dev, struct m6e_nano_stats *stats)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	memcpy(stats, &data->stats, sizeof(*stats));
+}
+
+/**
+ * @brief Take the next frame received for the data callback. m6e_nano_parse_response() and
+ * the tag accessors then read this frame.
+ *
+ * @param dev UART peripheral device.
+ * @return true if a frame was taken, false if none is left.
+ */
+bool m6e_nano_next_frame(const struct device *dev)
+{
+#ifdef CONFIG_M6E_NANO_COALESCE
+	return m6e_nano_coalesce_next(dev);
+#else
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	bool ready = data->frame_ready;
+
+	data->frame_ready = false;
+
+	return ready;
+#endif
+}
+
 /**
  * @brief Parse the tag response from the M6E Nano.
  *
@@ -615,15 +2513,17 @@ uint8_t m6e_nano_parse_response(const struct device *dev)
 	//   N] 00 00 00 00 00 00 00 00 00 00 15 45 = EPC ID [43, 44 + M + N] 45 E9 = EPC CRC [45,
 	//   46 + M + N] 56 1D = Message CRC
 
+	M6E_NANO_TRACE(dev, DEQUEUE);
+
 	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
-	uint8_t *msg = data->response.data;
+	uint8_t *msg = data->frame;
 	uint8_t msgLength = msg[1] + 7; // Add 7 (the header, length, opcode, status, and CRC) to
 					// the LEN field to get total bytes
-	LOG_DBG("Msg length: %d", msgLength);
 	uint8_t opCode = msg[2];
-	uint16_t messageCRC = _calculate_crc(
+	uint16_t messageCRC = m6e_nano_crc(
 		&msg[1],
 		msgLength - 3); // Ignore header (start spot 1), remove 3 bytes (header + 2 CRC)
+	M6E_NANO_TRACE(dev, CRC_DONE);
 	if ((msg[msgLength - 2] != (messageCRC >> 8)) ||
 	    (msg[msgLength - 1] != (messageCRC & 0xFF))) {
 		LOG_WRN("CRC error.");
@@ -638,9 +2538,12 @@ uint8_t m6e_nano_parse_response(const struct device *dev)
 				statusMsg |= (uint32_t)msg[3 + x] << (8 * (1 - x));
 			}
 
-			if (statusMsg == 0x0400) {
+			if (statusMsg == M6E_NANO_STATUS_KEEPALIVE) {
+#ifdef CONFIG_M6E_NANO_ROUNDS
+				m6e_nano_round_keepalive(dev);
+#endif
 				return (RESPONSE_IS_KEEPALIVE);
-			} else if (statusMsg == 0x0504) {
+			} else if (statusMsg == M6E_NANO_STATUS_TEMPTHROTTLE) {
 				return (RESPONSE_IS_TEMPTHROTTLE);
 			} else {
 				return (RESPONSE_IS_UNKNOWN);
@@ -650,6 +2553,31 @@ uint8_t m6e_nano_parse_response(const struct device *dev)
 		case 0x0a:
 			return (RESPONSE_IS_TEMPERATURE);
 		default:
+			// Counted and timed by the UART ISR as the frame completed
+			data->tag_time_us = data->frame_time_us;
+#if defined(CONFIG_M6E_NANO_ROUNDS) || defined(CONFIG_M6E_NANO_WATCHLIST) ||                       \
+    defined(CONFIG_M6E_NANO_GS1)
+			uint8_t epcOffset = 31 + _get_tag_data_bytes(dev);
+			uint8_t epcBytes = m6e_nano_get_tag_epc_bytes(dev);
+
+			// Skip EPC lengths that run past the message CRC
+			if (epcOffset + epcBytes > msgLength - 2) {
+				epcBytes = 0;
+			}
+#endif
+#ifdef CONFIG_M6E_NANO_WATCHLIST
+			if (!_m6e_nano_watch_tag(dev, &msg[epcOffset], epcBytes)) {
+				return (RESPONSE_IS_TAGFILTERED);
+			}
+#endif
+#ifdef CONFIG_M6E_NANO_GS1
+			_m6e_nano_count_sku(dev, &msg[epcOffset], epcBytes);
+#endif
+#ifdef CONFIG_M6E_NANO_ROUNDS
+			if (epcBytes > 0) {
+				m6e_nano_round_tag(dev, &msg[epcOffset], epcBytes);
+			}
+#endif
 			return (RESPONSE_IS_TAGFOUND);
 		}
 	} else {
@@ -658,6 +2586,73 @@ uint8_t m6e_nano_parse_response(const struct device *dev)
 	}
 }
 
+#ifdef CONFIG_PM_DEVICE
+/**
+ * @brief Power management action. Suspending stops reading, puts the module in its maximum
+ * power save mode and releases the UART reference taken at init; resuming takes it again and
+ * restarts reading if it was active. With PM device runtime, users share the module through
+ * pm_device_runtime_get() and pm_device_runtime_put().
+ *
+ * @param dev UART peripheral device.
+ * @param action Action to perform.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int m6e_nano_pm_action(const struct device *dev, enum pm_device_action action)
+{
+	const struct m6e_nano_config *cfg = dev->config;
+	struct m6e_nano_data *data = dev->data;
+	uint32_t start;
+	int ret = 0;
+
+	switch (action) {
+	case PM_DEVICE_ACTION_SUSPEND:
+		data->resume_reading = data->reading;
+
+		// Acknowledged first, tags still streaming would be taken for the sleep answers
+		ret = _m6e_nano_stop_reading(dev);
+		if (ret == 0) {
+			ret = _m6e_nano_sleep(dev, M6E_NANO_SLEEP_POWER_MODE);
+		}
+		if (ret < 0) {
+			LOG_WRN("Failed to suspend module (%d).", ret);
+			return ret;
+		}
+
+		uart_irq_rx_disable(cfg->uart_dev);
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+		pm_device_runtime_put(cfg->uart_dev);
+#endif
+		break;
+	case PM_DEVICE_ACTION_RESUME:
+		start = k_cycle_get_32();
+
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+		ret = pm_device_runtime_get(cfg->uart_dev);
+		if (ret < 0) {
+			return ret;
+		}
+#endif
+		data->response.len = 0;
+		data->status = RESPONSE_CLEAR;
+		uart_irq_rx_enable(cfg->uart_dev);
+
+		ret = _m6e_nano_resume(dev);
+		if (ret == 0 && data->resume_reading) {
+			ret = m6e_nano_start_reading(dev);
+		}
+
+		data->stats.resume_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+		data->stats.resume_us_max = MAX(data->stats.resume_us_max, data->stats.resume_us);
+		LOG_DBG("Resumed in %uus (%d).", data->stats.resume_us, ret);
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	return ret;
+}
+#endif
+
 /**
  * @brief Initialize the M6E Nano.
  *
@@ -673,6 +2668,14 @@ static int m6e_nano_init(const struct device *dev)
 		return -ENODEV;
 	}
 
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+	// The reader holds the UART while active, released and taken again by m6e_nano_pm_action()
+	if (pm_device_runtime_get(cfg->uart_dev) < 0) {
+		LOG_ERR("Bus device failed to resume");
+		return -EIO;
+	}
+#endif
+
 	while (uart_irq_rx_ready(cfg->uart_dev)) {
 		m6e_nano_uart_flush(cfg->uart_dev);
 	}
@@ -681,26 +2684,138 @@ static int m6e_nano_init(const struct device *dev)
 	rx->len = 0;
 	drv_data->status = RESPONSE_STARTUP;
 
+	k_mutex_init(&drv_data->lock);
+	k_sem_init(&drv_data->response_sem, 0, 1);
+	m6e_nano_clock_init(&drv_data->clock);
+	drv_data->frame = drv_data->response.data;
+	drv_data->dev = dev;
+
+#ifdef CONFIG_UART_USE_RUNTIME_CONFIGURE
+	struct uart_config uart_cfg;
+
+	if (uart_config_get(cfg->uart_dev, &uart_cfg) == 0) {
+		drv_data->boot_baud = uart_cfg.baudrate;
+	}
+#endif
+
+#ifdef CONFIG_GPIO
+	if (cfg->enable_gpio.port != NULL) {
+		if (!gpio_is_ready_dt(&cfg->enable_gpio)) {
+			LOG_ERR("Enable GPIO is not ready");
+			return -ENODEV;
+		}
+		// The module is powered until put to sleep
+		int err = gpio_pin_configure_dt(&cfg->enable_gpio, GPIO_OUTPUT_ACTIVE);
+
+		if (err < 0) {
+			return err;
+		}
+	}
+#endif
+
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	k_work_init(&drv_data->recover_work, m6e_nano_recover_work_handler);
+	k_work_init_delayable(&drv_data->watchdog_work, m6e_nano_watchdog_work_handler);
+#endif
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+	m6e_nano_round_init(dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_CAPTURE
+	m6e_nano_capture_init(dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+	m6e_nano_antenna_init(dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_RTIO
+	m6e_nano_rtio_init(dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_COALESCE
+	m6e_nano_coalesce_init(dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_ZBUS
+	m6e_nano_zbus_init(dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_BRIDGE
+	m6e_nano_bridge_init(dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_SCHEDULER
+	int ret = m6e_nano_sched_init(dev);
+
+	if (ret < 0) {
+		return ret;
+	}
+#endif
+
+	_m6e_nano_update_capabilities(dev);
+
 	uart_irq_callback_user_data_set(cfg->uart_dev, uart_rx_handler, (void *)dev);
 	uart_irq_rx_enable(cfg->uart_dev);
 
+#ifdef CONFIG_M6E_NANO_ASYNC_INIT
+	// The version probe and the devicetree configuration run from the driver work queue
+	m6e_nano_boot_init(dev);
+#elif defined(CONFIG_M6E_NANO_PROBE_VERSION)
+	// Cache the version, later calls to m6e_nano_get_capabilities() retry on failure
+	if (m6e_nano_get_version(dev, NULL) < 0) {
+		LOG_WRN("Module version unknown, using default capabilities.");
+	} else {
+		LOG_INF("M6E module %08X, firmware %08X.", drv_data->version.hardware,
+			drv_data->version.fw_version);
+	}
+#endif
+
 	return 0;
 }
 
 const static struct m6e_nano_api api = {
 	// .send_command = user_send_command,
 	.set_callback = user_set_command_callback,
+	.set_event_callback = user_set_event_callback,
 };
 
+// REGION_* and TMR_TAG_PROTOCOL_* value of the region and protocol properties, 0 without them
+#define M6E_NANO_DT_ENUM(inst, prop, prefix)                                                       \
+	COND_CODE_1(DT_INST_NODE_HAS_PROP(inst, prop),                                             \
+		    (UTIL_CAT(prefix, DT_INST_STRING_UPPER_TOKEN(inst, prop))), (0))
+
+#define M6E_NANO_BOOT_CONFIG(inst)                                                                 \
+	{                                                                                          \
+		.region = M6E_NANO_DT_ENUM(inst, region, REGION_),                                 \
+		.protocol = M6E_NANO_DT_ENUM(inst, protocol, TMR_TAG_PROTOCOL_),                   \
+		.read_power = DT_INST_PROP_OR(inst, read_power, -1),                               \
+		.write_power = DT_INST_PROP_OR(inst, write_power, -1),                             \
+		.baud = DT_INST_PROP_OR(inst, module_baud, 0),                                     \
+		.antenna = COND_CODE_1(DT_INST_NODE_HAS_PROP(inst, antenna),                       \
+				       ((DT_INST_PROP_BY_IDX(inst, antenna, 0) << 4) |             \
+					DT_INST_PROP_BY_IDX(inst, antenna, 1)),                    \
+				       (0)),                                                       \
+		.autostart = DT_INST_PROP(inst, autostart),                                        \
+	}
+
 #define M6E_NANO_DEFINE(inst)                                                                      \
 	static struct m6e_nano_data m6e_nano_data_##inst = {                                       \
 		.response.msg_len = 255,                                                           \
 	};                                                                                         \
 	static const struct m6e_nano_config m6e_nano_config_##inst = {                             \
 		.uart_dev = DEVICE_DT_GET(DT_INST_BUS(inst)),                                      \
+		IF_ENABLED(CONFIG_GPIO,                                                            \
+			   (.enable_gpio = GPIO_DT_SPEC_INST_GET_OR(inst, enable_gpios, {0}),      \
+			    .trigger_gpio = GPIO_DT_SPEC_INST_GET_OR(inst, trigger_gpios, {0}),))  \
+		IF_ENABLED(CONFIG_M6E_NANO_ASYNC_INIT, (.boot = M6E_NANO_BOOT_CONFIG(inst),))      \
 	};                                                                                         \
                                                                                                    \
-	DEVICE_DT_INST_DEFINE(inst, &m6e_nano_init, NULL, &m6e_nano_data_##inst,                   \
-			      &m6e_nano_config_##inst, POST_KERNEL, M6E_NANO_INIT_PRIORITY, &api);
+	PM_DEVICE_DT_INST_DEFINE(inst, m6e_nano_pm_action);                                        \
+                                                                                                   \
+	DEVICE_DT_INST_DEFINE(inst, &m6e_nano_init, PM_DEVICE_DT_INST_GET(inst),                   \
+			      &m6e_nano_data_##inst, &m6e_nano_config_##inst, POST_KERNEL,         \
+			      M6E_NANO_INIT_PRIORITY, &api);
 
 DT_INST_FOREACH_STATUS_OKAY(M6E_NANO_DEFINE)
\ No newline at end of file
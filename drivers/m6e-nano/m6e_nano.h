@@ -1,49 +1,31 @@
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+
+#ifdef CONFIG_M6E_NANO_RTIO
+#include <zephyr/rtio/rtio.h>
+#endif
+
+#ifdef CONFIG_M6E_NANO_ZBUS
+#include <zephyr/zbus/zbus.h>
+#endif
+
+#ifdef CONFIG_M6E_NANO_BRIDGE
+#include <zephyr/sys/ring_buffer.h>
+#endif
+
+#include "m6e_nano_capture.h"
+#include "m6e_nano_clock.h"
+#include "m6e_nano_gs1.h"
+#include "m6e_nano_proto.h"
+#include "m6e_nano_trace.h"
+#include "m6e_nano_watchlist.h"
 
 #ifndef M6E_NANO_H
 #define M6E_NANO_H
 
-#define M6E_NANO_BUF_SIZE 255
 #define M6E_NANO_MAX_TAGS 150
 
-// Packet header for M6E Nano
-#define TMR_START_HEADER 0xFF
-
-// Op codes for M6E Nano
-#define TMR_SR_OPCODE_VERSION                    0x03
-#define TMR_SR_OPCODE_VERSION_STARTUP            0x04
-#define TMR_SR_OPCODE_SET_BAUD_RATE              0x06
-#define TMR_SR_OPCODE_READ_TAG_ID_SINGLE         0x21
-#define TMR_SR_OPCODE_READ_TAG_ID_MULTIPLE       0x22
-#define TMR_SR_OPCODE_WRITE_TAG_ID               0x23
-#define TMR_SR_OPCODE_WRITE_TAG_DATA             0x24
-#define TMR_SR_OPCODE_KILL_TAG                   0x26
-#define TMR_SR_OPCODE_READ_TAG_DATA              0x28
-#define TMR_SR_OPCODE_CLEAR_TAG_ID_BUFFER        0x2A
-#define TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP      0x2F
-#define TMR_SR_OPCODE_GET_READ_TX_POWER          0x62
-#define TMR_SR_OPCODE_GET_WRITE_TX_POWER         0x64
-#define TMR_SR_OPCODE_GET_USER_GPIO_INPUTS       0x66
-#define TMR_SR_OPCODE_GET_POWER_MODE             0x68
-#define TMR_SR_OPCODE_GET_READER_OPTIONAL_PARAMS 0x6A
-#define TMR_SR_OPCODE_GET_PROTOCOL_PARAM         0x6B
-#define TMR_SR_OPCODE_SET_ANTENNA_PORT           0x91
-#define TMR_SR_OPCODE_SET_TAG_PROTOCOL           0x93
-#define TMR_SR_OPCODE_SET_READ_TX_POWER          0x92
-#define TMR_SR_OPCODE_SET_WRITE_TX_POWER         0x94
-#define TMR_SR_OPCODE_SET_USER_GPIO_OUTPUTS      0x96
-#define TMR_SR_OPCODE_SET_REGION                 0x97
-#define TMR_SR_OPCODE_SET_POWER_MODE             0x98
-#define TMR_SR_OPCODE_SET_READER_OPTIONAL_PARAMS 0x9A
-#define TMR_SR_OPCODE_SET_PROTOCOL_PARAM         0x9B
-
-// Power modes for M6E Nano
-#define TMR_SR_POWER_MODE_FULL     0x00
-#define TMR_SR_POWER_MODE_MIN_SAVE 0x01
-#define TMR_SR_POWER_MODE_MED_SAVE 0x02
-#define TMR_SR_POWER_MODE_MAX_SAVE 0x03
-
 // Number of ms before stop waiting for response from module
 #define COMMAND_TIME_OUT 2000
 
@@ -63,44 +45,66 @@
 #define RESPONSE_FAIL                  12
 #define RESPONSE_CLEAR                 13
 #define RESPONSE_STARTUP               14
+#define RESPONSE_IS_TAGFILTERED        15 // Tag read, but not on the watchlist
 
-// Define the allowed regions - these set the internal freq of the module
-#define REGION_INDIA        0x04
-#define REGION_JAPAN        0x05
-#define REGION_CHINA        0x06
-#define REGION_EUROPE       0x08
-#define REGION_KOREA        0x09
-#define REGION_AUSTRALIA    0x0B
-#define REGION_NEWZEALAND   0x0C
-#define REGION_NORTHAMERICA 0x0D
-#define REGION_OPEN         0xFF
-
-// Define the allowed tag protocols
-#define TMR_TAG_PROTOCOL_NONE             0x00
-#define TMR_TAG_PROTOCOL_ISO180006B       0x03
-#define TMR_TAG_PROTOCOL_GEN2             0x05
-#define TMR_TAG_PROTOCOL_ISO180006B_UCODE 0x06
-#define TMR_TAG_PROTOCOL_IPX64            0x07
-#define TMR_TAG_PROTOCOL_IPX256           0x08
-#define TMR_TAG_PROTOCOL_ATA              0x1D
+// Firmware adding the GPIO and Gen2 tag read metadata
+#define M6E_NANO_FW_EXTENDED_METADATA 0x01090000
 
 /* wait serial output with 1000ms timeout */
 #define CFG_M6E_NANO_SERIAL_TIMEOUT 1000
 
+// Wake-up sequence for a module in a power save mode
+#define M6E_NANO_WAKE_PREAMBLE_LEN 4
+#define M6E_NANO_WAKE_DELAY_MS     5
+
+// Events reported through the event callback
+#define M6E_NANO_EVENT_RESET           0 // Module sent a startup message, config was lost
+#define M6E_NANO_EVENT_KEEPALIVE_LOST  1 // No frame received while reading
+#define M6E_NANO_EVENT_RECOVERED       2 // Settings re-applied and reading restarted
+#define M6E_NANO_EVENT_RECOVERY_FAILED 3 // All recovery attempts failed
+#define M6E_NANO_EVENT_READY           4 // Devicetree configuration applied, reading if autostart
+#define M6E_NANO_EVENT_BOOT_FAILED     5 // Devicetree configuration failed on every attempt
+
+// Settings remembered by the driver so they can be re-applied after a module reset
+#define M6E_NANO_SETTING_REGION       BIT(0)
+#define M6E_NANO_SETTING_READ_POWER   BIT(1)
+#define M6E_NANO_SETTING_PROTOCOL     BIT(2)
+#define M6E_NANO_SETTING_POWER_MODE   BIT(3)
+#define M6E_NANO_SETTING_ANTENNA      BIT(4)
+#define M6E_NANO_SETTING_TRIGGER      BIT(5) // Reading is GPI-triggered
+#define M6E_NANO_SETTING_HOP_TABLE    BIT(6)
+#define M6E_NANO_SETTING_HOP_TIME     BIT(7)
+#define M6E_NANO_SETTING_LBT          BIT(8)
+#define M6E_NANO_SETTING_GEN2_SESSION BIT(9)
+#define M6E_NANO_SETTING_GEN2_TARGET  BIT(10)
+#define M6E_NANO_SETTING_GEN2_Q       BIT(11)
+#define M6E_NANO_SETTING_WRITE_POWER  BIT(12)
+#define M6E_NANO_SETTING_BAUD         BIT(13)
+
 // Set command to be transmitted
 typedef int (*m6e_nano_send_command_t)(const struct device *dev, uint8_t *command,
 					const uint8_t length, bool timeout);
 
-// Callback
+// Data callback, called from the UART ISR once per complete CRC-valid frame, or per batch of
+// frames with CONFIG_M6E_NANO_COALESCE. Take the frames with m6e_nano_next_frame()
 typedef void (*m6e_nano_callback_t)(const struct device *dev, void *user_data);
 
 // Set the data callback function for the device
 typedef void (*m6e_nano_set_callback_t)(const struct device *dev, m6e_nano_callback_t callback,
 					void *user_data);
 
+// Event callback, called from the driver work queue or the caller's thread
+typedef void (*m6e_nano_event_callback_t)(const struct device *dev, uint8_t event,
+					  void *user_data);
+
+// Set the event callback function for the device
+typedef void (*m6e_nano_set_event_callback_t)(const struct device *dev,
+					      m6e_nano_event_callback_t callback, void *user_data);
+
 struct m6e_nano_api {
 	// m6e_nano_send_command_t send_command;
 	m6e_nano_set_callback_t set_callback;
+	m6e_nano_set_event_callback_t set_event_callback;
 };
 
 /**
@@ -131,26 +135,487 @@ static inline void m6e_nano_set_callback(const struct device *dev, m6e_nano_call
 	return api->set_callback(dev, callback, user_data);
 }
 
+/**
+ * @brief Set the event callback function for the device. Events are one of M6E_NANO_EVENT_*.
+ *
+ * @param dev Pointer to the device structure.
+ * @param callback Callback function pointer.
+ * @param user_data Pointer to data accessible from the callback function.
+ */
+static inline void m6e_nano_set_event_callback(const struct device *dev,
+					       m6e_nano_event_callback_t callback, void *user_data)
+{
+	struct m6e_nano_api *api = (struct m6e_nano_api *)dev->api;
+	return api->set_event_callback(dev, callback, user_data);
+}
+
 struct m6e_nano_buf {
 	uint8_t data[M6E_NANO_BUF_SIZE];
 	size_t len;
 	size_t msg_len;
 };
 
+// What the module can do, derived from its version
+struct m6e_nano_capabilities {
+	uint32_t max_baud;
+	uint16_t max_read_power; // centi-dBm
+	uint16_t metadata;       // Tag read metadata, bitmask of M6E_NANO_METADATA_*
+	bool tag_buffer;         // Tags can be read into the module buffer and fetched in batches
+	bool embedded_tagop;     // Tag memory can be read during inventory
+};
+
+struct m6e_nano_settings {
+	uint16_t valid; // Bitmask of M6E_NANO_SETTING_*
+	uint32_t baud;
+	uint8_t region;
+	uint8_t protocol;
+	uint8_t power_mode;
+	uint16_t read_power;
+	uint16_t write_power;
+	uint8_t antenna; // 4 MSB TX port, 4 LSB RX port, 0 for port 1
+	uint8_t trigger_pin;
+	bool lbt;
+	int8_t lbt_threshold;
+	uint32_t hop_time;
+	uint8_t hop_count;
+	uint32_t hop_table[M6E_NANO_MAX_HOP_CHANNELS];
+	uint8_t gen2_session;
+	uint8_t gen2_target;
+	int8_t gen2_q; // Negative for dynamic Q
+};
+
+struct m6e_nano_channel_stats {
+	uint32_t freq; // Channel frequency in kHz
+	uint32_t reads;
+};
+
+struct m6e_nano_stats {
+	uint32_t resets;           // Startup messages received from the module
+	uint32_t keepalive_misses; // Read streams that went silent
+	uint32_t cmd_timeouts;     // Commands that got no response in time
+	uint32_t recoveries;       // Successful recoveries
+	uint32_t recovery_failures;
+	uint32_t frames;        // Complete frames received
+	uint32_t crc_errors;    // Frames with a bad CRC, not passed to the data callback
+	uint32_t tag_reads;     // Tag read frames received, parsed or not
+	uint32_t resume_us;     // Latency of the last PM resume
+	uint32_t resume_us_max; // Worst PM resume latency
+};
+
+// How the module is put to sleep between scheduled inventory windows
+#define M6E_NANO_SLEEP_POWER_MODE 0 // TMR_SR_POWER_MODE_MAX_SAVE over the serial link
+#define M6E_NANO_SLEEP_DISABLE    1 // Drive enable-gpios inactive, module is unpowered
+
+struct m6e_nano_schedule {
+	uint32_t window_ms; // Time spent reading per window
+	uint32_t period_ms; // Time between window starts, 0 to only read when triggered
+	uint8_t sleep;      // One of M6E_NANO_SLEEP_*
+	bool trigger;       // Open (or extend) a window on a trigger-gpios edge
+};
+
+struct m6e_nano_schedule_stats {
+	uint32_t windows;     // Completed inventory windows
+	uint32_t triggers;    // Windows opened or extended by trigger-gpios
+	uint32_t active_ms;   // Total time spent awake and reading
+	uint32_t tag_reads;   // Tags read during windows
+	uint32_t wake_us;     // Latency of the last wake-up
+	uint32_t wake_us_max; // Worst wake-up latency
+	uint32_t wake_errors; // Windows skipped because the module did not respond
+};
+
+#ifdef CONFIG_M6E_NANO_SCHEDULER
+struct m6e_nano_sched {
+	struct m6e_nano_schedule schedule;
+	struct m6e_nano_schedule_stats stats;
+	struct k_work_delayable window_work;
+#ifdef CONFIG_GPIO
+	struct gpio_callback trigger_cb;
+#endif
+	bool running;
+	bool active;
+	bool holds_ref; // Holds a PM device runtime reference on the device
+	uint32_t window_start_ms;
+	uint32_t window_tags;
+};
+#endif
+
+// Antenna port of a port list. Ports are numbered from 1, like on the module
+struct m6e_nano_antenna_port {
+	uint8_t tx;          // TX port
+	uint8_t rx;          // RX port, the TX port for a monostatic antenna
+	uint16_t read_power; // centi-dBm, 0 for the module read power
+	uint16_t dwell_ms;   // Time read before switching, 0 to let the module switch, see below
+};
+
+struct m6e_nano_antenna_stats {
+	uint32_t reads;      // Tag reads attributed to the port
+	uint8_t return_loss; // dB, from the last m6e_nano_check_antennas()
+	bool skipped;        // Return loss too low, the port is left out of the sequence
+};
+
+#ifdef CONFIG_M6E_NANO_ASYNC_INIT
+// Module configuration from the devicetree, applied after boot
+struct m6e_nano_boot_config {
+	uint8_t region;      // One of REGION_*, 0 to leave the module default
+	uint8_t protocol;    // One of TMR_TAG_PROTOCOL_*, 0 to leave the module default
+	int16_t read_power;  // centi-dBm, negative to leave the module default
+	int16_t write_power; // centi-dBm, negative to leave the module default
+	uint32_t baud;       // 0 to keep the UART baud rate
+	uint8_t antenna;     // 4 MSB TX port, 4 LSB RX port, 0 to leave the module default
+	bool autostart;      // Start continuous reading once configured
+};
+
+struct m6e_nano_boot {
+	struct k_work_delayable work;
+	struct k_sem done; // Given once the configuration succeeded or failed
+	uint8_t attempts;
+	int status; // -EINPROGRESS until done
+};
+#endif
+
+struct m6e_nano_watchlist_stats {
+	uint32_t entries; // EPCs on the watchlist, 0 without one
+	uint32_t hits;    // Tag reads on the watchlist
+	uint32_t misses;  // Tag reads filtered out
+};
+
+#ifdef CONFIG_M6E_NANO_WATCHLIST
+struct m6e_nano_watch {
+	struct k_spinlock lock; // Guards list against m6e_nano_set_watchlist()
+	struct m6e_nano_watchlist list;
+	uint32_t data; // Value of the entry of the tag last parsed
+	uint32_t hits;
+	uint32_t misses;
+};
+#endif
+
+#ifdef CONFIG_M6E_NANO_GS1
+struct m6e_nano_skus {
+	struct k_spinlock lock; // Guards the counters against m6e_nano_get_skus()
+	struct m6e_nano_sku skus[CONFIG_M6E_NANO_GS1_SKUS];
+	uint32_t dropped; // Reads of new GTINs with every counter taken
+};
+#endif
+
+#ifdef CONFIG_M6E_NANO_BRIDGE
+// Traffic in one direction of the bridge
+struct m6e_nano_bridge_stats {
+	uint32_t bytes;
+	uint32_t frames;     // CRC-valid frames
+	uint32_t crc_errors; // Frames with a bad CRC
+	uint32_t stalls;     // Times the ring filled and the sending side was held back
+};
+
+// One direction of the bridge, filled by the receiving UART ISR and drained by the other one
+struct m6e_nano_bridge_path {
+	struct ring_buf ring;
+	uint8_t buf[CONFIG_M6E_NANO_BRIDGE_BUF_SIZE];
+	struct m6e_nano_tap tap;
+	uint32_t stalls;
+};
+
+struct m6e_nano_bridge {
+	const struct device *host; // Host-facing UART, NULL while the bridge is off
+	struct m6e_nano_bridge_path to_module;
+	struct m6e_nano_bridge_path to_host;
+	uint32_t baud; // Baud rate of the last SET_BAUD_RATE command, until its response
+	struct k_work baud_work;
+	bool reading; // Reading when the bridge started
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	bool supervised; // Supervised when the bridge started
+#endif
+};
+#endif
+
+#ifdef CONFIG_M6E_NANO_FIRMWARE
+struct m6e_nano_fw {
+	// Command data of the chunk being written, then of the next one read while it is
+	uint8_t buf[M6E_NANO_FW_WRITE_LEN];
+};
+#endif
+
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+struct m6e_nano_antennas {
+	struct m6e_nano_antenna_port ports[CONFIG_M6E_NANO_ANTENNA_MAX_PORTS];
+	struct m6e_nano_antenna_stats stats[CONFIG_M6E_NANO_ANTENNA_MAX_PORTS];
+	uint8_t count;
+	uint8_t current;  // Port being read while the driver switches ports
+	bool sequencing;  // Ports with a dwell time are switched by the driver, the others unused
+	uint32_t switches; // Port switches made by the driver
+	struct k_work_delayable dwell_work;
+};
+#endif
+
+// Why an inventory round ended
+#define M6E_NANO_ROUND_END_TIME      0 // Round duration elapsed
+#define M6E_NANO_ROUND_END_KEEPALIVE 1 // Module sent a keep-alive
+#define M6E_NANO_ROUND_END_EXPLICIT  2 // m6e_nano_round_end() or m6e_nano_round_stop()
+
+struct m6e_nano_round_config {
+	uint32_t duration_ms; // Round length, 0 to not end rounds on time
+	bool keepalive;       // End the round on every keep-alive of the read stream
+};
+
+struct m6e_nano_round_summary {
+	uint32_t round;       // Sequence number, starting at 0
+	uint32_t start_ms;    // Uptime at the start of the round
+	uint32_t duration_ms; // Length of the round
+	uint32_t unique;      // Distinct EPCs read
+	uint32_t reads;       // Tag reads
+	uint32_t untracked;   // Distinct EPCs that did not fit the tag set, included in unique
+	uint8_t reason;       // One of M6E_NANO_ROUND_END_*
+};
+
+// Round summary callback, called from the driver work queue
+typedef void (*m6e_nano_round_callback_t)(const struct device *dev,
+					  const struct m6e_nano_round_summary *summary,
+					  void *user_data);
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+// Distinct EPCs of a round. EPCs longer than CONFIG_M6E_NANO_ROUND_EPC_LEN keep their last bytes,
+// which hold the serial number, and are told apart by a hash of the whole EPC.
+struct m6e_nano_tag_set {
+	uint32_t count;  // Distinct EPCs added, stored or not
+	uint16_t stored; // EPCs held in the arrays below
+	uint32_t bloom[CONFIG_M6E_NANO_ROUND_BLOOM_BITS / 32];
+	uint32_t hash[CONFIG_M6E_NANO_ROUND_MAX_TAGS];
+	uint8_t epc_len[CONFIG_M6E_NANO_ROUND_MAX_TAGS];
+	uint8_t epc[CONFIG_M6E_NANO_ROUND_MAX_TAGS][CONFIG_M6E_NANO_ROUND_EPC_LEN];
+};
+
+struct m6e_nano_round {
+	struct m6e_nano_round_config config;
+	struct m6e_nano_tag_set set;
+	struct k_spinlock lock;
+	struct k_msgq msgq;
+	char __aligned(4) msgq_buf[CONFIG_M6E_NANO_ROUND_QUEUE_LEN *
+				   sizeof(struct m6e_nano_round_summary)];
+	struct k_work_delayable timer_work;
+	struct k_work deliver_work;
+	m6e_nano_round_callback_t callback;
+	void *user_data;
+	bool running;
+	bool last_new; // Last parsed tag was first seen in the current round
+	uint32_t seq;
+	uint32_t start_ms;
+	uint32_t reads;
+	uint32_t dropped; // Summaries lost to a full queue
+};
+#endif
+
+#ifdef CONFIG_M6E_NANO_RTIO
+struct m6e_nano_rtio {
+	struct rtio_iodev iodev;
+	struct rtio_mpsc rx_q;  // Reads waiting for a tag frame, consumed by the UART ISR
+	struct rtio_mpsc cmd_q; // Commands waiting for the work queue
+	struct k_work cmd_work;
+	uint32_t overruns; // Tag frames that found no read waiting
+};
+#endif
+
+#ifdef CONFIG_M6E_NANO_ZBUS
+// Message of m6e_nano_tag_chan, one per tag read frame
+struct m6e_nano_tag_msg {
+	const struct device *dev;
+	int64_t frame_us; // Uptime the frame started arriving
+	struct m6e_nano_tag tag;
+#ifdef CONFIG_M6E_NANO_WATCHLIST
+	uint32_t watch_data; // Value of the watchlist entry of the tag, 0 without a watchlist
+#endif
+};
+
+// Message of m6e_nano_round_chan, one per inventory round
+struct m6e_nano_round_msg {
+	const struct device *dev;
+	struct m6e_nano_round_summary summary;
+};
+
+// Message of m6e_nano_telemetry_chan, every CONFIG_M6E_NANO_ZBUS_TELEMETRY_MS
+struct m6e_nano_telemetry_msg {
+	const struct device *dev;
+	uint32_t uptime_ms;
+	struct m6e_nano_stats stats;
+	uint32_t overruns;         // Messages lost to a full driver queue
+	uint32_t publish_failures; // Messages zbus did not take
+};
+
+struct m6e_nano_zbus {
+	struct k_msgq tags; // Filled by the UART ISR, published from the work queue
+	char __aligned(4) tags_buf[CONFIG_M6E_NANO_ZBUS_QUEUE_LEN * sizeof(struct m6e_nano_tag_msg)];
+#ifdef CONFIG_M6E_NANO_ROUNDS
+	struct k_msgq rounds;
+	char __aligned(4) rounds_buf[CONFIG_M6E_NANO_ROUND_QUEUE_LEN *
+				     sizeof(struct m6e_nano_round_msg)];
+#endif
+	struct k_work publish_work;
+	struct k_work_delayable telemetry_work;
+	uint32_t overruns;
+	uint32_t publish_failures;
+};
+
+// Channel consumer with a queue of its own, see M6E_NANO_SUBSCRIBER_DEFINE()
+struct m6e_nano_subscriber {
+	struct k_msgq *msgq;
+	atomic_t dropped; // Messages that found the queue full
+};
+
+ZBUS_CHAN_DECLARE(m6e_nano_tag_chan, m6e_nano_telemetry_chan);
+#ifdef CONFIG_M6E_NANO_ROUNDS
+ZBUS_CHAN_DECLARE(m6e_nano_round_chan);
+#endif
+
+/**
+ * @brief Define a subscriber of a driver channel with a queue of _depth messages. A zbus
+ * listener copies each message published on _chan into the queue, or counts it as dropped when
+ * the queue is full, so a slow consumer only loses its own messages and never holds up the
+ * publisher or the other subscribers. Take messages with m6e_nano_subscriber_get().
+ *
+ * @param _name Name of the struct m6e_nano_subscriber.
+ * @param _chan Channel, one of m6e_nano_tag_chan, m6e_nano_round_chan or m6e_nano_telemetry_chan.
+ * @param _type Message type of the channel.
+ * @param _depth Queue length in messages.
+ */
+#define M6E_NANO_SUBSCRIBER_DEFINE(_name, _chan, _type, _depth)                                  \
+	K_MSGQ_DEFINE(_name##_msgq, sizeof(_type), _depth, 4);                                    \
+	struct m6e_nano_subscriber _name = {.msgq = &_name##_msgq, .dropped = ATOMIC_INIT(0)};    \
+	static void _name##_listener_cb(const struct zbus_channel *chan)                          \
+	{                                                                                         \
+		m6e_nano_subscriber_put(&_name, chan);                                            \
+	}                                                                                         \
+	ZBUS_LISTENER_DEFINE(_name##_listener, _name##_listener_cb);                              \
+	ZBUS_CHAN_ADD_OBS(_chan, _name##_listener, 0)
+#endif
+
+#ifdef CONFIG_M6E_NANO_COALESCE
+struct m6e_nano_coalesce {
+	struct k_spinlock lock;
+	struct k_timer timer;
+	uint8_t frames[CONFIG_M6E_NANO_COALESCE_QUEUE_LEN][M6E_NANO_BUF_SIZE];
+	int64_t times_us[CONFIG_M6E_NANO_COALESCE_QUEUE_LEN]; // frame_time_us of each frame
+	uint8_t head;    // Next slot written by the UART ISR
+	uint8_t tail;    // Oldest slot not released by the consumer
+	uint8_t count;   // Slots in use, including the one the consumer holds
+	bool holding;    // The consumer holds the slot at tail
+	uint8_t pending; // Frames queued since the callback was last called
+	uint32_t dropped; // Frames that found the queue full
+};
+#endif
+
 struct m6e_nano_data {
 	bool debug;
 	uint8_t status;
+	uint8_t wait_opcode; // Opcode of the command last sent, only its response wakes the sender
 	struct m6e_nano_buf command;
 	struct m6e_nano_buf response;
 	bool has_response;
+	bool reading;
+	bool resume_reading;
+	bool expect_startup;
+	bool asleep;
+	uint8_t sleep_method; // One of M6E_NANO_SLEEP_*, valid while asleep
+	uint32_t boot_baud;   // UART baud rate at init, the module's rate after a reset
+	uint32_t last_frame_ms;
+	int64_t frame_us; // Uptime the frame being received started arriving
+	int64_t read_us;  // Uptime the tag of the last complete frame was read, see frame_time_us
+	uint8_t *frame;   // Frame read by the tag accessors, see m6e_nano_next_frame()
+	int64_t frame_time_us; // Uptime the tag of that frame was read, or when it arrived
+	bool frame_ready; // A frame was completed and not yet taken by m6e_nano_next_frame()
+	const struct device *dev;
+
+	struct k_mutex lock;
+	struct k_sem response_sem; // Given by the RX interrupt for the response to wait_opcode
+	struct m6e_nano_settings settings;
+	struct m6e_nano_stats stats;
+	bool has_version;
+	struct m6e_nano_version version;
+	struct m6e_nano_capabilities caps;
+	struct m6e_nano_clock clock;
+	int64_t tag_time_us; // Uptime of the tag last parsed
 
 	m6e_nano_callback_t callback;
 	void *user_data;
+	m6e_nano_event_callback_t event_callback;
+	void *event_user_data;
+
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	bool supervised;
+	bool recovering;
+	bool reset_pending;
+	uint8_t cmd_timeout_streak;
+	struct k_work recover_work;
+	struct k_work_delayable watchdog_work;
+#endif
+
+#ifdef CONFIG_M6E_NANO_SCHEDULER
+	struct m6e_nano_sched sched;
+#endif
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+	struct m6e_nano_round round;
+#endif
+
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+	struct m6e_nano_antennas antennas;
+#endif
+
+#ifdef CONFIG_M6E_NANO_ASYNC_INIT
+	struct m6e_nano_boot boot;
+#endif
+
+#ifdef CONFIG_M6E_NANO_WATCHLIST
+	struct m6e_nano_watch watch;
+#endif
+
+#ifdef CONFIG_M6E_NANO_GS1
+	struct m6e_nano_skus skus;
+#endif
+
+#ifdef CONFIG_M6E_NANO_TRACING_HISTOGRAM
+	struct m6e_nano_trace trace;
+#endif
+
+#ifdef CONFIG_M6E_NANO_CAPTURE
+	struct m6e_nano_capture capture;
+#endif
+
+#ifdef CONFIG_M6E_NANO_RTIO
+	struct m6e_nano_rtio rtio;
+#endif
+
+#ifdef CONFIG_M6E_NANO_COALESCE
+	struct m6e_nano_coalesce coalesce;
+#endif
+
+#ifdef CONFIG_M6E_NANO_ZBUS
+	struct m6e_nano_zbus zbus;
+#endif
+
+#ifdef CONFIG_M6E_NANO_FIRMWARE
+	struct m6e_nano_fw fw;
+#endif
+
+#ifdef CONFIG_M6E_NANO_BRIDGE
+	struct m6e_nano_bridge bridge;
+#endif
+
+#ifdef CONFIG_M6E_NANO_CHANNEL_STATS
+	struct k_spinlock channel_lock; // Guards the channel table, counted from the UART ISR
+	uint8_t channel_count;
+	struct m6e_nano_channel_stats channels[M6E_NANO_MAX_HOP_CHANNELS];
+	uint32_t channel_overflows; // Reads on channels beyond the table
+#endif
 };
 
 struct m6e_nano_config {
 	struct m6e_nano_data *data;
 	const struct device *uart_dev;
+#ifdef CONFIG_GPIO
+	struct gpio_dt_spec enable_gpio;
+	struct gpio_dt_spec trigger_gpio;
+#endif
+#ifdef CONFIG_M6E_NANO_ASYNC_INIT
+	struct m6e_nano_boot_config boot;
+#endif
 };
 
 /**
@@ -177,17 +642,37 @@ uint8_t m6e_nano_get_tag_epc_bytes(const struct device *dev);
  * @brief Retrieve the RSSI of the tag.
  *
  * @param dev UART peripheral device.
- * @return uint8_t RSSI of the tag.
+ * @return int8_t RSSI of the tag in dBm.
  */
-uint8_t m6e_nano_get_tag_rssi(const struct device *dev);
+int8_t m6e_nano_get_tag_rssi(const struct device *dev);
 
 /**
- * @brief Retrieve the timestamp of the tag.
+ * @brief Retrieve the timestamp of the tag, in ms since the last keep-alive of the module.
  *
  * @param dev UART peripheral device.
- * @return uint16_t Timestamp of the tag.
+ * @return uint32_t Timestamp of the tag.
  */
-uint16_t m6e_nano_get_tag_timestamp(const struct device *dev);
+uint32_t m6e_nano_get_tag_timestamp(const struct device *dev);
+
+/**
+ * @brief Retrieve the time the tag last parsed by m6e_nano_parse_response() was read, in the
+ * uptime of the host. The module timestamp is anchored on its keep-alives and corrected for
+ * the drift between the two clocks, so reads from a stream of any length, and from several
+ * readers, compare directly with each other and with k_uptime_get().
+ *
+ * @param dev UART peripheral device.
+ * @return int64_t Uptime of the read in ms.
+ */
+int64_t m6e_nano_get_tag_uptime(const struct device *dev);
+
+/**
+ * @brief Set a fixed offset added to the tag times of a reader, to align readers whose frames
+ * reach the host with different latencies.
+ *
+ * @param dev UART peripheral device.
+ * @param offset_us Offset in us.
+ */
+void m6e_nano_set_time_offset(const struct device *dev, int32_t offset_us);
 
 /**
  * @brief Retrieve the frequency of the tag.
@@ -197,6 +682,31 @@ uint16_t m6e_nano_get_tag_timestamp(const struct device *dev);
  */
 uint32_t m6e_nano_get_tag_freq(const struct device *dev);
 
+/**
+ * @brief Retrieve the phase of the tag's backscatter.
+ *
+ * @param dev UART peripheral device.
+ * @return uint16_t Phase in degrees, 0 to 180.
+ */
+uint16_t m6e_nano_get_tag_phase(const struct device *dev);
+
+/**
+ * @brief Retrieve the antenna the tag was read on.
+ *
+ * @param dev UART peripheral device.
+ * @return uint8_t TX port in the 4 MSB, RX port in the 4 LSB.
+ */
+uint8_t m6e_nano_get_tag_antenna(const struct device *dev);
+
+/**
+ * @brief Decode every field of a tag read at once.
+ *
+ * @param dev UART peripheral device.
+ * @param tag Decoded tag read.
+ * @return int 0 on success, -EBADMSG if the EPC runs past the frame.
+ */
+int m6e_nano_get_tag(const struct device *dev, struct m6e_nano_tag *tag);
+
 /**
  * @brief Disable the read filter.
  *
@@ -205,7 +715,7 @@ uint32_t m6e_nano_get_tag_freq(const struct device *dev);
 void m6e_nano_disable_read_filter(const struct device *dev);
 
 /**
- * @brief Stop a continuous read operation.
+ * @brief Stop a continuous read operation, waiting until the module acknowledges it.
  *
  * @param dev UART peripheral device.
  */
@@ -216,30 +726,204 @@ void m6e_nano_stop_reading(const struct device *dev);
  *
  * @param dev UART peripheral device.
  * @param mode Power mode to set. See docs for valid modes.
+ * @return int 0 on success, negative errno otherwise.
  */
-void m6e_nano_set_power_mode(const struct device *dev, uint8_t mode);
+int m6e_nano_set_power_mode(const struct device *dev, uint8_t mode);
 
 /**
  * @brief Set the antenna port of the M6E Nano.
  *
  * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_antenna_port(const struct device *dev);
+
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+/**
+ * @brief Read from a list of antenna ports, for modules behind an antenna multiplexer. When
+ * every port has a dwell time of 0, the module switches ports itself at the end of each
+ * search; otherwise the driver reads each port with a dwell time for that long while reading
+ * continuously, and the ports without one are unused. Ports skipped by
+ * m6e_nano_check_antennas() are left out. Requires CONFIG_M6E_NANO_ANTENNAS.
+ *
+ * @param dev UART peripheral device.
+ * @param ports Ports in read order.
+ * @param count Number of ports, up to CONFIG_M6E_NANO_ANTENNA_MAX_PORTS.
+ * @return int 0 on success, -EINVAL for an invalid port list, negative errno otherwise.
  */
-void m6e_nano_set_antenna_port(const struct device *dev);
+int m6e_nano_set_antenna_ports(const struct device *dev, const struct m6e_nano_antenna_port *ports,
+			       uint8_t count);
+#endif
+
+#ifdef CONFIG_M6E_NANO_WATCHLIST
+/**
+ * @brief Only pass the tag reads of a watchlist on. m6e_nano_parse_response() returns
+ * RESPONSE_IS_TAGFILTERED for the other reads, before they reach inventory rounds. The index is
+ * built by the host tool m6e_nano_index and used in place, so it can stay in memory-mapped
+ * flash. Requires CONFIG_M6E_NANO_WATCHLIST.
+ *
+ * @param dev UART peripheral device.
+ * @param index Index, 4-byte aligned, valid until replaced. NULL to pass every read on.
+ * @param size Size of the index.
+ * @return int 0 on success, -EINVAL for a malformed index.
+ */
+int m6e_nano_set_watchlist(const struct device *dev, const void *index, size_t size);
+
+/**
+ * @brief Retrieve the value stored with the watchlist entry of the tag last parsed by
+ * m6e_nano_parse_response(). Requires CONFIG_M6E_NANO_WATCHLIST.
+ *
+ * @param dev UART peripheral device.
+ * @return uint32_t Value of the entry.
+ */
+uint32_t m6e_nano_get_tag_watch_data(const struct device *dev);
+
+/**
+ * @brief Retrieve the watchlist counters. Requires CONFIG_M6E_NANO_WATCHLIST.
+ *
+ * @param dev UART peripheral device.
+ * @param stats Destination for the counters.
+ */
+void m6e_nano_get_watchlist_stats(const struct device *dev,
+				  struct m6e_nano_watchlist_stats *stats);
+#endif
+
+#ifdef CONFIG_M6E_NANO_GS1
+/**
+ * @brief Decode the EPC of the tag last parsed by m6e_nano_parse_response() as a GS1 EPC, taking
+ * its length from the PC word. Requires CONFIG_M6E_NANO_GS1.
+ *
+ * @param dev UART peripheral device.
+ * @param gs1 Decoded fields, see m6e_nano_gs1_key() for the GTIN of an SGTIN.
+ * @return int 0 on success, -EBADMSG for a malformed read or GS1 EPC, -ENOTSUP if the EPC is not
+ * of a 96-bit GS1 scheme.
+ */
+int m6e_nano_get_tag_gs1(const struct device *dev, struct m6e_nano_gs1 *gs1);
+
+/**
+ * @brief Retrieve the read counters per GTIN, counted by m6e_nano_parse_response() for the
+ * SGTIN-96 reads it passes on. Requires CONFIG_M6E_NANO_GS1.
+ *
+ * @param dev UART peripheral device.
+ * @param skus Destination for the counters, in no particular order.
+ * @param max Size of skus.
+ * @param dropped Reads of GTINs that found every counter taken, may be NULL.
+ * @param reset Clear every counter, those past max included.
+ * @return size_t Number of counters copied.
+ */
+size_t m6e_nano_get_skus(const struct device *dev, struct m6e_nano_sku *skus, size_t max,
+			 uint32_t *dropped, bool reset);
+#endif
+
+/**
+ * @brief Read a single tag, blocking until the module finds one or timeout_ms elapses. Faster
+ * to a first read than starting a continuous search, for point-of-use scanning. Call it while
+ * not reading.
+ *
+ * @param dev UART peripheral device.
+ * @param timeout_ms Time the module searches for a tag.
+ * @param metadata Tag read metadata to return, bitmask of M6E_NANO_METADATA_*. Flags the module
+ * does not support are dropped.
+ * @param select Tags to read, NULL for any tag.
+ * @param tag Tag read.
+ * @return int 0 on success, -ENODATA if no tag was found, -EBUSY while reading, -EINVAL for an
+ * invalid select, negative errno otherwise.
+ */
+int m6e_nano_read_single(const struct device *dev, uint16_t timeout_ms, uint16_t metadata,
+			 const struct m6e_nano_select *select, struct m6e_nano_tag *tag);
+
+/**
+ * @brief Measure the return loss of the antenna ports of the module.
+ *
+ * @param dev UART peripheral device.
+ * @param loss Return loss in dB, indexed by port number - 1. Ports the module does not report
+ * are set to 0.
+ * @param count Number of entries of loss.
+ * @return int Number of ports reported on success, negative errno otherwise.
+ */
+int m6e_nano_get_return_loss(const struct device *dev, uint8_t *loss, uint8_t count);
+
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+/**
+ * @brief Measure the return loss of every port of the port list and skip the ports below
+ * CONFIG_M6E_NANO_ANTENNA_MIN_RETURN_LOSS, which have no antenna connected. Call it while not
+ * reading. Requires CONFIG_M6E_NANO_ANTENNAS.
+ *
+ * @param dev UART peripheral device.
+ * @return int Number of ports kept, -EINVAL without a port list, -ENODEV if none has an antenna,
+ * negative errno otherwise.
+ */
+int m6e_nano_check_antennas(const struct device *dev);
+
+/**
+ * @brief Retrieve the statistics of a port of the port list. Requires CONFIG_M6E_NANO_ANTENNAS.
+ *
+ * @param dev UART peripheral device.
+ * @param index Index of the port in the port list.
+ * @param stats Destination for the statistics.
+ * @return int 0 on success, -EINVAL for an index outside the port list.
+ */
+int m6e_nano_get_antenna_stats(const struct device *dev, uint8_t index,
+			       struct m6e_nano_antenna_stats *stats);
+#endif
 
 /**
  * @brief Set the read power of the M6E Nano.
  *
  * @param dev UART peripheral device.
- * @param power Power to set. Between 0 and 27dBm.
+ * @param power Power to set in centi-dBm, up to the maximum of the module (27dBm for the Nano).
+ * @return int 0 on success, negative errno otherwise.
  */
-void m6e_nano_set_read_power(const struct device *dev, uint16_t power);
+int m6e_nano_set_read_power(const struct device *dev, uint16_t power);
 
 /**
  * @brief Start a continuous read operation.
  *
  * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_start_reading(const struct device *dev);
+
+/**
+ * @brief Read the level of the module's user GPIO pins.
+ *
+ * @param dev UART peripheral device.
+ * @param states Bitmask of pin levels, bit 0 is GPIO1.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_get_gpi(const struct device *dev, uint8_t *states);
+
+/**
+ * @brief Drive one of the module's user GPIO pins. The pin must be configured as an output.
+ *
+ * @param dev UART peripheral device.
+ * @param pin Pin number, 1 to M6E_NANO_GPIO_COUNT.
+ * @param level Level to drive.
+ * @return int 0 on success, -EINVAL for an invalid pin, negative errno otherwise.
+ */
+int m6e_nano_set_gpo(const struct device *dev, uint8_t pin, bool level);
+
+/**
+ * @brief Configure one of the module's user GPIO pins as an input or an output.
+ *
+ * @param dev UART peripheral device.
+ * @param pin Pin number, 1 to M6E_NANO_GPIO_COUNT.
+ * @param output Whether the pin is an output.
+ * @param level Initial level of an output.
+ * @return int 0 on success, -EINVAL for an invalid pin, negative errno otherwise.
  */
-void m6e_nano_start_reading(const struct device *dev);
+int m6e_nano_configure_gpio(const struct device *dev, uint8_t pin, bool output, bool level);
+
+/**
+ * @brief Arm a GPI-triggered continuous read. The module starts searching on its own when the
+ * input goes high, without a command from the host, and streams tags like
+ * m6e_nano_start_reading(). Stop it with m6e_nano_stop_reading().
+ *
+ * @param dev UART peripheral device.
+ * @param pin Module input that starts reading, 1 to M6E_NANO_GPIO_COUNT.
+ * @return int 0 on success, -EINVAL for an invalid pin, negative errno otherwise.
+ */
+int m6e_nano_start_triggered_reading(const struct device *dev, uint8_t pin);
 
 /**
  * @brief Set the operating region of the M6E Nano. This controls the transmission frequency of the
@@ -247,23 +931,175 @@ void m6e_nano_start_reading(const struct device *dev);
  *
  * @param dev UART peripheral device.
  * @param region Operating region to set.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_region(const struct device *dev, uint8_t region);
+
+/**
+ * @brief Retrieve the operating region of the M6E Nano.
+ *
+ * @param dev UART peripheral device.
+ * @param region Current region.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_get_region(const struct device *dev, uint8_t *region);
+
+/**
+ * @brief Retrieve the frequency hop table of the M6E Nano.
+ *
+ * @param dev UART peripheral device.
+ * @param freqs Channel frequencies in kHz.
+ * @param count Capacity of freqs on entry, number of channels on return.
+ * @return int 0 on success, -ENOMEM if freqs is too small, negative errno otherwise.
+ */
+int m6e_nano_get_hop_table(const struct device *dev, uint32_t *freqs, size_t *count);
+
+/**
+ * @brief Set the frequency hop table of the M6E Nano, for example to a subset of the channels
+ * of its region. Setting the region restores the region's default table.
+ *
+ * @param dev UART peripheral device.
+ * @param freqs Channel frequencies in kHz.
+ * @param count Number of channels, 1 to M6E_NANO_MAX_HOP_CHANNELS.
+ * @return int 0 on success, -EINVAL for an invalid count, negative errno otherwise.
+ */
+int m6e_nano_set_hop_table(const struct device *dev, const uint32_t *freqs, size_t count);
+
+/**
+ * @brief Retrieve the time spent on each channel before hopping.
+ *
+ * @param dev UART peripheral device.
+ * @param hop_time Hop time in ms.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_get_hop_time(const struct device *dev, uint32_t *hop_time);
+
+/**
+ * @brief Set the time spent on each channel before hopping.
+ *
+ * @param dev UART peripheral device.
+ * @param hop_time Hop time in ms.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_hop_time(const struct device *dev, uint32_t hop_time);
+
+/**
+ * @brief Configure listen-before-talk for the current region.
+ *
+ * @param dev UART peripheral device.
+ * @param enable Whether to listen before transmitting.
+ * @param threshold Channel busy threshold in dBm.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_lbt(const struct device *dev, bool enable, int8_t threshold);
+
+/**
+ * @brief Retrieve the number of tag reads per channel since the last reset of the statistics.
+ * Requires CONFIG_M6E_NANO_CHANNEL_STATS.
+ *
+ * @param dev UART peripheral device.
+ * @param stats Per-channel statistics, in order of first read.
+ * @param count Capacity of stats on entry, number of channels on return.
+ * @return int 0 on success, -ENOTSUP if channel statistics are disabled.
+ */
+int m6e_nano_get_channel_stats(const struct device *dev, struct m6e_nano_channel_stats *stats,
+			       size_t *count);
+
+/**
+ * @brief Clear the per-channel statistics.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_reset_channel_stats(const struct device *dev);
+
+/**
+ * @brief Restrict the hop table to the channels that produced at least min_reads tag reads.
+ * Requires CONFIG_M6E_NANO_CHANNEL_STATS. Like the other commands, call it while not reading.
+ *
+ * @param dev UART peripheral device.
+ * @param min_reads Reads a channel needs to be kept.
+ * @return int Number of channels kept, -ENODATA if no channel qualifies, negative errno
+ * otherwise.
  */
-void m6e_nano_set_region(const struct device *dev, uint8_t region);
+int m6e_nano_prune_hop_table(const struct device *dev, uint32_t min_reads);
 
 /**
- * @brief Retrieve the firmware version of the M6E Nano.
+ * @brief Retrieve the version of the M6E Nano and update the capabilities derived from it.
  *
  * @param dev UART peripheral device.
+ * @param version Decoded version, may be NULL.
+ * @return int 0 on success, negative errno otherwise.
  */
-int m6e_nano_get_version(const struct device *dev);
+int m6e_nano_get_version(const struct device *dev, struct m6e_nano_version *version);
+
+/**
+ * @brief Get the capabilities of the M6E Nano, from the version cached at init. The module is
+ * asked for its version if that failed.
+ *
+ * @param dev UART peripheral device.
+ * @param caps Capabilities of the module.
+ * @return int 0 on success, negative errno if the version could not be read. caps then holds
+ * conservative defaults.
+ */
+int m6e_nano_get_capabilities(const struct device *dev, struct m6e_nano_capabilities *caps);
 
 /**
  * @brief Set the tag protocol of the M6E Nano.
  *
  * @param dev UART peripheral device.
  * @param protocol Tag protocol to set.
+ * @return int 0 on success, negative errno otherwise.
  */
-void m6e_nano_set_tag_protocol(const struct device *dev, uint8_t protocol);
+int m6e_nano_set_tag_protocol(const struct device *dev, uint8_t protocol);
+
+/**
+ * @brief Set the Gen2 session used for inventory.
+ *
+ * @param dev UART peripheral device.
+ * @param session Session, 0 to 3.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_gen2_session(const struct device *dev, uint8_t session);
+
+/**
+ * @brief Set the Gen2 inventory target flag.
+ *
+ * @param dev UART peripheral device.
+ * @param target One of M6E_NANO_GEN2_TARGET_*.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_gen2_target(const struct device *dev, uint8_t target);
+
+/**
+ * @brief Set the Gen2 Q algorithm.
+ *
+ * @param dev UART peripheral device.
+ * @param q Static Q, 0 to 15, or negative for dynamic Q.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_gen2_q(const struct device *dev, int8_t q);
+
+/**
+ * @brief Set the write power of the M6E Nano, used for tag write, lock and kill operations.
+ *
+ * @param dev UART peripheral device.
+ * @param power Power to set in centi-dBm, up to the maximum read power of the module.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_set_write_power(const struct device *dev, uint16_t power);
+
+#ifdef CONFIG_M6E_NANO_ASYNC_INIT
+/**
+ * @brief Wait for the devicetree configuration applied after boot. Commands sent before it
+ * completes are serialized with it, but may be overridden by it. Requires
+ * CONFIG_M6E_NANO_ASYNC_INIT.
+ *
+ * @param dev UART peripheral device.
+ * @param timeout Longest wait.
+ * @return int 0 once configured, -EAGAIN on timeout, the error of the last attempt if it failed.
+ */
+int m6e_nano_wait_ready(const struct device *dev, k_timeout_t timeout);
+#endif
 
 /**
  * @brief Retrieve the write power of the M6E Nano.
@@ -273,10 +1109,11 @@ void m6e_nano_set_tag_protocol(const struct device *dev, uint8_t protocol);
 void m6e_nano_get_write_power(const struct device *dev);
 
 /**
- * @brief Set the baudrate of the M6E Nano.
+ * @brief Set the baudrate of the M6E Nano. The UART is left as is; the rate is remembered and
+ * sent first when the settings are restored.
  *
  * @param dev UART peripheral device.
- * @param baud_rate baudrate to set.
+ * @param baud_rate baudrate to set, limited to the maximum of the module.
  */
 void m6e_nano_set_baud(const struct device *dev, long baud_rate);
 
@@ -291,6 +1128,158 @@ void m6e_nano_set_baud(const struct device *dev, long baud_rate);
 void m6e_nano_send_generic_command(const struct device *dev, uint8_t *command, uint8_t size,
 				   uint8_t opcode);
 
+/**
+ * @brief Enable or disable supervision of the module. While supervised, module resets, silent
+ * read streams and repeated command timeouts trigger re-application of the last configured
+ * settings and a restart of continuous reading.
+ *
+ * @param dev UART peripheral device.
+ * @param enable Whether to supervise the module.
+ * @return int 0 on success, -ENOTSUP if CONFIG_M6E_NANO_SUPERVISOR is disabled.
+ */
+int m6e_nano_set_supervised(const struct device *dev, bool enable);
+
+/**
+ * @brief Re-apply the remembered settings and restart reading if it was active.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_restore_settings(const struct device *dev);
+
+/**
+ * @brief Retrieve a snapshot of the driver statistics.
+ *
+ * @param dev UART peripheral device.
+ * @param stats Destination for the statistics.
+ */
+void m6e_nano_get_stats(const struct device *dev, struct m6e_nano_stats *stats);
+
+#ifdef CONFIG_M6E_NANO_SCHEDULER
+/**
+ * @brief Start duty-cycled inventory. The module is put to sleep between windows and woken at
+ * full power for each window. Requires CONFIG_M6E_NANO_SCHEDULER.
+ *
+ * @param dev UART peripheral device.
+ * @param schedule Window timing, sleep method and trigger use.
+ * @return int 0 on success, -EINVAL for an invalid schedule, -ENOTSUP if the schedule needs a
+ * GPIO missing from the devicetree.
+ */
+int m6e_nano_schedule_start(const struct device *dev, const struct m6e_nano_schedule *schedule);
+
+/**
+ * @brief Stop duty-cycled inventory, leaving the module awake and not reading.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_schedule_stop(const struct device *dev);
+
+/**
+ * @brief Retrieve a snapshot of the scheduler statistics. Energy per tag read is proportional
+ * to active_ms / tag_reads.
+ *
+ * @param dev UART peripheral device.
+ * @param stats Destination for the statistics.
+ */
+void m6e_nano_get_schedule_stats(const struct device *dev, struct m6e_nano_schedule_stats *stats);
+#endif
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+/**
+ * @brief Start inventory rounds. Every tag parsed by m6e_nano_parse_response() is counted in
+ * the current round, and a summary of distinct tags is queued when the round ends. Starting
+ * while running ends the current round first. Requires CONFIG_M6E_NANO_ROUNDS.
+ *
+ * @param dev UART peripheral device.
+ * @param config How rounds are delimited, m6e_nano_round_end() always ends one.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_round_start(const struct device *dev, const struct m6e_nano_round_config *config);
+
+/**
+ * @brief End the current round and start the next one.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, -EINVAL if rounds are not running.
+ */
+int m6e_nano_round_end(const struct device *dev);
+
+/**
+ * @brief End the current round and stop counting.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, -EINVAL if rounds are not running.
+ */
+int m6e_nano_round_stop(const struct device *dev);
+
+/**
+ * @brief Deliver round summaries to a callback instead of keeping them for
+ * m6e_nano_round_get().
+ *
+ * @param dev UART peripheral device.
+ * @param callback Callback function pointer, NULL to queue summaries.
+ * @param user_data Pointer to data accessible from the callback function.
+ */
+void m6e_nano_round_set_callback(const struct device *dev, m6e_nano_round_callback_t callback,
+				 void *user_data);
+
+/**
+ * @brief Get the oldest queued round summary. Up to CONFIG_M6E_NANO_ROUND_QUEUE_LEN summaries
+ * are kept, later ones are dropped until the queue is read.
+ *
+ * @param dev UART peripheral device.
+ * @param summary Destination for the summary.
+ * @param timeout Time to wait for a round to end.
+ * @return int 0 on success, -EAGAIN on timeout, -ENOMSG if none is queued and K_NO_WAIT was
+ * given.
+ */
+int m6e_nano_round_get(const struct device *dev, struct m6e_nano_round_summary *summary,
+		       k_timeout_t timeout);
+
+/**
+ * @brief Whether the tag last parsed by m6e_nano_parse_response() was seen for the first time
+ * in the current round, so only new tags need to be reported.
+ *
+ * @param dev UART peripheral device.
+ * @return true if the tag is new.
+ */
+bool m6e_nano_round_tag_is_new(const struct device *dev);
+
+/**
+ * @brief Empty a tag set.
+ *
+ * @param set Tag set.
+ */
+void m6e_nano_tag_set_clear(struct m6e_nano_tag_set *set);
+
+/**
+ * @brief Add an EPC to a tag set. A bloom filter skips the search for EPCs not seen before.
+ * Once the set is full, new EPCs are still counted but a bloom filter false positive can hide
+ * one.
+ *
+ * @param set Tag set.
+ * @param epc EPC bytes.
+ * @param len Length of the EPC.
+ * @return true if the EPC was not in the set.
+ */
+bool m6e_nano_tag_set_add(struct m6e_nano_tag_set *set, const uint8_t *epc, uint8_t len);
+#endif
+
+/**
+ * @brief Take the next frame received for the data callback. m6e_nano_parse_response() and
+ * the tag accessors then read this frame.
+ *
+ * Without CONFIG_M6E_NANO_COALESCE this returns the frame that triggered the callback once,
+ * and must be called from the callback. With it, frames stay queued until taken, so the
+ * callback can wake a thread that takes every queued frame; the frame taken last is held
+ * until the next call. Frames are taken by a single consumer.
+ *
+ * @param dev UART peripheral device.
+ * @return true if a frame was taken, false if none is left.
+ */
+bool m6e_nano_next_frame(const struct device *dev);
+
 /**
  * @brief Parse the tag response from the M6E Nano.
  *
@@ -299,4 +1288,115 @@ void m6e_nano_send_generic_command(const struct device *dev, uint8_t *command, u
  */
 uint8_t m6e_nano_parse_response(const struct device *dev);
 
+#ifdef CONFIG_M6E_NANO_RTIO
+/**
+ * @brief Get the RTIO I/O device of the reader.
+ *
+ * RTIO_OP_RX reads complete with the next CRC-valid tag read frame, from the header to the
+ * CRC, and the frame length as result. Decode it with m6e_nano_decode_tag(). Tag frames that
+ * arrive while no read is waiting are counted as overruns and only reach the data callback.
+ *
+ * RTIO_OP_TX and RTIO_OP_TINY_TX send a command laid out like the frame on the wire without the
+ * header and CRC: length, opcode and data. They complete once the module accepted it, with the
+ * response frame length as result. RTIO_OP_TXRX also copies the response frame, from the
+ * header to the CRC, into the RX buffer. Commands run in order on the driver work queue.
+ *
+ * @param dev UART peripheral device.
+ * @return struct rtio_iodev* I/O device.
+ */
+struct rtio_iodev *m6e_nano_rtio_iodev(const struct device *dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_ZBUS
+/**
+ * @brief Copy the message of a channel into the queue of a subscriber, counting it as dropped
+ * if the queue is full. Called by the listener of M6E_NANO_SUBSCRIBER_DEFINE().
+ *
+ * @param sub Subscriber.
+ * @param chan Channel that was published.
+ */
+void m6e_nano_subscriber_put(struct m6e_nano_subscriber *sub, const struct zbus_channel *chan);
+
+/**
+ * @brief Take the oldest message of a subscriber.
+ *
+ * @param sub Subscriber.
+ * @param msg Destination, the message type of the subscriber.
+ * @param timeout Longest wait for a message.
+ * @return int 0 on success, -EAGAIN on timeout, -ENOMSG without waiting and no message.
+ */
+int m6e_nano_subscriber_get(struct m6e_nano_subscriber *sub, void *msg, k_timeout_t timeout);
+
+/**
+ * @brief Messages a subscriber lost to its full queue.
+ *
+ * @param sub Subscriber.
+ * @return uint32_t Dropped messages since boot.
+ */
+uint32_t m6e_nano_subscriber_dropped(struct m6e_nano_subscriber *sub);
+#endif
+
+#ifdef CONFIG_M6E_NANO_FIRMWARE
+/**
+ * @brief Update the firmware of the module from an image in a flash partition: start the
+ * bootloader, switch to the highest baud rate of the module, erase the application, write the
+ * image in M6E_NANO_FW_CHUNK_LEN chunks, have the bootloader verify its CRC-32 and boot it. Each
+ * chunk is read from flash while the module writes the one before, and the image is never
+ * copied to RAM whole. The remembered settings are applied to the new application, and reading
+ * restarted if it was running.
+ *
+ * The partition holds the image file as the vendor ships it, header included.
+ *
+ * @param dev UART peripheral device.
+ * @param area_id Flash area of the image, for example FIXED_PARTITION_ID(m6e_fw_partition).
+ * @param stats Outcome and throughput of the update, may be NULL.
+ * @return int 0 on success, -EBADMSG if the partition does not hold a firmware image, -EIO if
+ * the module reported an error or the image in its flash does not match, -ETIMEDOUT if it
+ * stopped answering, negative errno otherwise. The module stays in the bootloader if the update
+ * failed after starting it, and a new update picks up from there.
+ */
+int m6e_nano_update_firmware(const struct device *dev, uint8_t area_id,
+			     struct m6e_nano_fw_stats *stats);
+#endif
+
+#ifdef CONFIG_M6E_NANO_BRIDGE
+/**
+ * @brief Bridge a host-facing UART, such as a USB CDC ACM port, to the module UART so that vendor
+ * tools talk to the module through the MCU. Bytes are passed on untouched in both directions
+ * through ring buffers filled and drained by the UART interrupts, and a full ring holds the
+ * sending side back rather than dropping bytes. The driver stops reading and its commands fail
+ * with -EBUSY until the bridge stops; a frame tap counts the traffic and follows the baud rate
+ * changes of SET_BAUD_RATE commands on both UARTs. The bridge holds a PM device runtime
+ * reference on the device while it is on.
+ *
+ * @param dev UART peripheral device.
+ * @param host Host-facing UART, interrupt driven, not the console or shell backend.
+ * @return int 0 on success, -EALREADY if the bridge is on, -EINVAL if host is the module UART,
+ * -ENODEV if host is not ready, -EBUSY while the inventory scheduler runs, -ENOTSUP if host
+ * has no interrupt-driven API, negative errno if the device could not be resumed.
+ */
+int m6e_nano_bridge_start(const struct device *dev, const struct device *host);
+
+/**
+ * @brief Stop the bridge and take the module back: the remembered settings are applied again,
+ * since the vendor tool may have changed them, and reading restarted if it was running.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, -EALREADY if the bridge is off, negative errno if the settings
+ * could not be applied.
+ */
+int m6e_nano_bridge_stop(const struct device *dev);
+
+/**
+ * @brief Retrieve the traffic counters of the bridge, kept from its start until the next one.
+ *
+ * @param dev UART peripheral device.
+ * @param to_module Traffic from the host to the module.
+ * @param to_host Traffic from the module to the host.
+ * @return bool Whether the bridge is on.
+ */
+bool m6e_nano_get_bridge_stats(const struct device *dev, struct m6e_nano_bridge_stats *to_module,
+			       struct m6e_nano_bridge_stats *to_host);
+#endif
+
 #endif // M6E_NANO_PERIPHERAL_H
\ No newline at end of file
@@ -0,0 +1,404 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_internal.h"
+
+LOG_MODULE_DECLARE(M6E_NANO, CONFIG_M6E_NANO_LOG_LEVEL);
+
+// Options of TMR_SR_OPCODE_SET_ANTENNA_PORT
+#define ANTENNA_OPTION_SEARCH_LIST 0x02 // (TX, RX) pairs searched in turn
+#define ANTENNA_OPTION_POWERS      0x03 // Read and write power per port
+
+// Largest port number, the tag metadata holds it in 4 bits
+#define ANTENNA_MAX_PORT 15
+
+/**
+ * @brief Check whether a port of the list is read. Ports switched by the driver also need a
+ * dwell time.
+ *
+ * @param ant Antenna state.
+ * @param index Index of the port.
+ * @return true if the port is read.
+ */
+static bool _antenna_used(const struct m6e_nano_antennas *ant, uint8_t index)
+{
+	return !ant->stats[index].skipped && (!ant->sequencing || ant->ports[index].dwell_ms > 0);
+}
+
+/**
+ * @brief Find the next port of the list that is read.
+ *
+ * @param ant Antenna state.
+ * @param from Index to start looking at, wrapping around.
+ * @return int Index of the port, -ENODEV if no port is read.
+ */
+static int _antenna_next(const struct m6e_nano_antennas *ant, uint8_t from)
+{
+	for (uint8_t i = 0; i < ant->count; i++) {
+		uint8_t index = (from + i) % ant->count;
+
+		if (_antenna_used(ant, index)) {
+			return index;
+		}
+	}
+
+	return -ENODEV;
+}
+
+/**
+ * @brief Point the module at a single port of the list.
+ *
+ * @param dev UART peripheral device.
+ * @param index Index of the port.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _antenna_select(const struct device *dev, uint8_t index)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	const struct m6e_nano_antenna_port *port = &data->antennas.ports[index];
+	uint8_t cmd[] = {port->tx, port->rx};
+	uint16_t power = port->read_power;
+	int ret;
+
+	ret = _m6e_nano_command(dev, TMR_SR_OPCODE_SET_ANTENNA_PORT, cmd, sizeof(cmd));
+	if (ret < 0) {
+		return ret;
+	}
+
+	// Ports without their own power go back to the configured one, which stays remembered
+	if (power == 0 && (data->settings.valid & M6E_NANO_SETTING_READ_POWER)) {
+		power = data->settings.read_power;
+	}
+	if (power > 0) {
+		power = MIN(power, data->caps.max_read_power);
+		cmd[0] = power >> 8;
+		cmd[1] = power & 0xFF;
+		ret = _m6e_nano_command(dev, TMR_SR_OPCODE_SET_READ_TX_POWER, cmd, sizeof(cmd));
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Hand the ports that are not skipped to the module, which searches them in turn.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _antenna_send_list(const struct device *dev)
+{
+	struct m6e_nano_antennas *ant = &((struct m6e_nano_data *)dev->data)->antennas;
+	uint8_t list[1 + 2 * CONFIG_M6E_NANO_ANTENNA_MAX_PORTS];
+	uint8_t powers[1 + 5 * CONFIG_M6E_NANO_ANTENNA_MAX_PORTS];
+	uint8_t list_len = 0;
+	uint8_t powers_len = 0;
+	int ret;
+
+	list[list_len++] = ANTENNA_OPTION_SEARCH_LIST;
+	powers[powers_len++] = ANTENNA_OPTION_POWERS;
+	for (uint8_t i = 0; i < ant->count; i++) {
+		const struct m6e_nano_antenna_port *port = &ant->ports[i];
+
+		if (ant->stats[i].skipped) {
+			continue;
+		}
+
+		list[list_len++] = port->tx;
+		list[list_len++] = port->rx;
+
+		if (port->read_power > 0) {
+			// The write power follows the read power
+			powers[powers_len++] = port->tx;
+			powers[powers_len++] = port->read_power >> 8;
+			powers[powers_len++] = port->read_power & 0xFF;
+			powers[powers_len++] = port->read_power >> 8;
+			powers[powers_len++] = port->read_power & 0xFF;
+		}
+	}
+
+	ret = _m6e_nano_command(dev, TMR_SR_OPCODE_SET_ANTENNA_PORT, list, list_len);
+	if (ret == 0 && powers_len > 1) {
+		ret = _m6e_nano_command(dev, TMR_SR_OPCODE_SET_ANTENNA_PORT, powers, powers_len);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Configure the module for the port list, or the default port without one. Called when
+ * the list changes and when settings are re-applied.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, -ENODEV if every port is skipped, negative errno otherwise.
+ */
+int m6e_nano_antenna_apply(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_antennas *ant = &data->antennas;
+	uint8_t usable = 0;
+	uint8_t dwell = 0;
+	int first;
+
+	if (ant->count == 0) {
+		return m6e_nano_set_antenna_port(dev);
+	}
+
+	for (uint8_t i = 0; i < ant->count; i++) {
+		if (!ant->stats[i].skipped) {
+			usable++;
+			dwell += ant->ports[i].dwell_ms > 0;
+		}
+	}
+
+	// A port read alone, or ports switched by the driver, are selected one at a time
+	ant->sequencing = dwell > 0;
+	first = _antenna_next(ant, 0);
+	if (first < 0) {
+		return first;
+	}
+
+	data->settings.valid |= M6E_NANO_SETTING_ANTENNA;
+	ant->current = first;
+	if (usable == 1 || ant->sequencing) {
+		return _antenna_select(dev, first);
+	}
+
+	return _antenna_send_list(dev);
+}
+
+/**
+ * @brief Stop reading, move to the next port once the module acknowledged the stop and read
+ * again. Called with the driver lock held.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _antenna_advance(const struct device *dev)
+{
+	struct m6e_nano_antennas *ant = &((struct m6e_nano_data *)dev->data)->antennas;
+	int next;
+	int ret;
+
+	next = _antenna_next(ant, ant->current + 1);
+	if (next < 0 || next == ant->current) {
+		return;
+	}
+
+	// Tags still streaming would be taken for the answers to the port switch
+	ret = _m6e_nano_stop_reading(dev);
+	if (ret == 0) {
+		ret = _antenna_select(dev, next);
+	}
+	if (ret == 0) {
+		ant->current = next;
+		ant->switches++;
+	} else {
+		LOG_WRN("Failed to switch to antenna %u (%d).", ant->ports[next].tx, ret);
+	}
+
+	// Reading restarts on the previous port if the switch failed
+	ret = m6e_nano_start_reading(dev);
+	if (ret < 0) {
+		LOG_WRN("Failed to restart reading (%d).", ret);
+	}
+}
+
+/**
+ * @brief Dwell time of the current port elapsed: stop reading, move to the next port and read
+ * again.
+ *
+ * @param work Dwell work item of the driver instance.
+ */
+static void m6e_nano_dwell_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct m6e_nano_antennas *ant = CONTAINER_OF(dwork, struct m6e_nano_antennas, dwell_work);
+	struct m6e_nano_data *data = CONTAINER_OF(ant, struct m6e_nano_data, antennas);
+
+	// Reading may stop or the port list change while the handler waits for the lock
+	k_mutex_lock(&data->lock, K_FOREVER);
+	if (data->reading && ant->sequencing) {
+		_antenna_advance(data->dev);
+	}
+	k_mutex_unlock(&data->lock);
+}
+
+/**
+ * @brief Initialize the antenna port list of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_antenna_init(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	k_work_init_delayable(&data->antennas.dwell_work, m6e_nano_dwell_work_handler);
+}
+
+/**
+ * @brief Follow continuous reading starting or stopping, to switch ports after their dwell
+ * time.
+ *
+ * @param dev UART peripheral device.
+ * @param reading Whether continuous reading started.
+ */
+void m6e_nano_antenna_reading(const struct device *dev, bool reading)
+{
+	struct m6e_nano_antennas *ant = &((struct m6e_nano_data *)dev->data)->antennas;
+
+	if (!reading) {
+		// Not waiting, the dwell handler itself stops reading
+		k_work_cancel_delayable(&ant->dwell_work);
+		return;
+	}
+
+	if (ant->sequencing) {
+		k_work_reschedule_for_queue(&m6e_nano_workq, &ant->dwell_work,
+					    K_MSEC(ant->ports[ant->current].dwell_ms));
+	}
+}
+
+/**
+ * @brief Attribute a tag read to its port. Called from the UART ISR as the frame completes.
+ *
+ * @param dev UART peripheral device.
+ * @param antenna Antenna byte of the tag read, TX port in the 4 MSB.
+ */
+void m6e_nano_antenna_tag(const struct device *dev, uint8_t antenna)
+{
+	struct m6e_nano_antennas *ant = &((struct m6e_nano_data *)dev->data)->antennas;
+	uint8_t tx = antenna >> 4;
+	uint8_t rx = antenna & 0x0F;
+
+	for (uint8_t i = 0; i < ant->count; i++) {
+		if (ant->ports[i].tx == tx && ant->ports[i].rx == rx) {
+			ant->stats[i].reads++;
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Read from a list of antenna ports, for modules behind an antenna multiplexer. When
+ * every port has a dwell time of 0, the module switches ports itself at the end of each
+ * search; otherwise the driver reads each port with a dwell time for that long while reading
+ * continuously, and the ports without one are unused. Ports skipped by
+ * m6e_nano_check_antennas() are left out. Requires CONFIG_M6E_NANO_ANTENNAS.
+ *
+ * @param dev UART peripheral device.
+ * @param ports Ports in read order.
+ * @param count Number of ports, up to CONFIG_M6E_NANO_ANTENNA_MAX_PORTS.
+ * @return int 0 on success, -EINVAL for an invalid port list, negative errno otherwise.
+ */
+int m6e_nano_set_antenna_ports(const struct device *dev, const struct m6e_nano_antenna_port *ports,
+			       uint8_t count)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_antennas *ant = &data->antennas;
+
+	if (count == 0 || count > CONFIG_M6E_NANO_ANTENNA_MAX_PORTS) {
+		return -EINVAL;
+	}
+	for (uint8_t i = 0; i < count; i++) {
+		if (ports[i].tx < 1 || ports[i].tx > ANTENNA_MAX_PORT || ports[i].rx < 1 ||
+		    ports[i].rx > ANTENNA_MAX_PORT) {
+			return -EINVAL;
+		}
+	}
+
+	// A dwell handler already running sees the new list once it gets the lock
+	k_mutex_lock(&data->lock, K_FOREVER);
+	k_work_cancel_delayable(&ant->dwell_work);
+	memcpy(ant->ports, ports, count * sizeof(ports[0]));
+	memset(ant->stats, 0, sizeof(ant->stats));
+	ant->count = count;
+
+	int ret = m6e_nano_antenna_apply(dev);
+
+	k_mutex_unlock(&data->lock);
+
+	return ret;
+}
+
+/**
+ * @brief Measure the return loss of every port of the port list and skip the ports below
+ * CONFIG_M6E_NANO_ANTENNA_MIN_RETURN_LOSS, which have no antenna connected. Call it while not
+ * reading. Requires CONFIG_M6E_NANO_ANTENNAS.
+ *
+ * @param dev UART peripheral device.
+ * @return int Number of ports kept, -EINVAL without a port list, -ENODEV if none has an antenna,
+ * negative errno otherwise.
+ */
+int m6e_nano_check_antennas(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_antennas *ant = &data->antennas;
+	uint8_t loss[ANTENNA_MAX_PORT] = {0};
+	uint8_t kept = 0;
+	int ret;
+
+	if (ant->count == 0) {
+		return -EINVAL;
+	}
+	if (data->reading) {
+		return -EBUSY;
+	}
+
+	ret = m6e_nano_get_return_loss(dev, loss, ARRAY_SIZE(loss));
+	if (ret < 0) {
+		return ret;
+	}
+
+	for (uint8_t i = 0; i < ant->count; i++) {
+		struct m6e_nano_antenna_stats *stats = &ant->stats[i];
+
+		// Both ends of a bistatic pair need an antenna
+		stats->return_loss = MIN(loss[ant->ports[i].tx - 1], loss[ant->ports[i].rx - 1]);
+		stats->skipped = stats->return_loss < CONFIG_M6E_NANO_ANTENNA_MIN_RETURN_LOSS;
+		if (stats->skipped) {
+			LOG_WRN("Antenna %u/%u skipped, return loss %u dB.", ant->ports[i].tx,
+				ant->ports[i].rx, stats->return_loss);
+		} else {
+			kept++;
+		}
+	}
+
+	ret = m6e_nano_antenna_apply(dev);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return kept;
+}
+
+/**
+ * @brief Retrieve the statistics of a port of the port list. Requires CONFIG_M6E_NANO_ANTENNAS.
+ *
+ * @param dev UART peripheral device.
+ * @param index Index of the port in the port list.
+ * @param stats Destination for the statistics.
+ * @return int 0 on success, -EINVAL for an index outside the port list.
+ */
+int m6e_nano_get_antenna_stats(const struct device *dev, uint8_t index,
+			       struct m6e_nano_antenna_stats *stats)
+{
+	struct m6e_nano_antennas *ant = &((struct m6e_nano_data *)dev->data)->antennas;
+
+	if (index >= ant->count) {
+		return -EINVAL;
+	}
+
+	*stats = ant->stats[index];
+
+	return 0;
+}
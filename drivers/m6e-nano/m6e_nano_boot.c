@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_internal.h"
+
+LOG_MODULE_DECLARE(M6E_NANO, CONFIG_M6E_NANO_LOG_LEVEL);
+
+/**
+ * @brief Remember the devicetree configuration as the settings of the driver, so the
+ * supervisor restores it after a module reset.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _boot_load_settings(const struct device *dev)
+{
+	const struct m6e_nano_config *cfg = dev->config;
+	const struct m6e_nano_boot_config *boot = &cfg->boot;
+	struct m6e_nano_settings *settings = &((struct m6e_nano_data *)dev->data)->settings;
+
+	if (boot->region != 0) {
+		settings->region = boot->region;
+		settings->valid |= M6E_NANO_SETTING_REGION;
+	}
+	if (boot->protocol != 0) {
+		settings->protocol = boot->protocol;
+		settings->valid |= M6E_NANO_SETTING_PROTOCOL;
+	}
+	if (boot->read_power >= 0) {
+		settings->read_power = boot->read_power;
+		settings->valid |= M6E_NANO_SETTING_READ_POWER;
+	}
+	if (boot->write_power >= 0) {
+		settings->write_power = boot->write_power;
+		settings->valid |= M6E_NANO_SETTING_WRITE_POWER;
+	}
+	if (boot->antenna != 0) {
+		settings->antenna = boot->antenna;
+		settings->valid |= M6E_NANO_SETTING_ANTENNA;
+	}
+}
+
+/**
+ * @brief Probe and configure the module from the devicetree, retrying while it does not
+ * answer.
+ *
+ * @param work Boot work item of the driver instance.
+ */
+static void m6e_nano_boot_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct m6e_nano_boot *boot = CONTAINER_OF(dwork, struct m6e_nano_boot, work);
+	struct m6e_nano_data *data = CONTAINER_OF(boot, struct m6e_nano_data, boot);
+	const struct device *dev = data->dev;
+	const struct m6e_nano_config *cfg = dev->config;
+	int ret = 0;
+
+	// The first command waits for the startup message of a module powering up
+#ifdef CONFIG_M6E_NANO_PROBE_VERSION
+	ret = m6e_nano_get_version(dev, NULL);
+	if (ret == 0) {
+		LOG_INF("M6E module %08X, firmware %08X.", data->version.hardware,
+			data->version.fw_version);
+	}
+#endif
+	if (ret == 0) {
+		m6e_nano_stop_reading(dev);
+	}
+	if (ret == 0 && cfg->boot.baud != 0) {
+		ret = _m6e_nano_switch_baud(dev, cfg->boot.baud);
+		if (ret == -ENOTSUP) {
+			LOG_WRN("Baud rate unchanged, needs CONFIG_UART_USE_RUNTIME_CONFIGURE.");
+			ret = 0;
+		}
+	}
+	if (ret == 0) {
+		// Only once the module is up, its startup message would otherwise count as a reset
+		_boot_load_settings(dev);
+		ret = _m6e_nano_apply_settings(dev, cfg->boot.autostart);
+	}
+
+	if (ret < 0 && ++boot->attempts < CONFIG_M6E_NANO_ASYNC_INIT_ATTEMPTS) {
+		LOG_WRN("Module configuration failed (%d), retrying.", ret);
+		k_work_reschedule_for_queue(&m6e_nano_workq, &boot->work,
+					    K_MSEC(CFG_M6E_NANO_SERIAL_TIMEOUT));
+		return;
+	}
+
+	boot->status = ret;
+	k_sem_give(&boot->done);
+
+	if (ret < 0) {
+		LOG_ERR("Module configuration failed (%d).", ret);
+		_m6e_nano_notify(dev, M6E_NANO_EVENT_BOOT_FAILED);
+	} else {
+		_m6e_nano_notify(dev, M6E_NANO_EVENT_READY);
+	}
+}
+
+/**
+ * @brief Schedule the version probe and devicetree configuration of a driver instance on the
+ * driver work queue, so they do not hold up the other devices initialized at boot.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_boot_init(const struct device *dev)
+{
+	struct m6e_nano_boot *boot = &((struct m6e_nano_data *)dev->data)->boot;
+
+	boot->status = -EINPROGRESS;
+	boot->attempts = 0;
+	k_sem_init(&boot->done, 0, 1);
+	k_work_init_delayable(&boot->work, m6e_nano_boot_work_handler);
+
+	k_work_reschedule_for_queue(&m6e_nano_workq, &boot->work, K_NO_WAIT);
+}
+
+/**
+ * @brief Wait for the devicetree configuration applied after boot. Commands sent before it
+ * completes are serialized with it, but may be overridden by it. Requires
+ * CONFIG_M6E_NANO_ASYNC_INIT.
+ *
+ * @param dev UART peripheral device.
+ * @param timeout Longest wait.
+ * @return int 0 once configured, -EAGAIN on timeout, the error of the last attempt if it failed.
+ */
+int m6e_nano_wait_ready(const struct device *dev, k_timeout_t timeout)
+{
+	struct m6e_nano_boot *boot = &((struct m6e_nano_data *)dev->data)->boot;
+
+	if (boot->status == -EINPROGRESS) {
+		if (k_sem_take(&boot->done, timeout) < 0) {
+			return -EAGAIN;
+		}
+		// Let the other waiters through
+		k_sem_give(&boot->done);
+	}
+
+	return boot->status;
+}
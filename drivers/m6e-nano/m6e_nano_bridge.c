@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/pm/device_runtime.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/logging/log.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_internal.h"
+
+LOG_MODULE_DECLARE(M6E_NANO, CONFIG_M6E_NANO_LOG_LEVEL);
+
+// Bits a UART FIFO holds once the ring is empty, 64 bytes of 10 bits
+#define BRIDGE_FIFO_BITS 640
+
+/**
+ * @brief Look at a frame passing through the bridge. A SET_BAUD_RATE command is remembered, and
+ * once the module accepts it both UARTs follow from the work queue.
+ *
+ * @param bridge Bridge state.
+ * @param path Direction of the frame.
+ */
+static void _bridge_frame(struct m6e_nano_bridge *bridge, struct m6e_nano_bridge_path *path)
+{
+	const uint8_t *frame = path->tap.frame;
+
+	if (frame[2] != TMR_SR_OPCODE_SET_BAUD_RATE) {
+		return;
+	}
+
+	if (path == &bridge->to_module) {
+		// The new rate, big endian
+		bridge->baud = 0;
+		if (frame[1] == 4) {
+			bridge->baud = ((uint32_t)frame[3] << 24) | ((uint32_t)frame[4] << 16) |
+				       ((uint32_t)frame[5] << 8) | frame[6];
+		}
+	} else if (bridge->baud != 0 && m6e_nano_frame_status(frame) == 0) {
+		k_work_submit_to_queue(&m6e_nano_workq, &bridge->baud_work);
+	}
+}
+
+/**
+ * @brief Count the frames of bytes received on one side of the bridge.
+ *
+ * @param bridge Bridge state.
+ * @param path Direction of the bytes.
+ * @param buf Bytes received.
+ * @param len Number of bytes.
+ */
+static void _bridge_tap(struct m6e_nano_bridge *bridge, struct m6e_nano_bridge_path *path,
+			const uint8_t *buf, size_t len)
+{
+	size_t used = 0;
+	bool complete;
+
+	while (used < len) {
+		used += m6e_nano_tap_feed(&path->tap, &buf[used], len - used, &complete);
+		if (complete) {
+			_bridge_frame(bridge, path);
+		}
+	}
+}
+
+/**
+ * @brief Service the interrupt of one UART of the bridge: move received bytes straight from its
+ * FIFO into the ring of their direction, and fill its FIFO from the ring of the other one. A
+ * full ring leaves bytes in the FIFO, so USB and UARTs with flow control hold the sender back,
+ * until the other UART makes room.
+ *
+ * @param bridge Bridge state.
+ * @param uart UART that interrupted.
+ * @param rx Direction of the bytes it receives.
+ * @param tx Direction of the bytes it sends.
+ * @param peer The other UART.
+ */
+static void _bridge_service(struct m6e_nano_bridge *bridge, const struct device *uart,
+			    struct m6e_nano_bridge_path *rx, struct m6e_nano_bridge_path *tx,
+			    const struct device *peer)
+{
+	uint32_t size;
+	uint8_t *buf;
+	int len;
+
+	if (uart_irq_update(uart) <= 0) {
+		return;
+	}
+
+	while (uart_irq_rx_ready(uart)) {
+		size = ring_buf_put_claim(&rx->ring, &buf, CONFIG_M6E_NANO_BRIDGE_BUF_SIZE);
+		if (size == 0) {
+			rx->stalls++;
+			uart_irq_rx_disable(uart);
+			// The peer may have made room in between
+			if (ring_buf_space_get(&rx->ring) > 0) {
+				uart_irq_rx_enable(uart);
+			}
+			break;
+		}
+
+		len = uart_fifo_read(uart, buf, size);
+		if (len <= 0) {
+			ring_buf_put_finish(&rx->ring, 0);
+			break;
+		}
+		_bridge_tap(bridge, rx, buf, len);
+		ring_buf_put_finish(&rx->ring, len);
+		uart_irq_tx_enable(peer);
+	}
+
+	if (uart_irq_tx_ready(uart)) {
+		size = ring_buf_get_claim(&tx->ring, &buf, CONFIG_M6E_NANO_BRIDGE_BUF_SIZE);
+		if (size == 0) {
+			uart_irq_tx_disable(uart);
+			// The peer may have added bytes in between
+			if (!ring_buf_is_empty(&tx->ring)) {
+				uart_irq_tx_enable(uart);
+			}
+			return;
+		}
+
+		len = uart_fifo_fill(uart, buf, size);
+		ring_buf_get_finish(&tx->ring, MAX(len, 0));
+		// Room again for bytes the peer held back
+		uart_irq_rx_enable(peer);
+	}
+}
+
+/**
+ * @brief Interrupt of the host-facing UART.
+ *
+ * @param uart Host-facing UART.
+ * @param user_data Driver device.
+ */
+static void _bridge_host_isr(const struct device *uart, void *user_data)
+{
+	const struct device *dev = user_data;
+	const struct m6e_nano_config *cfg = dev->config;
+	struct m6e_nano_bridge *bridge = &((struct m6e_nano_data *)dev->data)->bridge;
+
+	_bridge_service(bridge, uart, &bridge->to_module, &bridge->to_host, cfg->uart_dev);
+}
+
+/**
+ * @brief Pass bytes on between the module UART and the bridge. Called from the UART interrupt
+ * in place of the frame receiver while the bridge is on.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_bridge_isr(const struct device *dev)
+{
+	const struct m6e_nano_config *cfg = dev->config;
+	struct m6e_nano_bridge *bridge = &((struct m6e_nano_data *)dev->data)->bridge;
+
+	_bridge_service(bridge, cfg->uart_dev, &bridge->to_host, &bridge->to_module, bridge->host);
+}
+
+/**
+ * @brief Switch both UARTs to the baud rate the module accepted. The module UART switches
+ * straight away; the host-facing one once the response has left it at the old rate. A USB CDC
+ * ACM port already runs at whatever rate the host set.
+ *
+ * @param work Work item.
+ */
+static void _bridge_baud_work_handler(struct k_work *work)
+{
+#ifdef CONFIG_UART_USE_RUNTIME_CONFIGURE
+	struct m6e_nano_bridge *bridge = CONTAINER_OF(work, struct m6e_nano_bridge, baud_work);
+	struct m6e_nano_data *data = CONTAINER_OF(bridge, struct m6e_nano_data, bridge);
+	const struct m6e_nano_config *cfg = data->dev->config;
+	const struct device *host = bridge->host;
+	struct uart_config uart_cfg;
+	uint32_t baud = bridge->baud;
+	int ret;
+
+	bridge->baud = 0;
+	if (host == NULL || baud == 0) {
+		return;
+	}
+
+	ret = uart_config_get(cfg->uart_dev, &uart_cfg);
+	if (ret == 0) {
+		uart_cfg.baudrate = baud;
+		ret = uart_configure(cfg->uart_dev, &uart_cfg);
+	}
+	if (ret < 0) {
+		LOG_WRN("Module UART not switched to %u baud (%d).", baud, ret);
+		return;
+	}
+
+	if (uart_config_get(host, &uart_cfg) < 0 || uart_cfg.baudrate == baud) {
+		return;
+	}
+	while (bridge->host != NULL && !ring_buf_is_empty(&bridge->to_host.ring)) {
+		k_msleep(1);
+	}
+	k_msleep(BRIDGE_FIFO_BITS * MSEC_PER_SEC / uart_cfg.baudrate + 1);
+
+	uart_cfg.baudrate = baud;
+	ret = uart_configure(host, &uart_cfg);
+	LOG_DBG("Bridge switched to %u baud (%d).", baud, ret);
+#else
+	ARG_UNUSED(work);
+#endif
+}
+
+/**
+ * @brief Reset one direction of the bridge.
+ *
+ * @param path Direction.
+ * @param overhead Frame overhead of the direction, see m6e_nano_tap_init().
+ */
+static void _bridge_path_init(struct m6e_nano_bridge_path *path, uint8_t overhead)
+{
+	ring_buf_init(&path->ring, sizeof(path->buf), path->buf);
+	m6e_nano_tap_init(&path->tap, overhead);
+	path->stalls = 0;
+}
+
+/**
+ * @brief Initialize the bridge of a driver instance, off.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_bridge_init(const struct device *dev)
+{
+	struct m6e_nano_bridge *bridge = &((struct m6e_nano_data *)dev->data)->bridge;
+
+	bridge->host = NULL;
+	k_work_init(&bridge->baud_work, _bridge_baud_work_handler);
+	_bridge_path_init(&bridge->to_module, M6E_NANO_COMMAND_OVERHEAD);
+	_bridge_path_init(&bridge->to_host, M6E_NANO_FRAME_OVERHEAD);
+}
+
+/**
+ * @brief Bridge a host-facing UART, such as a USB CDC ACM port, to the module UART so that vendor
+ * tools talk to the module through the MCU. Bytes are passed on untouched in both directions
+ * through ring buffers filled and drained by the UART interrupts, and a full ring holds the
+ * sending side back rather than dropping bytes. The driver stops reading and its commands fail
+ * with -EBUSY until the bridge stops; a frame tap counts the traffic and follows the baud rate
+ * changes of SET_BAUD_RATE commands on both UARTs. The bridge holds a PM device runtime
+ * reference on the device while it is on.
+ *
+ * @param dev UART peripheral device.
+ * @param host Host-facing UART, interrupt driven, not the console or shell backend.
+ * @return int 0 on success, -EALREADY if the bridge is on, -EINVAL if host is the module UART,
+ * -ENODEV if host is not ready, -EBUSY while the inventory scheduler runs, -ENOTSUP if host
+ * has no interrupt-driven API, negative errno if the device could not be resumed.
+ */
+int m6e_nano_bridge_start(const struct device *dev, const struct device *host)
+{
+	const struct m6e_nano_config *cfg = dev->config;
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_bridge *bridge = &data->bridge;
+	int ret;
+
+	if (host == cfg->uart_dev) {
+		return -EINVAL;
+	}
+	if (!device_is_ready(host)) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&data->lock, K_FOREVER);
+	if (bridge->host != NULL) {
+		k_mutex_unlock(&data->lock);
+		return -EALREADY;
+	}
+#ifdef CONFIG_M6E_NANO_SCHEDULER
+	// Its windows would wake and put the module to sleep under the host
+	if (data->sched.running) {
+		k_mutex_unlock(&data->lock);
+		return -EBUSY;
+	}
+#endif
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+	ret = pm_device_runtime_get(dev);
+	if (ret < 0) {
+		k_mutex_unlock(&data->lock);
+		return ret;
+	}
+#endif
+
+	bridge->reading = data->reading;
+	m6e_nano_stop_reading(dev);
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	// The module answers the host now, its silence is no failure to recover from
+	bridge->supervised = data->supervised;
+	m6e_nano_set_supervised(dev, false);
+#endif
+
+	uart_irq_rx_disable(cfg->uart_dev);
+	_bridge_path_init(&bridge->to_module, M6E_NANO_COMMAND_OVERHEAD);
+	_bridge_path_init(&bridge->to_host, M6E_NANO_FRAME_OVERHEAD);
+	bridge->baud = 0;
+	bridge->host = host;
+
+	ret = uart_irq_callback_user_data_set(host, _bridge_host_isr, (void *)dev);
+	if (ret < 0) {
+		// Hand the module back as it was
+		bridge->host = NULL;
+		data->response.len = 0;
+		data->status = RESPONSE_CLEAR;
+		uart_irq_rx_enable(cfg->uart_dev);
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+		m6e_nano_set_supervised(dev, bridge->supervised);
+#endif
+		if (bridge->reading) {
+			m6e_nano_start_reading(dev);
+		}
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+		pm_device_runtime_put(dev);
+#endif
+		k_mutex_unlock(&data->lock);
+		LOG_ERR("No interrupt callback on %s (%d).", host->name, ret);
+		return ret;
+	}
+	uart_irq_rx_enable(host);
+	uart_irq_rx_enable(cfg->uart_dev);
+	k_mutex_unlock(&data->lock);
+
+	LOG_INF("Bridge to %s started.", host->name);
+
+	return 0;
+}
+
+/**
+ * @brief Stop the bridge and take the module back: the remembered settings are applied again,
+ * since the vendor tool may have changed them, and reading restarted if it was running.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, -EALREADY if the bridge is off, negative errno if the settings
+ * could not be applied.
+ */
+int m6e_nano_bridge_stop(const struct device *dev)
+{
+	const struct m6e_nano_config *cfg = dev->config;
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_bridge *bridge = &data->bridge;
+	const struct device *host;
+	struct k_work_sync sync;
+	int ret;
+
+	k_mutex_lock(&data->lock, K_FOREVER);
+	host = bridge->host;
+	if (host == NULL) {
+		k_mutex_unlock(&data->lock);
+		return -EALREADY;
+	}
+
+	uart_irq_rx_disable(host);
+	uart_irq_tx_disable(host);
+	uart_irq_rx_disable(cfg->uart_dev);
+	uart_irq_tx_disable(cfg->uart_dev);
+	uart_irq_callback_user_data_set(host, NULL, NULL);
+	bridge->host = NULL;
+	k_work_cancel_sync(&bridge->baud_work, &sync);
+
+	LOG_INF("Bridge to %s stopped, %u bytes to the module, %u bytes to the host.", host->name,
+		bridge->to_module.tap.bytes, bridge->to_host.tap.bytes);
+
+	data->response.len = 0;
+	data->status = RESPONSE_CLEAR;
+	uart_irq_rx_enable(cfg->uart_dev);
+
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	m6e_nano_set_supervised(dev, bridge->supervised);
+#endif
+	ret = _m6e_nano_apply_settings(dev, bridge->reading);
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+	pm_device_runtime_put(dev);
+#endif
+	k_mutex_unlock(&data->lock);
+
+	return ret;
+}
+
+/**
+ * @brief Copy the counters of one direction of the bridge.
+ *
+ * @param path Direction.
+ * @param stats Destination.
+ */
+static void _bridge_stats(const struct m6e_nano_bridge_path *path,
+			  struct m6e_nano_bridge_stats *stats)
+{
+	stats->bytes = path->tap.bytes;
+	stats->frames = path->tap.frames;
+	stats->crc_errors = path->tap.crc_errors;
+	stats->stalls = path->stalls;
+}
+
+/**
+ * @brief Retrieve the traffic counters of the bridge, kept from its start until the next one.
+ *
+ * @param dev UART peripheral device.
+ * @param to_module Traffic from the host to the module.
+ * @param to_host Traffic from the module to the host.
+ * @return bool Whether the bridge is on.
+ */
+bool m6e_nano_get_bridge_stats(const struct device *dev, struct m6e_nano_bridge_stats *to_module,
+			       struct m6e_nano_bridge_stats *to_host)
+{
+	struct m6e_nano_bridge *bridge = &((struct m6e_nano_data *)dev->data)->bridge;
+
+	_bridge_stats(&bridge->to_module, to_module);
+	_bridge_stats(&bridge->to_host, to_host);
+
+	return bridge->host != NULL;
+}
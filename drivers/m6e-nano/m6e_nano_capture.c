@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/logging/log.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_capture.h"
+#include "m6e_nano_internal.h"
+
+LOG_MODULE_DECLARE(M6E_NANO, CONFIG_M6E_NANO_LOG_LEVEL);
+
+// Time, flags and length stored ahead of each frame in the ring buffer
+#define CAPTURE_HEADER_LEN 6
+
+/**
+ * @brief Capture a frame. Safe to call from an ISR.
+ *
+ * @param dev Driver device.
+ * @param flags Direction and flags, M6E_NANO_CAPTURE_*.
+ * @param frame Frame bytes.
+ * @param len Length of the frame.
+ */
+void m6e_nano_capture(const struct device *dev, uint8_t flags, const uint8_t *frame, size_t len)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_capture *capture = &data->capture;
+	uint32_t time_us = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+	uint8_t header[CAPTURE_HEADER_LEN];
+	k_spinlock_key_t key;
+
+	if (!capture->enabled) {
+		return;
+	}
+
+	len = MIN(len, UINT8_MAX);
+	memcpy(header, &time_us, sizeof(time_us));
+	header[4] = flags;
+	header[5] = len;
+
+	key = k_spin_lock(&capture->lock);
+
+	// Make room by dropping the oldest frames
+	while (ring_buf_space_get(&capture->rb) < CAPTURE_HEADER_LEN + len &&
+	       !ring_buf_is_empty(&capture->rb)) {
+		uint8_t old[CAPTURE_HEADER_LEN];
+
+		ring_buf_get(&capture->rb, old, sizeof(old));
+		ring_buf_get(&capture->rb, NULL, old[5]);
+		capture->overwritten++;
+	}
+
+	if (ring_buf_space_get(&capture->rb) >= CAPTURE_HEADER_LEN + len) {
+		ring_buf_put(&capture->rb, header, sizeof(header));
+		ring_buf_put(&capture->rb, frame, len);
+	}
+
+	k_spin_unlock(&capture->lock, key);
+}
+
+/**
+ * @brief Enable or disable frame capture.
+ *
+ * @param dev Driver device.
+ * @param enable Whether to capture frames.
+ */
+void m6e_nano_capture_enable(const struct device *dev, bool enable)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	data->capture.enabled = enable;
+}
+
+/**
+ * @brief Take the oldest captured frame out of the capture buffer.
+ *
+ * @param dev Driver device.
+ * @param record Destination for the frame.
+ * @return int 0 on success, -ENODATA if no frame is captured.
+ */
+int m6e_nano_capture_get(const struct device *dev, struct m6e_nano_capture_record *record)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_capture *capture = &data->capture;
+	uint8_t header[CAPTURE_HEADER_LEN];
+	k_spinlock_key_t key = k_spin_lock(&capture->lock);
+
+	if (ring_buf_is_empty(&capture->rb)) {
+		k_spin_unlock(&capture->lock, key);
+		return -ENODATA;
+	}
+
+	ring_buf_get(&capture->rb, header, sizeof(header));
+	memcpy(&record->time_us, header, sizeof(record->time_us));
+	record->flags = header[4];
+	record->len = header[5];
+	ring_buf_get(&capture->rb, record->data, record->len);
+
+	k_spin_unlock(&capture->lock, key);
+
+	return 0;
+}
+
+/**
+ * @brief Drop every captured frame.
+ *
+ * @param dev Driver device.
+ */
+void m6e_nano_capture_clear(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->capture.lock);
+
+	ring_buf_reset(&data->capture.rb);
+	k_spin_unlock(&data->capture.lock, key);
+}
+
+/**
+ * @brief Retrieve the number of frames lost to newer ones.
+ *
+ * @param dev Driver device.
+ * @param reset Whether to restart counting from 0.
+ * @return uint32_t Frames overwritten since boot or the last reset.
+ */
+uint32_t m6e_nano_capture_overwritten(const struct device *dev, bool reset)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->capture.lock);
+	uint32_t overwritten = data->capture.overwritten;
+
+	if (reset) {
+		data->capture.overwritten = 0;
+	}
+	k_spin_unlock(&data->capture.lock, key);
+
+	return overwritten;
+}
+
+/**
+ * @brief Format a captured frame as a line for the host decoder.
+ *
+ * @param record Captured frame.
+ * @param buf Destination.
+ * @param size Size of the destination.
+ * @return int Length of the line, negative errno if it does not fit.
+ */
+int m6e_nano_capture_format(const struct m6e_nano_capture_record *record, char *buf, size_t size)
+{
+	int len = snprintf(buf, size, "%u %s%s ", record->time_us,
+			   (record->flags & M6E_NANO_CAPTURE_DIR_MASK) == M6E_NANO_CAPTURE_TX ? "TX"
+											: "RX",
+			   (record->flags & M6E_NANO_CAPTURE_TRUNCATED) ? "!" : "");
+
+	if (len < 0 || len + (2 * record->len) + 1 > size) {
+		return -ENOMEM;
+	}
+
+	for (uint8_t i = 0; i < record->len; i++) {
+		len += snprintf(&buf[len], size - len, "%02x", record->data[i]);
+	}
+
+	return len;
+}
+
+#ifdef CONFIG_M6E_NANO_CAPTURE_LOG
+/**
+ * @brief Drain captured frames to the log.
+ *
+ * @param work Log work item of the driver instance.
+ */
+static void m6e_nano_capture_log_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct m6e_nano_capture *capture = CONTAINER_OF(dwork, struct m6e_nano_capture, log_work);
+	struct m6e_nano_data *data = CONTAINER_OF(capture, struct m6e_nano_data, capture);
+	// Only ever used from this work item
+	static struct m6e_nano_capture_record record;
+	static char line[M6E_NANO_CAPTURE_LINE_LEN];
+
+	while (m6e_nano_capture_get(data->dev, &record) == 0) {
+		if (m6e_nano_capture_format(&record, line, sizeof(line)) > 0) {
+			LOG_INF("%s", line);
+		}
+	}
+
+	k_work_reschedule_for_queue(&m6e_nano_workq, &capture->log_work,
+				    K_MSEC(CONFIG_M6E_NANO_CAPTURE_LOG_INTERVAL_MS));
+}
+#endif
+
+/**
+ * @brief Initialize frame capture of a driver instance.
+ *
+ * @param dev Driver device.
+ */
+void m6e_nano_capture_init(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_capture *capture = &data->capture;
+
+	ring_buf_init(&capture->rb, sizeof(capture->buf), capture->buf);
+	capture->enabled = true;
+
+#ifdef CONFIG_M6E_NANO_CAPTURE_LOG
+	k_work_init_delayable(&capture->log_work, m6e_nano_capture_log_work_handler);
+	k_work_reschedule_for_queue(&m6e_nano_workq, &capture->log_work,
+				    K_MSEC(CONFIG_M6E_NANO_CAPTURE_LOG_INTERVAL_MS));
+#endif
+}
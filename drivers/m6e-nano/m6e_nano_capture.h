@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_CAPTURE_H
+#define M6E_NANO_CAPTURE_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+#ifdef CONFIG_M6E_NANO_CAPTURE
+#include <zephyr/sys/ring_buffer.h>
+#endif
+
+/*
+ * Raw capture of the complete frames exchanged with the module. Frames are copied with their
+ * timestamp into a ring buffer from the UART ISR, overwriting the oldest ones when full, and
+ * read back later from thread context. Each frame is formatted as one line:
+ *
+ *   <time in us> RX|TX[!] <frame in hex>
+ *
+ * where ! marks a truncated frame. scripts/m6e_nano_decode.py decodes these lines on a host.
+ * Without CONFIG_M6E_NANO_CAPTURE the M6E_NANO_CAPTURE() macro expands to nothing.
+ */
+
+// Direction and flags of a captured frame
+#define M6E_NANO_CAPTURE_RX        0x00
+#define M6E_NANO_CAPTURE_TX        0x01
+#define M6E_NANO_CAPTURE_DIR_MASK  0x01
+#define M6E_NANO_CAPTURE_TRUNCATED 0x80 // Frame did not fit the receive buffer
+
+// Longest line written by m6e_nano_capture_format(), with its terminator
+#define M6E_NANO_CAPTURE_LINE_LEN (10 + 4 + 1 + (2 * 255) + 1)
+
+struct m6e_nano_capture_record {
+	uint32_t time_us; // Uptime, wraps every 71 minutes
+	uint8_t flags;    // M6E_NANO_CAPTURE_RX or _TX, and M6E_NANO_CAPTURE_TRUNCATED
+	uint8_t len;
+	uint8_t data[255];
+};
+
+#ifdef CONFIG_M6E_NANO_CAPTURE
+struct m6e_nano_capture {
+	struct ring_buf rb;
+	uint8_t buf[CONFIG_M6E_NANO_CAPTURE_BUF_SIZE];
+	struct k_spinlock lock;
+	bool enabled;
+	uint32_t overwritten; // Frames lost to newer ones
+#ifdef CONFIG_M6E_NANO_CAPTURE_LOG
+	struct k_work_delayable log_work;
+#endif
+};
+
+/**
+ * @brief Capture a frame. Safe to call from an ISR.
+ *
+ * @param dev Driver device.
+ * @param flags Direction and flags, M6E_NANO_CAPTURE_*.
+ * @param frame Frame bytes.
+ * @param len Length of the frame.
+ */
+void m6e_nano_capture(const struct device *dev, uint8_t flags, const uint8_t *frame, size_t len);
+
+/**
+ * @brief Initialize frame capture of a driver instance.
+ *
+ * @param dev Driver device.
+ */
+void m6e_nano_capture_init(const struct device *dev);
+
+#define M6E_NANO_CAPTURE(dev, flags, frame, len) m6e_nano_capture(dev, flags, frame, len)
+#else
+#define M6E_NANO_CAPTURE(dev, flags, frame, len)                                                   \
+	do {                                                                                       \
+	} while (0)
+#endif
+
+/**
+ * @brief Enable or disable frame capture. Capture is enabled at boot. Requires
+ * CONFIG_M6E_NANO_CAPTURE.
+ *
+ * @param dev Driver device.
+ * @param enable Whether to capture frames.
+ */
+void m6e_nano_capture_enable(const struct device *dev, bool enable);
+
+/**
+ * @brief Take the oldest captured frame out of the capture buffer.
+ *
+ * @param dev Driver device.
+ * @param record Destination for the frame.
+ * @return int 0 on success, -ENODATA if no frame is captured.
+ */
+int m6e_nano_capture_get(const struct device *dev, struct m6e_nano_capture_record *record);
+
+/**
+ * @brief Drop every captured frame.
+ *
+ * @param dev Driver device.
+ */
+void m6e_nano_capture_clear(const struct device *dev);
+
+/**
+ * @brief Retrieve the number of frames lost to newer ones.
+ *
+ * @param dev Driver device.
+ * @param reset Whether to restart counting from 0.
+ * @return uint32_t Frames overwritten since boot or the last reset.
+ */
+uint32_t m6e_nano_capture_overwritten(const struct device *dev, bool reset);
+
+/**
+ * @brief Format a captured frame as a line for the host decoder.
+ *
+ * @param record Captured frame.
+ * @param buf Destination, M6E_NANO_CAPTURE_LINE_LEN bytes fit any frame.
+ * @param size Size of the destination.
+ * @return int Length of the line, negative errno if it does not fit.
+ */
+int m6e_nano_capture_format(const struct m6e_nano_capture_record *record, char *buf, size_t size);
+
+#endif // M6E_NANO_CAPTURE_H
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "m6e_nano_clock.h"
+
+/**
+ * @brief Reset the clock, keeping its reader offset.
+ *
+ * @param clock Clock state.
+ */
+void m6e_nano_clock_init(struct m6e_nano_clock *clock)
+{
+	int32_t offset_us = clock->offset_us;
+
+	memset(clock, 0, sizeof(*clock));
+	clock->offset_us = offset_us;
+}
+
+/**
+ * @brief Module time elapsed since the anchor in host us, corrected for drift.
+ *
+ * @param clock Clock state.
+ * @param ts Tag timestamp in ms.
+ * @return int64_t Elapsed host time in us.
+ */
+static int64_t _clock_elapsed(const struct m6e_nano_clock *clock, uint32_t ts)
+{
+	return (int64_t)ts * 1000 + (int64_t)ts * clock->drift_ppm / 1000;
+}
+
+/**
+ * @brief Set a new anchor and restart the drift windows. The drift estimate is kept, it is a
+ * property of the module clock.
+ *
+ * @param clock Clock state.
+ * @param epoch_us Host time of module time 0.
+ */
+static void _clock_anchor(struct m6e_nano_clock *clock, int64_t epoch_us)
+{
+	clock->anchored = true;
+	clock->epoch_us = epoch_us;
+	clock->last_ts = 0;
+	clock->window_valid = false;
+	clock->prev_valid = false;
+}
+
+/**
+ * @brief Feed the offset of a read to the drift estimate.
+ *
+ * @param clock Clock state.
+ * @param ts Tag timestamp in ms.
+ * @param offset Arrival minus the uncorrected prediction, in us.
+ */
+static void _clock_track_drift(struct m6e_nano_clock *clock, uint32_t ts, int64_t offset)
+{
+	if (!clock->window_valid) {
+		clock->window_valid = true;
+	} else if (ts - clock->window_ts < M6E_NANO_CLOCK_WINDOW_MS) {
+		if (offset < clock->window_min) {
+			clock->window_min = offset;
+			clock->window_at = ts;
+		}
+		return;
+	} else {
+		// Window closed, the slope between the minima of two windows is the drift
+		if (clock->prev_valid && clock->window_at > clock->prev_at) {
+			int64_t ppm = (clock->window_min - clock->prev_min) * 1000 /
+				      (int64_t)(clock->window_at - clock->prev_at);
+
+			if (ppm > -M6E_NANO_CLOCK_MAX_DRIFT_PPM && ppm < M6E_NANO_CLOCK_MAX_DRIFT_PPM) {
+				clock->drift_ppm += ((int32_t)ppm - clock->drift_ppm) /
+						    (1 << M6E_NANO_CLOCK_DRIFT_SHIFT);
+			}
+		}
+		clock->prev_min = clock->window_min;
+		clock->prev_at = clock->window_at;
+		clock->prev_valid = true;
+	}
+
+	clock->window_ts = ts;
+	clock->window_min = offset;
+	clock->window_at = ts;
+}
+
+/**
+ * @brief Anchor module time 0 on a keep-alive.
+ *
+ * @param clock Clock state.
+ * @param arrival_us Host time the keep-alive frame started arriving.
+ */
+void m6e_nano_clock_keepalive(struct m6e_nano_clock *clock, int64_t arrival_us)
+{
+	_clock_anchor(clock, arrival_us);
+}
+
+/**
+ * @brief Convert a tag timestamp to host time, updating the drift estimate.
+ *
+ * @param clock Clock state.
+ * @param ts Tag timestamp in ms since the last keep-alive.
+ * @param arrival_us Host time the tag frame started arriving.
+ * @return int64_t Host time of the read in us.
+ */
+int64_t m6e_nano_clock_tag(struct m6e_nano_clock *clock, uint32_t ts, int64_t arrival_us)
+{
+	int64_t time_us;
+
+	// No keep-alive yet, or the module restarted its count without one
+	if (!clock->anchored || ts < clock->last_ts) {
+		_clock_anchor(clock, arrival_us - _clock_elapsed(clock, ts));
+		clock->reanchors++;
+	}
+	clock->last_ts = ts;
+
+	_clock_track_drift(clock, ts, arrival_us - (clock->epoch_us + (int64_t)ts * 1000));
+
+	time_us = clock->epoch_us + _clock_elapsed(clock, ts);
+	if (time_us > arrival_us) {
+		// Read after its frame arrived: the anchor is late
+		clock->epoch_us -= time_us - arrival_us;
+		time_us = arrival_us;
+	}
+
+	return time_us + clock->offset_us;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_CLOCK_H
+#define M6E_NANO_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Maps the module's tag timestamps, in ms since the last keep-alive, onto the host uptime.
+ *
+ * A keep-alive anchors module time 0 to the host time its frame started arriving. Before the
+ * first keep-alive, or when timestamps go backwards without one, the anchor is estimated from
+ * the tag frame itself.
+ *
+ * The module clock drifts from the host clock, which matters when tags are read for long
+ * stretches without keep-alives. The offset between the arrival of a frame and the time
+ * predicted from the anchor is the transmission latency plus the drift; its minimum over each
+ * window of module time is close to the pure drift, so the slope of successive minima gives
+ * the drift rate, smoothed and applied to every prediction. A read never happens after its
+ * frame arrived, so a prediction later than the arrival moves the anchor back.
+ *
+ * All readers of a host share its uptime, so their times compare directly; a per-reader offset
+ * corrects a remaining fixed skew.
+ */
+
+#ifdef CONFIG_M6E_NANO_CLOCK_WINDOW_MS
+#define M6E_NANO_CLOCK_WINDOW_MS CONFIG_M6E_NANO_CLOCK_WINDOW_MS
+#else
+#define M6E_NANO_CLOCK_WINDOW_MS 1000
+#endif
+
+// Drift beyond this is measurement noise, crystals are specified far below
+#define M6E_NANO_CLOCK_MAX_DRIFT_PPM 500
+
+// Smoothing of the drift estimate, weight of a new window is 1 / 2^shift
+#define M6E_NANO_CLOCK_DRIFT_SHIFT 2
+
+struct m6e_nano_clock {
+	bool anchored;
+	int64_t epoch_us;   // Host time of module time 0
+	uint32_t last_ts;   // Last tag timestamp, ms
+	int32_t drift_ppm;  // Module clock error, positive when it runs slow
+	int32_t offset_us;  // Added to every time, to align readers
+	uint32_t reanchors; // Anchors estimated from tags for lack of a keep-alive
+
+	// Drift window, in module time since the anchor
+	uint32_t window_ts;  // Start of the current window
+	int64_t window_min;  // Smallest arrival - prediction in the window, us
+	uint32_t window_at;  // Timestamp of that smallest offset
+	bool window_valid;   // The current window has a sample
+	int64_t prev_min;    // Smallest offset of the previous window
+	uint32_t prev_at;
+	bool prev_valid;
+};
+
+/**
+ * @brief Reset the clock, keeping its reader offset.
+ *
+ * @param clock Clock state.
+ */
+void m6e_nano_clock_init(struct m6e_nano_clock *clock);
+
+/**
+ * @brief Anchor module time 0 on a keep-alive.
+ *
+ * @param clock Clock state.
+ * @param arrival_us Host time the keep-alive frame started arriving.
+ */
+void m6e_nano_clock_keepalive(struct m6e_nano_clock *clock, int64_t arrival_us);
+
+/**
+ * @brief Convert a tag timestamp to host time, updating the drift estimate.
+ *
+ * @param clock Clock state.
+ * @param ts Tag timestamp in ms since the last keep-alive.
+ * @param arrival_us Host time the tag frame started arriving.
+ * @return int64_t Host time of the read in us.
+ */
+int64_t m6e_nano_clock_tag(struct m6e_nano_clock *clock, uint32_t ts, int64_t arrival_us);
+
+#endif // M6E_NANO_CLOCK_H
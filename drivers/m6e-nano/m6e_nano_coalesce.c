@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_internal.h"
+
+/**
+ * @brief Call the data callback to wake the consumer of the queued frames.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _coalesce_wake(const struct device *dev)
+{
+	const struct m6e_nano_config *cfg = dev->config;
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	m6e_nano_callback_t callback = data->callback;
+
+	if (callback != NULL) {
+		M6E_NANO_TRACE(dev, DISPATCH);
+		callback(cfg->uart_dev, (void *)dev);
+	}
+}
+
+/**
+ * @brief The serial line was idle since the last queued frame.
+ *
+ * @param timer Coalescing timer of the driver instance.
+ */
+static void m6e_nano_coalesce_timer_handler(struct k_timer *timer)
+{
+	const struct device *dev = k_timer_user_data_get(timer);
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_coalesce *co = &data->coalesce;
+	k_spinlock_key_t key = k_spin_lock(&co->lock);
+	bool wake = co->pending > 0;
+
+	co->pending = 0;
+	k_spin_unlock(&co->lock, key);
+
+	if (wake) {
+		_coalesce_wake(dev);
+	}
+}
+
+/**
+ * @brief Initialize callback coalescing of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_coalesce_init(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_coalesce *co = &data->coalesce;
+
+	k_timer_init(&co->timer, m6e_nano_coalesce_timer_handler, NULL);
+	k_timer_user_data_set(&co->timer, (void *)dev);
+}
+
+/**
+ * @brief Queue a CRC-valid frame for the consumer, calling the data callback once enough
+ * frames are queued. Called from the UART ISR.
+ *
+ * @param dev UART peripheral device.
+ * @param frame Frame, from the header to the CRC.
+ */
+void m6e_nano_coalesce_frame(const struct device *dev, const uint8_t *frame)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_coalesce *co = &data->coalesce;
+	size_t len = MIN(frame[1] + 7, M6E_NANO_BUF_SIZE);
+	k_spinlock_key_t key = k_spin_lock(&co->lock);
+	bool wake;
+
+	if (co->count == CONFIG_M6E_NANO_COALESCE_QUEUE_LEN) {
+		co->dropped++;
+		k_spin_unlock(&co->lock, key);
+		return;
+	}
+
+	memcpy(co->frames[co->head], frame, len);
+	co->times_us[co->head] = data->read_us;
+	co->head = (co->head + 1) % CONFIG_M6E_NANO_COALESCE_QUEUE_LEN;
+	co->count++;
+
+	wake = ++co->pending >= CONFIG_M6E_NANO_COALESCE_FRAMES;
+	if (wake) {
+		co->pending = 0;
+	}
+	k_spin_unlock(&co->lock, key);
+
+	if (wake) {
+		k_timer_stop(&co->timer);
+		_coalesce_wake(dev);
+	} else {
+		// Restarted by every frame, so it only expires once the line goes idle
+		k_timer_start(&co->timer, K_USEC(CONFIG_M6E_NANO_COALESCE_US), K_NO_WAIT);
+	}
+}
+
+/**
+ * @brief Release the frame the consumer holds and take the next queued one.
+ *
+ * @param dev UART peripheral device.
+ * @return true if a frame was taken.
+ */
+bool m6e_nano_coalesce_next(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_coalesce *co = &data->coalesce;
+	k_spinlock_key_t key = k_spin_lock(&co->lock);
+	bool taken = false;
+
+	if (co->holding) {
+		co->tail = (co->tail + 1) % CONFIG_M6E_NANO_COALESCE_QUEUE_LEN;
+		co->count--;
+		co->holding = false;
+	}
+
+	if (co->count > 0) {
+		// The slot stays out of reach of the ISR until the next call
+		data->frame = co->frames[co->tail];
+		data->frame_time_us = co->times_us[co->tail];
+		co->holding = true;
+		taken = true;
+	} else {
+		data->frame = data->response.data;
+	}
+	k_spin_unlock(&co->lock, key);
+
+	return taken;
+}
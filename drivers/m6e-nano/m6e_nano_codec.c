@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "m6e_nano_codec.h"
+
+#ifdef CONFIG_M6E_NANO_CODEC_CBOR
+#include <zcbor_encode.h>
+#include <zcbor_decode.h>
+#endif
+
+#define RECORD_TYPE_SHIFT 6
+#define RECORD_ANT_MASK   0x0F
+
+/**
+ * @brief Append bytes to the batch.
+ *
+ * @param enc Encoder state.
+ * @param pos Write position, advanced past the bytes.
+ * @param data Bytes to append.
+ * @param len Number of bytes.
+ * @return int 0 on success, -ENOMEM if they do not fit.
+ */
+static int _put(struct m6e_nano_encoder *enc, size_t *pos, const uint8_t *data, size_t len)
+{
+	if (enc->size - *pos < len) {
+		return -ENOMEM;
+	}
+
+	memcpy(&enc->buf[*pos], data, len);
+	*pos += len;
+
+	return 0;
+}
+
+/**
+ * @brief Append an unsigned LEB128 varint to the batch.
+ *
+ * @param enc Encoder state.
+ * @param pos Write position, advanced past the varint.
+ * @param value Value to append.
+ * @return int 0 on success, -ENOMEM if it does not fit.
+ */
+static int _put_varint(struct m6e_nano_encoder *enc, size_t *pos, uint64_t value)
+{
+	uint8_t bytes[10];
+	size_t len = 0;
+
+	do {
+		bytes[len] = value & 0x7F;
+		value >>= 7;
+		if (value) {
+			bytes[len] |= 0x80;
+		}
+		len++;
+	} while (value);
+
+	return _put(enc, pos, bytes, len);
+}
+
+/**
+ * @brief Read bytes from the batch.
+ *
+ * @param dec Decoder state.
+ * @param data Destination, may be NULL to only return a pointer.
+ * @param len Number of bytes.
+ * @return const uint8_t* The bytes read, NULL if the batch is truncated.
+ */
+static const uint8_t *_get(struct m6e_nano_decoder *dec, uint8_t *data, size_t len)
+{
+	const uint8_t *ptr = &dec->buf[dec->pos];
+
+	if (dec->len - dec->pos < len) {
+		return NULL;
+	}
+
+	if (data != NULL) {
+		memcpy(data, ptr, len);
+	}
+	dec->pos += len;
+
+	return ptr;
+}
+
+/**
+ * @brief Read an unsigned LEB128 varint from the batch.
+ *
+ * @param dec Decoder state.
+ * @param value Decoded value.
+ * @return int 0 on success, -EBADMSG if truncated or too long.
+ */
+static int _get_varint(struct m6e_nano_decoder *dec, uint64_t *value)
+{
+	*value = 0;
+
+	for (uint8_t shift = 0; shift < 64; shift += 7) {
+		const uint8_t *byte = _get(dec, NULL, 1);
+
+		if (byte == NULL) {
+			return -EBADMSG;
+		}
+		*value |= (uint64_t)(*byte & 0x7F) << shift;
+		if (!(*byte & 0x80)) {
+			return 0;
+		}
+	}
+
+	return -EBADMSG;
+}
+
+/**
+ * @brief Find the dictionary entry matching the prefix of an EPC.
+ *
+ * @param dict Dictionary.
+ * @param epc EPC to match.
+ * @param epc_len Length of the EPC.
+ * @return int Entry index, -ENOENT if there is none.
+ */
+static int _dict_find(const struct m6e_nano_codec_dict *dict, const uint8_t *epc,
+		      uint8_t epc_len)
+{
+	for (uint8_t i = 0; i < dict->count; i++) {
+		if (dict->epc_len[i] == epc_len &&
+		    memcmp(dict->prefix[i], epc, dict->prefix_len) == 0) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+/**
+ * @brief Add the prefix of an EPC as the next dictionary entry. Encoder and decoder call this
+ * for the same records, so both dictionaries stay identical.
+ *
+ * @param dict Dictionary.
+ * @param epc EPC to take the prefix from.
+ * @param epc_len Length of the EPC.
+ */
+static void _dict_add(struct m6e_nano_codec_dict *dict, const uint8_t *epc, uint8_t epc_len)
+{
+	uint8_t slot = dict->next;
+
+	memcpy(dict->prefix[slot], epc, dict->prefix_len);
+	dict->epc_len[slot] = epc_len;
+	dict->next = (slot + 1) % M6E_NANO_CODEC_DICT_SIZE;
+	if (dict->count < M6E_NANO_CODEC_DICT_SIZE) {
+		dict->count++;
+	}
+}
+
+int m6e_nano_encoder_init(struct m6e_nano_encoder *enc, uint8_t *buf, size_t size,
+			  uint8_t prefix_len, uint64_t base_ms)
+{
+	uint8_t header[] = {M6E_NANO_CODEC_VERSION, prefix_len};
+	size_t pos = 0;
+	int ret;
+
+	if (prefix_len > M6E_NANO_CODEC_PREFIX_MAX) {
+		return -EINVAL;
+	}
+
+	memset(enc, 0, sizeof(*enc));
+	enc->buf = buf;
+	enc->size = size;
+	enc->last_ms = base_ms;
+	enc->dict.prefix_len = prefix_len;
+
+	ret = _put(enc, &pos, header, sizeof(header));
+	if (ret == 0) {
+		ret = _put_varint(enc, &pos, base_ms);
+	}
+	enc->len = pos;
+
+	return ret;
+}
+
+int m6e_nano_encode_tag(struct m6e_nano_encoder *enc, const struct m6e_nano_codec_tag *tag)
+{
+	struct m6e_nano_codec_dict *dict = &enc->dict;
+	uint8_t type = M6E_NANO_CODEC_LITERAL;
+	size_t pos = enc->len;
+	uint8_t header;
+	int index = -ENOENT;
+	int ret;
+
+	if (tag->epc_len > M6E_NANO_CODEC_EPC_MAX_LEN || tag->time_ms < enc->last_ms) {
+		return -EINVAL;
+	}
+
+	if (dict->prefix_len > 0 && tag->epc_len > dict->prefix_len) {
+		index = _dict_find(dict, tag->epc, tag->epc_len);
+		type = index < 0 ? M6E_NANO_CODEC_DEFINE : M6E_NANO_CODEC_REF;
+	}
+
+	header = (type << RECORD_TYPE_SHIFT) | (tag->antenna & RECORD_ANT_MASK);
+
+	ret = _put(enc, &pos, &header, 1);
+	if (ret == 0) {
+		ret = _put_varint(enc, &pos, tag->time_ms - enc->last_ms);
+	}
+	if (ret == 0) {
+		ret = _put(enc, &pos, (const uint8_t *)&tag->rssi, 1);
+	}
+	if (ret == 0 && type == M6E_NANO_CODEC_REF) {
+		uint8_t idx = index;
+
+		ret = _put(enc, &pos, &idx, 1);
+		if (ret == 0) {
+			ret = _put(enc, &pos, &tag->epc[dict->prefix_len],
+				   tag->epc_len - dict->prefix_len);
+		}
+	} else if (ret == 0) {
+		ret = _put(enc, &pos, &tag->epc_len, 1);
+		if (ret == 0) {
+			ret = _put(enc, &pos, tag->epc, tag->epc_len);
+		}
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (type == M6E_NANO_CODEC_DEFINE) {
+		_dict_add(dict, tag->epc, tag->epc_len);
+	}
+	enc->len = pos;
+	enc->last_ms = tag->time_ms;
+
+	return 0;
+}
+
+int m6e_nano_encode_summary(struct m6e_nano_encoder *enc,
+			    const struct m6e_nano_codec_summary *summary)
+{
+	uint8_t header = M6E_NANO_CODEC_SUMMARY << RECORD_TYPE_SHIFT;
+	size_t pos = enc->len;
+	int ret;
+
+	if (summary->time_ms < enc->last_ms) {
+		return -EINVAL;
+	}
+
+	ret = _put(enc, &pos, &header, 1);
+	if (ret == 0) {
+		ret = _put_varint(enc, &pos, summary->time_ms - enc->last_ms);
+	}
+	if (ret == 0) {
+		ret = _put_varint(enc, &pos, summary->unique);
+	}
+	if (ret == 0) {
+		ret = _put_varint(enc, &pos, summary->reads);
+	}
+	if (ret == 0) {
+		ret = _put_varint(enc, &pos, summary->duration_ms);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	enc->len = pos;
+	enc->last_ms = summary->time_ms;
+
+	return 0;
+}
+
+int m6e_nano_decoder_init(struct m6e_nano_decoder *dec, const uint8_t *buf, size_t len)
+{
+	uint8_t header[2];
+
+	memset(dec, 0, sizeof(*dec));
+	dec->buf = buf;
+	dec->len = len;
+
+	if (_get(dec, header, sizeof(header)) == NULL || header[0] != M6E_NANO_CODEC_VERSION ||
+	    header[1] > M6E_NANO_CODEC_PREFIX_MAX) {
+		return -EBADMSG;
+	}
+	dec->dict.prefix_len = header[1];
+
+	return _get_varint(dec, &dec->last_ms);
+}
+
+/**
+ * @brief Decode the body of a tag record.
+ *
+ * @param dec Decoder state.
+ * @param type Record type.
+ * @param tag Decoded tag, time and antenna already set.
+ * @return int 0 on success, -EBADMSG for a corrupt record.
+ */
+static int _decode_tag(struct m6e_nano_decoder *dec, uint8_t type, struct m6e_nano_codec_tag *tag)
+{
+	struct m6e_nano_codec_dict *dict = &dec->dict;
+	uint8_t idx;
+
+	if (_get(dec, (uint8_t *)&tag->rssi, 1) == NULL) {
+		return -EBADMSG;
+	}
+
+	if (type == M6E_NANO_CODEC_REF) {
+		if (_get(dec, &idx, 1) == NULL || idx >= dict->count) {
+			return -EBADMSG;
+		}
+		tag->epc_len = dict->epc_len[idx];
+		memcpy(tag->epc, dict->prefix[idx], dict->prefix_len);
+		if (_get(dec, &tag->epc[dict->prefix_len], tag->epc_len - dict->prefix_len) ==
+		    NULL) {
+			return -EBADMSG;
+		}
+		return 0;
+	}
+
+	if (_get(dec, &tag->epc_len, 1) == NULL || tag->epc_len > M6E_NANO_CODEC_EPC_MAX_LEN ||
+	    _get(dec, tag->epc, tag->epc_len) == NULL) {
+		return -EBADMSG;
+	}
+
+	if (type == M6E_NANO_CODEC_DEFINE) {
+		if (tag->epc_len <= dict->prefix_len) {
+			return -EBADMSG;
+		}
+		_dict_add(dict, tag->epc, tag->epc_len);
+	}
+
+	return 0;
+}
+
+int m6e_nano_decode_next(struct m6e_nano_decoder *dec, struct m6e_nano_codec_record *record)
+{
+	uint64_t delta;
+	uint64_t value[3];
+	uint8_t header;
+	int ret;
+
+	if (dec->pos == dec->len) {
+		return -ENODATA;
+	}
+
+	if (_get(dec, &header, 1) == NULL || _get_varint(dec, &delta) < 0) {
+		return -EBADMSG;
+	}
+
+	memset(record, 0, sizeof(*record));
+	record->type = header >> RECORD_TYPE_SHIFT;
+	dec->last_ms += delta;
+
+	if (record->type == M6E_NANO_CODEC_SUMMARY) {
+		for (uint8_t i = 0; i < sizeof(value) / sizeof(value[0]); i++) {
+			ret = _get_varint(dec, &value[i]);
+			if (ret < 0 || value[i] > UINT32_MAX) {
+				return -EBADMSG;
+			}
+		}
+		record->summary.time_ms = dec->last_ms;
+		record->summary.unique = value[0];
+		record->summary.reads = value[1];
+		record->summary.duration_ms = value[2];
+		return 0;
+	}
+
+	record->tag.time_ms = dec->last_ms;
+	record->tag.antenna = header & RECORD_ANT_MASK;
+
+	return _decode_tag(dec, record->type, &record->tag);
+}
+
+#ifdef CONFIG_M6E_NANO_CODEC_CBOR
+bool m6e_nano_encode_tag_cbor(zcbor_state_t *state, const struct m6e_nano_codec_tag *tag)
+{
+	return zcbor_list_start_encode(state, 4) && zcbor_uint64_put(state, tag->time_ms) &&
+	       zcbor_int32_put(state, tag->rssi) && zcbor_uint32_put(state, tag->antenna) &&
+	       zcbor_bstr_encode_ptr(state, (const char *)tag->epc, tag->epc_len) &&
+	       zcbor_list_end_encode(state, 4);
+}
+
+bool m6e_nano_decode_tag_cbor(zcbor_state_t *state, struct m6e_nano_codec_tag *tag)
+{
+	struct zcbor_string epc;
+	int32_t rssi;
+	uint32_t antenna;
+
+	if (!(zcbor_list_start_decode(state) && zcbor_uint64_decode(state, &tag->time_ms) &&
+	      zcbor_int32_decode(state, &rssi) && zcbor_uint32_decode(state, &antenna) &&
+	      zcbor_bstr_decode(state, &epc) && zcbor_list_end_decode(state))) {
+		return false;
+	}
+	if (epc.len > M6E_NANO_CODEC_EPC_MAX_LEN || rssi < INT8_MIN || rssi > INT8_MAX) {
+		return false;
+	}
+
+	tag->rssi = rssi;
+	tag->antenna = antenna;
+	tag->epc_len = epc.len;
+	memcpy(tag->epc, epc.value, epc.len);
+
+	return true;
+}
+#endif
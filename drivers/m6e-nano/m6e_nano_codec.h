@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_CODEC_H
+#define M6E_NANO_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Compact binary encoding of tag events and inventory summaries for byte-metered uplinks.
+ *
+ * A batch starts with a header:
+ *   [0]    M6E_NANO_CODEC_VERSION
+ *   [1]    EPC prefix length used by the dictionary
+ *   [2..]  Base time in ms (varint)
+ *
+ * Followed by records, each starting with a header byte:
+ *   [7:6]  Record type, one of M6E_NANO_CODEC_*
+ *   [5:4]  Reserved, 0
+ *   [3:0]  Antenna (RX port) of a tag record
+ *   Time since the previous record in ms (varint)
+ *
+ * Tag records continue with the RSSI in dBm (int8) and the EPC:
+ *   LITERAL  EPC length, EPC
+ *   DEFINE   EPC length, EPC. The EPC prefix becomes the next dictionary entry
+ *   REF      Dictionary index, EPC suffix (entry EPC length - prefix length bytes)
+ *
+ * Summary records continue with the unique tags, reads and duration in ms (varints).
+ *
+ * The dictionary starts empty for every batch and replaces entries round-robin once full, so
+ * each batch decodes on its own. A 96-bit EPC sharing a prefix with an earlier read of the
+ * same SKU range typically takes 8 bytes.
+ */
+
+#define M6E_NANO_CODEC_VERSION 1
+
+// Record types
+#define M6E_NANO_CODEC_LITERAL 0
+#define M6E_NANO_CODEC_DEFINE  1
+#define M6E_NANO_CODEC_REF     2
+#define M6E_NANO_CODEC_SUMMARY 3
+
+#define M6E_NANO_CODEC_EPC_MAX_LEN 32
+#define M6E_NANO_CODEC_PREFIX_MAX  16
+
+#ifdef CONFIG_M6E_NANO_CODEC_DICT_SIZE
+#define M6E_NANO_CODEC_DICT_SIZE CONFIG_M6E_NANO_CODEC_DICT_SIZE
+#else
+#define M6E_NANO_CODEC_DICT_SIZE 16
+#endif
+
+struct m6e_nano_codec_tag {
+	uint64_t time_ms;
+	int8_t rssi; // dBm
+	uint8_t antenna;
+	uint8_t epc_len;
+	uint8_t epc[M6E_NANO_CODEC_EPC_MAX_LEN];
+};
+
+struct m6e_nano_codec_summary {
+	uint64_t time_ms;
+	uint32_t unique;      // Distinct tags
+	uint32_t reads;       // Total tag reads
+	uint32_t duration_ms; // Length of the inventory round
+};
+
+struct m6e_nano_codec_record {
+	uint8_t type; // M6E_NANO_CODEC_SUMMARY or any tag record type
+	union {
+		struct m6e_nano_codec_tag tag;
+		struct m6e_nano_codec_summary summary;
+	};
+};
+
+struct m6e_nano_codec_dict {
+	uint8_t prefix_len;
+	uint8_t count;
+	uint8_t next; // Entry replaced once the dictionary is full
+	uint8_t epc_len[M6E_NANO_CODEC_DICT_SIZE];
+	uint8_t prefix[M6E_NANO_CODEC_DICT_SIZE][M6E_NANO_CODEC_PREFIX_MAX];
+};
+
+struct m6e_nano_encoder {
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+	uint64_t last_ms;
+	struct m6e_nano_codec_dict dict;
+};
+
+struct m6e_nano_decoder {
+	const uint8_t *buf;
+	size_t len;
+	size_t pos;
+	uint64_t last_ms;
+	struct m6e_nano_codec_dict dict;
+};
+
+/**
+ * @brief Start a new batch in buf.
+ *
+ * @param enc Encoder state.
+ * @param buf Output buffer.
+ * @param size Size of the output buffer.
+ * @param prefix_len EPC prefix length shared by tags of a SKU range, 0 disables the
+ * dictionary. At most M6E_NANO_CODEC_PREFIX_MAX.
+ * @param base_ms Time the deltas of the batch start from.
+ * @return int 0 on success, -EINVAL for an invalid prefix length, -ENOMEM if the header does
+ * not fit.
+ */
+int m6e_nano_encoder_init(struct m6e_nano_encoder *enc, uint8_t *buf, size_t size,
+			  uint8_t prefix_len, uint64_t base_ms);
+
+/**
+ * @brief Append a tag event to the batch. The batch is left untouched if the record does not
+ * fit, so the caller can send it and start a new one.
+ *
+ * @param enc Encoder state.
+ * @param tag Tag event, times must not go backwards.
+ * @return int 0 on success, -ENOMEM if the batch is full, -EINVAL for an invalid tag.
+ */
+int m6e_nano_encode_tag(struct m6e_nano_encoder *enc, const struct m6e_nano_codec_tag *tag);
+
+/**
+ * @brief Append an inventory summary to the batch.
+ *
+ * @param enc Encoder state.
+ * @param summary Inventory summary, times must not go backwards.
+ * @return int 0 on success, -ENOMEM if the batch is full, -EINVAL for an invalid summary.
+ */
+int m6e_nano_encode_summary(struct m6e_nano_encoder *enc,
+			    const struct m6e_nano_codec_summary *summary);
+
+/**
+ * @brief Start decoding a batch.
+ *
+ * @param dec Decoder state.
+ * @param buf Encoded batch.
+ * @param len Length of the batch.
+ * @return int 0 on success, -EBADMSG for an unsupported or truncated header.
+ */
+int m6e_nano_decoder_init(struct m6e_nano_decoder *dec, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode the next record of the batch.
+ *
+ * @param dec Decoder state.
+ * @param record Decoded record.
+ * @return int 0 on success, -ENODATA at the end of the batch, -EBADMSG for a corrupt record.
+ */
+int m6e_nano_decode_next(struct m6e_nano_decoder *dec, struct m6e_nano_codec_record *record);
+
+#ifdef CONFIG_M6E_NANO_CODEC_CBOR
+#include <zcbor_common.h>
+
+/**
+ * @brief Encode a tag event as the CBOR array [time_ms, rssi, antenna, epc].
+ *
+ * @param state zcbor encoder state.
+ * @param tag Tag event.
+ * @return true on success.
+ */
+bool m6e_nano_encode_tag_cbor(zcbor_state_t *state, const struct m6e_nano_codec_tag *tag);
+
+/**
+ * @brief Decode a tag event encoded by m6e_nano_encode_tag_cbor().
+ *
+ * @param state zcbor decoder state.
+ * @param tag Decoded tag event.
+ * @return true on success.
+ */
+bool m6e_nano_decode_tag_cbor(zcbor_state_t *state, struct m6e_nano_codec_tag *tag);
+#endif
+
+#endif // M6E_NANO_CODEC_H
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/logging/log.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_internal.h"
+
+LOG_MODULE_DECLARE(M6E_NANO, CONFIG_M6E_NANO_LOG_LEVEL);
+
+// Driver instance and image of an update in progress
+struct fw_ctx {
+	const struct device *dev;
+	const struct flash_area *fa;
+};
+
+/**
+ * @brief Send an update command without waiting for its response.
+ *
+ * @param ctx Update in progress.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param len Length of the command data.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _fw_send(void *ctx, uint8_t opcode, const uint8_t *data, uint8_t len)
+{
+	struct fw_ctx *fw = ctx;
+
+	return _m6e_nano_command_send(fw->dev, opcode, data, len);
+}
+
+/**
+ * @brief Wait for the response to the update command sent.
+ *
+ * @param ctx Update in progress.
+ * @param opcode Opcode of the command.
+ * @param timeout_ms Longest wait for the response.
+ * @param frame Set to the response buffer.
+ * @return int 0 on success, -EIO if the module reported an error, negative errno otherwise.
+ */
+static int _fw_wait(void *ctx, uint8_t opcode, int32_t timeout_ms, const uint8_t **frame)
+{
+	struct fw_ctx *fw = ctx;
+
+	*frame = ((struct m6e_nano_data *)fw->dev->data)->response.data;
+
+	return _m6e_nano_command_wait(fw->dev, opcode, timeout_ms);
+}
+
+/**
+ * @brief Switch the module, then the UART, to a baud rate.
+ *
+ * @param ctx Update in progress.
+ * @param baud Baud rate.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _fw_set_baud(void *ctx, uint32_t baud)
+{
+	struct fw_ctx *fw = ctx;
+
+	return _m6e_nano_switch_baud(fw->dev, baud);
+}
+
+/**
+ * @brief Read bytes of the image from its flash area.
+ *
+ * @param ctx Update in progress.
+ * @param offset Offset from the start of the image header.
+ * @param buf Destination.
+ * @param len Number of bytes.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _fw_read(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+	struct fw_ctx *fw = ctx;
+
+	return flash_area_read(fw->fa, offset, buf, len);
+}
+
+/**
+ * @brief Monotonic time in ms.
+ *
+ * @param ctx Update in progress.
+ * @return uint32_t Uptime in ms.
+ */
+static uint32_t _fw_now_ms(void *ctx)
+{
+	ARG_UNUSED(ctx);
+
+	return k_uptime_get_32();
+}
+
+/**
+ * @brief Run an update with the command lock held.
+ *
+ * @param dev UART peripheral device.
+ * @param fa Flash area of the image.
+ * @param len Length of the application image.
+ * @param stats Outcome of the update.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _fw_update(const struct device *dev, const struct flash_area *fa, uint32_t len,
+		      struct m6e_nano_fw_stats *stats)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct fw_ctx ctx = {
+		.dev = dev,
+		.fa = fa,
+	};
+	const struct m6e_nano_fw_ops ops = {
+		.send = _fw_send,
+		.wait = _fw_wait,
+		.set_baud = _fw_set_baud,
+		.read = _fw_read,
+		.now_ms = _fw_now_ms,
+		.ctx = &ctx,
+	};
+	bool reading = data->reading;
+	int ret;
+
+	// A bootloader left by a failed update refuses the stop, and picks up from there
+	m6e_nano_stop_reading(dev);
+
+	ret = m6e_nano_fw_flash(&ops, len, data->caps.max_baud, data->fw.buf, stats);
+	if (ret < 0) {
+		LOG_ERR("Update failed after %u bytes (%d).", stats->bytes, ret);
+		return ret;
+	}
+	LOG_INF("%u bytes written in %u ms at %u baud, %u bytes/s.", stats->bytes,
+		stats->write_ms, stats->baud, stats->bytes_per_s);
+
+	// The startup message of the new application is the answer, the reset it reports is ours
+	data->expect_startup = true;
+	ret = _m6e_nano_command_send(dev, TMR_SR_OPCODE_BOOT_FIRMWARE, NULL, 0);
+	if (ret == 0) {
+		ret = _m6e_nano_command_wait(dev, TMR_SR_OPCODE_BOOT_FIRMWARE,
+					     M6E_NANO_FW_BOOT_TIMEOUT_MS);
+	}
+	if (ret < 0) {
+		data->expect_startup = false;
+		return ret;
+	}
+
+	ret = m6e_nano_get_version(dev, NULL);
+	if (ret == 0) {
+		LOG_INF("Firmware %08X started.", data->version.fw_version);
+		ret = _m6e_nano_apply_settings(dev, reading);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Update the firmware of the module from an image in a flash partition: start the
+ * bootloader, switch to the highest baud rate of the module, erase the application, write the
+ * image in M6E_NANO_FW_CHUNK_LEN chunks, have the bootloader verify its CRC-32 and boot it. Each
+ * chunk is read from flash while the module writes the one before, and the image is never
+ * copied to RAM whole. The remembered settings are applied to the new application, and reading
+ * restarted if it was running.
+ *
+ * The partition holds the image file as the vendor ships it, header included.
+ *
+ * @param dev UART peripheral device.
+ * @param area_id Flash area of the image, for example FIXED_PARTITION_ID(m6e_fw_partition).
+ * @param stats Outcome and throughput of the update, may be NULL.
+ * @return int 0 on success, -EBADMSG if the partition does not hold a firmware image, -EIO if
+ * the module reported an error or the image in its flash does not match, -ETIMEDOUT if it
+ * stopped answering, negative errno otherwise. The module stays in the bootloader if the update
+ * failed after starting it, and a new update picks up from there.
+ */
+int m6e_nano_update_firmware(const struct device *dev, uint8_t area_id,
+			     struct m6e_nano_fw_stats *stats)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_fw_stats local;
+	uint8_t header[M6E_NANO_FW_HEADER_LEN];
+	const struct flash_area *fa;
+	uint32_t len;
+	int ret;
+
+	if (stats == NULL) {
+		stats = &local;
+	}
+	memset(stats, 0, sizeof(*stats));
+
+	ret = flash_area_open(area_id, &fa);
+	if (ret < 0) {
+		return ret;
+	}
+
+	// Check the whole image is there before the module is touched
+	ret = flash_area_read(fa, 0, header, sizeof(header));
+	if (ret == 0) {
+		ret = m6e_nano_fw_header(header, &len);
+	}
+	if (ret == 0 && len > fa->fa_size - M6E_NANO_FW_HEADER_LEN) {
+		ret = -EBADMSG;
+	}
+	if (ret < 0) {
+		LOG_ERR("No firmware image in flash area %u (%d).", area_id, ret);
+		flash_area_close(fa);
+		return ret;
+	}
+
+	k_mutex_lock(&data->lock, K_FOREVER);
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	// The module goes silent while it restarts, that is no failure to recover from
+	bool supervised = data->supervised;
+
+	m6e_nano_set_supervised(dev, false);
+#endif
+
+	ret = _fw_update(dev, fa, len, stats);
+
+#ifdef CONFIG_M6E_NANO_SUPERVISOR
+	m6e_nano_set_supervised(dev, supervised);
+#endif
+	k_mutex_unlock(&data->lock);
+	flash_area_close(fa);
+
+	return ret;
+}
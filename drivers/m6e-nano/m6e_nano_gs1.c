@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "m6e_nano_gs1.h"
+
+// Filter and partition follow the header
+#define GS1_PARTITION_END 14
+
+struct gs1_partition {
+	uint8_t company_bits;
+	uint8_t company_digits;
+};
+
+struct gs1_scheme {
+	uint8_t header;
+	uint8_t fields_bits;   // Company prefix and reference
+	uint8_t fields_digits;
+	uint8_t serial_bits;
+	uint8_t key_digits;    // Without the check digit, 0 without a key
+	bool indicator;        // Leading reference digit leads the key
+};
+
+// Partition tables of every partitioned scheme share their company prefix column
+static const struct gs1_partition gs1_partitions[7] = {
+	{40, 12}, {37, 11}, {34, 10}, {30, 9}, {27, 8}, {24, 7}, {20, 6},
+};
+
+static const struct gs1_scheme gs1_schemes[] = {
+	{M6E_NANO_GS1_SGTIN_96, 44, 13, 38, 13, true},
+	{M6E_NANO_GS1_SSCC_96, 58, 17, 0, 17, true},
+	{M6E_NANO_GS1_SGLN_96, 41, 12, 41, 12, false},
+	{M6E_NANO_GS1_GRAI_96, 44, 12, 38, 13, false},
+	{M6E_NANO_GS1_GIAI_96, 82, 24, 0, 0, false},
+};
+
+static const uint64_t gs1_pow10[19] = {
+	1ULL,
+	10ULL,
+	100ULL,
+	1000ULL,
+	10000ULL,
+	100000ULL,
+	1000000ULL,
+	10000000ULL,
+	100000000ULL,
+	1000000000ULL,
+	10000000000ULL,
+	100000000000ULL,
+	1000000000000ULL,
+	10000000000000ULL,
+	100000000000000ULL,
+	1000000000000000ULL,
+	10000000000000000ULL,
+	100000000000000000ULL,
+	1000000000000000000ULL,
+};
+
+/**
+ * @brief Read a big-endian bit field.
+ *
+ * @param epc EPC.
+ * @param pos First bit, from the MSB of the first byte.
+ * @param len Field width, up to 64 bits.
+ * @return uint64_t Field value.
+ */
+static uint64_t _gs1_bits(const uint8_t *epc, uint8_t pos, uint8_t len)
+{
+	uint64_t value = 0;
+
+	while (len > 0) {
+		uint8_t offset = pos % 8;
+		uint8_t take = 8 - offset < len ? 8 - offset : len;
+		uint8_t bits = epc[pos / 8] >> (8 - offset - take);
+
+		value = (value << take) | (bits & ((1U << take) - 1));
+		pos += take;
+		len -= take;
+	}
+
+	return value;
+}
+
+/**
+ * @brief Find the table entry of a scheme.
+ *
+ * @param header Header byte.
+ * @return const struct gs1_scheme* Scheme, NULL if not partitioned or not supported.
+ */
+static const struct gs1_scheme *_gs1_scheme(uint8_t header)
+{
+	for (size_t i = 0; i < sizeof(gs1_schemes) / sizeof(gs1_schemes[0]); i++) {
+		if (gs1_schemes[i].header == header) {
+			return &gs1_schemes[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Decode a GS1 EPC.
+ *
+ * @param epc EPC.
+ * @param epc_len EPC length in bytes.
+ * @param gs1 Decoded fields.
+ * @return int 0 on success, -ENOTSUP if the EPC is not of a 96-bit GS1 scheme, -EBADMSG for
+ * an invalid partition or a field out of range for its digits.
+ */
+int m6e_nano_gs1_decode(const uint8_t *epc, uint8_t epc_len, struct m6e_nano_gs1 *gs1)
+{
+	const struct gs1_scheme *scheme;
+	const struct gs1_partition *partition;
+	uint8_t index;
+
+	if (epc_len != M6E_NANO_GS1_EPC_LEN) {
+		return -ENOTSUP;
+	}
+
+	gs1->header = epc[0];
+	if (epc[0] == M6E_NANO_GS1_GID_96) {
+		// Not partitioned, no filter and no digit limits
+		gs1->filter = 0;
+		gs1->company_digits = 0;
+		gs1->reference_digits = 0;
+		gs1->company = _gs1_bits(epc, 8, 28);
+		gs1->reference = _gs1_bits(epc, 36, 24);
+		gs1->serial = _gs1_bits(epc, 60, 36);
+		return 0;
+	}
+
+	scheme = _gs1_scheme(epc[0]);
+	if (scheme == NULL) {
+		return -ENOTSUP;
+	}
+
+	index = (epc[1] >> 2) & 0x07;
+	if (index >= sizeof(gs1_partitions) / sizeof(gs1_partitions[0])) {
+		return -EBADMSG;
+	}
+	partition = &gs1_partitions[index];
+
+	gs1->filter = epc[1] >> 5;
+	gs1->company_digits = partition->company_digits;
+	gs1->reference_digits = scheme->fields_digits - partition->company_digits;
+	gs1->company = _gs1_bits(epc, GS1_PARTITION_END, partition->company_bits);
+	gs1->reference = _gs1_bits(epc, GS1_PARTITION_END + partition->company_bits,
+				   scheme->fields_bits - partition->company_bits);
+	gs1->serial = _gs1_bits(epc, GS1_PARTITION_END + scheme->fields_bits, scheme->serial_bits);
+
+	// The bits hold more than the digits, larger values have no GS1 key
+	if (gs1->company >= gs1_pow10[gs1->company_digits] ||
+	    gs1->reference >= gs1_pow10[gs1->reference_digits]) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief GS1 key of a decoded EPC with its check digit: GTIN-14 for SGTIN-96, SSCC-18 for
+ * SSCC-96, GLN-13 for SGLN-96 and the 14-digit GRAI without serial for GRAI-96.
+ *
+ * @param gs1 Decoded fields.
+ * @return uint64_t Key, 0 for schemes without a fixed length key.
+ */
+uint64_t m6e_nano_gs1_key(const struct m6e_nano_gs1 *gs1)
+{
+	const struct gs1_scheme *scheme = _gs1_scheme(gs1->header);
+	uint8_t digits = gs1->reference_digits;
+	uint64_t body;
+	uint32_t sum = 0;
+
+	if (scheme == NULL || scheme->key_digits == 0) {
+		return 0;
+	}
+
+	if (scheme->indicator && digits > 0) {
+		// The indicator or extension digit moves in front of the company prefix
+		uint64_t lead = gs1->reference / gs1_pow10[digits - 1];
+		uint64_t rest = gs1->reference % gs1_pow10[digits - 1];
+
+		body = lead * gs1_pow10[scheme->key_digits - 1] +
+		       gs1->company * gs1_pow10[digits - 1] + rest;
+	} else {
+		body = gs1->company * gs1_pow10[digits] + gs1->reference;
+	}
+
+	// Weights alternate 3, 1 from the rightmost digit, leading zeros count nothing
+	for (uint64_t rest = body, weight = 3; rest > 0; rest /= 10, weight = 4 - weight) {
+		sum += (rest % 10) * weight;
+	}
+
+	return body * 10 + (10 - sum % 10) % 10;
+}
+
+/**
+ * @brief Count a read of a key in an open addressed table of counters.
+ *
+ * @param skus Counters, zeroed before the first read.
+ * @param size Number of counters, a power of two.
+ * @param key Key, not 0.
+ * @return int 0 on success, -ENOSPC if the key is new and the table full.
+ */
+int m6e_nano_sku_count(struct m6e_nano_sku *skus, uint16_t size, uint64_t key)
+{
+	// Fibonacci hashing, GTINs of one company differ in their low digits only
+	uint32_t slot = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (size - 1);
+
+	for (uint16_t probe = 0; probe < size; probe++) {
+		struct m6e_nano_sku *sku = &skus[(slot + probe) & (size - 1)];
+
+		if (sku->key == key) {
+			sku->reads++;
+			return 0;
+		}
+		if (sku->key == 0) {
+			sku->key = key;
+			sku->reads = 1;
+			return 0;
+		}
+	}
+
+	return -ENOSPC;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_GS1_H
+#define M6E_NANO_GS1_H
+
+#include <stdint.h>
+
+/*
+ * Decodes the 96-bit EPC schemes of the GS1 EPC Tag Data Standard into their integer fields.
+ *
+ * Every partitioned scheme splits the same 8-bit header, 3-bit filter and 3-bit partition
+ * the same way: the partition gives the width of the company prefix, the scheme the combined
+ * width of the prefix and its reference. Both come from small tables, so decoding is a few
+ * shifts and no formatting. Fields are returned as numbers; the company prefix and reference
+ * digit counts give their leading zeros back.
+ */
+
+// Header byte of each scheme
+#define M6E_NANO_GS1_SGTIN_96 0x30
+#define M6E_NANO_GS1_SSCC_96  0x31
+#define M6E_NANO_GS1_SGLN_96  0x32
+#define M6E_NANO_GS1_GRAI_96  0x33
+#define M6E_NANO_GS1_GIAI_96  0x34
+#define M6E_NANO_GS1_GID_96   0x35
+
+// EPC length of the 96-bit schemes
+#define M6E_NANO_GS1_EPC_LEN 12
+
+struct m6e_nano_gs1 {
+	uint8_t header;           // One of M6E_NANO_GS1_*
+	uint8_t filter;           // 0 for GID-96
+	uint8_t company_digits;   // 0 for GID-96
+	uint8_t reference_digits; // 0 for GID-96
+	// Company prefix, general manager number for GID-96
+	uint64_t company;
+	// Item reference with its indicator digit (SGTIN), serial reference with its extension
+	// digit (SSCC), location reference (SGLN), asset type (GRAI), individual asset reference
+	// (GIAI) or object class (GID)
+	uint64_t reference;
+	// Serial number, GLN extension for SGLN-96, 0 for SSCC-96 and GIAI-96
+	uint64_t serial;
+};
+
+// Read counter of a GS1 key, see m6e_nano_sku_count()
+struct m6e_nano_sku {
+	uint64_t key; // GTIN-14 for SGTIN-96 reads, 0 for a free slot
+	uint32_t reads;
+};
+
+/**
+ * @brief Decode a GS1 EPC.
+ *
+ * @param epc EPC.
+ * @param epc_len EPC length in bytes.
+ * @param gs1 Decoded fields.
+ * @return int 0 on success, -ENOTSUP if the EPC is not of a 96-bit GS1 scheme, -EBADMSG for
+ * an invalid partition or a field out of range for its digits.
+ */
+int m6e_nano_gs1_decode(const uint8_t *epc, uint8_t epc_len, struct m6e_nano_gs1 *gs1);
+
+/**
+ * @brief GS1 key of a decoded EPC with its check digit: GTIN-14 for SGTIN-96, SSCC-18 for
+ * SSCC-96, GLN-13 for SGLN-96 and the 14-digit GRAI without serial for GRAI-96.
+ *
+ * @param gs1 Decoded fields.
+ * @return uint64_t Key, 0 for schemes without a fixed length key.
+ */
+uint64_t m6e_nano_gs1_key(const struct m6e_nano_gs1 *gs1);
+
+/**
+ * @brief Count a read of a key in an open addressed table of counters.
+ *
+ * @param skus Counters, zeroed before the first read.
+ * @param size Number of counters, a power of two.
+ * @param key Key, not 0.
+ * @return int 0 on success, -ENOSPC if the key is new and the table full.
+ */
+int m6e_nano_sku_count(struct m6e_nano_sku *skus, uint16_t size, uint64_t key);
+
+#endif // M6E_NANO_GS1_H
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_INTERNAL_H
+#define M6E_NANO_INTERNAL_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+#include "m6e_nano.h"
+
+/* Helpers shared between the driver source files, not part of the public API. */
+
+#ifdef CONFIG_M6E_NANO_WORKQUEUE
+extern struct k_work_q m6e_nano_workq;
+#endif
+
+/**
+ * @brief Send every remembered setting to the module, optionally restarting reading.
+ *
+ * @param dev UART peripheral device.
+ * @param start Whether to start continuous reading afterwards.
+ * @return int 0 on success, the first failing command's error otherwise.
+ */
+int _m6e_nano_apply_settings(const struct device *dev, bool start);
+
+/**
+ * @brief Report an event to the application, if it registered for them.
+ *
+ * @param dev UART peripheral device.
+ * @param event One of M6E_NANO_EVENT_*.
+ */
+void _m6e_nano_notify(const struct device *dev, uint8_t event);
+
+/**
+ * @brief Send a command and check that the module accepted it. The response is left in the
+ * response buffer.
+ *
+ * @param dev UART peripheral device.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param size Length of the command data.
+ * @return int 0 on success, -EIO if the module reported an error, negative errno otherwise.
+ */
+int _m6e_nano_command(const struct device *dev, uint8_t opcode, const uint8_t *data,
+		      uint8_t size);
+
+/**
+ * @brief Send a command without waiting for its response, to do other work while the module
+ * processes it. Hold data->lock until _m6e_nano_command_wait(), so no other command is sent in
+ * between.
+ *
+ * @param dev UART peripheral device.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param size Length of the command data.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int _m6e_nano_command_send(const struct device *dev, uint8_t opcode, const uint8_t *data,
+			   uint8_t size);
+
+/**
+ * @brief Wait for the response to a command sent with _m6e_nano_command_send() and check that
+ * the module accepted it. The response is left in the response buffer.
+ *
+ * @param dev UART peripheral device.
+ * @param opcode Opcode of the command.
+ * @param timeout_ms Longest wait for the response.
+ * @return int 0 on success, -EIO if the module reported an error, negative errno otherwise.
+ */
+int _m6e_nano_command_wait(const struct device *dev, uint8_t opcode, int32_t timeout_ms);
+
+/**
+ * @brief Stop a continuous read operation and wait until the module acknowledges it, so the
+ * next command is not sent while tags are still streaming.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int _m6e_nano_stop_reading(const struct device *dev);
+
+/**
+ * @brief Switch the module, then the UART, to a baud rate, limited to the maximum of the
+ * module.
+ *
+ * @param dev UART peripheral device.
+ * @param baud Baud rate.
+ * @return int 0 on success, -ENOTSUP without runtime UART configuration, negative errno
+ * otherwise.
+ */
+int _m6e_nano_switch_baud(const struct device *dev, uint32_t baud);
+
+/**
+ * @brief Put the module to sleep. Does nothing if it is already asleep.
+ *
+ * @param dev UART peripheral device.
+ * @param method One of M6E_NANO_SLEEP_*.
+ * @return int 0 on success, -ENOTSUP without enable-gpios, negative errno otherwise.
+ */
+int _m6e_nano_sleep(const struct device *dev, uint8_t method);
+
+/**
+ * @brief Wake the module from _m6e_nano_sleep(), restoring its configuration. Does nothing if
+ * the module is awake.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int _m6e_nano_resume(const struct device *dev);
+
+#ifdef CONFIG_M6E_NANO_SCHEDULER
+/**
+ * @brief Initialize the inventory scheduler of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_sched_init(const struct device *dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+/**
+ * @brief Initialize inventory rounds of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_round_init(const struct device *dev);
+
+/**
+ * @brief Count a tag read in the current round. Called from m6e_nano_parse_response().
+ *
+ * @param dev UART peripheral device.
+ * @param epc EPC bytes.
+ * @param len Length of the EPC.
+ */
+void m6e_nano_round_tag(const struct device *dev, const uint8_t *epc, uint8_t len);
+
+/**
+ * @brief End the current round if rounds end on keep-alives. Called from
+ * m6e_nano_parse_response().
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_round_keepalive(const struct device *dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_ASYNC_INIT
+/**
+ * @brief Schedule the version probe and devicetree configuration of a driver instance on the
+ * driver work queue, so they do not hold up the other devices initialized at boot.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_boot_init(const struct device *dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+/**
+ * @brief Initialize the antenna port list of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_antenna_init(const struct device *dev);
+
+/**
+ * @brief Configure the module for the port list, or the default port without one. Called when
+ * the list changes and when settings are re-applied.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, -ENODEV if every port is skipped, negative errno otherwise.
+ */
+int m6e_nano_antenna_apply(const struct device *dev);
+
+/**
+ * @brief Follow continuous reading starting or stopping, to switch ports after their dwell
+ * time.
+ *
+ * @param dev UART peripheral device.
+ * @param reading Whether continuous reading started.
+ */
+void m6e_nano_antenna_reading(const struct device *dev, bool reading);
+
+/**
+ * @brief Attribute a tag read to its port. Called from the UART ISR as the frame completes.
+ *
+ * @param dev UART peripheral device.
+ * @param antenna Antenna byte of the tag read, TX port in the 4 MSB.
+ */
+void m6e_nano_antenna_tag(const struct device *dev, uint8_t antenna);
+#endif
+
+#ifdef CONFIG_M6E_NANO_RTIO
+/**
+ * @brief Initialize the RTIO I/O device of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_rtio_init(const struct device *dev);
+
+/**
+ * @brief Complete the oldest waiting RTIO read with a frame. Called from the UART ISR for every
+ * complete CRC-valid frame.
+ *
+ * @param dev UART peripheral device.
+ * @param frame Frame, from the header to the CRC.
+ */
+void m6e_nano_rtio_frame(const struct device *dev, const uint8_t *frame);
+#endif
+
+#ifdef CONFIG_M6E_NANO_ZBUS
+/**
+ * @brief Initialize zbus publication of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_zbus_init(const struct device *dev);
+
+/**
+ * @brief Queue a tag read frame for publication on m6e_nano_tag_chan. Called from the UART ISR
+ * for every complete CRC-valid frame. Reads the watchlist filters out are not published; GS1
+ * counting and inventory rounds stay with m6e_nano_parse_response().
+ *
+ * @param dev UART peripheral device.
+ * @param frame Frame, from the header to the CRC.
+ */
+void m6e_nano_zbus_frame(const struct device *dev, const uint8_t *frame);
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+/**
+ * @brief Queue a round summary for publication on m6e_nano_round_chan.
+ *
+ * @param dev UART peripheral device.
+ * @param summary Summary of the round that ended.
+ */
+void m6e_nano_zbus_round(const struct device *dev, const struct m6e_nano_round_summary *summary);
+#endif
+#endif
+
+#ifdef CONFIG_M6E_NANO_COALESCE
+/**
+ * @brief Initialize callback coalescing of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_coalesce_init(const struct device *dev);
+
+/**
+ * @brief Queue a CRC-valid frame for the consumer, calling the data callback once enough
+ * frames are queued. Called from the UART ISR.
+ *
+ * @param dev UART peripheral device.
+ * @param frame Frame, from the header to the CRC.
+ */
+void m6e_nano_coalesce_frame(const struct device *dev, const uint8_t *frame);
+
+/**
+ * @brief Release the frame the consumer holds and take the next queued one.
+ *
+ * @param dev UART peripheral device.
+ * @return true if a frame was taken.
+ */
+bool m6e_nano_coalesce_next(const struct device *dev);
+#endif
+
+#ifdef CONFIG_M6E_NANO_BRIDGE
+/**
+ * @brief Initialize the bridge of a driver instance, off.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_bridge_init(const struct device *dev);
+
+/**
+ * @brief Pass bytes on between the module UART and the bridge. Called from the UART interrupt
+ * in place of the frame receiver while the bridge is on.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_bridge_isr(const struct device *dev);
+#endif
+
+#endif // M6E_NANO_INTERNAL_H
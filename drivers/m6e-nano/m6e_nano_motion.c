@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "m6e_nano_motion.h"
+
+// Speed of light / 720, distance in um per degree of round trip phase at 1 kHz
+#define MOTION_UM_PER_DEG_KHZ 416378414U
+
+/**
+ * @brief Reset the estimate of a tag.
+ *
+ * @param motion Estimator state.
+ */
+void m6e_nano_motion_init(struct m6e_nano_motion *motion)
+{
+	memset(motion, 0, sizeof(*motion));
+}
+
+/**
+ * @brief Displacement between two reads on the same channel.
+ *
+ * @param from Phase of the earlier read in degrees.
+ * @param to Phase of the later read in degrees.
+ * @param freq Channel frequency in kHz.
+ * @return int32_t Displacement in um, positive away from the antenna.
+ */
+static int32_t _motion_displacement(uint16_t from, uint16_t to, uint32_t freq)
+{
+	int32_t delta = (int32_t)to - from;
+
+	// Phase is reported modulo 180 degrees, take the smallest change
+	if (delta > 90) {
+		delta -= 180;
+	} else if (delta <= -90) {
+		delta += 180;
+	}
+
+	return delta * (int32_t)(MOTION_UM_PER_DEG_KHZ / freq);
+}
+
+/**
+ * @brief Movement of a tag from its smoothed velocity.
+ *
+ * @param motion Estimator state.
+ * @return uint8_t One of M6E_NANO_MOTION_*.
+ */
+static uint8_t _motion_classify(const struct m6e_nano_motion *motion)
+{
+	if (!motion->moved) {
+		return M6E_NANO_MOTION_UNKNOWN;
+	} else if (motion->velocity <= -M6E_NANO_MOTION_THRESHOLD_MM_S) {
+		return M6E_NANO_MOTION_APPROACHING;
+	} else if (motion->velocity >= M6E_NANO_MOTION_THRESHOLD_MM_S) {
+		return M6E_NANO_MOTION_RECEDING;
+	}
+
+	return M6E_NANO_MOTION_STATIC;
+}
+
+/**
+ * @brief Feed a read of the tag to its estimator.
+ *
+ * @param motion Estimator state.
+ * @param rssi RSSI in dBm.
+ * @param phase Phase in degrees, 0 to 180.
+ * @param freq Channel frequency in kHz.
+ * @param time_ms Time of the read in ms, must not go backwards.
+ * @return uint8_t Movement of the tag, one of M6E_NANO_MOTION_*.
+ */
+uint8_t m6e_nano_motion_update(struct m6e_nano_motion *motion, int8_t rssi, uint16_t phase,
+			       uint32_t freq, uint32_t time_ms)
+{
+	uint32_t gap = time_ms - motion->last_ms;
+	uint8_t state = motion->state;
+
+	if (motion->reads == 0) {
+		motion->rssi_q8 = rssi * 256;
+		motion->rssi_peak = rssi;
+		motion->first_ms = time_ms;
+		motion->window_ms = time_ms;
+	} else {
+		motion->rssi_q8 += (rssi * 256 - motion->rssi_q8) / (1 << M6E_NANO_MOTION_EWMA_SHIFT);
+		if (rssi > motion->rssi_peak) {
+			motion->rssi_peak = rssi;
+		}
+
+		if (gap > M6E_NANO_MOTION_MAX_GAP_MS) {
+			// Phase track lost, restart the velocity window
+			motion->window_ms = time_ms;
+			motion->window_um = 0;
+		} else if (freq == motion->last_freq && freq > 0) {
+			// A different channel only re-anchors the phase reference
+			int32_t um = _motion_displacement(motion->last_phase, phase, freq);
+
+			motion->distance_um += um;
+			motion->window_um += um;
+		}
+	}
+	motion->reads++;
+
+	uint32_t elapsed = time_ms - motion->window_ms;
+
+	if (elapsed >= M6E_NANO_MOTION_WINDOW_MS) {
+		// um per ms is mm per s
+		int32_t velocity = motion->window_um / (int32_t)elapsed;
+
+		if (motion->moved) {
+			motion->velocity +=
+				(velocity - motion->velocity) / (1 << M6E_NANO_MOTION_EWMA_SHIFT);
+		} else {
+			motion->velocity = velocity;
+			motion->moved = true;
+		}
+		motion->window_ms = time_ms;
+		motion->window_um = 0;
+	}
+
+	motion->state = _motion_classify(motion);
+	if (motion->state == M6E_NANO_MOTION_APPROACHING) {
+		motion->approached = true;
+	} else if (motion->state == M6E_NANO_MOTION_RECEDING && motion->approached) {
+		motion->passed = true;
+	}
+	if (motion->state == M6E_NANO_MOTION_STATIC && state == M6E_NANO_MOTION_STATIC) {
+		motion->dwell_ms += gap;
+	} else if (motion->state != M6E_NANO_MOTION_STATIC) {
+		motion->dwell_ms = 0;
+	}
+
+	motion->last_ms = time_ms;
+	motion->last_freq = freq;
+	motion->last_phase = phase;
+
+	return motion->state;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_MOTION_H
+#define M6E_NANO_MOTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Per-tag streaming estimate of proximity and radial movement, in integer arithmetic.
+ *
+ * RSSI is smoothed with an exponentially weighted moving average kept in 1/256 dBm.
+ *
+ * The module reports the backscatter phase modulo 180 degrees. Over the round trip a phase
+ * change of d degrees is a change in distance of c * d / (720 * f), about 0.45 mm per degree
+ * at 915 MHz, so two reads on the same channel less than CONFIG_M6E_NANO_MOTION_MAX_GAP_MS
+ * apart give an unambiguous displacement as long as the tag moved less than an eighth of a
+ * wavelength, about 4 cm. Every channel has its own phase offset, so a hop re-anchors the phase
+ * reference while the accumulated displacement carries on: the track is unwrapped across hops.
+ *
+ * Displacement is turned into a radial velocity every CONFIG_M6E_NANO_MOTION_WINDOW_MS and
+ * smoothed like the RSSI. Positive velocities move away from the antenna.
+ */
+
+#ifdef CONFIG_M6E_NANO_MOTION_EWMA_SHIFT
+#define M6E_NANO_MOTION_EWMA_SHIFT CONFIG_M6E_NANO_MOTION_EWMA_SHIFT
+#else
+#define M6E_NANO_MOTION_EWMA_SHIFT 2
+#endif
+
+#ifdef CONFIG_M6E_NANO_MOTION_MAX_GAP_MS
+#define M6E_NANO_MOTION_MAX_GAP_MS CONFIG_M6E_NANO_MOTION_MAX_GAP_MS
+#else
+#define M6E_NANO_MOTION_MAX_GAP_MS 50
+#endif
+
+#ifdef CONFIG_M6E_NANO_MOTION_WINDOW_MS
+#define M6E_NANO_MOTION_WINDOW_MS CONFIG_M6E_NANO_MOTION_WINDOW_MS
+#else
+#define M6E_NANO_MOTION_WINDOW_MS 100
+#endif
+
+#ifdef CONFIG_M6E_NANO_MOTION_THRESHOLD_MM_S
+#define M6E_NANO_MOTION_THRESHOLD_MM_S CONFIG_M6E_NANO_MOTION_THRESHOLD_MM_S
+#else
+#define M6E_NANO_MOTION_THRESHOLD_MM_S 50
+#endif
+
+// Movement of a tag
+#define M6E_NANO_MOTION_UNKNOWN     0 // Not enough reads yet
+#define M6E_NANO_MOTION_STATIC      1
+#define M6E_NANO_MOTION_APPROACHING 2
+#define M6E_NANO_MOTION_RECEDING    3
+
+struct m6e_nano_motion {
+	// Estimates
+	int32_t rssi_q8;     // Smoothed RSSI in 1/256 dBm
+	int8_t rssi_peak;    // Strongest read in dBm
+	int32_t velocity;    // Smoothed radial velocity in mm/s, positive when receding
+	int32_t distance_um; // Displacement since the first read, positive away from the antenna
+	uint8_t state;       // One of M6E_NANO_MOTION_*
+	bool approached;     // Was seen approaching
+	bool passed;         // Approached then receded: the tag walked past the antenna
+	uint32_t dwell_ms;   // Time spent static without interruption
+	uint32_t reads;
+	uint32_t first_ms;
+
+	// Phase track
+	uint32_t last_ms;
+	uint32_t last_freq; // kHz, 0 before the first read
+	uint16_t last_phase;
+	uint32_t window_ms; // Start of the current velocity window
+	int32_t window_um;  // Displacement within the current velocity window
+	bool moved;         // A velocity window completed
+};
+
+/**
+ * @brief Reset the estimate of a tag.
+ *
+ * @param motion Estimator state.
+ */
+void m6e_nano_motion_init(struct m6e_nano_motion *motion);
+
+/**
+ * @brief Feed a read of the tag to its estimator.
+ *
+ * @param motion Estimator state.
+ * @param rssi RSSI in dBm.
+ * @param phase Phase in degrees, 0 to 180.
+ * @param freq Channel frequency in kHz.
+ * @param time_ms Time of the read in ms, must not go backwards.
+ * @return uint8_t Movement of the tag, one of M6E_NANO_MOTION_*.
+ */
+uint8_t m6e_nano_motion_update(struct m6e_nano_motion *motion, int8_t rssi, uint16_t phase,
+			       uint32_t freq, uint32_t time_ms);
+
+#endif // M6E_NANO_MOTION_H
@@ -0,0 +1,964 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "m6e_nano_proto.h"
+
+// Singulation option flags of TMR_SR_OPCODE_READ_TAG_ID_SINGLE, besides the select target
+#define SINGULATION_OPTION_INVERT   0x08
+#define SINGULATION_OPTION_METADATA 0x10
+
+static const uint16_t crc_table[] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+	0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+static const uint32_t crc32_table[] = {
+	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4,
+	0x4db26158, 0x5005713c, 0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+	0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+// Firmware image header: "TM-SPaik", the image format, then the image length
+static const uint8_t fw_magic[] = {0x54, 0x4D, 0x2D, 0x53, 0x50, 0x61,
+				   0x69, 0x6B, 0x00, 0x00, 0x00, 0x02};
+
+// Flash passwords and sector of the application, fixed by the bootloader
+#define FW_ERASE_PASSWORD 0x08959121
+#define FW_WRITE_PASSWORD 0x02254410
+#define FW_APP_SECTOR     0x02
+
+/**
+ * @brief Calculate the CRC of a frame.
+ *
+ * @param buf Frame from its length byte, without the header.
+ * @param len Number of bytes.
+ * @return uint16_t CRC, sent big-endian after the data.
+ */
+uint16_t m6e_nano_crc(const uint8_t *buf, size_t len)
+{
+	uint16_t crc = 0xFFFF;
+
+	for (size_t i = 0; i < len; i++) {
+		crc = ((crc << 4) | (buf[i] >> 4)) ^ crc_table[crc >> 12];
+		crc = ((crc << 4) | (buf[i] & 0x0F)) ^ crc_table[crc >> 12];
+	}
+
+	return crc;
+}
+
+/**
+ * @brief Encode a command frame.
+ *
+ * @param frame Destination, len + 5 bytes.
+ * @param size Size of the destination.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param len Length of the command data.
+ * @return int Length of the frame, -ENOMEM if it does not fit.
+ */
+int m6e_nano_frame_encode(uint8_t *frame, size_t size, uint8_t opcode, const uint8_t *data,
+			  uint8_t len)
+{
+	uint16_t crc;
+
+	if (size < (size_t)len + 5) {
+		return -ENOMEM;
+	}
+
+	frame[0] = TMR_START_HEADER;
+	frame[1] = len;
+	frame[2] = opcode;
+	if (len > 0) {
+		memcpy(&frame[3], data, len);
+	}
+
+	crc = m6e_nano_crc(&frame[1], len + 2);
+	frame[len + 3] = crc >> 8;
+	frame[len + 4] = crc & 0xFF;
+
+	return len + 5;
+}
+
+/**
+ * @brief Check the CRC of a complete frame received from the module.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @return true if the CRC matches.
+ */
+bool m6e_nano_frame_crc_ok(const uint8_t *frame)
+{
+	uint16_t len = frame[1] + M6E_NANO_FRAME_OVERHEAD;
+	uint16_t crc = m6e_nano_crc(&frame[1], len - 3);
+
+	return frame[len - 2] == (crc >> 8) && frame[len - 1] == (crc & 0xFF);
+}
+
+/**
+ * @brief Get the status of a frame received from the module.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @return uint16_t Status, 0 on success.
+ */
+uint16_t m6e_nano_frame_status(const uint8_t *frame)
+{
+	return ((uint16_t)frame[3] << 8) | frame[4];
+}
+
+/**
+ * @brief Whether a frame is a tag read of a continuous search, not a keep-alive, temperature or
+ * command response.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @return true for a tag read.
+ */
+bool m6e_nano_frame_is_tag(const uint8_t *frame)
+{
+	if (frame[2] != TMR_SR_OPCODE_READ_TAG_ID_MULTIPLE) {
+		return false;
+	}
+
+	// Same classification as m6e_nano_parse_response()
+	switch (frame[1]) {
+	case 0x00:
+	case 0x08:
+	case 0x0a:
+		return false;
+	default:
+		return true;
+	}
+}
+
+/**
+ * @brief Decode a tag read frame received from the module.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @param tag Decoded tag read.
+ * @return int 0 on success, -EBADMSG if the EPC runs past the frame.
+ */
+int m6e_nano_decode_tag(const uint8_t *frame, struct m6e_nano_tag *tag)
+{
+	uint16_t msgLength = frame[1] + M6E_NANO_FRAME_OVERHEAD;
+	uint16_t tagDataBits = 0;
+	uint16_t epcBits = 0;
+
+	if (msgLength < 31) {
+		return -EBADMSG;
+	}
+
+	for (uint8_t x = 0; x < 2; x++) {
+		tagDataBits |= (uint16_t)frame[24 + x] << (8 * (1 - x));
+	}
+	uint16_t epcOffset = 31 + (tagDataBits + 7) / 8;
+
+	// EPC is followed by its CRC and the message CRC
+	if (epcOffset + 4 > msgLength) {
+		return -EBADMSG;
+	}
+	for (uint8_t x = 0; x < 2; x++) {
+		epcBits |= (uint16_t)frame[epcOffset - 4 + x] << (8 * (1 - x));
+	}
+	// Length counts the PC and EPC CRC words
+	uint16_t epcBytes = epcBits / 8 - 4;
+
+	if (epcBits / 8 < 4 || epcBytes > M6E_NANO_EPC_MAX_LEN ||
+	    epcOffset + epcBytes + 4 > msgLength) {
+		return -EBADMSG;
+	}
+
+	tag->rssi = (int8_t)frame[12];
+	tag->antenna = frame[13];
+	tag->freq = 0;
+	for (uint8_t x = 0; x < 3; x++) {
+		tag->freq |= (uint32_t)frame[14 + x] << (8 * (2 - x));
+	}
+	tag->timestamp = 0;
+	for (uint8_t x = 0; x < 4; x++) {
+		tag->timestamp |= (uint32_t)frame[17 + x] << (8 * (3 - x));
+	}
+	tag->phase = 0;
+	for (uint8_t x = 0; x < 2; x++) {
+		tag->phase |= (uint16_t)frame[21 + x] << (8 * (1 - x));
+	}
+	tag->protocol = frame[23];
+	tag->epc_len = epcBytes;
+	memcpy(tag->epc, &frame[epcOffset], epcBytes);
+
+	return 0;
+}
+
+/**
+ * @brief Decode the response to TMR_SR_OPCODE_VERSION.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @param version Decoded version.
+ * @return int 0 on success, -EBADMSG if the frame is too short.
+ */
+int m6e_nano_decode_version(const uint8_t *frame, struct m6e_nano_version *version)
+{
+	uint32_t words[5] = {0};
+
+	if (frame[1] < sizeof(words)) {
+		return -EBADMSG;
+	}
+
+	// Bootloader, hardware, firmware date, firmware version and protocols, big-endian
+	for (uint8_t i = 0; i < 5; i++) {
+		for (uint8_t x = 0; x < 4; x++) {
+			words[i] |= (uint32_t)frame[5 + 4 * i + x] << (8 * (3 - x));
+		}
+	}
+
+	version->bootloader = words[0];
+	version->hardware = words[1];
+	version->fw_date = words[2];
+	version->fw_version = words[3];
+	version->protocols = words[4];
+
+	return 0;
+}
+
+/**
+ * @brief Encode the data of a TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP command starting a
+ * continuous Gen2 search.
+ *
+ * @param data Destination, M6E_NANO_START_SEARCH_LEN bytes.
+ * @param tm_option TM option byte, a combination of TMR_SR_TM_OPTION_*.
+ * @return uint8_t Length of the data.
+ */
+uint8_t m6e_nano_encode_start_search(uint8_t *data, uint8_t tm_option)
+{
+	// Timeout, TM option, READ_TAG_ID_MULTIPLE sub command, search flags, Gen2, then the
+	// embedded read of the tag metadata
+	static const uint8_t search[M6E_NANO_START_SEARCH_LEN] = {
+		0x00, 0x00, 0x00, 0x22, 0x00, 0x00, 0x05, 0x07,
+		0x22, 0x10, 0x00, 0x1B, 0x03, 0xE8, 0x01, 0xFF};
+
+	memcpy(data, search, sizeof(search));
+	data[2] = tm_option;
+
+	return sizeof(search);
+}
+
+/**
+ * @brief Encode the data of a TMR_SR_OPCODE_READ_TAG_ID_SINGLE command.
+ *
+ * @param data Destination.
+ * @param size Size of the destination.
+ * @param timeout_ms Time the module searches for a tag.
+ * @param metadata Tag read metadata to return, bitmask of M6E_NANO_METADATA_*.
+ * @param select Tags to read, NULL for any tag.
+ * @return int Length of the data, -EINVAL for an invalid select, -ENOMEM if it does not fit.
+ */
+int m6e_nano_encode_read_single(uint8_t *data, size_t size, uint16_t timeout_ms,
+				uint16_t metadata, const struct m6e_nano_select *select)
+{
+	size_t mask_len = 0;
+	size_t len = 5;
+
+	if (select != NULL) {
+		if (select->target < M6E_NANO_SELECT_EPC ||
+		    select->target > M6E_NANO_SELECT_EPC_BANK ||
+		    (select->bit_len > 0 && select->mask == NULL)) {
+			return -EINVAL;
+		}
+		mask_len = (select->bit_len + 7) / 8;
+		// Access password, then the EPC length or the bank address and length, then the mask
+		len += 4 + (select->target == M6E_NANO_SELECT_EPC ? 1 : 5) + mask_len;
+	}
+	if (size < len) {
+		return -ENOMEM;
+	}
+
+	// Timeout, singulation option with the metadata flag, metadata
+	data[0] = timeout_ms >> 8;
+	data[1] = timeout_ms & 0xFF;
+	data[2] = SINGULATION_OPTION_METADATA;
+	data[3] = metadata >> 8;
+	data[4] = metadata & 0xFF;
+	if (select == NULL) {
+		return len;
+	}
+
+	data[2] |= select->target | (select->invert ? SINGULATION_OPTION_INVERT : 0);
+	memset(&data[5], 0, 4);
+	if (select->target == M6E_NANO_SELECT_EPC) {
+		data[9] = select->bit_len;
+		memcpy(&data[10], select->mask, mask_len);
+	} else {
+		for (uint8_t x = 0; x < 4; x++) {
+			data[9 + x] = select->bit_pointer >> (8 * (3 - x));
+		}
+		data[13] = select->bit_len;
+		memcpy(&data[14], select->mask, mask_len);
+	}
+
+	return len;
+}
+
+/**
+ * @brief Decode the response to TMR_SR_OPCODE_READ_TAG_ID_SINGLE. Fields missing from the
+ * metadata of the response are set to 0.
+ *
+ * @param frame Frame with a success status, from the header to the CRC.
+ * @param tag Decoded tag read.
+ * @return int 0 on success, -EBADMSG if the metadata or EPC run past the frame.
+ */
+int m6e_nano_decode_single(const uint8_t *frame, struct m6e_nano_tag *tag)
+{
+	// Metadata fields in the order the module sends them, with their sizes
+	static const uint8_t sizes[] = {1, 1, 1, 3, 4, 2, 1, 2, 1, 1, 1, 1};
+	uint16_t end = 5 + frame[1];
+	uint16_t pos = 6;
+	uint16_t metadata = 0;
+
+	if (frame[1] < 1) {
+		return -EBADMSG;
+	}
+
+	memset(tag, 0, sizeof(*tag));
+
+	// [5] singulation option, then the metadata flags when the option says so
+	if (frame[5] & SINGULATION_OPTION_METADATA) {
+		if (end < pos + 2) {
+			return -EBADMSG;
+		}
+		metadata = ((uint16_t)frame[6] << 8) | frame[7];
+		pos += 2;
+	}
+
+	for (uint8_t bit = 0; bit < sizeof(sizes); bit++) {
+		const uint8_t *field = &frame[pos];
+
+		if (!(metadata & (1U << bit))) {
+			continue;
+		}
+		if (pos + sizes[bit] > end) {
+			return -EBADMSG;
+		}
+		pos += sizes[bit];
+
+		switch (1U << bit) {
+		case M6E_NANO_METADATA_RSSI:
+			tag->rssi = (int8_t)field[0];
+			break;
+		case M6E_NANO_METADATA_ANTENNA:
+			tag->antenna = field[0];
+			break;
+		case M6E_NANO_METADATA_FREQUENCY:
+			tag->freq = ((uint32_t)field[0] << 16) | ((uint32_t)field[1] << 8) | field[2];
+			break;
+		case M6E_NANO_METADATA_TIMESTAMP:
+			tag->timestamp = ((uint32_t)field[0] << 24) | ((uint32_t)field[1] << 16) |
+					 ((uint32_t)field[2] << 8) | field[3];
+			break;
+		case M6E_NANO_METADATA_PHASE:
+			tag->phase = ((uint16_t)field[0] << 8) | field[1];
+			break;
+		case M6E_NANO_METADATA_PROTOCOL:
+			tag->protocol = field[0];
+			break;
+		case M6E_NANO_METADATA_DATA:
+			// Length in bits, then the embedded data
+			pos += ((((uint16_t)field[0] << 8) | field[1]) + 7) / 8;
+			break;
+		default:
+			break;
+		}
+	}
+
+	// PC word, EPC, EPC CRC
+	if (pos > end || end - pos < 4 || end - pos - 4 > M6E_NANO_EPC_MAX_LEN) {
+		return -EBADMSG;
+	}
+	tag->epc_len = end - pos - 4;
+	memcpy(tag->epc, &frame[pos + 2], tag->epc_len);
+
+	return 0;
+}
+
+/**
+ * @brief Update a CRC-32 (IEEE 802.3) with more bytes.
+ *
+ * @param crc CRC of the bytes so far, 0 to start.
+ * @param buf Bytes.
+ * @param len Number of bytes.
+ * @return uint32_t CRC including the bytes.
+ */
+uint32_t m6e_nano_crc32(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	crc = ~crc;
+	for (size_t i = 0; i < len; i++) {
+		crc = (crc >> 4) ^ crc32_table[(crc ^ buf[i]) & 0x0F];
+		crc = (crc >> 4) ^ crc32_table[(crc ^ (buf[i] >> 4)) & 0x0F];
+	}
+
+	return ~crc;
+}
+
+/**
+ * @brief Store a big-endian 32-bit value.
+ *
+ * @param buf Destination, 4 bytes.
+ * @param value Value.
+ */
+static void _put_be32(uint8_t *buf, uint32_t value)
+{
+	buf[0] = value >> 24;
+	buf[1] = value >> 16;
+	buf[2] = value >> 8;
+	buf[3] = value;
+}
+
+/**
+ * @brief Check the header of a firmware image.
+ *
+ * @param header First M6E_NANO_FW_HEADER_LEN bytes of the image.
+ * @param len Length of the application image that follows the header.
+ * @return int 0 on success, -EBADMSG if the header is not of an M6E firmware image.
+ */
+int m6e_nano_fw_header(const uint8_t *header, uint32_t *len)
+{
+	if (memcmp(header, fw_magic, sizeof(fw_magic)) != 0) {
+		return -EBADMSG;
+	}
+
+	*len = ((uint32_t)header[12] << 24) | ((uint32_t)header[13] << 16) |
+	       ((uint32_t)header[14] << 8) | header[15];
+	if (*len == 0) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Encode the data of a TMR_SR_OPCODE_ERASE_FLASH command erasing the application.
+ *
+ * @param data Destination, M6E_NANO_FW_ERASE_LEN bytes.
+ * @return uint8_t Length of the data.
+ */
+uint8_t m6e_nano_encode_erase_flash(uint8_t *data)
+{
+	_put_be32(data, FW_ERASE_PASSWORD);
+	data[4] = FW_APP_SECTOR;
+
+	return M6E_NANO_FW_ERASE_LEN;
+}
+
+/**
+ * @brief Encode the data of a TMR_SR_OPCODE_WRITE_FLASH_SECTOR command up to the image bytes,
+ * which go at data + M6E_NANO_FW_WRITE_PREFIX_LEN so they can be read in place.
+ *
+ * @param data Destination, M6E_NANO_FW_WRITE_PREFIX_LEN bytes.
+ * @param address Offset of the image bytes in the application image.
+ * @return uint8_t Length of the data before the image bytes.
+ */
+uint8_t m6e_nano_encode_write_flash(uint8_t *data, uint32_t address)
+{
+	_put_be32(data, FW_WRITE_PASSWORD);
+	_put_be32(&data[4], address);
+	data[8] = FW_APP_SECTOR;
+
+	return M6E_NANO_FW_WRITE_PREFIX_LEN;
+}
+
+/**
+ * @brief Decode the response to TMR_SR_OPCODE_VERIFY_IMAGE_CRC.
+ *
+ * @param frame Frame with a success status, from the header to the CRC.
+ * @param crc CRC-32 of the application image in flash.
+ * @return int 0 on success, -EBADMSG if the frame is too short.
+ */
+int m6e_nano_decode_image_crc(const uint8_t *frame, uint32_t *crc)
+{
+	if (frame[1] < 4) {
+		return -EBADMSG;
+	}
+
+	*crc = ((uint32_t)frame[5] << 24) | ((uint32_t)frame[6] << 16) |
+	       ((uint32_t)frame[7] << 8) | frame[8];
+
+	return 0;
+}
+
+/**
+ * @brief Reset a frame receiver.
+ *
+ * @param rx Receiver state.
+ */
+void m6e_nano_rx_reset(struct m6e_nano_rx *rx)
+{
+	rx->len = 0;
+}
+
+/**
+ * @brief Feed bytes to a frame receiver. Stops after the first complete CRC-valid frame, which
+ * stays in rx->frame until the next call.
+ *
+ * @param rx Receiver state.
+ * @param buf Bytes received.
+ * @param len Number of bytes.
+ * @param complete Set to whether a frame was completed.
+ * @return size_t Number of bytes consumed.
+ */
+size_t m6e_nano_rx_feed(struct m6e_nano_rx *rx, const uint8_t *buf, size_t len, bool *complete)
+{
+	size_t used = 0;
+
+	*complete = false;
+
+	// A frame returned by the previous call is done with
+	if (rx->len >= 2 && rx->len == rx->frame[1] + M6E_NANO_FRAME_OVERHEAD) {
+		rx->len = 0;
+	}
+
+	while (used < len) {
+		uint8_t byte = buf[used++];
+
+		if (rx->len == 0 && byte != TMR_START_HEADER) {
+			rx->skipped++;
+			continue;
+		}
+		rx->frame[rx->len++] = byte;
+
+		if (rx->len < 2 || rx->len < rx->frame[1] + M6E_NANO_FRAME_OVERHEAD) {
+			continue;
+		}
+
+		if (m6e_nano_frame_crc_ok(rx->frame)) {
+			*complete = true;
+			break;
+		}
+		rx->crc_errors++;
+		rx->len = 0;
+	}
+
+	return used;
+}
+
+/**
+ * @brief Reset a frame tap and its counters.
+ *
+ * @param tap Tap state.
+ * @param overhead M6E_NANO_COMMAND_OVERHEAD for commands, M6E_NANO_FRAME_OVERHEAD for frames
+ * from the module.
+ */
+void m6e_nano_tap_init(struct m6e_nano_tap *tap, uint8_t overhead)
+{
+	memset(tap, 0, sizeof(*tap));
+	tap->overhead = overhead;
+}
+
+/**
+ * @brief Count the frames of a byte stream. Stops after the first complete CRC-valid frame,
+ * which stays in tap->frame until the next call.
+ *
+ * @param tap Tap state.
+ * @param buf Bytes of the stream.
+ * @param len Number of bytes.
+ * @param complete Set when a frame was completed.
+ * @return size_t Number of bytes used, call again with the rest.
+ */
+size_t m6e_nano_tap_feed(struct m6e_nano_tap *tap, const uint8_t *buf, size_t len,
+			 bool *complete)
+{
+	size_t used = 0;
+	uint16_t crc;
+	uint16_t end;
+
+	*complete = false;
+
+	// A frame returned by the previous call is done with
+	if (tap->len >= 2 && tap->len == tap->frame[1] + tap->overhead) {
+		tap->len = 0;
+	}
+
+	while (used < len) {
+		uint8_t byte = buf[used++];
+
+		tap->bytes++;
+		if (tap->len == 0 && byte != TMR_START_HEADER) {
+			tap->skipped++;
+			continue;
+		}
+		tap->frame[tap->len++] = byte;
+
+		end = tap->frame[1] + tap->overhead;
+		if (tap->len < 2 || tap->len < end) {
+			continue;
+		}
+
+		crc = m6e_nano_crc(&tap->frame[1], end - 3);
+		if (tap->frame[end - 2] == (crc >> 8) && tap->frame[end - 1] == (crc & 0xFF)) {
+			tap->frames++;
+			*complete = true;
+			break;
+		}
+		tap->crc_errors++;
+		tap->len = 0;
+	}
+
+	return used;
+}
+
+/**
+ * @brief Initialize a command engine.
+ *
+ * @param link Engine state.
+ * @param transport Byte stream to the module.
+ * @param on_frame Callback for frames that do not answer a command, may be NULL.
+ * @param user_data Pointer passed to the callback.
+ */
+void m6e_nano_link_init(struct m6e_nano_link *link, const struct m6e_nano_transport *transport,
+			m6e_nano_frame_cb_t on_frame, void *user_data)
+{
+	memset(link, 0, sizeof(*link));
+	link->transport = transport;
+	link->on_frame = on_frame;
+	link->user_data = user_data;
+}
+
+/**
+ * @brief Receive the next frame.
+ *
+ * @param link Engine state.
+ * @param deadline Time from transport->now_ms() to give up at.
+ * @return int 0 with the frame in link->rx.frame, -ETIMEDOUT, negative errno otherwise.
+ */
+static int _link_receive(struct m6e_nano_link *link, uint32_t deadline)
+{
+	const struct m6e_nano_transport *tr = link->transport;
+	bool complete;
+	int ret;
+
+	for (;;) {
+		if (link->in_pos < link->in_len) {
+			link->in_pos += m6e_nano_rx_feed(&link->rx, &link->in[link->in_pos],
+							 link->in_len - link->in_pos, &complete);
+			if (complete) {
+				return 0;
+			}
+		}
+
+		int32_t remaining = (int32_t)(deadline - tr->now_ms(tr->ctx));
+
+		if (remaining < 0) {
+			return -ETIMEDOUT;
+		}
+
+		ret = tr->read(tr->ctx, link->in, sizeof(link->in), remaining);
+		if (ret < 0) {
+			return ret;
+		}
+		if (ret == 0) {
+			return -ETIMEDOUT;
+		}
+		link->in_len = ret;
+		link->in_pos = 0;
+	}
+}
+
+/**
+ * @brief Send a command without waiting for its response.
+ *
+ * @param link Engine state.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param len Length of the command data.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_link_send(struct m6e_nano_link *link, uint8_t opcode, const uint8_t *data,
+		       uint8_t len)
+{
+	const struct m6e_nano_transport *tr = link->transport;
+	int ret;
+
+	ret = m6e_nano_frame_encode(link->tx, sizeof(link->tx), opcode, data, len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return tr->write(tr->ctx, link->tx, ret);
+}
+
+/**
+ * @brief Send a command and wait for its response, which is left in link->rx.frame. Other
+ * frames received meanwhile go to the frame callback.
+ *
+ * @param link Engine state.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param len Length of the command data.
+ * @param timeout_ms Longest wait for the response.
+ * @return int 0 on success, -EIO if the module reported an error, -ETIMEDOUT without a
+ * response, negative errno otherwise.
+ */
+int m6e_nano_link_command(struct m6e_nano_link *link, uint8_t opcode, const uint8_t *data,
+			  uint8_t len, int32_t timeout_ms)
+{
+	int ret;
+
+	ret = m6e_nano_link_send(link, opcode, data, len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return m6e_nano_link_wait(link, opcode, timeout_ms);
+}
+
+/**
+ * @brief Wait for the response to a command sent with m6e_nano_link_send(), which is left in
+ * link->rx.frame. Other frames received meanwhile go to the frame callback.
+ *
+ * @param link Engine state.
+ * @param opcode Opcode of the command.
+ * @param timeout_ms Longest wait for the response.
+ * @return int 0 on success, -EIO if the module reported an error, -ETIMEDOUT without a
+ * response, negative errno otherwise.
+ */
+int m6e_nano_link_wait(struct m6e_nano_link *link, uint8_t opcode, int32_t timeout_ms)
+{
+	const struct m6e_nano_transport *tr = link->transport;
+	uint32_t deadline = tr->now_ms(tr->ctx) + timeout_ms;
+	int ret;
+
+	for (;;) {
+		ret = _link_receive(link, deadline);
+		if (ret < 0) {
+			return ret;
+		}
+
+		if (link->rx.frame[2] == opcode) {
+			return m6e_nano_frame_status(link->rx.frame) == 0 ? 0 : -EIO;
+		}
+		if (link->on_frame != NULL) {
+			link->on_frame(link->rx.frame, link->user_data);
+		}
+	}
+}
+
+/**
+ * @brief Pass the frames received within a time to the frame callback.
+ *
+ * @param link Engine state.
+ * @param timeout_ms Time to receive for.
+ * @return int Number of frames received, negative errno otherwise.
+ */
+int m6e_nano_link_poll(struct m6e_nano_link *link, int32_t timeout_ms)
+{
+	const struct m6e_nano_transport *tr = link->transport;
+	uint32_t deadline = tr->now_ms(tr->ctx) + timeout_ms;
+	int frames = 0;
+	int ret;
+
+	for (;;) {
+		ret = _link_receive(link, deadline);
+		if (ret == -ETIMEDOUT) {
+			return frames;
+		}
+		if (ret < 0) {
+			return ret;
+		}
+
+		frames++;
+		if (link->on_frame != NULL) {
+			link->on_frame(link->rx.frame, link->user_data);
+		}
+	}
+}
+
+/**
+ * @brief Send a firmware update command and wait for its response.
+ *
+ * @param ops Commands of the update.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param len Length of the command data.
+ * @param timeout_ms Longest wait for the response.
+ * @param frame Set to the response.
+ * @return int 0 on success, -EIO if the module reported an error, negative errno otherwise.
+ */
+static int _fw_command(const struct m6e_nano_fw_ops *ops, uint8_t opcode, const uint8_t *data,
+		       uint8_t len, int32_t timeout_ms, const uint8_t **frame)
+{
+	int ret;
+
+	ret = ops->send(ops->ctx, opcode, data, len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return ops->wait(ops->ctx, opcode, timeout_ms, frame);
+}
+
+/**
+ * @brief Start the bootloader, unless it is running already.
+ *
+ * @param ops Commands of the update.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _fw_enter_bootloader(const struct m6e_nano_fw_ops *ops)
+{
+	const uint8_t *frame;
+	uint32_t deadline;
+	int ret;
+
+	ret = _fw_command(ops, TMR_SR_OPCODE_GET_CURRENT_PROGRAM, NULL, 0,
+			  M6E_NANO_FW_COMMAND_TIMEOUT_MS, &frame);
+	if (ret < 0) {
+		return ret;
+	}
+	if (frame[1] >= 1 && (frame[5] & 0x03) == M6E_NANO_PROGRAM_BOOTLOADER) {
+		return 0;
+	}
+
+	// Older bootloaders start at 9600 whatever the application ran at
+	ret = ops->set_baud(ops->ctx, M6E_NANO_FW_BOOT_BAUD);
+	if (ret == 0) {
+		ret = _fw_command(ops, TMR_SR_OPCODE_BOOT_BOOTLOADER, NULL, 0,
+				  M6E_NANO_FW_COMMAND_TIMEOUT_MS, &frame);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	deadline = ops->now_ms(ops->ctx) + M6E_NANO_FW_BOOT_TIMEOUT_MS;
+	do {
+		ret = _fw_command(ops, TMR_SR_OPCODE_VERSION, NULL, 0,
+				  M6E_NANO_FW_PROBE_TIMEOUT_MS, &frame);
+	} while (ret == -ETIMEDOUT && (int32_t)(deadline - ops->now_ms(ops->ctx)) > 0);
+
+	return ret;
+}
+
+/**
+ * @brief Write the application image, reading each chunk while the module writes the one
+ * before. A chunk is sent whole before ops->send() returns, so one buffer does.
+ *
+ * @param ops Commands and image of the update.
+ * @param len Length of the application image.
+ * @param buf Command data of the chunks, M6E_NANO_FW_WRITE_LEN bytes.
+ * @param stats Outcome of the update.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _fw_write(const struct m6e_nano_fw_ops *ops, uint32_t len, uint8_t *buf,
+		     struct m6e_nano_fw_stats *stats)
+{
+	uint8_t *chunk = &buf[M6E_NANO_FW_WRITE_PREFIX_LEN];
+	uint32_t size = len < M6E_NANO_FW_CHUNK_LEN ? len : M6E_NANO_FW_CHUNK_LEN;
+	uint32_t address = 0;
+	const uint8_t *frame;
+	uint32_t start;
+	int ret;
+
+	ret = ops->read(ops->ctx, M6E_NANO_FW_HEADER_LEN, chunk, size);
+	if (ret < 0) {
+		return ret;
+	}
+
+	start = ops->now_ms(ops->ctx);
+	while (address < len) {
+		uint32_t next = address + size;
+		uint32_t next_size = len - next < M6E_NANO_FW_CHUNK_LEN ? len - next
+									: M6E_NANO_FW_CHUNK_LEN;
+
+		m6e_nano_encode_write_flash(buf, address);
+		ret = ops->send(ops->ctx, TMR_SR_OPCODE_WRITE_FLASH_SECTOR, buf,
+				M6E_NANO_FW_WRITE_PREFIX_LEN + size);
+		if (ret < 0) {
+			return ret;
+		}
+		stats->crc = m6e_nano_crc32(stats->crc, chunk, size);
+
+		if (next_size > 0) {
+			ret = ops->read(ops->ctx, M6E_NANO_FW_HEADER_LEN + next, chunk, next_size);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+
+		ret = ops->wait(ops->ctx, TMR_SR_OPCODE_WRITE_FLASH_SECTOR,
+				M6E_NANO_FW_COMMAND_TIMEOUT_MS, &frame);
+		if (ret < 0) {
+			return ret;
+		}
+
+		stats->bytes += size;
+		stats->chunks++;
+		address = next;
+		size = next_size;
+	}
+	stats->write_ms = ops->now_ms(ops->ctx) - start;
+
+	return 0;
+}
+
+/**
+ * @brief Write an application image to a module: start the bootloader unless it is running,
+ * switch to the transfer baud rate, erase the application flash, write the image in
+ * M6E_NANO_FW_CHUNK_LEN chunks, reading each chunk while the module writes the one before, and
+ * have the bootloader verify its CRC-32. Booting the new application is left to the caller,
+ * which knows how it sees the startup message.
+ *
+ * @param ops Commands, image and clock of the update.
+ * @param len Length of the application image that follows the header, see
+ * m6e_nano_fw_header().
+ * @param baud Baud rate of the transfer.
+ * @param buf Command data of the chunks, M6E_NANO_FW_WRITE_LEN bytes.
+ * @param stats Outcome of the update, zeroed by the caller.
+ * @return int 0 on success, -EIO if the module reported an error or the image in its flash does
+ * not match, -ETIMEDOUT if it stopped answering, negative errno otherwise.
+ */
+int m6e_nano_fw_flash(const struct m6e_nano_fw_ops *ops, uint32_t len, uint32_t baud,
+		      uint8_t *buf, struct m6e_nano_fw_stats *stats)
+{
+	uint8_t erase[M6E_NANO_FW_ERASE_LEN];
+	const uint8_t *frame;
+	uint32_t start;
+	uint32_t crc;
+	int ret;
+
+	ret = _fw_enter_bootloader(ops);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = ops->set_baud(ops->ctx, baud);
+	if (ret < 0) {
+		return ret;
+	}
+	stats->baud = baud;
+
+	start = ops->now_ms(ops->ctx);
+	ret = _fw_command(ops, TMR_SR_OPCODE_ERASE_FLASH, erase, m6e_nano_encode_erase_flash(erase),
+			  M6E_NANO_FW_ERASE_TIMEOUT_MS, &frame);
+	if (ret < 0) {
+		return ret;
+	}
+	stats->erase_ms = ops->now_ms(ops->ctx) - start;
+
+	ret = _fw_write(ops, len, buf, stats);
+	if (ret < 0) {
+		return ret;
+	}
+	if (stats->write_ms > 0) {
+		stats->bytes_per_s = (uint64_t)stats->bytes * 1000 / stats->write_ms;
+	}
+
+	ret = _fw_command(ops, TMR_SR_OPCODE_VERIFY_IMAGE_CRC, NULL, 0,
+			  M6E_NANO_FW_COMMAND_TIMEOUT_MS, &frame);
+	if (ret == 0) {
+		ret = m6e_nano_decode_image_crc(frame, &crc);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	return crc == stats->crc ? 0 : -EIO;
+}
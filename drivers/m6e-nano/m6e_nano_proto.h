@@ -0,0 +1,625 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_PROTO_H
+#define M6E_NANO_PROTO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Serial protocol of the M6E Nano, without any OS dependency: frame encoding, CRC, an
+ * incremental frame receiver, decoding of responses, and a command engine over a transport
+ * of three callbacks. The Zephyr driver shares the framing and decoding with the Linux host
+ * library in host/, which runs the command engine over a POSIX serial port.
+ *
+ * Frames received from the module are laid out as:
+ *   [0]           TMR_START_HEADER
+ *   [1]           Length N of the data
+ *   [2]           Opcode
+ *   [3, 4]        Status, 0 on success
+ *   [5 .. 5+N-1]  Data
+ *   [5+N, 6+N]    CRC of [1 .. 4+N], big-endian
+ * Frames sent to the module have no status.
+ */
+
+#define M6E_NANO_BUF_SIZE 255
+#define M6E_NANO_EPC_MAX_LEN 62 // 496-bit EPC, the Gen2 maximum
+
+// Packet header for M6E Nano
+#define TMR_START_HEADER 0xFF
+
+// Op codes for M6E Nano
+#define TMR_SR_OPCODE_VERSION                    0x03
+#define TMR_SR_OPCODE_VERSION_STARTUP            0x04
+#define TMR_SR_OPCODE_SET_BAUD_RATE              0x06
+#define TMR_SR_OPCODE_READ_TAG_ID_SINGLE         0x21
+#define TMR_SR_OPCODE_READ_TAG_ID_MULTIPLE       0x22
+#define TMR_SR_OPCODE_WRITE_TAG_ID               0x23
+#define TMR_SR_OPCODE_WRITE_TAG_DATA             0x24
+#define TMR_SR_OPCODE_KILL_TAG                   0x26
+#define TMR_SR_OPCODE_READ_TAG_DATA              0x28
+#define TMR_SR_OPCODE_CLEAR_TAG_ID_BUFFER        0x2A
+#define TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP      0x2F
+#define TMR_SR_OPCODE_GET_ANTENNA_PORT           0x61
+#define TMR_SR_OPCODE_GET_READ_TX_POWER          0x62
+#define TMR_SR_OPCODE_GET_WRITE_TX_POWER         0x64
+#define TMR_SR_OPCODE_GET_FREQ_HOP_TABLE         0x65
+#define TMR_SR_OPCODE_GET_USER_GPIO_INPUTS       0x66
+#define TMR_SR_OPCODE_GET_REGION                 0x67
+#define TMR_SR_OPCODE_GET_POWER_MODE             0x68
+#define TMR_SR_OPCODE_GET_READER_OPTIONAL_PARAMS 0x6A
+#define TMR_SR_OPCODE_GET_PROTOCOL_PARAM         0x6B
+#define TMR_SR_OPCODE_SET_ANTENNA_PORT           0x91
+#define TMR_SR_OPCODE_SET_TAG_PROTOCOL           0x93
+#define TMR_SR_OPCODE_SET_READ_TX_POWER          0x92
+#define TMR_SR_OPCODE_SET_WRITE_TX_POWER         0x94
+#define TMR_SR_OPCODE_SET_FREQ_HOP_TABLE         0x95
+#define TMR_SR_OPCODE_SET_USER_GPIO_OUTPUTS      0x96
+#define TMR_SR_OPCODE_SET_REGION                 0x97
+#define TMR_SR_OPCODE_SET_POWER_MODE             0x98
+#define TMR_SR_OPCODE_SET_READER_OPTIONAL_PARAMS 0x9A
+#define TMR_SR_OPCODE_SET_PROTOCOL_PARAM         0x9B
+
+// Op codes of the bootloader, for firmware updates. The application answers the version and
+// TMR_SR_OPCODE_GET_CURRENT_PROGRAM too, and starts the bootloader.
+#define TMR_SR_OPCODE_BOOT_FIRMWARE       0x04 // Answered with the startup message
+#define TMR_SR_OPCODE_ERASE_FLASH         0x07
+#define TMR_SR_OPCODE_VERIFY_IMAGE_CRC    0x08
+#define TMR_SR_OPCODE_BOOT_BOOTLOADER     0x09
+#define TMR_SR_OPCODE_GET_CURRENT_PROGRAM 0x0C
+#define TMR_SR_OPCODE_WRITE_FLASH_SECTOR  0x0D
+
+// Program running, low bits of the TMR_SR_OPCODE_GET_CURRENT_PROGRAM response
+#define M6E_NANO_PROGRAM_BOOTLOADER 0x01
+#define M6E_NANO_PROGRAM_APP        0x02
+
+// TM option byte of a multi-protocol search
+#define TMR_SR_TM_OPTION_CONTINUOUS   0x01
+#define TMR_SR_TM_OPTION_TRIGGER_READ 0x04 // Wait for the trigger GPI before searching
+
+// Reader configuration keys (SET_READER_OPTIONAL_PARAMS)
+#define TMR_SR_CONFIGURATION_ENABLE_READ_FILTER 0x0C
+#define TMR_SR_CONFIGURATION_TRIGGER_READ_GPIO  0x1B
+
+// Region configuration keys (SET_REGION / GET_REGION)
+#define TMR_SR_REGION_CONFIGURATION_LBT_ENABLED   0x40
+#define TMR_SR_REGION_CONFIGURATION_LBT_THRESHOLD 0x41
+
+// Gen2 protocol parameters (SET_PROTOCOL_PARAM)
+#define TMR_SR_GEN2_CONFIGURATION_SESSION 0x00
+#define TMR_SR_GEN2_CONFIGURATION_TARGET  0x01
+#define TMR_SR_GEN2_CONFIGURATION_Q       0x12
+
+// Gen2 inventory target flag
+#define M6E_NANO_GEN2_TARGET_A  0
+#define M6E_NANO_GEN2_TARGET_B  1
+#define M6E_NANO_GEN2_TARGET_AB 2
+#define M6E_NANO_GEN2_TARGET_BA 3
+
+// Frequency hop table options (GET/SET_FREQ_HOP_TABLE)
+#define TMR_SR_HOP_TABLE_OPTION_HOP_TIME 0x01
+
+// Largest hop table that fits a single frame, 4 bytes (kHz) per channel
+#define M6E_NANO_MAX_HOP_CHANNELS 62
+
+// User GPIO pins of the M6E Nano, numbered from 1
+#define M6E_NANO_GPIO_COUNT 4
+
+// Power modes for M6E Nano
+#define TMR_SR_POWER_MODE_FULL     0x00
+#define TMR_SR_POWER_MODE_MIN_SAVE 0x01
+#define TMR_SR_POWER_MODE_MED_SAVE 0x02
+#define TMR_SR_POWER_MODE_MAX_SAVE 0x03
+
+// Define the allowed regions - these set the internal freq of the module
+#define REGION_INDIA        0x04
+#define REGION_JAPAN        0x05
+#define REGION_CHINA        0x06
+#define REGION_EUROPE       0x08
+#define REGION_KOREA        0x09
+#define REGION_AUSTRALIA    0x0B
+#define REGION_NEWZEALAND   0x0C
+#define REGION_NORTHAMERICA 0x0D
+#define REGION_OPEN         0xFF
+
+// Define the allowed tag protocols
+#define TMR_TAG_PROTOCOL_NONE             0x00
+#define TMR_TAG_PROTOCOL_ISO180006B       0x03
+#define TMR_TAG_PROTOCOL_GEN2             0x05
+#define TMR_TAG_PROTOCOL_ISO180006B_UCODE 0x06
+#define TMR_TAG_PROTOCOL_IPX64            0x07
+#define TMR_TAG_PROTOCOL_IPX256           0x08
+#define TMR_TAG_PROTOCOL_ATA              0x1D
+
+// Module families, the first byte of the hardware version
+#define TMR_SR_MODEL_M6E       0x18
+#define TMR_SR_MODEL_M6E_I     0x19
+#define TMR_SR_MODEL_M6E_MICRO 0x20
+#define TMR_SR_MODEL_M6E_NANO  0x30
+
+// Tag read metadata (TMR_TRD_METADATA_FLAG_*)
+#define M6E_NANO_METADATA_READ_COUNT  (1U << 0)
+#define M6E_NANO_METADATA_RSSI        (1U << 1)
+#define M6E_NANO_METADATA_ANTENNA     (1U << 2)
+#define M6E_NANO_METADATA_FREQUENCY   (1U << 3)
+#define M6E_NANO_METADATA_TIMESTAMP   (1U << 4)
+#define M6E_NANO_METADATA_PHASE       (1U << 5)
+#define M6E_NANO_METADATA_PROTOCOL    (1U << 6)
+#define M6E_NANO_METADATA_DATA        (1U << 7)
+#define M6E_NANO_METADATA_GPIO        (1U << 8)
+#define M6E_NANO_METADATA_GEN2_Q      (1U << 9)
+#define M6E_NANO_METADATA_GEN2_LF     (1U << 10)
+#define M6E_NANO_METADATA_GEN2_TARGET (1U << 11)
+
+// Tags a single read selects, Gen2 singulation options
+#define M6E_NANO_SELECT_EPC      0x01 // Mask compared with the EPC from its first bit
+#define M6E_NANO_SELECT_TID      0x02 // Mask compared with the TID bank at bit_pointer
+#define M6E_NANO_SELECT_USER     0x03 // Mask compared with the user bank at bit_pointer
+#define M6E_NANO_SELECT_EPC_BANK 0x04 // Mask compared with the EPC bank at bit_pointer
+
+// Received frame overhead: header, length, opcode, status and CRC
+#define M6E_NANO_FRAME_OVERHEAD 7
+
+// Longest frame received from the module
+#define M6E_NANO_FRAME_MAX (255 + M6E_NANO_FRAME_OVERHEAD)
+
+// Command frame overhead: header, length, opcode and CRC
+#define M6E_NANO_COMMAND_OVERHEAD 5
+
+// Status of the frames of a continuous read that carry no tag
+#define M6E_NANO_STATUS_KEEPALIVE    0x0400
+#define M6E_NANO_STATUS_TEMPTHROTTLE 0x0504
+
+// Data of a continuous search started by m6e_nano_encode_start_search()
+#define M6E_NANO_START_SEARCH_LEN 16
+
+// Status of a single read that found no tag
+#define M6E_NANO_STATUS_NO_TAG 0x0400
+
+// Firmware image: a header of magic and image length, then the application image
+#define M6E_NANO_FW_HEADER_LEN 16
+
+// Image bytes per TMR_SR_OPCODE_WRITE_FLASH_SECTOR: what a 255-byte command frame carries after
+// the password, address and sector, down to a multiple of the 16-byte flash line
+#define M6E_NANO_FW_CHUNK_LEN 240
+
+// Data of TMR_SR_OPCODE_WRITE_FLASH_SECTOR before the image bytes
+#define M6E_NANO_FW_WRITE_PREFIX_LEN 9
+
+// Command data of a chunk, the write prefix then the image bytes
+#define M6E_NANO_FW_WRITE_LEN (M6E_NANO_FW_WRITE_PREFIX_LEN + M6E_NANO_FW_CHUNK_LEN)
+
+// Data of TMR_SR_OPCODE_ERASE_FLASH
+#define M6E_NANO_FW_ERASE_LEN 5
+
+// Erasing the application flash takes seconds
+#define M6E_NANO_FW_ERASE_TIMEOUT_MS 10000
+
+// Time for the bootloader or the application to start
+#define M6E_NANO_FW_BOOT_TIMEOUT_MS 2000
+
+// Baud rate the bootloader starts at, whatever the application ran at
+#define M6E_NANO_FW_BOOT_BAUD 9600
+
+// Longest wait for the response to an update command other than the erase
+#define M6E_NANO_FW_COMMAND_TIMEOUT_MS 1000
+
+// Wait for a version response while probing for the bootloader
+#define M6E_NANO_FW_PROBE_TIMEOUT_MS 100
+
+// Outcome of a firmware update
+struct m6e_nano_fw_stats {
+	uint32_t bytes;       // Image bytes written
+	uint32_t chunks;      // TMR_SR_OPCODE_WRITE_FLASH_SECTOR commands
+	uint32_t baud;        // Baud rate of the transfer
+	uint32_t crc;         // CRC-32 of the image, as the bootloader verified it
+	uint32_t erase_ms;    // Time to erase the application flash
+	uint32_t write_ms;    // Time from the first chunk sent to the last one written
+	uint32_t bytes_per_s; // Transfer throughput
+};
+
+// Select of a single tag read
+struct m6e_nano_select {
+	uint8_t target;       // One of M6E_NANO_SELECT_*
+	bool invert;          // Select the tags that do not match instead
+	uint32_t bit_pointer; // First bit compared, unused for M6E_NANO_SELECT_EPC
+	uint8_t bit_len;      // Number of bits of mask compared
+	const uint8_t *mask;
+};
+
+struct m6e_nano_tag {
+	int8_t rssi;        // dBm
+	uint8_t antenna;    // 4 MSB TX port, 4 LSB RX port
+	uint32_t freq;      // kHz
+	uint32_t timestamp; // ms since the last keep-alive
+	uint16_t phase;     // Degrees, 0 to 180
+	uint8_t protocol;   // One of TMR_TAG_PROTOCOL_*
+	uint8_t epc_len;
+	uint8_t epc[M6E_NANO_EPC_MAX_LEN];
+};
+
+struct m6e_nano_version {
+	uint32_t bootloader;
+	uint32_t hardware;   // Model in the top byte, one of TMR_SR_MODEL_*
+	uint32_t fw_date;    // BCD, 0xYYYYMMDD
+	uint32_t fw_version; // BCD, 0xMMmmPPBB
+	uint32_t protocols;  // Bit n - 1 set when protocol n (TMR_TAG_PROTOCOL_*) is supported
+};
+
+// Incremental receiver of frames from a byte stream
+struct m6e_nano_rx {
+	uint8_t frame[M6E_NANO_FRAME_MAX];
+	uint16_t len;
+	uint32_t skipped;    // Bytes dropped while looking for a header
+	uint32_t crc_errors; // Frames dropped for a bad CRC
+};
+
+// Frame counter of a byte stream in either direction, for traffic that is passed on untouched
+struct m6e_nano_tap {
+	uint8_t frame[M6E_NANO_FRAME_MAX];
+	uint16_t len;
+	uint8_t overhead;    // M6E_NANO_COMMAND_OVERHEAD or M6E_NANO_FRAME_OVERHEAD
+	uint32_t bytes;
+	uint32_t frames;     // CRC-valid frames
+	uint32_t crc_errors; // Frames with a bad CRC
+	uint32_t skipped;    // Bytes outside frames
+};
+
+/**
+ * @brief Byte stream to and from the module.
+ */
+struct m6e_nano_transport {
+	/**
+	 * @brief Write bytes to the module.
+	 *
+	 * @return int 0 once every byte is written, negative errno otherwise.
+	 */
+	int (*write)(void *ctx, const uint8_t *buf, size_t len);
+
+	/**
+	 * @brief Read the bytes available, waiting up to timeout_ms for the first one.
+	 *
+	 * @return int Number of bytes read, 0 on timeout, negative errno otherwise.
+	 */
+	int (*read)(void *ctx, uint8_t *buf, size_t len, int32_t timeout_ms);
+
+	/**
+	 * @brief Monotonic time in ms.
+	 */
+	uint32_t (*now_ms)(void *ctx);
+
+	void *ctx;
+};
+
+/**
+ * @brief Callback for each frame that does not answer the command being run: tag reads,
+ * keep-alives and startup messages.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @param user_data Pointer passed to m6e_nano_link_init().
+ */
+typedef void (*m6e_nano_frame_cb_t)(const uint8_t *frame, void *user_data);
+
+/**
+ * @brief Commands, image and clock of a firmware update, so the driver and the host tools run
+ * the same sequence with m6e_nano_fw_flash().
+ */
+struct m6e_nano_fw_ops {
+	/**
+	 * @brief Send a command without waiting for its response.
+	 *
+	 * @return int 0 on success, negative errno otherwise.
+	 */
+	int (*send)(void *ctx, uint8_t opcode, const uint8_t *data, uint8_t len);
+
+	/**
+	 * @brief Wait for the response to the command sent.
+	 *
+	 * @return int 0 with the response in *frame, -EIO if the module reported an error,
+	 * -ETIMEDOUT without a response, negative errno otherwise.
+	 */
+	int (*wait)(void *ctx, uint8_t opcode, int32_t timeout_ms, const uint8_t **frame);
+
+	/**
+	 * @brief Switch the module, then the transport, to a baud rate.
+	 *
+	 * @return int 0 on success, negative errno otherwise.
+	 */
+	int (*set_baud)(void *ctx, uint32_t baud);
+
+	/**
+	 * @brief Read bytes of the image, at an offset from the start of its header.
+	 *
+	 * @return int 0 on success, negative errno otherwise.
+	 */
+	int (*read)(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
+
+	/**
+	 * @brief Monotonic time in ms.
+	 */
+	uint32_t (*now_ms)(void *ctx);
+
+	void *ctx;
+};
+
+// Command engine over a transport
+struct m6e_nano_link {
+	const struct m6e_nano_transport *transport;
+	struct m6e_nano_rx rx;
+	uint8_t in[256]; // Bytes read but not yet fed to the receiver
+	uint16_t in_len;
+	uint16_t in_pos;
+	uint8_t tx[M6E_NANO_FRAME_MAX];
+	m6e_nano_frame_cb_t on_frame;
+	void *user_data;
+};
+
+/**
+ * @brief Calculate the CRC of a frame.
+ *
+ * @param buf Frame from its length byte, without the header.
+ * @param len Number of bytes.
+ * @return uint16_t CRC, sent big-endian after the data.
+ */
+uint16_t m6e_nano_crc(const uint8_t *buf, size_t len);
+
+/**
+ * @brief Encode a command frame.
+ *
+ * @param frame Destination, len + 5 bytes.
+ * @param size Size of the destination.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param len Length of the command data.
+ * @return int Length of the frame, -ENOMEM if it does not fit.
+ */
+int m6e_nano_frame_encode(uint8_t *frame, size_t size, uint8_t opcode, const uint8_t *data,
+			  uint8_t len);
+
+/**
+ * @brief Check the CRC of a complete frame received from the module.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @return true if the CRC matches.
+ */
+bool m6e_nano_frame_crc_ok(const uint8_t *frame);
+
+/**
+ * @brief Get the status of a frame received from the module.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @return uint16_t Status, 0 on success.
+ */
+uint16_t m6e_nano_frame_status(const uint8_t *frame);
+
+/**
+ * @brief Whether a frame is a tag read of a continuous search, not a keep-alive, temperature or
+ * command response.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @return true for a tag read.
+ */
+bool m6e_nano_frame_is_tag(const uint8_t *frame);
+
+/**
+ * @brief Decode a tag read frame received from the module.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @param tag Decoded tag read.
+ * @return int 0 on success, -EBADMSG if the EPC runs past the frame.
+ */
+int m6e_nano_decode_tag(const uint8_t *frame, struct m6e_nano_tag *tag);
+
+/**
+ * @brief Decode the response to TMR_SR_OPCODE_VERSION.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @param version Decoded version.
+ * @return int 0 on success, -EBADMSG if the frame is too short.
+ */
+int m6e_nano_decode_version(const uint8_t *frame, struct m6e_nano_version *version);
+
+/**
+ * @brief Encode the data of a TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP command starting a
+ * continuous Gen2 search.
+ *
+ * @param data Destination, M6E_NANO_START_SEARCH_LEN bytes.
+ * @param tm_option TM option byte, a combination of TMR_SR_TM_OPTION_*.
+ * @return uint8_t Length of the data.
+ */
+uint8_t m6e_nano_encode_start_search(uint8_t *data, uint8_t tm_option);
+
+/**
+ * @brief Encode the data of a TMR_SR_OPCODE_READ_TAG_ID_SINGLE command.
+ *
+ * @param data Destination.
+ * @param size Size of the destination.
+ * @param timeout_ms Time the module searches for a tag.
+ * @param metadata Tag read metadata to return, bitmask of M6E_NANO_METADATA_*.
+ * @param select Tags to read, NULL for any tag.
+ * @return int Length of the data, -EINVAL for an invalid select, -ENOMEM if it does not fit.
+ */
+int m6e_nano_encode_read_single(uint8_t *data, size_t size, uint16_t timeout_ms,
+				uint16_t metadata, const struct m6e_nano_select *select);
+
+/**
+ * @brief Decode the response to TMR_SR_OPCODE_READ_TAG_ID_SINGLE. Fields missing from the
+ * metadata of the response are set to 0.
+ *
+ * @param frame Frame with a success status, from the header to the CRC.
+ * @param tag Decoded tag read.
+ * @return int 0 on success, -EBADMSG if the metadata or EPC run past the frame.
+ */
+int m6e_nano_decode_single(const uint8_t *frame, struct m6e_nano_tag *tag);
+
+/**
+ * @brief Update a CRC-32 (IEEE 802.3) with more bytes.
+ *
+ * @param crc CRC of the bytes so far, 0 to start.
+ * @param buf Bytes.
+ * @param len Number of bytes.
+ * @return uint32_t CRC including the bytes.
+ */
+uint32_t m6e_nano_crc32(uint32_t crc, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Check the header of a firmware image.
+ *
+ * @param header First M6E_NANO_FW_HEADER_LEN bytes of the image.
+ * @param len Length of the application image that follows the header.
+ * @return int 0 on success, -EBADMSG if the header is not of an M6E firmware image.
+ */
+int m6e_nano_fw_header(const uint8_t *header, uint32_t *len);
+
+/**
+ * @brief Encode the data of a TMR_SR_OPCODE_ERASE_FLASH command erasing the application.
+ *
+ * @param data Destination, M6E_NANO_FW_ERASE_LEN bytes.
+ * @return uint8_t Length of the data.
+ */
+uint8_t m6e_nano_encode_erase_flash(uint8_t *data);
+
+/**
+ * @brief Encode the data of a TMR_SR_OPCODE_WRITE_FLASH_SECTOR command up to the image bytes,
+ * which go at data + M6E_NANO_FW_WRITE_PREFIX_LEN so they can be read in place.
+ *
+ * @param data Destination, M6E_NANO_FW_WRITE_PREFIX_LEN bytes.
+ * @param address Offset of the image bytes in the application image.
+ * @return uint8_t Length of the data before the image bytes.
+ */
+uint8_t m6e_nano_encode_write_flash(uint8_t *data, uint32_t address);
+
+/**
+ * @brief Decode the response to TMR_SR_OPCODE_VERIFY_IMAGE_CRC.
+ *
+ * @param frame Frame with a success status, from the header to the CRC.
+ * @param crc CRC-32 of the application image in flash.
+ * @return int 0 on success, -EBADMSG if the frame is too short.
+ */
+int m6e_nano_decode_image_crc(const uint8_t *frame, uint32_t *crc);
+
+/**
+ * @brief Reset a frame receiver.
+ *
+ * @param rx Receiver state.
+ */
+void m6e_nano_rx_reset(struct m6e_nano_rx *rx);
+
+/**
+ * @brief Feed bytes to a frame receiver. Stops after the first complete CRC-valid frame, which
+ * stays in rx->frame until the next call.
+ *
+ * @param rx Receiver state.
+ * @param buf Bytes received.
+ * @param len Number of bytes.
+ * @param complete Set to whether a frame was completed.
+ * @return size_t Number of bytes consumed.
+ */
+size_t m6e_nano_rx_feed(struct m6e_nano_rx *rx, const uint8_t *buf, size_t len, bool *complete);
+
+/**
+ * @brief Reset a frame tap and its counters.
+ *
+ * @param tap Tap state.
+ * @param overhead M6E_NANO_COMMAND_OVERHEAD for commands, M6E_NANO_FRAME_OVERHEAD for frames
+ * from the module.
+ */
+void m6e_nano_tap_init(struct m6e_nano_tap *tap, uint8_t overhead);
+
+/**
+ * @brief Count the frames of a byte stream. Stops after the first complete CRC-valid frame,
+ * which stays in tap->frame until the next call.
+ *
+ * @param tap Tap state.
+ * @param buf Bytes of the stream.
+ * @param len Number of bytes.
+ * @param complete Set when a frame was completed.
+ * @return size_t Number of bytes used, call again with the rest.
+ */
+size_t m6e_nano_tap_feed(struct m6e_nano_tap *tap, const uint8_t *buf, size_t len,
+			 bool *complete);
+
+/**
+ * @brief Initialize a command engine.
+ *
+ * @param link Engine state.
+ * @param transport Byte stream to the module.
+ * @param on_frame Callback for frames that do not answer a command, may be NULL.
+ * @param user_data Pointer passed to the callback.
+ */
+void m6e_nano_link_init(struct m6e_nano_link *link, const struct m6e_nano_transport *transport,
+			m6e_nano_frame_cb_t on_frame, void *user_data);
+
+/**
+ * @brief Send a command without waiting for its response.
+ *
+ * @param link Engine state.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param len Length of the command data.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_link_send(struct m6e_nano_link *link, uint8_t opcode, const uint8_t *data,
+		       uint8_t len);
+
+/**
+ * @brief Wait for the response to a command sent with m6e_nano_link_send(), which is left in
+ * link->rx.frame. Other frames received meanwhile go to the frame callback.
+ *
+ * @param link Engine state.
+ * @param opcode Opcode of the command.
+ * @param timeout_ms Longest wait for the response.
+ * @return int 0 on success, -EIO if the module reported an error, -ETIMEDOUT without a
+ * response, negative errno otherwise.
+ */
+int m6e_nano_link_wait(struct m6e_nano_link *link, uint8_t opcode, int32_t timeout_ms);
+
+/**
+ * @brief Send a command and wait for its response, which is left in link->rx.frame. Other
+ * frames received meanwhile go to the frame callback.
+ *
+ * @param link Engine state.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param len Length of the command data.
+ * @param timeout_ms Longest wait for the response.
+ * @return int 0 on success, -EIO if the module reported an error, -ETIMEDOUT without a
+ * response, negative errno otherwise.
+ */
+int m6e_nano_link_command(struct m6e_nano_link *link, uint8_t opcode, const uint8_t *data,
+			  uint8_t len, int32_t timeout_ms);
+
+/**
+ * @brief Pass the frames received within a time to the frame callback.
+ *
+ * @param link Engine state.
+ * @param timeout_ms Time to receive for.
+ * @return int Number of frames received, negative errno otherwise.
+ */
+int m6e_nano_link_poll(struct m6e_nano_link *link, int32_t timeout_ms);
+
+/**
+ * @brief Write an application image to a module: start the bootloader unless it is running,
+ * switch to the transfer baud rate, erase the application flash, write the image in
+ * M6E_NANO_FW_CHUNK_LEN chunks, reading each chunk while the module writes the one before, and
+ * have the bootloader verify its CRC-32. Booting the new application is left to the caller,
+ * which knows how it sees the startup message.
+ *
+ * @param ops Commands, image and clock of the update.
+ * @param len Length of the application image that follows the header, see
+ * m6e_nano_fw_header().
+ * @param baud Baud rate of the transfer.
+ * @param buf Command data of the chunks, M6E_NANO_FW_WRITE_LEN bytes.
+ * @param stats Outcome of the update, zeroed by the caller.
+ * @return int 0 on success, -EIO if the module reported an error or the image in its flash does
+ * not match, -ETIMEDOUT if it stopped answering, negative errno otherwise.
+ */
+int m6e_nano_fw_flash(const struct m6e_nano_fw_ops *ops, uint32_t len, uint32_t baud,
+		      uint8_t *buf, struct m6e_nano_fw_stats *stats);
+
+#endif // M6E_NANO_PROTO_H
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_internal.h"
+
+LOG_MODULE_DECLARE(M6E_NANO, CONFIG_M6E_NANO_LOG_LEVEL);
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_M6E_NANO_ROUND_BLOOM_BITS),
+	     "CONFIG_M6E_NANO_ROUND_BLOOM_BITS must be a power of two");
+
+// Bits set per EPC in the bloom filter
+#define ROUND_BLOOM_HASHES 3
+
+/**
+ * @brief 32-bit FNV-1a hash of an EPC.
+ *
+ * @param epc EPC bytes.
+ * @param len Length of the EPC.
+ * @return uint32_t Hash.
+ */
+static uint32_t _tag_set_hash(const uint8_t *epc, uint8_t len)
+{
+	uint32_t hash = 2166136261U;
+
+	for (uint8_t i = 0; i < len; i++) {
+		hash = (hash ^ epc[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Bloom filter bit of an EPC hash, using double hashing.
+ *
+ * @param hash Hash of the EPC.
+ * @param i Index of the derived hash, below ROUND_BLOOM_HASHES.
+ * @return uint32_t Bit index.
+ */
+static uint32_t _tag_set_bit(uint32_t hash, uint8_t i)
+{
+	uint32_t step = (hash >> 16) | (hash << 16) | 1;
+
+	return (hash + i * step) & (CONFIG_M6E_NANO_ROUND_BLOOM_BITS - 1);
+}
+
+/**
+ * @brief Empty a tag set.
+ *
+ * @param set Tag set.
+ */
+void m6e_nano_tag_set_clear(struct m6e_nano_tag_set *set)
+{
+	set->count = 0;
+	set->stored = 0;
+	memset(set->bloom, 0, sizeof(set->bloom));
+}
+
+/**
+ * @brief Add an EPC to a tag set. A bloom filter skips the search for EPCs not seen before.
+ *
+ * @param set Tag set.
+ * @param epc EPC bytes.
+ * @param len Length of the EPC.
+ * @return true if the EPC was not in the set.
+ */
+bool m6e_nano_tag_set_add(struct m6e_nano_tag_set *set, const uint8_t *epc, uint8_t len)
+{
+	uint32_t hash = _tag_set_hash(epc, len);
+	uint8_t kept = MIN(len, CONFIG_M6E_NANO_ROUND_EPC_LEN);
+	const uint8_t *tail = &epc[len - kept];
+	bool maybe = true;
+
+	for (uint8_t i = 0; i < ROUND_BLOOM_HASHES; i++) {
+		uint32_t bit = _tag_set_bit(hash, i);
+
+		if ((set->bloom[bit / 32] & BIT(bit % 32)) == 0) {
+			maybe = false;
+			break;
+		}
+	}
+
+	if (maybe) {
+		for (uint16_t i = 0; i < set->stored; i++) {
+			if (set->hash[i] == hash && set->epc_len[i] == len &&
+			    memcmp(set->epc[i], tail, kept) == 0) {
+				return false;
+			}
+		}
+		// Once full, a bloom filter hit may be an EPC that was not stored
+		if (set->stored == CONFIG_M6E_NANO_ROUND_MAX_TAGS) {
+			return false;
+		}
+	}
+
+	for (uint8_t i = 0; i < ROUND_BLOOM_HASHES; i++) {
+		uint32_t bit = _tag_set_bit(hash, i);
+
+		set->bloom[bit / 32] |= BIT(bit % 32);
+	}
+
+	if (set->stored < CONFIG_M6E_NANO_ROUND_MAX_TAGS) {
+		set->hash[set->stored] = hash;
+		set->epc_len[set->stored] = len;
+		memcpy(set->epc[set->stored], tail, kept);
+		set->stored++;
+	}
+	set->count++;
+
+	return true;
+}
+
+/**
+ * @brief Close the current round, queue its summary and start the next one. Safe to call from
+ * the UART ISR.
+ *
+ * @param dev UART peripheral device.
+ * @param reason One of M6E_NANO_ROUND_END_*.
+ */
+static void _round_close(const struct device *dev, uint8_t reason)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_round *round = &data->round;
+	struct m6e_nano_round_summary summary;
+	uint32_t now = k_uptime_get_32();
+	k_spinlock_key_t key = k_spin_lock(&round->lock);
+
+	summary.round = round->seq++;
+	summary.start_ms = round->start_ms;
+	summary.duration_ms = now - round->start_ms;
+	summary.unique = round->set.count;
+	summary.reads = round->reads;
+	summary.untracked = round->set.count - round->set.stored;
+	summary.reason = reason;
+
+	m6e_nano_tag_set_clear(&round->set);
+	round->start_ms = now;
+	round->reads = 0;
+
+	k_spin_unlock(&round->lock, key);
+
+	if (k_msgq_put(&round->msgq, &summary, K_NO_WAIT) < 0) {
+		round->dropped++;
+	}
+#ifdef CONFIG_M6E_NANO_ZBUS
+	m6e_nano_zbus_round(dev, &summary);
+#endif
+	if (round->callback != NULL) {
+		k_work_submit_to_queue(&m6e_nano_workq, &round->deliver_work);
+	}
+	if (round->running && round->config.duration_ms > 0) {
+		k_work_reschedule_for_queue(&m6e_nano_workq, &round->timer_work,
+					    K_MSEC(round->config.duration_ms));
+	}
+}
+
+/**
+ * @brief Round duration elapsed.
+ *
+ * @param work Timer work item of the driver instance.
+ */
+static void m6e_nano_round_timer_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct m6e_nano_round *round = CONTAINER_OF(dwork, struct m6e_nano_round, timer_work);
+	struct m6e_nano_data *data = CONTAINER_OF(round, struct m6e_nano_data, round);
+
+	if (round->running) {
+		_round_close(data->dev, M6E_NANO_ROUND_END_TIME);
+	}
+}
+
+/**
+ * @brief Hand queued summaries to the round callback.
+ *
+ * @param work Deliver work item of the driver instance.
+ */
+static void m6e_nano_round_deliver_work_handler(struct k_work *work)
+{
+	struct m6e_nano_round *round = CONTAINER_OF(work, struct m6e_nano_round, deliver_work);
+	struct m6e_nano_data *data = CONTAINER_OF(round, struct m6e_nano_data, round);
+	struct m6e_nano_round_summary summary;
+	m6e_nano_round_callback_t callback = round->callback;
+
+	while (callback != NULL && k_msgq_get(&round->msgq, &summary, K_NO_WAIT) == 0) {
+		callback(data->dev, &summary, round->user_data);
+	}
+}
+
+/**
+ * @brief Count a tag read in the current round.
+ *
+ * @param dev UART peripheral device.
+ * @param epc EPC bytes.
+ * @param len Length of the EPC.
+ */
+void m6e_nano_round_tag(const struct device *dev, const uint8_t *epc, uint8_t len)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_round *round = &data->round;
+	k_spinlock_key_t key;
+
+	if (!round->running) {
+		round->last_new = false;
+		return;
+	}
+
+	key = k_spin_lock(&round->lock);
+	round->reads++;
+	round->last_new = m6e_nano_tag_set_add(&round->set, epc, len);
+	k_spin_unlock(&round->lock, key);
+}
+
+/**
+ * @brief End the current round if rounds end on keep-alives.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_round_keepalive(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	if (data->round.running && data->round.config.keepalive) {
+		_round_close(dev, M6E_NANO_ROUND_END_KEEPALIVE);
+	}
+}
+
+/**
+ * @brief Start inventory rounds.
+ *
+ * @param dev UART peripheral device.
+ * @param config How rounds are delimited.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_round_start(const struct device *dev, const struct m6e_nano_round_config *config)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_round *round = &data->round;
+	k_spinlock_key_t key;
+
+	if (round->running) {
+		m6e_nano_round_stop(dev);
+	}
+
+	key = k_spin_lock(&round->lock);
+	round->config = *config;
+	m6e_nano_tag_set_clear(&round->set);
+	round->start_ms = k_uptime_get_32();
+	round->reads = 0;
+	round->running = true;
+	k_spin_unlock(&round->lock, key);
+
+	if (config->duration_ms > 0) {
+		k_work_reschedule_for_queue(&m6e_nano_workq, &round->timer_work,
+					    K_MSEC(config->duration_ms));
+	}
+
+	return 0;
+}
+
+/**
+ * @brief End the current round and start the next one.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, -EINVAL if rounds are not running.
+ */
+int m6e_nano_round_end(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	if (!data->round.running) {
+		return -EINVAL;
+	}
+
+	_round_close(dev, M6E_NANO_ROUND_END_EXPLICIT);
+
+	return 0;
+}
+
+/**
+ * @brief End the current round and stop counting.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, -EINVAL if rounds are not running.
+ */
+int m6e_nano_round_stop(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_round *round = &data->round;
+	struct k_work_sync sync;
+
+	if (!round->running) {
+		return -EINVAL;
+	}
+
+	round->running = false;
+	k_work_cancel_delayable_sync(&round->timer_work, &sync);
+	_round_close(dev, M6E_NANO_ROUND_END_EXPLICIT);
+
+	return 0;
+}
+
+/**
+ * @brief Deliver round summaries to a callback instead of queueing them.
+ *
+ * @param dev UART peripheral device.
+ * @param callback Callback function pointer, NULL to queue summaries.
+ * @param user_data Pointer to data accessible from the callback function.
+ */
+void m6e_nano_round_set_callback(const struct device *dev, m6e_nano_round_callback_t callback,
+				 void *user_data)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	data->round.user_data = user_data;
+	data->round.callback = callback;
+
+	if (callback != NULL) {
+		k_work_submit_to_queue(&m6e_nano_workq, &data->round.deliver_work);
+	}
+}
+
+/**
+ * @brief Get the oldest queued round summary.
+ *
+ * @param dev UART peripheral device.
+ * @param summary Destination for the summary.
+ * @param timeout Time to wait for a round to end.
+ * @return int 0 on success, -EAGAIN on timeout, -ENOMSG if none is queued.
+ */
+int m6e_nano_round_get(const struct device *dev, struct m6e_nano_round_summary *summary,
+		       k_timeout_t timeout)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	return k_msgq_get(&data->round.msgq, summary, timeout);
+}
+
+/**
+ * @brief Whether the tag last parsed was seen for the first time in the current round.
+ *
+ * @param dev UART peripheral device.
+ * @return true if the tag is new.
+ */
+bool m6e_nano_round_tag_is_new(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	return data->round.last_new;
+}
+
+/**
+ * @brief Initialize inventory rounds of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_round_init(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_round *round = &data->round;
+
+	k_msgq_init(&round->msgq, round->msgq_buf, sizeof(struct m6e_nano_round_summary),
+		    CONFIG_M6E_NANO_ROUND_QUEUE_LEN);
+	k_work_init_delayable(&round->timer_work, m6e_nano_round_timer_work_handler);
+	k_work_init(&round->deliver_work, m6e_nano_round_deliver_work_handler);
+}
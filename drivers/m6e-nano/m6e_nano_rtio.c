@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/rtio/rtio.h>
+#include <zephyr/logging/log.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_internal.h"
+
+LOG_MODULE_DECLARE(M6E_NANO, CONFIG_M6E_NANO_LOG_LEVEL);
+
+/**
+ * @brief Complete the oldest waiting RTIO read with a frame. Called from the UART ISR for every
+ * complete CRC-valid frame.
+ *
+ * @param dev UART peripheral device.
+ * @param frame Frame, from the header to the CRC.
+ */
+void m6e_nano_rtio_frame(const struct device *dev, const uint8_t *frame)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_rtio *rtio = &data->rtio;
+	struct rtio_mpsc_node *node;
+	struct rtio_iodev_sqe *iodev_sqe;
+	uint32_t len = frame[1] + 7;
+	uint32_t buf_len;
+	uint8_t *buf;
+	int ret;
+
+	if (!m6e_nano_frame_is_tag(frame)) {
+		return;
+	}
+
+	node = rtio_mpsc_pop(&rtio->rx_q);
+	if (node == NULL) {
+		rtio->overruns++;
+		return;
+	}
+	iodev_sqe = CONTAINER_OF(node, struct rtio_iodev_sqe, q);
+
+	ret = rtio_sqe_rx_buf(iodev_sqe, len, len, &buf, &buf_len);
+	if (ret < 0) {
+		rtio_iodev_sqe_err(iodev_sqe, ret);
+		return;
+	}
+	if (buf_len < len) {
+		rtio_iodev_sqe_err(iodev_sqe, -ENOMEM);
+		return;
+	}
+
+	memcpy(buf, frame, len);
+	rtio_iodev_sqe_ok(iodev_sqe, len);
+}
+
+/**
+ * @brief Send the command of a submission and complete it.
+ *
+ * @param dev UART peripheral device.
+ * @param iodev_sqe Submission, one of RTIO_OP_TX, RTIO_OP_TINY_TX or RTIO_OP_TXRX.
+ */
+static void _rtio_command(const struct device *dev, struct rtio_iodev_sqe *iodev_sqe)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	const struct rtio_sqe *sqe = &iodev_sqe->sqe;
+	const uint8_t *cmd;
+	uint32_t cmd_len;
+	uint32_t len;
+	int ret;
+
+	switch (sqe->op) {
+	case RTIO_OP_TX:
+		cmd = sqe->buf;
+		cmd_len = sqe->buf_len;
+		break;
+	case RTIO_OP_TINY_TX:
+		cmd = sqe->tiny_buf;
+		cmd_len = sqe->tiny_buf_len;
+		break;
+	default:
+		cmd = sqe->tx_buf;
+		cmd_len = sqe->txrx_buf_len;
+		break;
+	}
+
+	// Length and opcode, then the data. TXRX buffers may be longer than the command
+	if (cmd_len < 2 || cmd[0] + 2 > cmd_len ||
+	    (sqe->op != RTIO_OP_TXRX && cmd[0] + 2 != cmd_len)) {
+		rtio_iodev_sqe_err(iodev_sqe, -EINVAL);
+		return;
+	}
+
+	ret = _m6e_nano_command(dev, cmd[1], &cmd[2], cmd[0]);
+	if (ret < 0) {
+		rtio_iodev_sqe_err(iodev_sqe, ret);
+		return;
+	}
+
+	len = data->response.data[1] + 7;
+	if (sqe->op == RTIO_OP_TXRX) {
+		if (sqe->txrx_buf_len < len) {
+			rtio_iodev_sqe_err(iodev_sqe, -ENOMEM);
+			return;
+		}
+		memcpy(sqe->rx_buf, data->response.data, len);
+	}
+
+	rtio_iodev_sqe_ok(iodev_sqe, len);
+}
+
+/**
+ * @brief Send queued commands.
+ *
+ * @param work Command work item of the driver instance.
+ */
+static void m6e_nano_rtio_cmd_work_handler(struct k_work *work)
+{
+	struct m6e_nano_rtio *rtio = CONTAINER_OF(work, struct m6e_nano_rtio, cmd_work);
+	struct m6e_nano_data *data = CONTAINER_OF(rtio, struct m6e_nano_data, rtio);
+	struct rtio_mpsc_node *node;
+
+	while ((node = rtio_mpsc_pop(&rtio->cmd_q)) != NULL) {
+		_rtio_command(data->dev, CONTAINER_OF(node, struct rtio_iodev_sqe, q));
+	}
+}
+
+/**
+ * @brief Accept a submission. Reads wait for the UART ISR, commands for the work queue, as
+ * submissions may come from any context.
+ *
+ * @param iodev_sqe Submission.
+ */
+static void m6e_nano_rtio_submit(struct rtio_iodev_sqe *iodev_sqe)
+{
+	const struct device *dev = iodev_sqe->sqe.iodev->data;
+	struct m6e_nano_rtio *rtio = &((struct m6e_nano_data *)dev->data)->rtio;
+
+	switch (iodev_sqe->sqe.op) {
+	case RTIO_OP_RX:
+		rtio_mpsc_push(&rtio->rx_q, &iodev_sqe->q);
+		break;
+	case RTIO_OP_TX:
+	case RTIO_OP_TINY_TX:
+	case RTIO_OP_TXRX:
+		rtio_mpsc_push(&rtio->cmd_q, &iodev_sqe->q);
+		k_work_submit_to_queue(&m6e_nano_workq, &rtio->cmd_work);
+		break;
+	default:
+		rtio_iodev_sqe_err(iodev_sqe, -ENOTSUP);
+		break;
+	}
+}
+
+static const struct rtio_iodev_api m6e_nano_rtio_api = {
+	.submit = m6e_nano_rtio_submit,
+};
+
+/**
+ * @brief Get the RTIO I/O device of the reader.
+ *
+ * @param dev UART peripheral device.
+ * @return struct rtio_iodev* I/O device.
+ */
+struct rtio_iodev *m6e_nano_rtio_iodev(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	return &data->rtio.iodev;
+}
+
+/**
+ * @brief Initialize the RTIO I/O device of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_rtio_init(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_rtio *rtio = &data->rtio;
+
+	rtio->iodev.api = &m6e_nano_rtio_api;
+	rtio->iodev.data = (void *)dev;
+	rtio_mpsc_init(&rtio->iodev.iodev_sq);
+	rtio_mpsc_init(&rtio->rx_q);
+	rtio_mpsc_init(&rtio->cmd_q);
+	k_work_init(&rtio->cmd_work, m6e_nano_rtio_cmd_work_handler);
+}
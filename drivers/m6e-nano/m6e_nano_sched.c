@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/pm/device_runtime.h>
+#include <zephyr/logging/log.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_internal.h"
+
+LOG_MODULE_DECLARE(M6E_NANO, CONFIG_M6E_NANO_LOG_LEVEL);
+
+/**
+ * @brief Check whether a GPIO was provided in the devicetree.
+ *
+ * @param dev UART peripheral device.
+ * @param trigger Check trigger-gpios instead of enable-gpios.
+ * @return true if the GPIO exists.
+ */
+static bool _sched_has_gpio(const struct device *dev, bool trigger)
+{
+#ifdef CONFIG_GPIO
+	const struct m6e_nano_config *cfg = dev->config;
+
+	return (trigger ? cfg->trigger_gpio.port : cfg->enable_gpio.port) != NULL;
+#else
+	ARG_UNUSED(dev);
+	ARG_UNUSED(trigger);
+
+	return false;
+#endif
+}
+
+/**
+ * @brief Take the scheduler's reference on the device, unless it holds it already.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _sched_get(const struct device *dev)
+{
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+	struct m6e_nano_sched *sched = &((struct m6e_nano_data *)dev->data)->sched;
+	int ret;
+
+	if (sched->holds_ref) {
+		return 0;
+	}
+	ret = pm_device_runtime_get(dev);
+	if (ret < 0) {
+		return ret;
+	}
+	sched->holds_ref = true;
+#else
+	ARG_UNUSED(dev);
+#endif
+
+	return 0;
+}
+
+/**
+ * @brief Drop the scheduler's reference on the device, if it holds it, which lets PM device
+ * runtime suspend it and release the UART.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _sched_put(const struct device *dev)
+{
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+	struct m6e_nano_sched *sched = &((struct m6e_nano_data *)dev->data)->sched;
+
+	if (sched->holds_ref) {
+		sched->holds_ref = false;
+		pm_device_runtime_put(dev);
+	}
+#else
+	ARG_UNUSED(dev);
+#endif
+}
+
+/**
+ * @brief Put the module to sleep and drop the scheduler's reference on the device.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _sched_sleep(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	if (_m6e_nano_sleep(dev, data->sched.schedule.sleep) < 0) {
+		LOG_WRN("Failed to put module to sleep.");
+	}
+
+	_sched_put(dev);
+}
+
+/**
+ * @brief Take a reference on the device and bring the module back to its configured state.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _sched_wake(const struct device *dev)
+{
+	int ret = _sched_get(dev);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	return _m6e_nano_resume(dev);
+}
+
+/**
+ * @brief Open an inventory window: wake the module and start reading.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _sched_open_window(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_sched *sched = &data->sched;
+	uint32_t start = k_cycle_get_32();
+	int ret;
+
+	ret = _sched_wake(dev);
+	if (ret < 0) {
+		// Resuming may have failed after the reference was taken, the module is not awake
+		_sched_put(dev);
+	} else {
+		ret = m6e_nano_start_reading(dev);
+		if (ret < 0) {
+			_sched_sleep(dev);
+		}
+	}
+
+	sched->stats.wake_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+	sched->stats.wake_us_max = MAX(sched->stats.wake_us_max, sched->stats.wake_us);
+
+	if (ret < 0) {
+		LOG_WRN("Inventory window skipped (%d).", ret);
+		sched->stats.wake_errors++;
+		if (sched->schedule.period_ms > 0) {
+			k_work_reschedule_for_queue(&m6e_nano_workq, &sched->window_work,
+						    K_MSEC(sched->schedule.period_ms));
+		}
+		return;
+	}
+
+	sched->active = true;
+	sched->window_start_ms = k_uptime_get_32();
+	sched->window_tags = data->stats.tag_reads;
+
+	k_work_reschedule_for_queue(&m6e_nano_workq, &sched->window_work,
+				    K_MSEC(sched->schedule.window_ms));
+}
+
+/**
+ * @brief Stop reading and account for the window that just ended.
+ *
+ * @param dev UART peripheral device.
+ * @return uint32_t Duration of the window in ms.
+ */
+static uint32_t _sched_end_window(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_sched *sched = &data->sched;
+	uint32_t elapsed;
+
+	m6e_nano_stop_reading(dev);
+
+	elapsed = k_uptime_get_32() - sched->window_start_ms;
+	sched->active = false;
+	sched->stats.windows++;
+	sched->stats.active_ms += elapsed;
+	sched->stats.tag_reads += data->stats.tag_reads - sched->window_tags;
+
+	return elapsed;
+}
+
+/**
+ * @brief Close an inventory window: stop reading, account for it and put the module to sleep.
+ *
+ * @param dev UART peripheral device.
+ */
+static void _sched_close_window(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_sched *sched = &data->sched;
+	uint32_t elapsed = _sched_end_window(dev);
+
+	_sched_sleep(dev);
+
+	if (sched->running && sched->schedule.period_ms > 0) {
+		uint32_t delay = sched->schedule.period_ms > elapsed
+					 ? sched->schedule.period_ms - elapsed
+					 : 0;
+
+		k_work_reschedule_for_queue(&m6e_nano_workq, &sched->window_work, K_MSEC(delay));
+	}
+}
+
+/**
+ * @brief Window transitions, alternating between opening and closing.
+ *
+ * @param work Window work item of the driver instance.
+ */
+static void m6e_nano_window_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct m6e_nano_sched *sched = CONTAINER_OF(dwork, struct m6e_nano_sched, window_work);
+	struct m6e_nano_data *data = CONTAINER_OF(sched, struct m6e_nano_data, sched);
+
+	if (sched->active) {
+		_sched_close_window(data->dev);
+	} else if (sched->running) {
+		_sched_open_window(data->dev);
+	}
+}
+
+#ifdef CONFIG_GPIO
+/**
+ * @brief Trigger input edge, opens a window or extends the current one.
+ */
+static void _sched_trigger_handler(const struct device *port, struct gpio_callback *cb,
+				   gpio_port_pins_t pins)
+{
+	struct m6e_nano_sched *sched = CONTAINER_OF(cb, struct m6e_nano_sched, trigger_cb);
+
+	ARG_UNUSED(port);
+	ARG_UNUSED(pins);
+
+	if (!sched->running || !sched->schedule.trigger) {
+		return;
+	}
+
+	sched->stats.triggers++;
+	k_work_reschedule_for_queue(&m6e_nano_workq, &sched->window_work,
+				    sched->active ? K_MSEC(sched->schedule.window_ms) : K_NO_WAIT);
+}
+#endif
+
+/**
+ * @brief Start duty-cycled inventory.
+ *
+ * @param dev UART peripheral device.
+ * @param schedule Window timing, sleep method and trigger use.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_schedule_start(const struct device *dev, const struct m6e_nano_schedule *schedule)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_sched *sched = &data->sched;
+
+	if (schedule->window_ms == 0 || (schedule->period_ms == 0 && !schedule->trigger) ||
+	    (schedule->period_ms > 0 && schedule->period_ms < schedule->window_ms)) {
+		return -EINVAL;
+	}
+	if ((schedule->sleep == M6E_NANO_SLEEP_DISABLE && !_sched_has_gpio(dev, false)) ||
+	    (schedule->trigger && !_sched_has_gpio(dev, true))) {
+		return -ENOTSUP;
+	}
+
+	// A stopped schedule leaves the module awake, holding the reference it woke it with
+	m6e_nano_schedule_stop(dev);
+
+	sched->schedule = *schedule;
+	sched->running = true;
+
+	// Sleep straight away, the first window opens on the period or the first trigger
+	m6e_nano_stop_reading(dev);
+	_sched_sleep(dev);
+
+	if (schedule->period_ms > 0) {
+		k_work_reschedule_for_queue(&m6e_nano_workq, &sched->window_work, K_NO_WAIT);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Stop duty-cycled inventory, leaving the module awake and not reading.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_schedule_stop(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_sched *sched = &data->sched;
+	struct k_work_sync sync;
+
+	if (!sched->running) {
+		return 0;
+	}
+
+	sched->running = false;
+	k_work_cancel_delayable_sync(&sched->window_work, &sync);
+
+	if (sched->active) {
+		_sched_end_window(dev);
+		return 0;
+	}
+
+	return _sched_wake(dev);
+}
+
+/**
+ * @brief Retrieve a snapshot of the scheduler statistics.
+ *
+ * @param dev UART peripheral device.
+ * @param stats Destination for the statistics.
+ */
+void m6e_nano_get_schedule_stats(const struct device *dev, struct m6e_nano_schedule_stats *stats)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+
+	memcpy(stats, &data->sched.stats, sizeof(*stats));
+}
+
+/**
+ * @brief Initialize the inventory scheduler of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_sched_init(const struct device *dev)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	int ret = 0;
+
+	k_work_init_delayable(&data->sched.window_work, m6e_nano_window_work_handler);
+
+#ifdef CONFIG_GPIO
+	const struct m6e_nano_config *cfg = dev->config;
+
+	if (_sched_has_gpio(dev, true)) {
+		if (!gpio_is_ready_dt(&cfg->trigger_gpio)) {
+			LOG_ERR("Trigger GPIO is not ready");
+			return -ENODEV;
+		}
+		ret = gpio_pin_configure_dt(&cfg->trigger_gpio, GPIO_INPUT);
+		if (ret < 0) {
+			return ret;
+		}
+		gpio_init_callback(&data->sched.trigger_cb, _sched_trigger_handler,
+				   BIT(cfg->trigger_gpio.pin));
+		ret = gpio_add_callback(cfg->trigger_gpio.port, &data->sched.trigger_cb);
+		if (ret < 0) {
+			return ret;
+		}
+		ret = gpio_pin_interrupt_configure_dt(&cfg->trigger_gpio,
+						      GPIO_INT_EDGE_TO_ACTIVE);
+	}
+#endif
+
+	return ret;
+}
@@ -0,0 +1,709 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/shell/shell.h>
+
+#include "m6e_nano.h"
+
+#define DT_DRV_COMPAT thingmagic_m6enano
+
+// Longest timed throughput test
+#define SHELL_THROUGHPUT_MAX_S 600
+
+struct shell_name {
+	const char *name;
+	uint8_t value;
+};
+
+static const struct shell_name regions[] = {
+	{"in", REGION_INDIA},     {"jp", REGION_JAPAN},       {"cn", REGION_CHINA},
+	{"eu", REGION_EUROPE},    {"kr", REGION_KOREA},       {"au", REGION_AUSTRALIA},
+	{"nz", REGION_NEWZEALAND}, {"na", REGION_NORTHAMERICA}, {"open", REGION_OPEN},
+};
+
+static const struct shell_name protocols[] = {
+	{"gen2", TMR_TAG_PROTOCOL_GEN2},   {"iso18k6b", TMR_TAG_PROTOCOL_ISO180006B},
+	{"ipx64", TMR_TAG_PROTOCOL_IPX64}, {"ipx256", TMR_TAG_PROTOCOL_IPX256},
+	{"ata", TMR_TAG_PROTOCOL_ATA},
+};
+
+static const struct shell_name targets[] = {
+	{"a", M6E_NANO_GEN2_TARGET_A},
+	{"b", M6E_NANO_GEN2_TARGET_B},
+	{"ab", M6E_NANO_GEN2_TARGET_AB},
+	{"ba", M6E_NANO_GEN2_TARGET_BA},
+};
+
+// Device the commands act on, the first instance unless changed with "m6e dev"
+static const struct device *shell_dev = DEVICE_DT_GET_ANY(DT_DRV_COMPAT);
+
+// Device a throughput test parses frames of with _shell_parse_callback()
+static const struct device *shell_parse_dev;
+
+// Statistics at the previous "m6e stats", for rates
+static struct m6e_nano_stats shell_last_stats;
+static uint32_t shell_last_ms;
+
+/**
+ * @brief Get the selected device, reporting an error if there is none.
+ */
+static const struct device *_shell_get_dev(const struct shell *sh)
+{
+	if (shell_dev == NULL || !device_is_ready(shell_dev)) {
+		shell_error(sh, "M6E Nano device not ready");
+		return NULL;
+	}
+
+	return shell_dev;
+}
+
+/**
+ * @brief Look up a name in a table.
+ *
+ * @return int Value of the name, -EINVAL if it is unknown.
+ */
+static int _shell_lookup(const struct shell *sh, const struct shell_name *table, size_t count,
+			 const char *name)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (strcmp(table[i].name, name) == 0) {
+			return table[i].value;
+		}
+	}
+
+	shell_error(sh, "Unknown value %s, one of:", name);
+	for (size_t i = 0; i < count; i++) {
+		shell_error(sh, "  %s", table[i].name);
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * @brief Report the result of a command sent to the module.
+ */
+static int _shell_result(const struct shell *sh, int ret)
+{
+	if (ret < 0) {
+		shell_error(sh, "Failed (%d)", ret);
+		return ret;
+	}
+
+	shell_print(sh, "OK");
+
+	return 0;
+}
+
+/**
+ * @brief Data callback parsing frames while a throughput test runs without one.
+ */
+static void _shell_parse_callback(const struct device *dev, void *user_data)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(user_data);
+
+	while (m6e_nano_next_frame(shell_parse_dev)) {
+		m6e_nano_parse_response(shell_parse_dev);
+	}
+}
+
+static int cmd_m6e_dev(const struct shell *sh, size_t argc, char **argv)
+{
+	if (argc > 1) {
+		const struct device *dev = device_get_binding(argv[1]);
+
+		if (dev == NULL) {
+			shell_error(sh, "Device %s not found", argv[1]);
+			return -ENODEV;
+		}
+		shell_dev = dev;
+	}
+
+	shell_print(sh, "%s", shell_dev != NULL ? shell_dev->name : "none");
+
+	return 0;
+}
+
+static int cmd_m6e_version(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	struct m6e_nano_version version;
+	struct m6e_nano_capabilities caps;
+	int ret;
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	ret = m6e_nano_get_version(dev, &version);
+	if (ret < 0) {
+		shell_error(sh, "No response (%d)", ret);
+		return ret;
+	}
+	m6e_nano_get_capabilities(dev, &caps);
+
+	shell_print(sh, "Bootloader: %08x", version.bootloader);
+	shell_print(sh, "Hardware:   %08x", version.hardware);
+	shell_print(sh, "Firmware:   %08x (%04x-%02x-%02x)", version.fw_version,
+		    version.fw_date >> 16, (version.fw_date >> 8) & 0xFF, version.fw_date & 0xFF);
+	shell_print(sh, "Protocols:  0x%08x", version.protocols);
+	shell_print(sh, "Max baud:   %u", caps.max_baud);
+	shell_print(sh, "Max power:  %u cdBm", caps.max_read_power);
+	shell_print(sh, "Metadata:   0x%04x", caps.metadata);
+	shell_print(sh, "Tag buffer: %s, embedded TagOps: %s", caps.tag_buffer ? "yes" : "no",
+		    caps.embedded_tagop ? "yes" : "no");
+
+	return 0;
+}
+
+static int cmd_m6e_start(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	return _shell_result(sh, m6e_nano_start_reading(dev));
+}
+
+static int cmd_m6e_stop(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	m6e_nano_stop_reading(dev);
+
+	return 0;
+}
+
+static int cmd_m6e_power(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	struct m6e_nano_capabilities caps;
+	int err = 0;
+	unsigned long power = shell_strtoul(argv[1], 10, &err);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+	m6e_nano_get_capabilities(dev, &caps);
+	if (err != 0 || power > caps.max_read_power) {
+		shell_error(sh, "Read power is 0 to %u centi-dBm", caps.max_read_power);
+		return -EINVAL;
+	}
+
+	return _shell_result(sh, m6e_nano_set_read_power(dev, power));
+}
+
+static int cmd_m6e_region(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	int region = _shell_lookup(sh, regions, ARRAY_SIZE(regions), argv[1]);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+	if (region < 0) {
+		return region;
+	}
+
+	return _shell_result(sh, m6e_nano_set_region(dev, region));
+}
+
+static int cmd_m6e_protocol(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	int protocol = _shell_lookup(sh, protocols, ARRAY_SIZE(protocols), argv[1]);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+	if (protocol < 0) {
+		return protocol;
+	}
+
+	return _shell_result(sh, m6e_nano_set_tag_protocol(dev, protocol));
+}
+
+static int cmd_m6e_gen2_session(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	int err = 0;
+	unsigned long session = shell_strtoul(argv[1], 10, &err);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+	if (err != 0 || session > 3) {
+		shell_error(sh, "Session is 0 to 3");
+		return -EINVAL;
+	}
+
+	return _shell_result(sh, m6e_nano_set_gen2_session(dev, session));
+}
+
+static int cmd_m6e_gen2_target(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	int target = _shell_lookup(sh, targets, ARRAY_SIZE(targets), argv[1]);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+	if (target < 0) {
+		return target;
+	}
+
+	return _shell_result(sh, m6e_nano_set_gen2_target(dev, target));
+}
+
+static int cmd_m6e_gen2_q(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	bool dynamic = strcmp(argv[1], "dynamic") == 0;
+	int err = 0;
+	unsigned long q = dynamic ? 0 : shell_strtoul(argv[1], 10, &err);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+	if (err != 0 || q > 15) {
+		shell_error(sh, "Q is dynamic or 0 to 15");
+		return -EINVAL;
+	}
+
+	return _shell_result(sh, m6e_nano_set_gen2_q(dev, dynamic ? -1 : q));
+}
+
+static int cmd_m6e_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	struct m6e_nano_stats stats;
+	uint32_t now = k_uptime_get_32();
+	uint32_t elapsed = now - shell_last_ms;
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	m6e_nano_get_stats(dev, &stats);
+
+	shell_print(sh, "Frames:         %u", stats.frames);
+	shell_print(sh, "Tag reads:      %u", stats.tag_reads);
+	shell_print(sh, "CRC errors:     %u", stats.crc_errors);
+	shell_print(sh, "Cmd timeouts:   %u", stats.cmd_timeouts);
+	shell_print(sh, "Module resets:  %u", stats.resets);
+	shell_print(sh, "Keepalive miss: %u", stats.keepalive_misses);
+	shell_print(sh, "Recoveries:     %u (%u failed)", stats.recoveries,
+		    stats.recovery_failures);
+#ifdef CONFIG_M6E_NANO_WATCHLIST
+	struct m6e_nano_watchlist_stats watch;
+
+	m6e_nano_get_watchlist_stats(dev, &watch);
+	if (watch.entries > 0) {
+		shell_print(sh, "Watchlist:      %u hits, %u filtered (%u EPCs)", watch.hits,
+			    watch.misses, watch.entries);
+	}
+#endif
+#ifdef CONFIG_M6E_NANO_ZBUS
+	struct m6e_nano_zbus *zbus = &((struct m6e_nano_data *)dev->data)->zbus;
+
+	shell_print(sh, "Zbus:           %u overruns, %u not published", zbus->overruns,
+		    zbus->publish_failures);
+#endif
+	if (shell_last_ms != 0 && elapsed > 0) {
+		shell_print(sh, "Since last:     %u tags/s, %u frames/s over %u ms",
+			    (stats.tag_reads - shell_last_stats.tag_reads) * 1000 / elapsed,
+			    (stats.frames - shell_last_stats.frames) * 1000 / elapsed, elapsed);
+	}
+
+	shell_last_stats = stats;
+	shell_last_ms = now;
+
+	return 0;
+}
+
+static int cmd_m6e_throughput(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	int err = 0;
+	long seconds = argc > 1 ? shell_strtol(argv[1], 10, &err) : 10;
+	struct m6e_nano_stats before, after;
+	struct m6e_nano_data *data;
+	bool parse = false;
+	uint32_t start, elapsed;
+	int ret;
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+	if (err != 0 || seconds <= 0 || seconds > SHELL_THROUGHPUT_MAX_S) {
+		shell_error(sh, "Duration is 1 to %u s", SHELL_THROUGHPUT_MAX_S);
+		return -EINVAL;
+	}
+
+	// Without an application callback nothing parses the frames, use our own
+	data = (struct m6e_nano_data *)dev->data;
+	if (data->callback == NULL) {
+		shell_parse_dev = dev;
+		m6e_nano_set_callback(dev, _shell_parse_callback, NULL);
+		parse = true;
+	}
+
+	m6e_nano_get_stats(dev, &before);
+	start = k_uptime_get_32();
+
+	ret = m6e_nano_start_reading(dev);
+	if (ret == 0) {
+		shell_print(sh, "Reading for %ld s...", seconds);
+		k_sleep(K_SECONDS(seconds));
+		m6e_nano_stop_reading(dev);
+	}
+
+	elapsed = k_uptime_get_32() - start;
+	m6e_nano_get_stats(dev, &after);
+
+	if (parse) {
+		m6e_nano_set_callback(dev, NULL, NULL);
+	}
+	if (ret < 0) {
+		shell_error(sh, "Failed to start reading (%d)", ret);
+		return ret;
+	}
+
+	shell_print(sh, "Tag reads:  %u (%u tags/s)", after.tag_reads - before.tag_reads,
+		    (after.tag_reads - before.tag_reads) * 1000 / elapsed);
+	shell_print(sh, "Frames:     %u (%u frames/s)", after.frames - before.frames,
+		    (after.frames - before.frames) * 1000 / elapsed);
+	shell_print(sh, "CRC errors: %u", after.crc_errors - before.crc_errors);
+	shell_print(sh, "Resets:     %u", after.resets - before.resets);
+
+	return 0;
+}
+
+static int cmd_m6e_antenna(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	uint8_t loss[15];
+	int ret;
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+#ifdef CONFIG_M6E_NANO_ANTENNAS
+	struct m6e_nano_antennas *ant = &((struct m6e_nano_data *)dev->data)->antennas;
+	struct m6e_nano_antenna_stats stats;
+
+	if (ant->count > 0) {
+		ret = m6e_nano_check_antennas(dev);
+		if (ret < 0 && ret != -ENODEV) {
+			shell_error(sh, "Failed (%d)", ret);
+			return ret;
+		}
+
+		for (uint8_t i = 0; i < ant->count; i++) {
+			m6e_nano_get_antenna_stats(dev, i, &stats);
+			shell_print(sh, "%u/%u  %2u dB  %8u reads%s", ant->ports[i].tx,
+				    ant->ports[i].rx, stats.return_loss, stats.reads,
+				    stats.skipped ? "  skipped" : "");
+		}
+		shell_print(sh, "%d ports read, %u switches", MAX(ret, 0), ant->switches);
+
+		return 0;
+	}
+#endif
+
+	ret = m6e_nano_get_return_loss(dev, loss, ARRAY_SIZE(loss));
+	if (ret < 0) {
+		shell_error(sh, "Failed (%d), stop reading first", ret);
+		return ret;
+	}
+
+	for (uint8_t i = 0; i < ARRAY_SIZE(loss); i++) {
+		if (loss[i] > 0) {
+			shell_print(sh, "%u  %2u dB", i + 1, loss[i]);
+		}
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+static int cmd_m6e_dedup(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	struct m6e_nano_round *round;
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	round = &((struct m6e_nano_data *)dev->data)->round;
+	if (!round->running) {
+		shell_warn(sh, "Inventory rounds are not running");
+	}
+
+	// Entries are only ever appended during a round, print the ones present now
+	uint16_t stored = round->set.stored;
+
+	for (uint16_t i = 0; i < stored; i++) {
+		uint8_t len = MIN(round->set.epc_len[i], CONFIG_M6E_NANO_ROUND_EPC_LEN);
+
+		shell_fprintf(sh, SHELL_NORMAL, "%3u ", i);
+		if (len < round->set.epc_len[i]) {
+			shell_fprintf(sh, SHELL_NORMAL, "..");
+		}
+		for (uint8_t x = 0; x < len; x++) {
+			shell_fprintf(sh, SHELL_NORMAL, "%02X", round->set.epc[i][x]);
+		}
+		shell_fprintf(sh, SHELL_NORMAL, "\n");
+	}
+	shell_print(sh, "%u distinct tags, %u stored, %u reads this round", round->set.count,
+		    stored, round->reads);
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_M6E_NANO_GS1
+static int cmd_m6e_skus(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	struct m6e_nano_sku skus[16];
+	bool reset = argc > 1 && strcmp(argv[1], "reset") == 0;
+	uint32_t dropped;
+	size_t count;
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	count = m6e_nano_get_skus(dev, skus, ARRAY_SIZE(skus), &dropped, reset);
+	for (size_t i = 0; i < count; i++) {
+		shell_print(sh, "%014llu %u", (unsigned long long)skus[i].key, skus[i].reads);
+	}
+	shell_print(sh, "%u GTINs shown, %u reads dropped", (unsigned int)count, dropped);
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_M6E_NANO_FIRMWARE
+static int cmd_m6e_firmware(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	struct m6e_nano_fw_stats stats;
+	int err = 0;
+	unsigned long area_id = shell_strtoul(argv[1], 10, &err);
+	int ret;
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+	if (err != 0 || area_id > UINT8_MAX) {
+		shell_error(sh, "Flash area is 0 to %u", UINT8_MAX);
+		return -EINVAL;
+	}
+
+	ret = m6e_nano_update_firmware(dev, area_id, &stats);
+	if (ret == 0) {
+		shell_print(sh, "%u bytes in %u chunks at %u baud, CRC %08X", stats.bytes,
+			    stats.chunks, stats.baud, stats.crc);
+		shell_print(sh, "Erase %u ms, write %u ms, %u bytes/s", stats.erase_ms,
+			    stats.write_ms, stats.bytes_per_s);
+	}
+
+	return _shell_result(sh, ret);
+}
+#endif
+
+#ifdef CONFIG_M6E_NANO_BRIDGE
+static int cmd_m6e_bridge_start(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	const struct device *host = device_get_binding(argv[1]);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+	if (host == NULL) {
+		shell_error(sh, "Device %s not found", argv[1]);
+		return -ENODEV;
+	}
+
+	return _shell_result(sh, m6e_nano_bridge_start(dev, host));
+}
+
+static int cmd_m6e_bridge_stop(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	return _shell_result(sh, m6e_nano_bridge_stop(dev));
+}
+
+static int cmd_m6e_bridge_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	struct m6e_nano_bridge_stats path[2];
+	static const char *const names[] = {"To module", "To host"};
+	bool on;
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	on = m6e_nano_get_bridge_stats(dev, &path[0], &path[1]);
+	shell_print(sh, "Bridge %s", on ? "on" : "off");
+	for (size_t i = 0; i < ARRAY_SIZE(path); i++) {
+		shell_print(sh, "%-10s %u bytes, %u frames, %u CRC errors, %u stalls", names[i],
+			    path[i].bytes, path[i].frames, path[i].crc_errors, path[i].stalls);
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_m6e_bridge,
+			       SHELL_CMD_ARG(start, NULL, "Bridge a UART to the module <device>",
+					     cmd_m6e_bridge_start, 2, 0),
+			       SHELL_CMD(stop, NULL, "Stop the bridge and restore the settings",
+					 cmd_m6e_bridge_stop),
+			       SHELL_CMD(stats, NULL, "Show the bridged traffic",
+					 cmd_m6e_bridge_stats),
+			       SHELL_SUBCMD_SET_END);
+#endif
+
+#ifdef CONFIG_M6E_NANO_CAPTURE
+static int cmd_m6e_capture_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+	// Too large for the shell stack, the shell runs one command at a time
+	static struct m6e_nano_capture_record record;
+	static char line[M6E_NANO_CAPTURE_LINE_LEN];
+	uint32_t overwritten;
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	while (m6e_nano_capture_get(dev, &record) == 0) {
+		if (m6e_nano_capture_format(&record, line, sizeof(line)) > 0) {
+			shell_print(sh, "%s", line);
+		}
+	}
+	overwritten = m6e_nano_capture_overwritten(dev, true);
+	if (overwritten > 0) {
+		shell_warn(sh, "%u frames overwritten", overwritten);
+	}
+
+	return 0;
+}
+
+static int cmd_m6e_capture_clear(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	m6e_nano_capture_clear(dev);
+
+	return 0;
+}
+
+static int cmd_m6e_capture_on(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	m6e_nano_capture_enable(dev, true);
+
+	return 0;
+}
+
+static int cmd_m6e_capture_off(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = _shell_get_dev(sh);
+
+	if (dev == NULL) {
+		return -ENODEV;
+	}
+
+	m6e_nano_capture_enable(dev, false);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_m6e_capture,
+			       SHELL_CMD(dump, NULL, "Print and drop captured frames",
+					 cmd_m6e_capture_dump),
+			       SHELL_CMD(clear, NULL, "Drop captured frames", cmd_m6e_capture_clear),
+			       SHELL_CMD(on, NULL, "Start capturing", cmd_m6e_capture_on),
+			       SHELL_CMD(off, NULL, "Stop capturing", cmd_m6e_capture_off),
+			       SHELL_SUBCMD_SET_END);
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_m6e_gen2,
+			       SHELL_CMD_ARG(session, NULL, "Set session <0-3>", cmd_m6e_gen2_session,
+					     2, 0),
+			       SHELL_CMD_ARG(target, NULL, "Set target <a|b|ab|ba>",
+					     cmd_m6e_gen2_target, 2, 0),
+			       SHELL_CMD_ARG(q, NULL, "Set Q <dynamic|0-15>", cmd_m6e_gen2_q, 2, 0),
+			       SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+	sub_m6e, SHELL_CMD_ARG(dev, NULL, "Show or select the device [name]", cmd_m6e_dev, 1, 1),
+	SHELL_CMD(version, NULL, "Show bootloader, hardware and firmware versions",
+		  cmd_m6e_version),
+	SHELL_CMD(start, NULL, "Start continuous reading", cmd_m6e_start),
+	SHELL_CMD(stop, NULL, "Stop reading", cmd_m6e_stop),
+	SHELL_CMD_ARG(power, NULL, "Set read power <centi-dBm>", cmd_m6e_power, 2, 0),
+	SHELL_CMD_ARG(region, NULL, "Set region <in|jp|cn|eu|kr|au|nz|na|open>", cmd_m6e_region,
+		      2, 0),
+	SHELL_CMD_ARG(protocol, NULL, "Set tag protocol <gen2|iso18k6b|ipx64|ipx256|ata>",
+		      cmd_m6e_protocol, 2, 0),
+	SHELL_CMD(gen2, &sub_m6e_gen2, "Gen2 parameters", NULL),
+	SHELL_CMD(stats, NULL, "Show statistics and rates since the last call", cmd_m6e_stats),
+	SHELL_CMD_ARG(throughput, NULL, "Read for a time and report rates [seconds]",
+		      cmd_m6e_throughput, 1, 1),
+	SHELL_CMD(antenna, NULL, "Measure the return loss of the antenna ports", cmd_m6e_antenna),
+#ifdef CONFIG_M6E_NANO_ROUNDS
+	SHELL_CMD(dedup, NULL, "Show the distinct tags of the current round", cmd_m6e_dedup),
+#endif
+#ifdef CONFIG_M6E_NANO_GS1
+	SHELL_CMD_ARG(skus, NULL, "Show the reads per GTIN [reset]", cmd_m6e_skus, 1, 1),
+#endif
+#ifdef CONFIG_M6E_NANO_BRIDGE
+	SHELL_CMD(bridge, &sub_m6e_bridge, "Pass a host UART through to the module", NULL),
+#endif
+#ifdef CONFIG_M6E_NANO_FIRMWARE
+	SHELL_CMD_ARG(firmware, NULL, "Update the module firmware from a flash area <id>",
+		      cmd_m6e_firmware, 2, 0),
+#endif
+#ifdef CONFIG_M6E_NANO_CAPTURE
+	SHELL_CMD(capture, &sub_m6e_capture, "Raw frame capture", NULL),
+#endif
+	SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(m6e, &sub_m6e, "M6E Nano RFID reader", NULL);
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "m6e_nano_store.h"
+#include "m6e_nano_internal.h"
+
+LOG_MODULE_DECLARE(M6E_NANO, CONFIG_M6E_NANO_LOG_LEVEL);
+
+/**
+ * @brief Write the staging buffer as one FCB entry and empty it. Called with the lock held.
+ *
+ * @param store Log state.
+ * @return int 0 on success, -ENOSPC if the log is full, negative errno otherwise.
+ */
+static int _store_write(struct m6e_nano_store *store)
+{
+	struct fcb *fcb = &store->fcb;
+	struct fcb_entry loc;
+	size_t len = store->enc.len;
+	size_t padded = ROUND_UP(len, fcb->f_align);
+	int ret;
+
+	if (store->staged == 0) {
+		return 0;
+	}
+
+	ret = fcb_append(fcb, len, &loc);
+	while (ret == -ENOSPC && IS_ENABLED(CONFIG_M6E_NANO_STORE_OVERWRITE)) {
+		// Drop the oldest sector of batches
+		ret = fcb_rotate(fcb);
+		if (ret < 0) {
+			break;
+		}
+		store->rotated++;
+		ret = fcb_append(fcb, len, &loc);
+	}
+
+	if (ret == 0) {
+		// Flash may only take whole write blocks, the padding is outside the entry CRC
+		memset(&store->buf[len], fcb->f_erase_value, padded - len);
+		ret = flash_area_write(fcb->fap, FCB_ENTRY_FA_DATA_OFF(loc), store->buf, padded);
+	}
+	if (ret == 0) {
+		ret = fcb_append_finish(fcb, &loc);
+	}
+
+	if (ret < 0) {
+		LOG_WRN("Failed to store %u records (%d).", store->staged, ret);
+		store->dropped += store->staged;
+	} else {
+		store->batches++;
+	}
+	store->staged = 0;
+
+	return ret;
+}
+
+/**
+ * @brief Append a record to the staging buffer, writing it out first if the record does not
+ * fit. Called with the lock held.
+ *
+ * @param store Log state.
+ * @param tag Tag read, or NULL for a summary.
+ * @param summary Inventory summary, used if tag is NULL.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _store_append(struct m6e_nano_store *store, const struct m6e_nano_codec_tag *tag,
+			 const struct m6e_nano_codec_summary *summary)
+{
+	uint64_t time_ms = tag != NULL ? tag->time_ms : summary->time_ms;
+	int ret = 0;
+
+	for (uint8_t attempt = 0; attempt < 2; attempt++) {
+		if (store->staged == 0) {
+			ret = m6e_nano_encoder_init(&store->enc, store->buf,
+						    M6E_NANO_STORE_BATCH_SIZE, store->prefix_len,
+						    time_ms);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+
+		ret = tag != NULL ? m6e_nano_encode_tag(&store->enc, tag)
+				  : m6e_nano_encode_summary(&store->enc, summary);
+		if (ret != -ENOMEM || store->staged == 0) {
+			break;
+		}
+
+		// Batch is full, write it and retry in a new one
+		ret = _store_write(store);
+		if (ret < 0) {
+			store->dropped++;
+			return ret;
+		}
+	}
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (store->staged++ == 0) {
+		k_work_schedule_for_queue(&m6e_nano_workq, &store->flush_work,
+					  K_MSEC(CONFIG_M6E_NANO_STORE_FLUSH_MS));
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Flush interval elapsed.
+ *
+ * @param work Flush work item of the log.
+ */
+static void m6e_nano_store_flush_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct m6e_nano_store *store = CONTAINER_OF(dwork, struct m6e_nano_store, flush_work);
+
+	m6e_nano_store_flush(store);
+}
+
+/**
+ * @brief Open the log in a flash partition, recovering the batches already written.
+ *
+ * @param store Log state.
+ * @param area_id Flash area of the log, for example FIXED_PARTITION_ID(storage_partition).
+ * @param prefix_len EPC prefix length of the codec dictionary, see m6e_nano_encoder_init().
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_store_init(struct m6e_nano_store *store, uint8_t area_id, uint8_t prefix_len)
+{
+	uint32_t count = ARRAY_SIZE(store->sectors);
+	const struct flash_area *fa;
+	int ret;
+
+	if (prefix_len > M6E_NANO_CODEC_PREFIX_MAX) {
+		return -EINVAL;
+	}
+
+	memset(store, 0, sizeof(*store));
+	store->prefix_len = prefix_len;
+	k_mutex_init(&store->lock);
+	k_work_init_delayable(&store->flush_work, m6e_nano_store_flush_work_handler);
+
+	ret = flash_area_get_sectors(area_id, &count, store->sectors);
+	if (ret < 0) {
+		LOG_ERR("Cannot get sectors of flash area %u (%d).", area_id, ret);
+		return ret;
+	}
+
+	store->fcb.f_magic = M6E_NANO_STORE_MAGIC;
+	store->fcb.f_version = M6E_NANO_CODEC_VERSION;
+	store->fcb.f_sector_cnt = count;
+	store->fcb.f_scratch_cnt = 0;
+	store->fcb.f_sectors = store->sectors;
+
+	ret = fcb_init(area_id, &store->fcb);
+	if (ret == -ENOMSG) {
+		// Sectors hold something else, or batches of an older codec
+		LOG_WRN("Flash area %u is not a tag log, erasing.", area_id);
+		ret = flash_area_open(area_id, &fa);
+		if (ret == 0) {
+			ret = flash_area_erase(fa, 0, fa->fa_size);
+			flash_area_close(fa);
+		}
+		if (ret == 0) {
+			ret = fcb_init(area_id, &store->fcb);
+		}
+	}
+	if (ret < 0) {
+		LOG_ERR("Cannot open the tag log (%d).", ret);
+		return ret;
+	}
+
+	if (store->fcb.f_align > M6E_NANO_STORE_ALIGN_MAX) {
+		return -ENOTSUP;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Append a tag read to the log.
+ *
+ * @param store Log state.
+ * @param tag Tag read, times must not go backwards.
+ * @return int 0 on success, -ENOSPC if the log is full, negative errno otherwise.
+ */
+int m6e_nano_store_tag(struct m6e_nano_store *store, const struct m6e_nano_codec_tag *tag)
+{
+	int ret;
+
+	k_mutex_lock(&store->lock, K_FOREVER);
+	ret = _store_append(store, tag, NULL);
+	k_mutex_unlock(&store->lock);
+
+	return ret;
+}
+
+/**
+ * @brief Append an inventory summary to the log.
+ *
+ * @param store Log state.
+ * @param summary Inventory summary, times must not go backwards.
+ * @return int 0 on success, -ENOSPC if the log is full, negative errno otherwise.
+ */
+int m6e_nano_store_summary(struct m6e_nano_store *store,
+			   const struct m6e_nano_codec_summary *summary)
+{
+	int ret;
+
+	k_mutex_lock(&store->lock, K_FOREVER);
+	ret = _store_append(store, NULL, summary);
+	k_mutex_unlock(&store->lock);
+
+	return ret;
+}
+
+/**
+ * @brief Write the staging buffer to flash.
+ *
+ * @param store Log state.
+ * @return int 0 on success, -ENOSPC if the log is full, negative errno otherwise.
+ */
+int m6e_nano_store_flush(struct m6e_nano_store *store)
+{
+	int ret;
+
+	k_mutex_lock(&store->lock, K_FOREVER);
+	ret = _store_write(store);
+	k_mutex_unlock(&store->lock);
+
+	return ret;
+}
+
+/**
+ * @brief Flush the staging buffer, then call a callback for each batch of the log.
+ *
+ * @param store Log state.
+ * @param cb Callback.
+ * @param user_data Pointer passed to the callback.
+ * @return int 0 on success, the callback's non-zero return, negative errno otherwise.
+ */
+int m6e_nano_store_walk(struct m6e_nano_store *store, m6e_nano_store_cb_t cb, void *user_data)
+{
+	struct fcb_entry loc = {0};
+	int ret = 0;
+
+	k_mutex_lock(&store->lock, K_FOREVER);
+
+	// The staging buffer holds each batch in turn, records that cannot be written are dropped
+	(void)_store_write(store);
+
+	// Entries with a bad CRC, torn by a power loss, are skipped
+	while (ret == 0 && fcb_getnext(&store->fcb, &loc) == 0) {
+		if (loc.fe_data_len > M6E_NANO_STORE_BATCH_SIZE) {
+			continue;
+		}
+		ret = flash_area_read(store->fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), store->buf,
+				      loc.fe_data_len);
+		if (ret == 0) {
+			ret = cb(store->buf, loc.fe_data_len, user_data);
+		}
+	}
+
+	k_mutex_unlock(&store->lock);
+
+	return ret;
+}
+
+/**
+ * @brief Erase the log, for example once it was synced. Records still staged are kept.
+ *
+ * @param store Log state.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_store_clear(struct m6e_nano_store *store)
+{
+	int ret;
+
+	k_mutex_lock(&store->lock, K_FOREVER);
+	ret = fcb_clear(&store->fcb);
+	k_mutex_unlock(&store->lock);
+
+	return ret;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_STORE_H
+#define M6E_NANO_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "m6e_nano_codec.h"
+
+/*
+ * Flash log of tag reads for readers that sync occasionally.
+ *
+ * Records are encoded with m6e_nano_codec into a RAM staging buffer. The buffer is written as
+ * a single flash circular buffer (FCB) entry once the next record does not fit, or
+ * CONFIG_M6E_NANO_STORE_FLUSH_MS after its first record, so flash is written in large batches
+ * instead of once per read. Every entry is a complete codec batch that decodes on its own.
+ *
+ * FCB checksums every entry, so after a power loss the log holds every batch written before
+ * it and an entry torn by the power loss is skipped. Records still in the staging buffer are
+ * lost: call m6e_nano_store_flush() before a planned power off.
+ */
+
+#ifdef CONFIG_M6E_NANO_STORE_BATCH_SIZE
+#define M6E_NANO_STORE_BATCH_SIZE CONFIG_M6E_NANO_STORE_BATCH_SIZE
+#else
+#define M6E_NANO_STORE_BATCH_SIZE 512
+#endif
+
+#ifdef CONFIG_M6E_NANO_STORE_MAX_SECTORS
+#define M6E_NANO_STORE_MAX_SECTORS CONFIG_M6E_NANO_STORE_MAX_SECTORS
+#else
+#define M6E_NANO_STORE_MAX_SECTORS 16
+#endif
+
+// Identifies log sectors, "M6EL". Logs with another magic or codec version are erased
+#define M6E_NANO_STORE_MAGIC 0x4D36454C
+
+// Largest flash write block size supported, batches are padded to it
+#define M6E_NANO_STORE_ALIGN_MAX 32
+
+struct m6e_nano_store {
+	struct fcb fcb;
+	struct flash_sector sectors[M6E_NANO_STORE_MAX_SECTORS];
+	struct k_mutex lock;
+	struct k_work_delayable flush_work;
+	struct m6e_nano_encoder enc;
+	uint8_t prefix_len;
+	uint32_t staged; // Records in the staging buffer
+	uint8_t buf[M6E_NANO_STORE_BATCH_SIZE + M6E_NANO_STORE_ALIGN_MAX];
+
+	// Statistics
+	uint32_t batches; // Batches written
+	uint32_t dropped; // Records lost to a full log or a failed write
+	uint32_t rotated; // Sectors of old batches erased to make room
+};
+
+/**
+ * @brief Callback for each batch of the log, oldest first.
+ *
+ * @param batch Codec batch, decode with m6e_nano_decoder_init().
+ * @param len Length of the batch.
+ * @param user_data Pointer passed to m6e_nano_store_walk().
+ * @return int 0 to continue, anything else stops the walk and is returned by it.
+ */
+typedef int (*m6e_nano_store_cb_t)(const uint8_t *batch, size_t len, void *user_data);
+
+/**
+ * @brief Open the log in a flash partition, recovering the batches already written.
+ *
+ * @param store Log state.
+ * @param area_id Flash area of the log, for example FIXED_PARTITION_ID(storage_partition).
+ * @param prefix_len EPC prefix length of the codec dictionary, see m6e_nano_encoder_init().
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_store_init(struct m6e_nano_store *store, uint8_t area_id, uint8_t prefix_len);
+
+/**
+ * @brief Append a tag read to the log.
+ *
+ * @param store Log state.
+ * @param tag Tag read, times must not go backwards.
+ * @return int 0 on success, -ENOSPC if the log is full, negative errno otherwise.
+ */
+int m6e_nano_store_tag(struct m6e_nano_store *store, const struct m6e_nano_codec_tag *tag);
+
+/**
+ * @brief Append an inventory summary to the log.
+ *
+ * @param store Log state.
+ * @param summary Inventory summary, times must not go backwards.
+ * @return int 0 on success, -ENOSPC if the log is full, negative errno otherwise.
+ */
+int m6e_nano_store_summary(struct m6e_nano_store *store,
+			   const struct m6e_nano_codec_summary *summary);
+
+/**
+ * @brief Write the staging buffer to flash.
+ *
+ * @param store Log state.
+ * @return int 0 on success, -ENOSPC if the log is full, negative errno otherwise.
+ */
+int m6e_nano_store_flush(struct m6e_nano_store *store);
+
+/**
+ * @brief Flush the staging buffer, then call a callback for each batch of the log.
+ *
+ * @param store Log state.
+ * @param cb Callback.
+ * @param user_data Pointer passed to the callback.
+ * @return int 0 on success, the callback's non-zero return, negative errno otherwise.
+ */
+int m6e_nano_store_walk(struct m6e_nano_store *store, m6e_nano_store_cb_t cb, void *user_data);
+
+/**
+ * @brief Erase the log, for example once it was synced. Records still staged are kept.
+ *
+ * @param store Log state.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_store_clear(struct m6e_nano_store *store);
+
+#endif // M6E_NANO_STORE_H
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_trace.h"
+
+// Start and end points of each M6E_NANO_TRACE_SPAN_*
+static const uint8_t span_points[M6E_NANO_TRACE_SPANS][2] = {
+	[M6E_NANO_TRACE_SPAN_RX] = {M6E_NANO_TRACE_FRAME_START, M6E_NANO_TRACE_FRAME_END},
+	[M6E_NANO_TRACE_SPAN_DISPATCH] = {M6E_NANO_TRACE_FRAME_END, M6E_NANO_TRACE_DISPATCH},
+	[M6E_NANO_TRACE_SPAN_QUEUE] = {M6E_NANO_TRACE_DISPATCH, M6E_NANO_TRACE_DEQUEUE},
+	[M6E_NANO_TRACE_SPAN_PARSE] = {M6E_NANO_TRACE_DEQUEUE, M6E_NANO_TRACE_CRC_DONE},
+	[M6E_NANO_TRACE_SPAN_TAG] = {M6E_NANO_TRACE_FRAME_START, M6E_NANO_TRACE_CRC_DONE},
+	[M6E_NANO_TRACE_SPAN_COMMAND] = {M6E_NANO_TRACE_CMD_SENT, M6E_NANO_TRACE_RESPONSE},
+};
+
+/**
+ * @brief Timestamp a trace point and account for the spans it ends.
+ *
+ * @param dev Driver device.
+ * @param point One of M6E_NANO_TRACE_*.
+ */
+void m6e_nano_trace_record(const struct device *dev, uint8_t point)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_trace *trace = &data->trace;
+	k_spinlock_key_t key = k_spin_lock(&trace->lock);
+	uint32_t now = k_cycle_get_32();
+
+	for (uint8_t span = 0; span < M6E_NANO_TRACE_SPANS; span++) {
+		if (span_points[span][1] != point || trace->stamp[span_points[span][0]] == 0) {
+			continue;
+		}
+
+		struct m6e_nano_trace_hist *hist = &trace->hist[span];
+		uint32_t cycles = now - trace->stamp[span_points[span][0]];
+
+		hist->buckets[find_msb_set(cycles | 1) - 1]++;
+		hist->min = hist->count == 0 ? cycles : MIN(hist->min, cycles);
+		hist->max = MAX(hist->max, cycles);
+		hist->total += cycles;
+		hist->count++;
+	}
+
+	// 0 marks a point not reached yet
+	trace->stamp[point] = now | 1;
+	k_spin_unlock(&trace->lock, key);
+}
+
+/**
+ * @brief Retrieve the latency histogram of a span.
+ *
+ * @param dev Driver device.
+ * @param span One of M6E_NANO_TRACE_SPAN_*.
+ * @param hist Destination for the histogram, in cycles of k_cycle_get_32().
+ * @return int 0 on success, -EINVAL for an unknown span.
+ */
+int m6e_nano_trace_get(const struct device *dev, uint8_t span, struct m6e_nano_trace_hist *hist)
+{
+	struct m6e_nano_trace *trace = &((struct m6e_nano_data *)dev->data)->trace;
+	k_spinlock_key_t key;
+
+	if (span >= M6E_NANO_TRACE_SPANS) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&trace->lock);
+	memcpy(hist, &trace->hist[span], sizeof(*hist));
+	k_spin_unlock(&trace->lock, key);
+
+	return 0;
+}
+
+/**
+ * @brief Clear all latency histograms.
+ *
+ * @param dev Driver device.
+ */
+void m6e_nano_trace_reset(const struct device *dev)
+{
+	struct m6e_nano_trace *trace = &((struct m6e_nano_data *)dev->data)->trace;
+	k_spinlock_key_t key = k_spin_lock(&trace->lock);
+
+	memset(trace->stamp, 0, sizeof(trace->stamp));
+	memset(trace->hist, 0, sizeof(trace->hist));
+	k_spin_unlock(&trace->lock, key);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_TRACE_H
+#define M6E_NANO_TRACE_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+#ifdef CONFIG_M6E_NANO_TRACING_NAMED_EVENT
+#include <zephyr/tracing/tracing.h>
+#endif
+
+/*
+ * Trace points along the path of a frame and of a command. Each one can be emitted as a named
+ * event of the tracing subsystem (CTF, SEGGER SystemView) and/or timestamped with the cycle
+ * counter to build latency histograms between points. Without CONFIG_M6E_NANO_TRACING the
+ * M6E_NANO_TRACE() macro expands to nothing.
+ */
+
+// Trace points
+#define M6E_NANO_TRACE_FRAME_START 0 // Header byte received, ISR
+#define M6E_NANO_TRACE_FRAME_END   1 // Last byte of the frame received, ISR
+#define M6E_NANO_TRACE_DISPATCH    2 // Frame handed to the data callback, ISR
+#define M6E_NANO_TRACE_DEQUEUE     3 // Consumer started parsing the frame
+#define M6E_NANO_TRACE_CRC_DONE    4 // Frame CRC checked
+#define M6E_NANO_TRACE_CMD_SENT    5 // Last command byte written to the UART
+#define M6E_NANO_TRACE_RESPONSE    6 // Response to the command matched
+#define M6E_NANO_TRACE_POINTS      7
+
+// Latency spans between trace points
+#define M6E_NANO_TRACE_SPAN_RX       0 // FRAME_START to FRAME_END
+#define M6E_NANO_TRACE_SPAN_DISPATCH 1 // FRAME_END to DISPATCH
+#define M6E_NANO_TRACE_SPAN_QUEUE    2 // DISPATCH to DEQUEUE
+#define M6E_NANO_TRACE_SPAN_PARSE    3 // DEQUEUE to CRC_DONE
+#define M6E_NANO_TRACE_SPAN_TAG      4 // FRAME_START to CRC_DONE, end to end
+#define M6E_NANO_TRACE_SPAN_COMMAND  5 // CMD_SENT to RESPONSE
+#define M6E_NANO_TRACE_SPANS         6
+
+// Histogram bucket n counts latencies of 2^n to 2^(n+1) - 1 cycles
+#define M6E_NANO_TRACE_BUCKETS 32
+
+struct m6e_nano_trace_hist {
+	uint32_t count;
+	uint32_t min; // Cycles
+	uint32_t max; // Cycles
+	uint64_t total; // Cycles
+	uint32_t buckets[M6E_NANO_TRACE_BUCKETS];
+};
+
+struct m6e_nano_trace {
+	struct k_spinlock lock; // Points are recorded from the UART ISR and threads
+	uint32_t stamp[M6E_NANO_TRACE_POINTS];
+	struct m6e_nano_trace_hist hist[M6E_NANO_TRACE_SPANS];
+};
+
+#ifdef CONFIG_M6E_NANO_TRACING_NAMED_EVENT
+#define _M6E_NANO_TRACE_EVENT(dev, point)                                                          \
+	sys_trace_named_event("m6e_nano_" #point, (uint32_t)(uintptr_t)(dev), k_cycle_get_32())
+#else
+#define _M6E_NANO_TRACE_EVENT(dev, point)
+#endif
+
+#ifdef CONFIG_M6E_NANO_TRACING_HISTOGRAM
+#define _M6E_NANO_TRACE_HIST(dev, point) m6e_nano_trace_record(dev, M6E_NANO_TRACE_##point)
+#else
+#define _M6E_NANO_TRACE_HIST(dev, point)
+#endif
+
+#ifdef CONFIG_M6E_NANO_TRACING
+/**
+ * @brief Emit a trace point, one of M6E_NANO_TRACE_* without the prefix.
+ */
+#define M6E_NANO_TRACE(dev, point)                                                                 \
+	do {                                                                                       \
+		_M6E_NANO_TRACE_EVENT(dev, point);                                                 \
+		_M6E_NANO_TRACE_HIST(dev, point);                                                  \
+	} while (0)
+#else
+#define M6E_NANO_TRACE(dev, point)                                                                 \
+	do {                                                                                       \
+	} while (0)
+#endif
+
+#ifdef CONFIG_M6E_NANO_TRACING_HISTOGRAM
+/**
+ * @brief Timestamp a trace point and account for the spans it ends. Safe to call from an ISR.
+ *
+ * @param dev Driver device.
+ * @param point One of M6E_NANO_TRACE_*.
+ */
+void m6e_nano_trace_record(const struct device *dev, uint8_t point);
+#endif
+
+/**
+ * @brief Retrieve the latency histogram of a span. Requires CONFIG_M6E_NANO_TRACING_HISTOGRAM.
+ *
+ * @param dev Driver device.
+ * @param span One of M6E_NANO_TRACE_SPAN_*.
+ * @param hist Destination for the histogram, in cycles of k_cycle_get_32().
+ * @return int 0 on success, -EINVAL for an unknown span.
+ */
+int m6e_nano_trace_get(const struct device *dev, uint8_t span, struct m6e_nano_trace_hist *hist);
+
+/**
+ * @brief Clear all latency histograms.
+ *
+ * @param dev Driver device.
+ */
+void m6e_nano_trace_reset(const struct device *dev);
+
+#endif // M6E_NANO_TRACE_H
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "m6e_nano_proto.h"
+#include "m6e_nano_watchlist.h"
+
+/**
+ * @brief Size of an index.
+ *
+ * @param count Number of entries.
+ * @param epc_len EPC length in bytes.
+ * @param bucket_bits Bucket table size, log2.
+ * @return size_t Size in bytes.
+ */
+size_t m6e_nano_watchlist_size(uint32_t count, uint8_t epc_len, uint8_t bucket_bits)
+{
+	return sizeof(struct m6e_nano_watchlist_header) +
+	       (((size_t)1 << bucket_bits) + 1) * sizeof(uint32_t) +
+	       (size_t)count * (sizeof(uint32_t) + epc_len);
+}
+
+/**
+ * @brief Bucket of an EPC.
+ *
+ * @param epc EPC.
+ * @param epc_len EPC length in bytes.
+ * @param bucket_bits Bucket table size, log2.
+ * @return uint32_t Bucket number.
+ */
+uint32_t m6e_nano_watchlist_bucket(const uint8_t *epc, uint8_t epc_len, uint8_t bucket_bits)
+{
+	// Top bits of the CRC, EPCs of one batch differ in their last bytes only
+	return (uint32_t)m6e_nano_crc(epc, epc_len) >> (16 - bucket_bits);
+}
+
+/**
+ * @brief Check an index and open it. The index is used in place and must outlive the
+ * watchlist.
+ *
+ * @param list Watchlist.
+ * @param index Index, 4-byte aligned.
+ * @param size Size of the index.
+ * @return int 0 on success, -EINVAL if the index is malformed, misaligned or big-endian.
+ */
+int m6e_nano_watchlist_open(struct m6e_nano_watchlist *list, const void *index, size_t size)
+{
+	const struct m6e_nano_watchlist_header *header = index;
+	const uint32_t *offsets;
+	uint32_t buckets;
+
+	memset(list, 0, sizeof(*list));
+
+	if (((uintptr_t)index & 3) != 0 || size < sizeof(*header)) {
+		return -EINVAL;
+	}
+	// A big-endian host reads the magic reversed
+	if (header->magic != M6E_NANO_WATCHLIST_MAGIC ||
+	    header->version != M6E_NANO_WATCHLIST_VERSION || header->epc_len == 0 ||
+	    header->epc_len > M6E_NANO_EPC_MAX_LEN ||
+	    header->bucket_bits > M6E_NANO_WATCHLIST_MAX_BUCKET_BITS ||
+	    header->count > size / (sizeof(uint32_t) + header->epc_len) ||
+	    size != m6e_nano_watchlist_size(header->count, header->epc_len, header->bucket_bits)) {
+		return -EINVAL;
+	}
+
+	// Buckets must cover every entry in order, lookups trust them
+	buckets = 1U << header->bucket_bits;
+	offsets = (const uint32_t *)(header + 1);
+	if (offsets[0] != 0 || offsets[buckets] != header->count) {
+		return -EINVAL;
+	}
+	for (uint32_t i = 0; i < buckets; i++) {
+		if (offsets[i] > offsets[i + 1]) {
+			return -EINVAL;
+		}
+	}
+
+	list->header = header;
+	list->offsets = offsets;
+	list->data = &offsets[buckets + 1];
+	list->epcs = (const uint8_t *)&list->data[header->count];
+
+	return 0;
+}
+
+/**
+ * @brief Look an EPC up.
+ *
+ * @param list Opened watchlist.
+ * @param epc EPC.
+ * @param epc_len EPC length in bytes.
+ * @param data Value of the entry, may be NULL.
+ * @return int 0 if the EPC is on the watchlist, -ENOENT otherwise.
+ */
+int m6e_nano_watchlist_find(const struct m6e_nano_watchlist *list, const uint8_t *epc,
+			    uint8_t epc_len, uint32_t *data)
+{
+	const struct m6e_nano_watchlist_header *header = list->header;
+	uint32_t bucket;
+	uint32_t low;
+	uint32_t high;
+
+	if (header == NULL || epc_len != header->epc_len) {
+		return -ENOENT;
+	}
+
+	bucket = m6e_nano_watchlist_bucket(epc, epc_len, header->bucket_bits);
+	low = list->offsets[bucket];
+	high = list->offsets[bucket + 1];
+
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		int cmp = memcmp(&list->epcs[(size_t)mid * epc_len], epc, epc_len);
+
+		if (cmp == 0) {
+			if (data != NULL) {
+				*data = list->data[mid];
+			}
+			return 0;
+		}
+		if (cmp < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return -ENOENT;
+}
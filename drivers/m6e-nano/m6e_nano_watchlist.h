@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_WATCHLIST_H
+#define M6E_NANO_WATCHLIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Read-only index of the EPCs a deployment cares about, built offline by the host tool
+ * m6e_nano_index and used in place, for example from memory-mapped flash.
+ *
+ * EPCs are spread over 2^bucket_bits buckets by their CRC-16, the same one the frames use, and
+ * sorted within each bucket. A lookup hashes the EPC, reads the two offsets of its bucket and
+ * binary searches the few EPCs between them, so it costs the same for tens of thousands of
+ * entries as for ten. The EPCs of a bucket are contiguous, a miss usually touches a single
+ * cache line of them.
+ *
+ * Layout, little-endian and 4-byte aligned:
+ *
+ *   struct m6e_nano_watchlist_header
+ *   uint32_t offsets[2^bucket_bits + 1]  First entry of each bucket, then count
+ *   uint32_t data[count]                 Value returned for each entry, by entry
+ *   uint8_t epcs[count][epc_len]         Sorted by bucket, then EPC
+ */
+
+#define M6E_NANO_WATCHLIST_MAGIC   0x4C57364D // "M6WL"
+#define M6E_NANO_WATCHLIST_VERSION 1
+
+// Largest bucket table, 256 KiB of offsets
+#define M6E_NANO_WATCHLIST_MAX_BUCKET_BITS 16
+
+struct m6e_nano_watchlist_header {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t epc_len;     // Every EPC of the index has this length, in bytes
+	uint8_t bucket_bits;
+	uint8_t reserved;
+	uint32_t count;      // Number of entries
+};
+
+// Opened index
+struct m6e_nano_watchlist {
+	const struct m6e_nano_watchlist_header *header; // NULL if no index is open
+	const uint32_t *offsets;
+	const uint32_t *data;
+	const uint8_t *epcs;
+};
+
+/**
+ * @brief Size of an index.
+ *
+ * @param count Number of entries.
+ * @param epc_len EPC length in bytes.
+ * @param bucket_bits Bucket table size, log2.
+ * @return size_t Size in bytes.
+ */
+size_t m6e_nano_watchlist_size(uint32_t count, uint8_t epc_len, uint8_t bucket_bits);
+
+/**
+ * @brief Bucket of an EPC.
+ *
+ * @param epc EPC.
+ * @param epc_len EPC length in bytes.
+ * @param bucket_bits Bucket table size, log2.
+ * @return uint32_t Bucket number.
+ */
+uint32_t m6e_nano_watchlist_bucket(const uint8_t *epc, uint8_t epc_len, uint8_t bucket_bits);
+
+/**
+ * @brief Check an index and open it. The index is used in place and must outlive the
+ * watchlist.
+ *
+ * @param list Watchlist.
+ * @param index Index, 4-byte aligned.
+ * @param size Size of the index.
+ * @return int 0 on success, -EINVAL if the index is malformed, misaligned or big-endian.
+ */
+int m6e_nano_watchlist_open(struct m6e_nano_watchlist *list, const void *index, size_t size);
+
+/**
+ * @brief Look an EPC up.
+ *
+ * @param list Opened watchlist.
+ * @param epc EPC.
+ * @param epc_len EPC length in bytes.
+ * @param data Value of the entry, may be NULL.
+ * @return int 0 if the EPC is on the watchlist, -ENOENT otherwise.
+ */
+int m6e_nano_watchlist_find(const struct m6e_nano_watchlist *list, const uint8_t *epc,
+			    uint8_t epc_len, uint32_t *data);
+
+#endif // M6E_NANO_WATCHLIST_H
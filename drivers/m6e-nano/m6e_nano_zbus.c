@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/zbus/zbus.h>
+
+#include "m6e_nano.h"
+#include "m6e_nano_internal.h"
+
+ZBUS_CHAN_DEFINE(m6e_nano_tag_chan, struct m6e_nano_tag_msg, NULL, NULL, ZBUS_OBSERVERS_EMPTY,
+		 ZBUS_MSG_INIT(.dev = NULL));
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+ZBUS_CHAN_DEFINE(m6e_nano_round_chan, struct m6e_nano_round_msg, NULL, NULL,
+		 ZBUS_OBSERVERS_EMPTY, ZBUS_MSG_INIT(.dev = NULL));
+#endif
+
+ZBUS_CHAN_DEFINE(m6e_nano_telemetry_chan, struct m6e_nano_telemetry_msg, NULL, NULL,
+		 ZBUS_OBSERVERS_EMPTY, ZBUS_MSG_INIT(.dev = NULL));
+
+/**
+ * @brief Publish a message without waiting, so a subscriber reading the channel never holds up
+ * the driver work queue.
+ *
+ * @param zbus Zbus state of the driver instance.
+ * @param chan Channel.
+ * @param msg Message.
+ */
+static void _zbus_publish(struct m6e_nano_zbus *zbus, const struct zbus_channel *chan,
+			  const void *msg)
+{
+	if (zbus_chan_pub(chan, msg, K_NO_WAIT) < 0) {
+		zbus->publish_failures++;
+	}
+}
+
+/**
+ * @brief Publish the tag reads and round summaries queued from the UART ISR.
+ *
+ * @param work Publish work item of the driver instance.
+ */
+static void m6e_nano_zbus_publish_work_handler(struct k_work *work)
+{
+	struct m6e_nano_zbus *zbus = CONTAINER_OF(work, struct m6e_nano_zbus, publish_work);
+	struct m6e_nano_tag_msg tag;
+
+	while (k_msgq_get(&zbus->tags, &tag, K_NO_WAIT) == 0) {
+		_zbus_publish(zbus, &m6e_nano_tag_chan, &tag);
+	}
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+	struct m6e_nano_round_msg round;
+
+	while (k_msgq_get(&zbus->rounds, &round, K_NO_WAIT) == 0) {
+		_zbus_publish(zbus, &m6e_nano_round_chan, &round);
+	}
+#endif
+}
+
+/**
+ * @brief Publish the statistics of the driver instance, every
+ * CONFIG_M6E_NANO_ZBUS_TELEMETRY_MS.
+ *
+ * @param work Telemetry work item of the driver instance.
+ */
+static void m6e_nano_zbus_telemetry_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct m6e_nano_zbus *zbus = CONTAINER_OF(dwork, struct m6e_nano_zbus, telemetry_work);
+	struct m6e_nano_data *data = CONTAINER_OF(zbus, struct m6e_nano_data, zbus);
+	struct m6e_nano_telemetry_msg msg = {
+		.dev = data->dev,
+		.uptime_ms = k_uptime_get_32(),
+		.overruns = zbus->overruns,
+		.publish_failures = zbus->publish_failures,
+	};
+
+	m6e_nano_get_stats(data->dev, &msg.stats);
+	_zbus_publish(zbus, &m6e_nano_telemetry_chan, &msg);
+
+	k_work_reschedule_for_queue(&m6e_nano_workq, &zbus->telemetry_work,
+				    K_MSEC(CONFIG_M6E_NANO_ZBUS_TELEMETRY_MS));
+}
+
+/**
+ * @brief Initialize zbus publication of a driver instance.
+ *
+ * @param dev UART peripheral device.
+ */
+void m6e_nano_zbus_init(const struct device *dev)
+{
+	struct m6e_nano_zbus *zbus = &((struct m6e_nano_data *)dev->data)->zbus;
+
+	k_msgq_init(&zbus->tags, zbus->tags_buf, sizeof(struct m6e_nano_tag_msg),
+		    CONFIG_M6E_NANO_ZBUS_QUEUE_LEN);
+#ifdef CONFIG_M6E_NANO_ROUNDS
+	k_msgq_init(&zbus->rounds, zbus->rounds_buf, sizeof(struct m6e_nano_round_msg),
+		    CONFIG_M6E_NANO_ROUND_QUEUE_LEN);
+#endif
+	k_work_init(&zbus->publish_work, m6e_nano_zbus_publish_work_handler);
+	k_work_init_delayable(&zbus->telemetry_work, m6e_nano_zbus_telemetry_work_handler);
+
+	if (CONFIG_M6E_NANO_ZBUS_TELEMETRY_MS > 0) {
+		k_work_reschedule_for_queue(&m6e_nano_workq, &zbus->telemetry_work,
+					    K_MSEC(CONFIG_M6E_NANO_ZBUS_TELEMETRY_MS));
+	}
+}
+
+#ifdef CONFIG_M6E_NANO_WATCHLIST
+/**
+ * @brief Match a tag read against the watchlist, like m6e_nano_parse_response() does, without
+ * counting it a second time in the watchlist counters.
+ *
+ * @param data Driver instance data.
+ * @param msg Message of the read, its watch_data set on a hit.
+ * @return true if the read is published, always without a watchlist.
+ */
+static bool _zbus_watched(struct m6e_nano_data *data, struct m6e_nano_tag_msg *msg)
+{
+	struct m6e_nano_watch *watch = &data->watch;
+	k_spinlock_key_t key = k_spin_lock(&watch->lock);
+	bool hit = true;
+
+	msg->watch_data = 0;
+	if (watch->list.header != NULL) {
+		hit = m6e_nano_watchlist_find(&watch->list, msg->tag.epc, msg->tag.epc_len,
+					      &msg->watch_data) == 0;
+	}
+	k_spin_unlock(&watch->lock, key);
+
+	return hit;
+}
+#endif
+
+/**
+ * @brief Queue a tag read frame for publication on m6e_nano_tag_chan. Called from the UART ISR
+ * for every complete CRC-valid frame. Reads the watchlist filters out are not published; GS1
+ * counting and inventory rounds stay with m6e_nano_parse_response().
+ *
+ * @param dev UART peripheral device.
+ * @param frame Frame, from the header to the CRC.
+ */
+void m6e_nano_zbus_frame(const struct device *dev, const uint8_t *frame)
+{
+	struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
+	struct m6e_nano_zbus *zbus = &data->zbus;
+	struct m6e_nano_tag_msg msg;
+
+	if (!m6e_nano_frame_is_tag(frame)) {
+		return;
+	}
+
+	msg.dev = dev;
+	msg.frame_us = data->frame_us;
+	if (m6e_nano_decode_tag(frame, &msg.tag) < 0) {
+		return;
+	}
+#ifdef CONFIG_M6E_NANO_WATCHLIST
+	if (!_zbus_watched(data, &msg)) {
+		return;
+	}
+#endif
+
+	if (k_msgq_put(&zbus->tags, &msg, K_NO_WAIT) < 0) {
+		zbus->overruns++;
+		return;
+	}
+	k_work_submit_to_queue(&m6e_nano_workq, &zbus->publish_work);
+}
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+/**
+ * @brief Queue a round summary for publication on m6e_nano_round_chan.
+ *
+ * @param dev UART peripheral device.
+ * @param summary Summary of the round that ended.
+ */
+void m6e_nano_zbus_round(const struct device *dev, const struct m6e_nano_round_summary *summary)
+{
+	struct m6e_nano_zbus *zbus = &((struct m6e_nano_data *)dev->data)->zbus;
+	struct m6e_nano_round_msg msg = {
+		.dev = dev,
+		.summary = *summary,
+	};
+
+	if (k_msgq_put(&zbus->rounds, &msg, K_NO_WAIT) < 0) {
+		zbus->overruns++;
+		return;
+	}
+	k_work_submit_to_queue(&m6e_nano_workq, &zbus->publish_work);
+}
+#endif
+
+/**
+ * @brief Copy the message of a channel into the queue of a subscriber, counting it as dropped
+ * if the queue is full. Called by the listener of M6E_NANO_SUBSCRIBER_DEFINE().
+ *
+ * @param sub Subscriber.
+ * @param chan Channel that was published.
+ */
+void m6e_nano_subscriber_put(struct m6e_nano_subscriber *sub, const struct zbus_channel *chan)
+{
+	if (k_msgq_put(sub->msgq, zbus_chan_const_msg(chan), K_NO_WAIT) < 0) {
+		atomic_inc(&sub->dropped);
+	}
+}
+
+/**
+ * @brief Take the oldest message of a subscriber.
+ *
+ * @param sub Subscriber.
+ * @param msg Destination, the message type of the subscriber.
+ * @param timeout Longest wait for a message.
+ * @return int 0 on success, -EAGAIN on timeout, -ENOMSG without waiting and no message.
+ */
+int m6e_nano_subscriber_get(struct m6e_nano_subscriber *sub, void *msg, k_timeout_t timeout)
+{
+	return k_msgq_get(sub->msgq, msg, timeout);
+}
+
+/**
+ * @brief Messages a subscriber lost to its full queue.
+ *
+ * @param sub Subscriber.
+ * @return uint32_t Dropped messages since boot.
+ */
+uint32_t m6e_nano_subscriber_dropped(struct m6e_nano_subscriber *sub)
+{
+	return (uint32_t)atomic_get(&sub->dropped);
+}
@@ -11,38 +11,32 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(main, CONFIG_APP_LOG_LEVEL);
 
-#define TAG_TOTAL_LIMIT 100
-
-struct counter {
-	char tags[TAG_TOTAL_LIMIT][(12 * 2) + 1];
-	uint32_t total;
-};
-
-static struct counter seen_tags = {
-	.total = 0,
-};
-
-void array_to_string(uint8_t *buf, char *str)
+void array_to_string(const uint8_t *buf, uint8_t len, char *str)
 {
 	char *ptr = &str[0];
 
-	for (int i = 0; i < 12; i++) {
+	*ptr = '\0';
+	for (int i = 0; i < len; i++) {
 		ptr += sprintf(ptr, "%02X", buf[i]);
 	}
 }
 
-// void clear_callback(void *user_data)
-// {
-//     struct counter *tags = user_data;
-//     tags->total = 0;
-// }
+void round_callback(const struct device *dev, const struct m6e_nano_round_summary *summary,
+		    void *user_data)
+{
+	printk("Round %u: %u tags, %u reads in %ums\n", summary->round, summary->unique,
+	       summary->reads, summary->duration_ms);
+}
 
-void read_callback(const struct device *dev, void *user_data)
+// Reader of the frames, passed as user_data of the data callback
+static const struct device *frame_dev;
+
+void frame_work_handler(struct k_work *work)
 {
-	const struct device *m6e_nano_dev = user_data;
-	struct m6e_nano_data *drv_data = m6e_nano_dev->data;
+	const struct device *m6e_nano_dev = frame_dev;
+	void *user_data = (void *)m6e_nano_dev;
 
-	if (drv_data->status == RESPONSE_SUCCESS) {
+	while (m6e_nano_next_frame(m6e_nano_dev)) {
 		int res = m6e_nano_parse_response(user_data);
 		char *res_str = "";
 		switch (res) {
@@ -51,40 +45,32 @@ void read_callback(const struct device *dev, void *user_data)
 			break;
 		case RESPONSE_IS_KEEPALIVE:
 			res_str = "RESPONSE_IS_KEEPALIVE";
-			seen_tags.total = 0;
-			printk("Tag count: %d\n", seen_tags.total);
 			break;
 		case RESPONSE_IS_TAGFOUND:
 			res_str = "RESPONSE_IS_TAGFOUND";
 
-			uint8_t rssi =
+			int8_t rssi =
 				m6e_nano_get_tag_rssi(user_data); // Get the RSSI for tag read
 			long freq = m6e_nano_get_tag_freq(
 				user_data); // Get the frequency tag was detected at
 			long timeStamp = m6e_nano_get_tag_timestamp(
 				user_data); // Get the time (ms) since last keep-alive
-			uint8_t tagEPCBytes = m6e_nano_get_tag_epc_bytes(user_data);
+			struct m6e_nano_tag tag;
 
-			char new_tag_str[(12 * 2) + 1];
-			array_to_string(drv_data->response.data + 31, new_tag_str);
-			printk("Tag found: %s\n", new_tag_str);
-			printk("rssi: -%ddBm | freq: %ldHz | timestamp: %ldms | size %d\n", rssi,
-			       freq, timeStamp, tagEPCBytes);
-			int ret = 0;
-			for (size_t i = 0; i < seen_tags.total; i++) {
-				if (strcmp(seen_tags.tags[i], new_tag_str) == 0) {
-					// printk("Tag already exists\n");
-					ret = 1;
-				}
+			// The EPC length comes from the PC word, it is not always 12 bytes
+			if (m6e_nano_get_tag(user_data, &tag) < 0) {
+				break;
 			}
+			uint8_t tagEPCBytes = tag.epc_len;
 
-			if (ret == 1) {
-				printk("Tag count: %d\n", seen_tags.total);
-				break;
-			} else {
-				strcpy(seen_tags.tags[seen_tags.total], new_tag_str);
-				seen_tags.total++;
-				printk("Tag count: %d\n", seen_tags.total);
+			char new_tag_str[(M6E_NANO_EPC_MAX_LEN * 2) + 1];
+			array_to_string(tag.epc, tag.epc_len, new_tag_str);
+			printk("Tag found: %s\n", new_tag_str);
+			printk("rssi: %ddBm | freq: %ldHz | timestamp: %ldms | size %d\n", rssi,
+			       freq, timeStamp, tagEPCBytes);
+			printk("Read at uptime %lldms\n", m6e_nano_get_tag_uptime(user_data));
+			if (m6e_nano_round_tag_is_new(user_data)) {
+				printk("New tag this round\n");
 			}
 
 			break;
@@ -95,11 +81,18 @@ void read_callback(const struct device *dev, void *user_data)
 			break;
 		}
 		LOG_INF("%s", res_str);
-
-		drv_data->status = RESPONSE_CLEAR;
 	}
 }
 
+K_WORK_DEFINE(frame_work, frame_work_handler);
+
+void read_callback(const struct device *dev, void *user_data)
+{
+	// Called from the UART ISR once per batch of frames, print them from a thread
+	frame_dev = user_data;
+	k_work_submit(&frame_work);
+}
+
 int main(void)
 {
 	const struct device *dev = DEVICE_DT_GET_ONE(thingmagic_m6enano);
@@ -111,7 +104,11 @@ int main(void)
 	m6e_nano_set_baud(dev, 115200);
 
 	LOG_INF("Requesting hardware version...");
-	m6e_nano_get_version(dev);
+	struct m6e_nano_version version;
+
+	if (m6e_nano_get_version(dev, &version) == 0) {
+		LOG_INF("Hardware %08X, firmware %08X", version.hardware, version.fw_version);
+	}
 
 	LOG_INF("Setting tag protocol...");
 	m6e_nano_set_tag_protocol(dev, TMR_TAG_PROTOCOL_GEN2);
@@ -133,10 +130,18 @@ int main(void)
 	LOG_INF("Setting power mode...");
 	m6e_nano_set_power_mode(dev, TMR_SR_POWER_MODE_MED_SAVE);
 
+	// Count distinct tags between keep-alives of the read stream
+	struct m6e_nano_round_config round = {
+		.keepalive = true,
+	};
+
+	m6e_nano_round_set_callback(dev, round_callback, NULL);
+	m6e_nano_round_start(dev, &round);
+
 	LOG_INF("Start reading...");
 	m6e_nano_start_reading(dev);
 
-	m6e_nano_set_callback(dev, read_callback, &seen_tags);
+	m6e_nano_set_callback(dev, read_callback, (void *)dev);
 
 	return 0;
 }
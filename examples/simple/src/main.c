@@ -14,7 +14,7 @@ LOG_MODULE_REGISTER(main, CONFIG_APP_LOG_LEVEL);
 #define TAG_TOTAL_LIMIT 100
 
 struct counter {
-	char tags[TAG_TOTAL_LIMIT][(12 * 2) + 1];
+	char tags[TAG_TOTAL_LIMIT][(M6E_NANO_EPC_MAX_LEN * 2) + 1];
 	uint32_t total;
 };
 
@@ -22,21 +22,22 @@ static struct counter seen_tags = {
 	.total = 0,
 };
 
-void array_to_string(uint8_t *buf, char *str)
+void array_to_string(const uint8_t *buf, uint8_t len, char *str)
 {
 	char *ptr = &str[0];
 
-	for (int i = 0; i < 12; i++) {
+	*ptr = '\0';
+	for (int i = 0; i < len; i++) {
 		ptr += sprintf(ptr, "%02X", buf[i]);
 	}
 }
 
-void read_callback(const struct device *dev, void *user_data)
+void frame_work_handler(struct k_work *work)
 {
-	const struct device *m6e_nano_dev = user_data;
-	struct m6e_nano_data *drv_data = m6e_nano_dev->data;
+	const struct device *m6e_nano_dev = DEVICE_DT_GET_ONE(thingmagic_m6enano);
+	void *user_data = (void *)m6e_nano_dev;
 
-	if (drv_data->status == RESPONSE_SUCCESS) {
+	while (m6e_nano_next_frame(m6e_nano_dev)) {
 		int res = m6e_nano_parse_response(user_data);
 		char *res_str = "";
 		switch (res) {
@@ -50,19 +51,36 @@ void read_callback(const struct device *dev, void *user_data)
 		case RESPONSE_IS_TAGFOUND:
 			res_str = "RESPONSE_IS_TAGFOUND";
 
-			uint8_t rssi =
+			int8_t rssi =
 				m6e_nano_get_tag_rssi(user_data); // Get the RSSI for tag read
 			long freq = m6e_nano_get_tag_freq(
 				user_data); // Get the frequency tag was detected at
 			long timeStamp = m6e_nano_get_tag_timestamp(
 				user_data); // Get the time (ms) since last keep-alive
-			uint8_t tagEPCBytes = m6e_nano_get_tag_epc_bytes(user_data);
+			struct m6e_nano_tag tag;
+
+			// The EPC length comes from the PC word, it is not always 12 bytes
+			if (m6e_nano_get_tag(user_data, &tag) < 0) {
+				break;
+			}
+			uint8_t tagEPCBytes = tag.epc_len;
 
-			char new_tag_str[(12 * 2) + 1];
-			array_to_string(drv_data->response.data + 31, new_tag_str);
+			char new_tag_str[(M6E_NANO_EPC_MAX_LEN * 2) + 1];
+			array_to_string(tag.epc, tag.epc_len, new_tag_str);
 			printk("Tag found: %s\n", new_tag_str);
-			printk("rssi: -%ddBm | freq: %ldHz | timestamp: %ldms | size %d\n", rssi,
+#ifdef CONFIG_M6E_NANO_GS1
+			struct m6e_nano_gs1 gs1;
+
+			if (m6e_nano_get_tag_gs1(user_data, &gs1) == 0 &&
+			    gs1.header == M6E_NANO_GS1_SGTIN_96) {
+				printk("GTIN %014llu serial %llu\n",
+				       (unsigned long long)m6e_nano_gs1_key(&gs1),
+				       (unsigned long long)gs1.serial);
+			}
+#endif
+			printk("rssi: %ddBm | freq: %ldHz | timestamp: %ldms | size %d\n", rssi,
 			       freq, timeStamp, tagEPCBytes);
+			printk("Read at uptime %lldms\n", m6e_nano_get_tag_uptime(user_data));
 			int ret = 0;
 			for (size_t i = 0; i < seen_tags.total; i++) {
 				if (strcmp(seen_tags.tags[i], new_tag_str) == 0) {
@@ -87,11 +105,17 @@ void read_callback(const struct device *dev, void *user_data)
 			break;
 		}
 		LOG_INF("%s", res_str);
-
-		drv_data->status = RESPONSE_CLEAR;
 	}
 }
 
+K_WORK_DEFINE(frame_work, frame_work_handler);
+
+void read_callback(const struct device *dev, void *user_data)
+{
+	// Called from the UART ISR once per batch of frames, print them from a thread
+	k_work_submit(&frame_work);
+}
+
 int main(void)
 {
 	const struct device *dev = DEVICE_DT_GET_ONE(thingmagic_m6enano);
@@ -103,7 +127,11 @@ int main(void)
 	m6e_nano_set_baud(dev, 115200);
 
 	LOG_INF("Requesting hardware version...");
-	m6e_nano_get_version(dev);
+	struct m6e_nano_version version;
+
+	if (m6e_nano_get_version(dev, &version) == 0) {
+		LOG_INF("Hardware %08X, firmware %08X", version.hardware, version.fw_version);
+	}
 
 	LOG_INF("Setting tag protocol...");
 	m6e_nano_set_tag_protocol(dev, TMR_TAG_PROTOCOL_GEN2);
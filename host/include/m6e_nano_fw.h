@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_FW_H
+#define M6E_NANO_FW_H
+
+#include <stdint.h>
+
+#include "m6e_nano_posix.h"
+
+/*
+ * Module firmware update over a POSIX serial port, running m6e_nano_fw_flash() like the Zephyr
+ * driver's m6e_nano_update_firmware(): start the bootloader, raise the baud rate, erase the
+ * application flash, write the image in M6E_NANO_FW_CHUNK_LEN chunks, have the bootloader verify
+ * its CRC-32, then boot the new application. The image is read from its file a chunk at a time,
+ * each read overlapping the module writing the chunk before.
+ */
+
+/**
+ * @brief Update the firmware of a module that is not reading.
+ *
+ * @param port Open serial port.
+ * @param link Command engine over the port.
+ * @param fd Firmware image, read with pread().
+ * @param baud Baud rate of the transfer, kept once the application boots.
+ * @param stats Outcome of the update, may be NULL.
+ * @return int 0 on success, -EBADMSG if the file is not a complete firmware image, -EIO if the
+ * module reported an error or the image in its flash does not match, -ETIMEDOUT if it stopped
+ * answering, negative errno otherwise. The module stays in the bootloader if the update failed
+ * after starting it, and a new update picks up from there.
+ */
+int m6e_nano_fw_update(struct m6e_nano_posix *port, struct m6e_nano_link *link, int fd,
+		       uint32_t baud, struct m6e_nano_fw_stats *stats);
+
+#endif // M6E_NANO_FW_H
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_INDEX_H
+#define M6E_NANO_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "m6e_nano_watchlist.h"
+
+/*
+ * Builds the watchlist indexes the driver matches tag reads against, see m6e_nano_watchlist.h.
+ * The bucket table is sized for about two EPCs per bucket.
+ */
+
+/**
+ * @brief Build a watchlist index.
+ *
+ * @param epcs EPCs, count * epc_len bytes, in any order.
+ * @param data Value stored per EPC, NULL for 0.
+ * @param count Number of EPCs.
+ * @param epc_len EPC length in bytes.
+ * @param index Allocated index, free() it.
+ * @param size Size of the index.
+ * @return int 0 on success, -EINVAL for an invalid EPC length, -EEXIST if an EPC is listed
+ * twice, -ENOMEM if out of memory.
+ */
+int m6e_nano_index_build(const uint8_t *epcs, const uint32_t *data, uint32_t count,
+			 uint8_t epc_len, void **index, size_t *size);
+
+#endif // M6E_NANO_INDEX_H
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_POSIX_H
+#define M6E_NANO_POSIX_H
+
+#include <stdint.h>
+
+#include "m6e_nano_proto.h"
+
+/*
+ * Transport of the protocol core over a POSIX serial port, for Linux gateways. The port is set
+ * to raw 8N1 with termios and waited on with epoll, so a read with a timeout costs one
+ * epoll_wait() and one read() whatever the number of bytes available.
+ *
+ *   struct m6e_nano_posix port;
+ *   struct m6e_nano_link link;
+ *
+ *   m6e_nano_posix_open(&port, "/dev/ttyUSB0", 115200);
+ *   m6e_nano_link_init(&link, &port.transport, on_frame, NULL);
+ *   m6e_nano_link_command(&link, TMR_SR_OPCODE_VERSION, NULL, 0, 1000);
+ */
+
+struct m6e_nano_posix {
+	int fd;
+	int epfd;
+	struct m6e_nano_transport transport; // Pass to m6e_nano_link_init()
+};
+
+/**
+ * @brief Open a serial port.
+ *
+ * @param port Port state.
+ * @param path Device path, for example /dev/ttyUSB0 or the slave of a pty.
+ * @param baud Baud rate.
+ * @return int 0 on success, -EINVAL for an unsupported baud rate, negative errno otherwise.
+ */
+int m6e_nano_posix_open(struct m6e_nano_posix *port, const char *path, uint32_t baud);
+
+/**
+ * @brief Change the baud rate of an open port, after the module was told to with
+ * TMR_SR_OPCODE_SET_BAUD_RATE.
+ *
+ * @param port Port state.
+ * @param baud Baud rate.
+ * @return int 0 on success, -EINVAL for an unsupported baud rate, negative errno otherwise.
+ */
+int m6e_nano_posix_set_baud(struct m6e_nano_posix *port, uint32_t baud);
+
+/**
+ * @brief Close a serial port.
+ *
+ * @param port Port state.
+ */
+void m6e_nano_posix_close(struct m6e_nano_posix *port);
+
+#endif // M6E_NANO_POSIX_H
@@ -0,0 +1,595 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "m6e_nano_sim.h"
+
+// Status the module answers unknown opcodes with
+#define SIM_STATUS_INVALID_OPCODE 0x0101
+
+// Flash faults of the bootloader
+#define SIM_STATUS_BAD_ERASE_PASSWORD 0x0200
+#define SIM_STATUS_BAD_WRITE_PASSWORD 0x0201
+#define SIM_STATUS_ILLEGAL_SECTOR     0x0203
+#define SIM_STATUS_NON_ERASED_AREA    0x0204
+#define SIM_STATUS_VERIFY_FAILED      0x0206
+
+// Bootloader, hardware, firmware date, firmware version, supported protocols
+static const uint8_t sim_version[] = {
+	0x12, 0x03, 0x00, 0x00, 0x30, 0x00, 0x00, 0x02, 0x20, 0x23, 0x01, 0x16,
+	0x01, 0x09, 0x01, 0x00, 0x00, 0x00, 0x00, 0x10};
+
+/**
+ * @brief Monotonic time in ms.
+ *
+ * @return uint32_t Time in ms.
+ */
+static uint32_t _sim_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/**
+ * @brief Append the CRC to a frame and send it.
+ *
+ * @param sim Simulator state.
+ * @param frame Frame without its CRC, with room for it.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _sim_send(struct m6e_nano_sim *sim, uint8_t *frame)
+{
+	size_t len = frame[1] + M6E_NANO_FRAME_OVERHEAD;
+	uint16_t crc = m6e_nano_crc(&frame[1], len - 3);
+	size_t done = 0;
+
+	frame[len - 2] = crc >> 8;
+	frame[len - 1] = crc & 0xFF;
+
+	while (done < len) {
+		ssize_t ret = write(sim->master, frame + done, len - done);
+
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN) {
+				struct pollfd pfd = {.fd = sim->master, .events = POLLOUT};
+
+				poll(&pfd, 1, 100);
+				continue;
+			}
+			return -errno;
+		}
+		done += ret;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Send a response.
+ *
+ * @param sim Simulator state.
+ * @param opcode Opcode of the command answered.
+ * @param status Status, 0 on success.
+ * @param data Response data.
+ * @param len Length of the response data.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _sim_respond(struct m6e_nano_sim *sim, uint8_t opcode, uint16_t status,
+			const uint8_t *data, uint8_t len)
+{
+	uint8_t frame[M6E_NANO_FRAME_MAX];
+
+	frame[0] = TMR_START_HEADER;
+	frame[1] = len;
+	frame[2] = opcode;
+	frame[3] = status >> 8;
+	frame[4] = status & 0xFF;
+	if (len > 0) {
+		memcpy(&frame[5], data, len);
+	}
+
+	return _sim_send(sim, frame);
+}
+
+/**
+ * @brief Build a tag read frame with a 12-byte EPC ending with index.
+ *
+ * @param frame Destination, M6E_NANO_FRAME_MAX bytes.
+ * @param index Tag number, stored big-endian in the last 4 bytes of the EPC.
+ * @param timestamp Module time of the read in ms.
+ * @return size_t Length of the frame.
+ */
+size_t m6e_nano_sim_tag_frame(uint8_t *frame, uint32_t index, uint32_t timestamp)
+{
+	static const uint8_t epc_prefix[] = {0xE2, 0x00, 0x68, 0x16, 0x00, 0x00, 0x00, 0x00};
+	// Search flags, metadata flags, read count and RSSI of a streamed read
+	static const uint8_t head[] = {0x10, 0x00, 0x1B, 0x01, 0xFF, 0x01, 0x01};
+	uint32_t freq = 902750 + (index % 50) * 500;
+	uint16_t crc;
+
+	memset(frame, 0, 47);
+	frame[0] = TMR_START_HEADER;
+	frame[1] = 0x28;
+	frame[2] = TMR_SR_OPCODE_READ_TAG_ID_MULTIPLE;
+	memcpy(&frame[5], head, sizeof(head));
+	frame[12] = (uint8_t)(-40 - (int)(index % 30));
+	frame[13] = 0x11;
+	frame[14] = freq >> 16;
+	frame[15] = freq >> 8;
+	frame[16] = freq;
+	frame[17] = timestamp >> 24;
+	frame[18] = timestamp >> 16;
+	frame[19] = timestamp >> 8;
+	frame[20] = timestamp;
+	frame[21] = 0;
+	frame[22] = index % 180;
+	frame[23] = TMR_TAG_PROTOCOL_GEN2;
+	// No embedded tag data, then the EPC length in bits counting the PC and EPC CRC
+	frame[27] = 0x00;
+	frame[28] = 0x80;
+	frame[29] = 0x30;
+	frame[30] = 0x00;
+	memcpy(&frame[31], epc_prefix, sizeof(epc_prefix));
+	frame[39] = index >> 24;
+	frame[40] = index >> 16;
+	frame[41] = index >> 8;
+	frame[42] = index;
+	crc = ~m6e_nano_crc(&frame[31], 12);
+	frame[43] = crc >> 8;
+	frame[44] = crc & 0xFF;
+
+	crc = m6e_nano_crc(&frame[1], 44);
+	frame[45] = crc >> 8;
+	frame[46] = crc & 0xFF;
+
+	return 47;
+}
+
+/**
+ * @brief Answer a single tag read with tag 0, or no tag when the simulator reads none. Only the
+ * RSSI and antenna metadata are returned.
+ *
+ * @param sim Simulator state.
+ * @param cmd Command frame, from the header to the CRC.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _sim_read_single(struct m6e_nano_sim *sim, const uint8_t *cmd)
+{
+	uint8_t tag[M6E_NANO_FRAME_MAX];
+	uint8_t data[24];
+	uint16_t metadata = 0;
+	uint8_t len = 3;
+
+	if (sim->tags == 0) {
+		return _sim_respond(sim, TMR_SR_OPCODE_READ_TAG_ID_SINGLE, M6E_NANO_STATUS_NO_TAG,
+				    NULL, 0);
+	}
+	// [3-4] timeout, [5] option, [6-7] metadata
+	if (cmd[1] >= 5) {
+		metadata = ((cmd[6] << 8) | cmd[7]) &
+			   (M6E_NANO_METADATA_RSSI | M6E_NANO_METADATA_ANTENNA);
+	}
+
+	// Option with the metadata flag, metadata, then the PC, EPC and CRC of a tag read frame
+	m6e_nano_sim_tag_frame(tag, 0, 0);
+	data[0] = 0x10;
+	data[1] = metadata >> 8;
+	data[2] = metadata & 0xFF;
+	if (metadata & M6E_NANO_METADATA_RSSI) {
+		data[len++] = tag[12];
+	}
+	if (metadata & M6E_NANO_METADATA_ANTENNA) {
+		data[len++] = tag[13];
+	}
+	memcpy(&data[len], &tag[29], 16);
+	len += 16;
+
+	return _sim_respond(sim, TMR_SR_OPCODE_READ_TAG_ID_SINGLE, 0, data, len);
+}
+
+/**
+ * @brief Write a chunk of application image, in order after the previous one.
+ *
+ * @param sim Simulator state.
+ * @param cmd Command frame, from the header to the CRC.
+ * @return uint16_t Status of the response.
+ */
+static uint16_t _sim_write_flash(struct m6e_nano_sim *sim, const uint8_t *cmd)
+{
+	uint8_t prefix[M6E_NANO_FW_WRITE_PREFIX_LEN];
+	const uint8_t *data = &cmd[3];
+	uint8_t len = cmd[1];
+	uint32_t address;
+	uint32_t size;
+
+	if (len < sizeof(prefix)) {
+		return SIM_STATUS_INVALID_OPCODE;
+	}
+
+	m6e_nano_encode_write_flash(prefix, 0);
+	if (memcmp(data, prefix, 4) != 0) {
+		return SIM_STATUS_BAD_WRITE_PASSWORD;
+	}
+	if (data[8] != prefix[8]) {
+		return SIM_STATUS_ILLEGAL_SECTOR;
+	}
+
+	address = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) |
+		  ((uint32_t)data[6] << 8) | data[7];
+	size = len - sizeof(prefix);
+	// Flash is written once per erase, so chunks come in order
+	if (address != sim->flash_len || size > M6E_NANO_SIM_FLASH_SIZE - address) {
+		return SIM_STATUS_NON_ERASED_AREA;
+	}
+
+	memcpy(&sim->flash[address], &data[sizeof(prefix)], size);
+	sim->flash_len += size;
+
+	return 0;
+}
+
+/**
+ * @brief Answer a command in the bootloader.
+ *
+ * @param sim Simulator state.
+ * @param cmd Command frame, from the header to the CRC.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _sim_bootloader(struct m6e_nano_sim *sim, const uint8_t *cmd)
+{
+	uint8_t erase[M6E_NANO_FW_ERASE_LEN];
+	uint8_t opcode = cmd[2];
+	uint8_t program;
+	uint8_t crc[4];
+	uint32_t value;
+
+	switch (opcode) {
+	case TMR_SR_OPCODE_VERSION:
+		return _sim_respond(sim, opcode, 0, sim_version, sizeof(sim_version));
+	case TMR_SR_OPCODE_SET_BAUD_RATE:
+		return _sim_respond(sim, opcode, 0, NULL, 0);
+	case TMR_SR_OPCODE_GET_CURRENT_PROGRAM:
+		program = M6E_NANO_PROGRAM_BOOTLOADER;
+		return _sim_respond(sim, opcode, 0, &program, 1);
+	case TMR_SR_OPCODE_ERASE_FLASH:
+		m6e_nano_encode_erase_flash(erase);
+		if (cmd[1] != sizeof(erase) || memcmp(&cmd[3], erase, 4) != 0) {
+			return _sim_respond(sim, opcode, SIM_STATUS_BAD_ERASE_PASSWORD, NULL, 0);
+		}
+		if (cmd[7] != erase[4]) {
+			return _sim_respond(sim, opcode, SIM_STATUS_ILLEGAL_SECTOR, NULL, 0);
+		}
+		memset(sim->flash, 0xFF, M6E_NANO_SIM_FLASH_SIZE);
+		sim->flash_len = 0;
+		return _sim_respond(sim, opcode, 0, NULL, 0);
+	case TMR_SR_OPCODE_WRITE_FLASH_SECTOR:
+		return _sim_respond(sim, opcode, _sim_write_flash(sim, cmd), NULL, 0);
+	case TMR_SR_OPCODE_VERIFY_IMAGE_CRC:
+		value = m6e_nano_crc32(0, sim->flash, sim->flash_len);
+		crc[0] = value >> 24;
+		crc[1] = value >> 16;
+		crc[2] = value >> 8;
+		crc[3] = value;
+		return _sim_respond(sim, opcode, 0, crc, sizeof(crc));
+	case TMR_SR_OPCODE_BOOT_FIRMWARE:
+		if (sim->flash_len == 0) {
+			return _sim_respond(sim, opcode, SIM_STATUS_VERIFY_FAILED, NULL, 0);
+		}
+		// The application answers with its startup message
+		sim->bootloader = false;
+		sim->boots++;
+		return _sim_respond(sim, opcode, 0, sim_version, sizeof(sim_version));
+	default:
+		return _sim_respond(sim, opcode, SIM_STATUS_INVALID_OPCODE, NULL, 0);
+	}
+}
+
+/**
+ * @brief Answer a complete command frame.
+ *
+ * @param sim Simulator state.
+ * @param cmd Command frame, from the header to the CRC.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _sim_command(struct m6e_nano_sim *sim, const uint8_t *cmd)
+{
+	uint8_t opcode = cmd[2];
+	uint8_t len = cmd[1];
+	uint8_t program;
+
+	sim->commands++;
+
+	if (sim->bootloader) {
+		return _sim_bootloader(sim, cmd);
+	}
+
+	switch (opcode) {
+	case TMR_SR_OPCODE_VERSION:
+		return _sim_respond(sim, opcode, 0, sim_version, sizeof(sim_version));
+	case TMR_SR_OPCODE_GET_CURRENT_PROGRAM:
+		program = M6E_NANO_PROGRAM_APP;
+		return _sim_respond(sim, opcode, 0, &program, 1);
+	case TMR_SR_OPCODE_BOOT_BOOTLOADER:
+		sim->reading = false;
+		sim->bootloader = true;
+		return _sim_respond(sim, opcode, 0, NULL, 0);
+	case TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP:
+		if (len >= 3 && cmd[5] == 0x02) {
+			sim->reading = false;
+			return _sim_respond(sim, opcode, 0, &cmd[3], 3);
+		}
+		sim->reading = true;
+		sim->start_ms = _sim_now_ms();
+		sim->next_cycle_ms = sim->start_ms;
+		return _sim_respond(sim, opcode, 0, NULL, 0);
+	case TMR_SR_OPCODE_READ_TAG_ID_SINGLE:
+		return _sim_read_single(sim, cmd);
+	case TMR_SR_OPCODE_SET_BAUD_RATE:
+	case TMR_SR_OPCODE_SET_ANTENNA_PORT:
+	case TMR_SR_OPCODE_SET_TAG_PROTOCOL:
+	case TMR_SR_OPCODE_SET_READ_TX_POWER:
+	case TMR_SR_OPCODE_SET_WRITE_TX_POWER:
+	case TMR_SR_OPCODE_SET_FREQ_HOP_TABLE:
+	case TMR_SR_OPCODE_SET_REGION:
+	case TMR_SR_OPCODE_SET_POWER_MODE:
+	case TMR_SR_OPCODE_SET_READER_OPTIONAL_PARAMS:
+	case TMR_SR_OPCODE_SET_PROTOCOL_PARAM:
+		return _sim_respond(sim, opcode, 0, NULL, 0);
+	default:
+		return _sim_respond(sim, opcode, SIM_STATUS_INVALID_OPCODE, NULL, 0);
+	}
+}
+
+/**
+ * @brief Receive a byte of a command. Commands carry no status, so they are 5 bytes longer than
+ * their data rather than the 7 of the frames m6e_nano_rx_feed() takes.
+ *
+ * @param sim Simulator state.
+ * @param byte Byte received.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _sim_receive(struct m6e_nano_sim *sim, uint8_t byte)
+{
+	uint16_t crc;
+
+	if (sim->cmd_len == 0 && byte != TMR_START_HEADER) {
+		return 0;
+	}
+
+	sim->cmd[sim->cmd_len++] = byte;
+	if (sim->cmd_len < 2 || sim->cmd_len < sim->cmd[1] + 5) {
+		return 0;
+	}
+
+	sim->cmd_len = 0;
+	crc = m6e_nano_crc(&sim->cmd[1], sim->cmd[1] + 2);
+	if (sim->cmd[sim->cmd[1] + 3] != (crc >> 8) || sim->cmd[sim->cmd[1] + 4] != (crc & 0xFF)) {
+		return 0;
+	}
+
+	return _sim_command(sim, sim->cmd);
+}
+
+/**
+ * @brief Emit a read cycle.
+ *
+ * @param sim Simulator state.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _sim_cycle(struct m6e_nano_sim *sim)
+{
+	uint8_t frame[M6E_NANO_FRAME_MAX];
+	uint32_t timestamp = _sim_now_ms() - sim->start_ms;
+	int ret;
+
+	if (sim->tags == 0) {
+		// Keep-alives restart the module clock
+		sim->start_ms = _sim_now_ms();
+		frame[0] = TMR_START_HEADER;
+		frame[1] = 0;
+		frame[2] = TMR_SR_OPCODE_READ_TAG_ID_MULTIPLE;
+		frame[3] = M6E_NANO_STATUS_KEEPALIVE >> 8;
+		frame[4] = M6E_NANO_STATUS_KEEPALIVE & 0xFF;
+		return _sim_send(sim, frame);
+	}
+
+	for (uint16_t i = 0; i < sim->tags; i++) {
+		m6e_nano_sim_tag_frame(frame, i, timestamp);
+		ret = _sim_send(sim, frame);
+		if (ret < 0) {
+			return ret;
+		}
+		sim->tag_frames++;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Create a simulated module.
+ *
+ * @param sim Simulator state.
+ * @param tags Tags read per cycle, 0 for keep-alives only.
+ * @param cycle_ms Time between read cycles.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_sim_open(struct m6e_nano_sim *sim, uint16_t tags, uint32_t cycle_ms)
+{
+	struct termios tio;
+	int ret;
+
+	memset(sim, 0, sizeof(*sim));
+	sim->tags = tags;
+	sim->cycle_ms = cycle_ms;
+	sim->slave = -1;
+
+	sim->flash = malloc(M6E_NANO_SIM_FLASH_SIZE);
+	if (sim->flash == NULL) {
+		return -ENOMEM;
+	}
+	memset(sim->flash, 0xFF, M6E_NANO_SIM_FLASH_SIZE);
+
+	sim->master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+	if (sim->master < 0) {
+		ret = -errno;
+		goto fail;
+	}
+	if (grantpt(sim->master) < 0 || unlockpt(sim->master) < 0 ||
+	    ptsname_r(sim->master, sim->path, sizeof(sim->path)) != 0) {
+		ret = -errno;
+		goto fail;
+	}
+
+	// Raw on both sides, so frames pass unchanged
+	sim->slave = open(sim->path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+	if (sim->slave < 0 || tcgetattr(sim->slave, &tio) < 0) {
+		ret = -errno;
+		goto fail;
+	}
+	cfmakeraw(&tio);
+	if (tcsetattr(sim->slave, TCSANOW, &tio) < 0) {
+		ret = -errno;
+		goto fail;
+	}
+	fcntl(sim->master, F_SETFL, fcntl(sim->master, F_GETFL) | O_NONBLOCK);
+
+	return 0;
+
+fail:
+	m6e_nano_sim_close(sim);
+	return ret;
+}
+
+/**
+ * @brief Answer the commands received and emit the read cycles that are due.
+ *
+ * @param sim Simulator state.
+ * @param timeout_ms Longest wait for a command.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_sim_step(struct m6e_nano_sim *sim, int32_t timeout_ms)
+{
+	struct pollfd pfd = {.fd = sim->master, .events = POLLIN};
+	uint8_t buf[256];
+	uint32_t now = _sim_now_ms();
+	ssize_t len;
+	int ret;
+
+	if (sim->reading) {
+		int32_t due = (int32_t)(sim->next_cycle_ms - now);
+
+		if (due < timeout_ms) {
+			timeout_ms = due > 0 ? due : 0;
+		}
+	}
+
+	ret = poll(&pfd, 1, timeout_ms);
+	if (ret < 0 && errno != EINTR) {
+		return -errno;
+	}
+
+	if (ret > 0 && (pfd.revents & POLLIN)) {
+		len = read(sim->master, buf, sizeof(buf));
+		if (len < 0 && errno != EAGAIN && errno != EINTR) {
+			return -errno;
+		}
+
+		for (ssize_t i = 0; i < len; i++) {
+			ret = _sim_receive(sim, buf[i]);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+	}
+
+	now = _sim_now_ms();
+	if (sim->reading && (int32_t)(now - sim->next_cycle_ms) >= 0) {
+		sim->next_cycle_ms += sim->cycle_ms;
+		// Skip cycles missed while blocked, like a module that was not polled
+		if ((int32_t)(now - sim->next_cycle_ms) > 0) {
+			sim->next_cycle_ms = now + sim->cycle_ms;
+		}
+		return _sim_cycle(sim);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Simulator thread.
+ *
+ * @param arg Simulator state.
+ * @return void* NULL.
+ */
+static void *_sim_thread(void *arg)
+{
+	struct m6e_nano_sim *sim = arg;
+
+	while (sim->running) {
+		if (m6e_nano_sim_step(sim, 10) < 0) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Run the simulator on its own thread.
+ *
+ * @param sim Simulator state.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_sim_start(struct m6e_nano_sim *sim)
+{
+	int ret;
+
+	sim->running = true;
+	ret = pthread_create(&sim->thread, NULL, _sim_thread, sim);
+	if (ret != 0) {
+		sim->running = false;
+		return -ret;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Stop the simulator thread and close the pty.
+ *
+ * @param sim Simulator state.
+ */
+void m6e_nano_sim_close(struct m6e_nano_sim *sim)
+{
+	if (sim->running) {
+		sim->running = false;
+		pthread_join(sim->thread, NULL);
+	}
+	if (sim->slave >= 0) {
+		close(sim->slave);
+		sim->slave = -1;
+	}
+	if (sim->master >= 0) {
+		close(sim->master);
+		sim->master = -1;
+	}
+	free(sim->flash);
+	sim->flash = NULL;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_SIM_H
+#define M6E_NANO_SIM_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "m6e_nano_proto.h"
+
+/*
+ * Simulated M6E Nano behind a pseudo terminal. It answers the version, set, single read and
+ * start/stop reading commands, and while reading emits a read cycle of tag frames every cycle_ms,
+ * or a keep-alive for cycles without tags like the module does. Point a serial port at path.
+ *
+ * It also has a bootloader for firmware updates: the application flash is erased, written in
+ * order, its CRC-32 verified and booted as the bootloader opcodes say, with a startup message
+ * once booted.
+ */
+
+// Application flash of the simulated module
+#define M6E_NANO_SIM_FLASH_SIZE (512 * 1024)
+
+struct m6e_nano_sim {
+	int master;
+	int slave; // Kept open so the pty does not hang up between clients
+	char path[64];
+	uint8_t cmd[M6E_NANO_FRAME_MAX]; // Command being received, without status bytes
+	uint16_t cmd_len;
+
+	// Read cycles
+	uint16_t tags;     // Tags read per cycle
+	uint32_t cycle_ms; // Time between cycles
+	bool reading;
+	uint32_t start_ms;
+	uint32_t next_cycle_ms;
+	uint32_t tag_frames; // Tag frames sent
+	uint32_t commands;   // Commands received
+
+	// Bootloader
+	bool bootloader;     // Running the bootloader rather than the application
+	uint8_t *flash;      // M6E_NANO_SIM_FLASH_SIZE bytes
+	uint32_t flash_len;  // Bytes written since the last erase
+	uint32_t boots;      // Applications booted
+
+	pthread_t thread;
+	volatile bool running;
+};
+
+/**
+ * @brief Create a simulated module.
+ *
+ * @param sim Simulator state.
+ * @param tags Tags read per cycle, 0 for keep-alives only.
+ * @param cycle_ms Time between read cycles.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_sim_open(struct m6e_nano_sim *sim, uint16_t tags, uint32_t cycle_ms);
+
+/**
+ * @brief Answer the commands received and emit the read cycles that are due.
+ *
+ * @param sim Simulator state.
+ * @param timeout_ms Longest wait for a command.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_sim_step(struct m6e_nano_sim *sim, int32_t timeout_ms);
+
+/**
+ * @brief Run the simulator on its own thread.
+ *
+ * @param sim Simulator state.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int m6e_nano_sim_start(struct m6e_nano_sim *sim);
+
+/**
+ * @brief Stop the simulator thread and close the pty.
+ *
+ * @param sim Simulator state.
+ */
+void m6e_nano_sim_close(struct m6e_nano_sim *sim);
+
+/**
+ * @brief Build a tag read frame with a 12-byte EPC ending with index.
+ *
+ * @param frame Destination, M6E_NANO_FRAME_MAX bytes.
+ * @param index Tag number, stored big-endian in the last 4 bytes of the EPC.
+ * @param timestamp Module time of the read in ms.
+ * @return size_t Length of the frame.
+ */
+size_t m6e_nano_sim_tag_frame(uint8_t *frame, uint32_t index, uint32_t timestamp);
+
+#endif // M6E_NANO_SIM_H
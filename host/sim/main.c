@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "m6e_nano_sim.h"
+
+int main(int argc, char **argv)
+{
+	struct m6e_nano_sim sim;
+	uint16_t tags = argc > 1 ? atoi(argv[1]) : 10;
+	uint32_t cycle_ms = argc > 2 ? atoi(argv[2]) : 100;
+	int ret;
+
+	if (argc > 3) {
+		fprintf(stderr, "usage: %s [tags per cycle] [cycle ms]\n", argv[0]);
+		return 2;
+	}
+
+	ret = m6e_nano_sim_open(&sim, tags, cycle_ms);
+	if (ret < 0) {
+		fprintf(stderr, "Failed to open a pty: %s\n", strerror(-ret));
+		return 1;
+	}
+
+	printf("%s\n", sim.path);
+	fflush(stdout);
+
+	for (;;) {
+		ret = m6e_nano_sim_step(&sim, 1000);
+		if (ret < 0) {
+			fprintf(stderr, "Simulator stopped: %s\n", strerror(-ret));
+			break;
+		}
+	}
+
+	m6e_nano_sim_close(&sim);
+
+	return 1;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "m6e_nano_fw.h"
+
+// Port, command engine and image of an update in progress
+struct fw_ctx {
+	struct m6e_nano_posix *port;
+	struct m6e_nano_link *link;
+	int fd;
+};
+
+/**
+ * @brief Send an update command without waiting for its response.
+ *
+ * @param ctx Update in progress.
+ * @param opcode Opcode of the command.
+ * @param data Command data.
+ * @param len Length of the command data.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _fw_send(void *ctx, uint8_t opcode, const uint8_t *data, uint8_t len)
+{
+	struct fw_ctx *fw = ctx;
+
+	return m6e_nano_link_send(fw->link, opcode, data, len);
+}
+
+/**
+ * @brief Wait for the response to the update command sent.
+ *
+ * @param ctx Update in progress.
+ * @param opcode Opcode of the command.
+ * @param timeout_ms Longest wait for the response.
+ * @param frame Set to the response buffer.
+ * @return int 0 on success, -EIO if the module reported an error, negative errno otherwise.
+ */
+static int _fw_wait(void *ctx, uint8_t opcode, int32_t timeout_ms, const uint8_t **frame)
+{
+	struct fw_ctx *fw = ctx;
+
+	*frame = fw->link->rx.frame;
+
+	return m6e_nano_link_wait(fw->link, opcode, timeout_ms);
+}
+
+/**
+ * @brief Switch the module, then the port, to a baud rate.
+ *
+ * @param ctx Update in progress.
+ * @param baud Baud rate.
+ * @return int 0 on success, negative errno otherwise.
+ */
+static int _fw_set_baud(void *ctx, uint32_t baud)
+{
+	struct fw_ctx *fw = ctx;
+	uint8_t data[] = {baud >> 24, baud >> 16, baud >> 8, baud};
+	int ret;
+
+	// The module answers at the old rate, then listens at the new one
+	ret = m6e_nano_link_command(fw->link, TMR_SR_OPCODE_SET_BAUD_RATE, data, sizeof(data),
+				    M6E_NANO_FW_COMMAND_TIMEOUT_MS);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return m6e_nano_posix_set_baud(fw->port, baud);
+}
+
+/**
+ * @brief Read bytes of the image file.
+ *
+ * @param ctx Update in progress.
+ * @param offset Offset in the file.
+ * @param buf Destination.
+ * @param len Number of bytes.
+ * @return int 0 on success, -EBADMSG if the file ends first, negative errno otherwise.
+ */
+static int _fw_read(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+	struct fw_ctx *fw = ctx;
+
+	while (len > 0) {
+		ssize_t ret = pread(fw->fd, buf, len, offset);
+
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -errno;
+		}
+		if (ret == 0) {
+			return -EBADMSG;
+		}
+		buf += ret;
+		len -= ret;
+		offset += ret;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Monotonic time of the transport of the port.
+ *
+ * @param ctx Update in progress.
+ * @return uint32_t Time in ms.
+ */
+static uint32_t _fw_now_ms(void *ctx)
+{
+	struct fw_ctx *fw = ctx;
+
+	return fw->link->transport->now_ms(fw->link->transport->ctx);
+}
+
+/**
+ * @brief Update the firmware of a module that is not reading.
+ *
+ * @param port Open serial port.
+ * @param link Command engine over the port.
+ * @param fd Firmware image, read with pread().
+ * @param baud Baud rate of the transfer, kept once the application boots.
+ * @param stats Outcome of the update, may be NULL.
+ * @return int 0 on success, -EBADMSG if the file is not a complete firmware image, -EIO if the
+ * module reported an error or the image in its flash does not match, -ETIMEDOUT if it stopped
+ * answering, negative errno otherwise. The module stays in the bootloader if the update failed
+ * after starting it, and a new update picks up from there.
+ */
+int m6e_nano_fw_update(struct m6e_nano_posix *port, struct m6e_nano_link *link, int fd,
+		       uint32_t baud, struct m6e_nano_fw_stats *stats)
+{
+	struct fw_ctx ctx = {
+		.port = port,
+		.link = link,
+		.fd = fd,
+	};
+	const struct m6e_nano_fw_ops ops = {
+		.send = _fw_send,
+		.wait = _fw_wait,
+		.set_baud = _fw_set_baud,
+		.read = _fw_read,
+		.now_ms = _fw_now_ms,
+		.ctx = &ctx,
+	};
+	struct m6e_nano_fw_stats local;
+	uint8_t header[M6E_NANO_FW_HEADER_LEN];
+	uint8_t buf[M6E_NANO_FW_WRITE_LEN];
+	struct stat st;
+	uint32_t len;
+	int ret;
+
+	if (stats == NULL) {
+		stats = &local;
+	}
+	memset(stats, 0, sizeof(*stats));
+
+	// Check the whole image is there before the module is touched
+	ret = _fw_read(&ctx, 0, header, sizeof(header));
+	if (ret == 0) {
+		ret = m6e_nano_fw_header(header, &len);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+	if (fstat(fd, &st) < 0) {
+		return -errno;
+	}
+	if ((uint64_t)st.st_size < (uint64_t)M6E_NANO_FW_HEADER_LEN + len) {
+		return -EBADMSG;
+	}
+
+	ret = m6e_nano_fw_flash(&ops, len, baud, buf, stats);
+	if (ret < 0) {
+		return ret;
+	}
+
+	// Answered by the startup message of the new application
+	return m6e_nano_link_command(link, TMR_SR_OPCODE_BOOT_FIRMWARE, NULL, 0,
+				     M6E_NANO_FW_BOOT_TIMEOUT_MS);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "m6e_nano_index.h"
+#include "m6e_nano_proto.h"
+
+// Entry being sorted into the index
+struct index_entry {
+	uint32_t bucket;
+	uint32_t input; // Position in the input
+};
+
+struct index_input {
+	const uint8_t *epcs;
+	uint8_t epc_len;
+};
+
+/**
+ * @brief Order entries by bucket, then EPC.
+ *
+ * @param a First entry.
+ * @param b Second entry.
+ * @param ctx Input EPCs.
+ * @return int Negative, 0 or positive like memcmp().
+ */
+static int _index_compare(const void *a, const void *b, void *ctx)
+{
+	const struct index_entry *x = a;
+	const struct index_entry *y = b;
+	const struct index_input *input = ctx;
+	const uint8_t *epcs = input->epcs;
+	uint8_t epc_len = input->epc_len;
+
+	if (x->bucket != y->bucket) {
+		return x->bucket < y->bucket ? -1 : 1;
+	}
+
+	return memcmp(&epcs[(size_t)x->input * epc_len], &epcs[(size_t)y->input * epc_len],
+		      epc_len);
+}
+
+/**
+ * @brief Build a watchlist index.
+ *
+ * @param epcs EPCs, count * epc_len bytes, in any order.
+ * @param data Value stored per EPC, NULL for 0.
+ * @param count Number of EPCs.
+ * @param epc_len EPC length in bytes.
+ * @param index Allocated index, free() it.
+ * @param size Size of the index.
+ * @return int 0 on success, -EINVAL for an invalid EPC length, -EEXIST if an EPC is listed
+ * twice, -ENOMEM if out of memory.
+ */
+int m6e_nano_index_build(const uint8_t *epcs, const uint32_t *data, uint32_t count,
+			 uint8_t epc_len, void **index, size_t *size)
+{
+	struct index_input input = {.epcs = epcs, .epc_len = epc_len};
+	struct m6e_nano_watchlist_header *header;
+	struct index_entry *entries;
+	uint32_t *offsets;
+	uint32_t *values;
+	uint8_t *out_epcs;
+	uint8_t bucket_bits = 0;
+	int ret = 0;
+
+	if (epc_len == 0 || epc_len > M6E_NANO_EPC_MAX_LEN) {
+		return -EINVAL;
+	}
+
+	// About two EPCs per bucket
+	while (bucket_bits < M6E_NANO_WATCHLIST_MAX_BUCKET_BITS &&
+	       ((uint64_t)2 << bucket_bits) < count) {
+		bucket_bits++;
+	}
+
+	*size = m6e_nano_watchlist_size(count, epc_len, bucket_bits);
+	*index = calloc(1, *size);
+	entries = malloc(((size_t)count + 1) * sizeof(*entries));
+	if (*index == NULL || entries == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		entries[i].bucket = m6e_nano_watchlist_bucket(&epcs[(size_t)i * epc_len], epc_len,
+							       bucket_bits);
+		entries[i].input = i;
+	}
+	qsort_r(entries, count, sizeof(*entries), _index_compare, &input);
+
+	header = *index;
+	header->magic = M6E_NANO_WATCHLIST_MAGIC;
+	header->version = M6E_NANO_WATCHLIST_VERSION;
+	header->epc_len = epc_len;
+	header->bucket_bits = bucket_bits;
+	header->count = count;
+	offsets = (uint32_t *)(header + 1);
+	values = &offsets[(1U << bucket_bits) + 1];
+	out_epcs = (uint8_t *)&values[count];
+
+	for (uint32_t i = 0; i < count; i++) {
+		const struct index_entry *entry = &entries[i];
+
+		if (i > 0 && _index_compare(&entries[i - 1], entry, &input) == 0) {
+			ret = -EEXIST;
+			goto out;
+		}
+		memcpy(&out_epcs[(size_t)i * epc_len], &epcs[(size_t)entry->input * epc_len],
+		       epc_len);
+		values[i] = data != NULL ? data[entry->input] : 0;
+		// The bucket of entry i ends after it, as far as known
+		offsets[entry->bucket + 1] = i + 1;
+	}
+
+	// Empty buckets start where the previous one ended
+	for (uint32_t b = 1; b <= (1U << bucket_bits); b++) {
+		if (offsets[b] < offsets[b - 1]) {
+			offsets[b] = offsets[b - 1];
+		}
+	}
+
+out:
+	free(entries);
+	if (ret < 0) {
+		free(*index);
+		*index = NULL;
+	}
+
+	return ret;
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "m6e_nano_posix.h"
+
+/**
+ * @brief Map a baud rate to its termios speed.
+ *
+ * @param baud Baud rate.
+ * @param speed Termios speed.
+ * @return int 0 on success, -EINVAL for an unsupported baud rate.
+ */
+static int _posix_speed(uint32_t baud, speed_t *speed)
+{
+	static const struct {
+		uint32_t baud;
+		speed_t speed;
+	} speeds[] = {
+		{9600, B9600},     {19200, B19200},   {38400, B38400},   {57600, B57600},
+		{115200, B115200}, {230400, B230400}, {460800, B460800}, {921600, B921600},
+	};
+
+	for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+		if (speeds[i].baud == baud) {
+			*speed = speeds[i].speed;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * @brief Write bytes to the module.
+ *
+ * @param ctx Port state.
+ * @param buf Bytes to write.
+ * @param len Number of bytes.
+ * @return int 0 once every byte is written, negative errno otherwise.
+ */
+static int _posix_write(void *ctx, const uint8_t *buf, size_t len)
+{
+	struct m6e_nano_posix *port = ctx;
+
+	while (len > 0) {
+		ssize_t ret = write(port->fd, buf, len);
+
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -errno;
+		}
+		buf += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Read the bytes available, waiting up to timeout_ms for the first one.
+ *
+ * @param ctx Port state.
+ * @param buf Destination.
+ * @param len Size of the destination.
+ * @param timeout_ms Longest wait.
+ * @return int Number of bytes read, 0 on timeout, negative errno otherwise.
+ */
+static int _posix_read(void *ctx, uint8_t *buf, size_t len, int32_t timeout_ms)
+{
+	struct m6e_nano_posix *port = ctx;
+	struct epoll_event event;
+	ssize_t ret;
+
+	ret = epoll_wait(port->epfd, &event, 1, timeout_ms);
+	if (ret < 0) {
+		return errno == EINTR ? 0 : -errno;
+	}
+	if (ret == 0) {
+		return 0;
+	}
+
+	ret = read(port->fd, buf, len);
+	if (ret < 0) {
+		return errno == EAGAIN || errno == EINTR ? 0 : -errno;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Monotonic time in ms.
+ *
+ * @param ctx Port state.
+ * @return uint32_t Time in ms.
+ */
+static uint32_t _posix_now_ms(void *ctx)
+{
+	struct timespec ts;
+
+	(void)ctx;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/**
+ * @brief Change the baud rate of an open port, after the module was told to with
+ * TMR_SR_OPCODE_SET_BAUD_RATE.
+ *
+ * @param port Port state.
+ * @param baud Baud rate.
+ * @return int 0 on success, -EINVAL for an unsupported baud rate, negative errno otherwise.
+ */
+int m6e_nano_posix_set_baud(struct m6e_nano_posix *port, uint32_t baud)
+{
+	struct termios tio;
+	speed_t speed;
+	int ret;
+
+	ret = _posix_speed(baud, &speed);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (tcgetattr(port->fd, &tio) < 0) {
+		return -errno;
+	}
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	if (tcsetattr(port->fd, TCSADRAIN, &tio) < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Open a serial port.
+ *
+ * @param port Port state.
+ * @param path Device path, for example /dev/ttyUSB0 or the slave of a pty.
+ * @param baud Baud rate.
+ * @return int 0 on success, -EINVAL for an unsupported baud rate, negative errno otherwise.
+ */
+int m6e_nano_posix_open(struct m6e_nano_posix *port, const char *path, uint32_t baud)
+{
+	struct epoll_event event = {.events = EPOLLIN};
+	struct termios tio;
+	speed_t speed;
+	int ret;
+
+	ret = _posix_speed(baud, &speed);
+	if (ret < 0) {
+		return ret;
+	}
+
+	memset(port, 0, sizeof(*port));
+	port->epfd = -1;
+	port->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (port->fd < 0) {
+		return -errno;
+	}
+
+	// Raw 8N1, without flow control, reads return what is available
+	if (tcgetattr(port->fd, &tio) < 0) {
+		ret = -errno;
+		goto fail;
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	if (tcsetattr(port->fd, TCSANOW, &tio) < 0) {
+		ret = -errno;
+		goto fail;
+	}
+	tcflush(port->fd, TCIOFLUSH);
+
+	port->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (port->epfd < 0 || epoll_ctl(port->epfd, EPOLL_CTL_ADD, port->fd, &event) < 0) {
+		ret = -errno;
+		goto fail;
+	}
+
+	port->transport.write = _posix_write;
+	port->transport.read = _posix_read;
+	port->transport.now_ms = _posix_now_ms;
+	port->transport.ctx = port;
+
+	return 0;
+
+fail:
+	m6e_nano_posix_close(port);
+	return ret;
+}
+
+/**
+ * @brief Close a serial port.
+ *
+ * @param port Port state.
+ */
+void m6e_nano_posix_close(struct m6e_nano_posix *port)
+{
+	if (port->epfd >= 0) {
+		close(port->epfd);
+		port->epfd = -1;
+	}
+	if (port->fd >= 0) {
+		close(port->fd);
+		port->fd = -1;
+	}
+}
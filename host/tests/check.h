@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef M6E_NANO_CHECK_H
+#define M6E_NANO_CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Fail the test with the location and the condition that did not hold
+#define CHECK(cond)                                                                               \
+	do {                                                                                       \
+		if (!(cond)) {                                                                     \
+			fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+			exit(1);                                                                   \
+		}                                                                                  \
+	} while (0)
+
+#endif // M6E_NANO_CHECK_H
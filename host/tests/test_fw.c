@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "m6e_nano_fw.h"
+#include "m6e_nano_sim.h"
+
+// Not a multiple of the chunk length, so the last chunk is short
+#define IMAGE_LEN 100003
+
+static uint8_t image[M6E_NANO_FW_HEADER_LEN + IMAGE_LEN];
+
+/**
+ * @brief Write a firmware image to a temporary file.
+ *
+ * @param len Length of the file, up to sizeof(image).
+ * @return FILE* Open file.
+ */
+static FILE *_image_file(size_t len)
+{
+	static const uint8_t magic[] = {0x54, 0x4D, 0x2D, 0x53, 0x50, 0x61,
+					0x69, 0x6B, 0x00, 0x00, 0x00, 0x02};
+	FILE *file = tmpfile();
+
+	CHECK(file != NULL);
+	memcpy(image, magic, sizeof(magic));
+	image[12] = (IMAGE_LEN >> 24) & 0xFF;
+	image[13] = (IMAGE_LEN >> 16) & 0xFF;
+	image[14] = (IMAGE_LEN >> 8) & 0xFF;
+	image[15] = IMAGE_LEN & 0xFF;
+	for (size_t i = M6E_NANO_FW_HEADER_LEN; i < sizeof(image); i++) {
+		image[i] = (uint8_t)(i * 7 + (i >> 8));
+	}
+	CHECK(fwrite(image, 1, len, file) == len);
+	CHECK(fflush(file) == 0);
+
+	return file;
+}
+
+/**
+ * @brief Run an update against a simulated module.
+ *
+ * @param sim Simulator, not started.
+ * @param file Firmware image.
+ * @param stats Outcome of the update.
+ * @return int Result of the update.
+ */
+static int _update(struct m6e_nano_sim *sim, FILE *file, struct m6e_nano_fw_stats *stats)
+{
+	struct m6e_nano_posix port;
+	struct m6e_nano_link link;
+	int ret;
+
+	CHECK(m6e_nano_sim_start(sim) == 0);
+	CHECK(m6e_nano_posix_open(&port, sim->path, 115200) == 0);
+	m6e_nano_link_init(&link, &port.transport, NULL, NULL);
+
+	ret = m6e_nano_fw_update(&port, &link, fileno(file), 921600, stats);
+
+	// The application runs the new image at the transfer baud rate
+	if (ret == 0) {
+		CHECK(m6e_nano_link_command(&link, TMR_SR_OPCODE_GET_CURRENT_PROGRAM, NULL, 0,
+					    1000) == 0);
+		CHECK(link.rx.frame[5] == M6E_NANO_PROGRAM_APP);
+	}
+
+	m6e_nano_posix_close(&port);
+
+	return ret;
+}
+
+/**
+ * @brief Update from the application, through the bootloader and back.
+ */
+static void test_update(void)
+{
+	struct m6e_nano_sim sim;
+	struct m6e_nano_fw_stats stats;
+	FILE *file = _image_file(sizeof(image));
+
+	CHECK(m6e_nano_sim_open(&sim, 0, 100) == 0);
+	CHECK(_update(&sim, file, &stats) == 0);
+
+	CHECK(sim.boots == 1 && !sim.bootloader);
+	CHECK(sim.flash_len == IMAGE_LEN);
+	CHECK(memcmp(sim.flash, &image[M6E_NANO_FW_HEADER_LEN], IMAGE_LEN) == 0);
+	CHECK(stats.bytes == IMAGE_LEN);
+	CHECK(stats.chunks == (IMAGE_LEN + M6E_NANO_FW_CHUNK_LEN - 1) / M6E_NANO_FW_CHUNK_LEN);
+	CHECK(stats.crc == m6e_nano_crc32(0, &image[M6E_NANO_FW_HEADER_LEN], IMAGE_LEN));
+	CHECK(stats.baud == 921600);
+	printf("%u bytes in %u chunks, %u ms, %u bytes/s\n", stats.bytes, stats.chunks,
+	       stats.write_ms, stats.bytes_per_s);
+
+	m6e_nano_sim_close(&sim);
+	fclose(file);
+}
+
+/**
+ * @brief A module left in the bootloader by a failed update.
+ */
+static void test_resume(void)
+{
+	struct m6e_nano_sim sim;
+	FILE *file = _image_file(sizeof(image));
+
+	CHECK(m6e_nano_sim_open(&sim, 0, 100) == 0);
+	sim.bootloader = true;
+	sim.flash_len = 1000;
+	CHECK(_update(&sim, file, NULL) == 0);
+	CHECK(sim.boots == 1 && sim.flash_len == IMAGE_LEN);
+
+	m6e_nano_sim_close(&sim);
+	fclose(file);
+}
+
+/**
+ * @brief Files that are not complete images never reach the module.
+ */
+static void test_bad_image(void)
+{
+	FILE *files[] = {_image_file(sizeof(image) - 1), _image_file(sizeof(image))};
+
+	// Truncated, then without the magic
+	CHECK(pwrite(fileno(files[1]), "XX", 2, 0) == 2);
+
+	for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+		struct m6e_nano_sim sim;
+
+		CHECK(m6e_nano_sim_open(&sim, 0, 100) == 0);
+		CHECK(_update(&sim, files[i], NULL) == -EBADMSG);
+		m6e_nano_sim_close(&sim);
+		CHECK(sim.commands == 0);
+		fclose(files[i]);
+	}
+}
+
+int main(void)
+{
+	test_update();
+	test_resume();
+	test_bad_image();
+
+	printf("test_fw: OK\n");
+
+	return 0;
+}
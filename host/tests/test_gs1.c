@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "check.h"
+#include "m6e_nano_gs1.h"
+
+#define READS 1000000
+#define SKUS  64
+
+// Examples of the GS1 EPC Tag Data Standard, company prefix 0614141
+static const uint8_t sgtin[] = {0x30, 0x74, 0x25, 0x7B, 0xF7, 0x19,
+				0x4E, 0x40, 0x00, 0x00, 0x1A, 0x85};
+static const uint8_t sscc[] = {0x31, 0x74, 0x25, 0x7B, 0xF4, 0x49,
+			       0x96, 0x02, 0xD2, 0x00, 0x00, 0x00};
+static const uint8_t sgln[] = {0x32, 0x74, 0x25, 0x7B, 0xF4, 0x60,
+			       0x72, 0x00, 0x00, 0x00, 0x16, 0x2E};
+static const uint8_t grai[] = {0x33, 0x74, 0x25, 0x7B, 0xF4, 0x0C,
+			       0x0E, 0x40, 0x00, 0x00, 0x16, 0x2E};
+
+/**
+ * @brief Fields and keys of each scheme.
+ */
+static void test_decode(void)
+{
+	struct m6e_nano_gs1 gs1;
+
+	CHECK(m6e_nano_gs1_decode(sgtin, sizeof(sgtin), &gs1) == 0);
+	CHECK(gs1.header == M6E_NANO_GS1_SGTIN_96 && gs1.filter == 3);
+	CHECK(gs1.company == 614141 && gs1.company_digits == 7);
+	CHECK(gs1.reference == 812345 && gs1.reference_digits == 6);
+	CHECK(gs1.serial == 6789);
+	CHECK(m6e_nano_gs1_key(&gs1) == 80614141123458ULL);
+
+	CHECK(m6e_nano_gs1_decode(sscc, sizeof(sscc), &gs1) == 0);
+	CHECK(gs1.reference == 1234567890 && gs1.reference_digits == 10 && gs1.serial == 0);
+	CHECK(m6e_nano_gs1_key(&gs1) == 106141412345678908ULL);
+
+	CHECK(m6e_nano_gs1_decode(sgln, sizeof(sgln), &gs1) == 0);
+	CHECK(gs1.reference == 12345 && gs1.reference_digits == 5 && gs1.serial == 5678);
+	CHECK(m6e_nano_gs1_key(&gs1) == 614141123452ULL);
+
+	CHECK(m6e_nano_gs1_decode(grai, sizeof(grai), &gs1) == 0);
+	CHECK(gs1.reference == 12345 && gs1.serial == 5678);
+	CHECK(m6e_nano_gs1_key(&gs1) == 614141123452ULL);
+}
+
+/**
+ * @brief EPCs that are not GS1, or not valid GS1.
+ */
+static void test_invalid(void)
+{
+	uint8_t epc[sizeof(sgtin)];
+	struct m6e_nano_gs1 gs1;
+
+	memcpy(epc, sgtin, sizeof(epc));
+	CHECK(m6e_nano_gs1_decode(epc, 8, &gs1) == -ENOTSUP);
+
+	// Manufacturer default EPC
+	epc[0] = 0xE2;
+	CHECK(m6e_nano_gs1_decode(epc, sizeof(epc), &gs1) == -ENOTSUP);
+	epc[0] = M6E_NANO_GS1_SGTIN_96;
+
+	// Partition 7
+	epc[1] |= 0x1C;
+	CHECK(m6e_nano_gs1_decode(epc, sizeof(epc), &gs1) == -EBADMSG);
+
+	// Partition 5, 24-bit company prefix of all ones, 8 digits
+	epc[1] = 0x77;
+	epc[2] = 0xFF;
+	epc[3] = 0xFF;
+	epc[4] |= 0xFC;
+	CHECK(m6e_nano_gs1_decode(epc, sizeof(epc), &gs1) == -EBADMSG);
+}
+
+/**
+ * @brief Reads counted per GTIN, with the table full.
+ */
+static void test_skus(void)
+{
+	struct m6e_nano_sku skus[SKUS] = {0};
+	struct timespec start, end;
+	struct m6e_nano_gs1 gs1;
+	uint8_t epc[sizeof(sgtin)];
+	uint32_t reads = 0;
+	double ns;
+
+	memcpy(epc, sgtin, sizeof(epc));
+
+	// Item references 812345 to 812345 + SKUS - 1, each with serials 0 to 255
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (uint32_t n = 0; n < READS; n++) {
+		uint32_t item = 812345 + n % SKUS;
+
+		epc[4] = (epc[4] & 0xFC) | (item >> 18);
+		epc[5] = item >> 10;
+		epc[6] = item >> 2;
+		epc[7] = (item << 6) | (epc[7] & 0x3F);
+		epc[11] = n / SKUS;
+		CHECK(m6e_nano_gs1_decode(epc, sizeof(epc), &gs1) == 0);
+		CHECK(m6e_nano_sku_count(skus, SKUS, m6e_nano_gs1_key(&gs1)) == 0);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / READS;
+	printf("%u reads, %.0f ns per read\n", READS, ns);
+
+	for (uint32_t i = 0; i < SKUS; i++) {
+		CHECK(skus[i].key != 0);
+		CHECK(skus[i].reads == READS / SKUS || skus[i].reads == READS / SKUS + 1);
+		reads += skus[i].reads;
+	}
+	CHECK(reads == READS);
+	CHECK(m6e_nano_sku_count(skus, SKUS, 80614141123458ULL) == 0);
+	CHECK(m6e_nano_sku_count(skus, SKUS, 80614141999993ULL) == -ENOSPC);
+}
+
+int main(void)
+{
+	test_decode();
+	test_invalid();
+	test_skus();
+
+	printf("test_gs1: OK\n");
+
+	return 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "m6e_nano_posix.h"
+#include "m6e_nano_sim.h"
+
+struct frames {
+	unsigned int tags;
+	unsigned int keepalives;
+	unsigned int bad;
+};
+
+static void _count_frame(const uint8_t *frame, void *user_data)
+{
+	struct frames *frames = user_data;
+	struct m6e_nano_tag tag;
+
+	if (m6e_nano_frame_status(frame) == M6E_NANO_STATUS_KEEPALIVE) {
+		frames->keepalives++;
+	} else if (m6e_nano_decode_tag(frame, &tag) == 0 && tag.epc_len == 12) {
+		frames->tags++;
+	} else {
+		frames->bad++;
+	}
+}
+
+/**
+ * @brief Commands, a read stream and its end over a pty, through the POSIX transport.
+ */
+static void test_stream(void)
+{
+	struct m6e_nano_sim sim;
+	struct m6e_nano_posix port;
+	struct m6e_nano_link link;
+	struct m6e_nano_version version;
+	struct frames frames = {0};
+	uint8_t search[M6E_NANO_START_SEARCH_LEN];
+	uint8_t stop[] = {0x00, 0x00, 0x02};
+
+	CHECK(m6e_nano_sim_open(&sim, 20, 20) == 0);
+	CHECK(m6e_nano_sim_start(&sim) == 0);
+	CHECK(m6e_nano_posix_open(&port, sim.path, 115200) == 0);
+	m6e_nano_link_init(&link, &port.transport, _count_frame, &frames);
+
+	CHECK(m6e_nano_link_command(&link, TMR_SR_OPCODE_VERSION, NULL, 0, 1000) == 0);
+	CHECK(m6e_nano_decode_version(link.rx.frame, &version) == 0);
+	CHECK(version.hardware == 0x30000002);
+
+	CHECK(m6e_nano_link_command(&link, TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP, search,
+				    m6e_nano_encode_start_search(search, TMR_SR_TM_OPTION_CONTINUOUS),
+				    1000) == 0);
+	CHECK(m6e_nano_link_poll(&link, 200) > 0);
+
+	// Tag frames still in flight go to the callback until the stop is answered
+	CHECK(m6e_nano_link_command(&link, TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP, stop, sizeof(stop),
+				    1000) == 0);
+	CHECK(frames.tags >= 20);
+	CHECK(frames.tags % 20 == 0);
+	CHECK(frames.bad == 0);
+	CHECK(link.rx.crc_errors == 0);
+	CHECK(m6e_nano_link_poll(&link, 100) == 0);
+
+	// Errors reported by the module
+	CHECK(m6e_nano_link_command(&link, TMR_SR_OPCODE_KILL_TAG, NULL, 0, 1000) == -EIO);
+
+	m6e_nano_posix_close(&port);
+	m6e_nano_sim_close(&sim);
+}
+
+/**
+ * @brief Keep-alives of a read stream without tags.
+ */
+static void test_keepalive(void)
+{
+	struct m6e_nano_sim sim;
+	struct m6e_nano_posix port;
+	struct m6e_nano_link link;
+	struct frames frames = {0};
+	uint8_t search[M6E_NANO_START_SEARCH_LEN];
+
+	CHECK(m6e_nano_sim_open(&sim, 0, 20) == 0);
+	CHECK(m6e_nano_sim_start(&sim) == 0);
+	CHECK(m6e_nano_posix_open(&port, sim.path, 115200) == 0);
+	m6e_nano_link_init(&link, &port.transport, _count_frame, &frames);
+
+	CHECK(m6e_nano_link_command(&link, TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP, search,
+				    m6e_nano_encode_start_search(search, TMR_SR_TM_OPTION_CONTINUOUS),
+				    1000) == 0);
+	CHECK(m6e_nano_link_poll(&link, 200) > 0);
+	CHECK(frames.keepalives > 0);
+	CHECK(frames.tags == 0);
+
+	m6e_nano_posix_close(&port);
+	m6e_nano_sim_close(&sim);
+}
+
+/**
+ * @brief Single tag reads, with and without a tag in the field.
+ */
+static void test_read_single(void)
+{
+	struct m6e_nano_sim sim;
+	struct m6e_nano_posix port;
+	struct m6e_nano_link link;
+	struct m6e_nano_tag tag;
+	uint8_t data[32];
+	int len;
+
+	CHECK(m6e_nano_sim_open(&sim, 1, 20) == 0);
+	CHECK(m6e_nano_sim_start(&sim) == 0);
+	CHECK(m6e_nano_posix_open(&port, sim.path, 115200) == 0);
+	m6e_nano_link_init(&link, &port.transport, NULL, NULL);
+
+	len = m6e_nano_encode_read_single(data, sizeof(data), 100,
+					  M6E_NANO_METADATA_RSSI | M6E_NANO_METADATA_ANTENNA, NULL);
+	CHECK(m6e_nano_link_command(&link, TMR_SR_OPCODE_READ_TAG_ID_SINGLE, data, len, 1000) == 0);
+	CHECK(m6e_nano_decode_single(link.rx.frame, &tag) == 0);
+	CHECK(tag.antenna == 0x11);
+	CHECK(tag.rssi == -40);
+	CHECK(tag.epc_len == 12);
+	CHECK(memcmp(tag.epc, "\xE2\x00\x68\x16", 4) == 0);
+
+	m6e_nano_posix_close(&port);
+	m6e_nano_sim_close(&sim);
+
+	CHECK(m6e_nano_sim_open(&sim, 0, 20) == 0);
+	CHECK(m6e_nano_sim_start(&sim) == 0);
+	CHECK(m6e_nano_posix_open(&port, sim.path, 115200) == 0);
+	m6e_nano_link_init(&link, &port.transport, NULL, NULL);
+
+	CHECK(m6e_nano_link_command(&link, TMR_SR_OPCODE_READ_TAG_ID_SINGLE, data, len, 1000) ==
+	      -EIO);
+	CHECK(m6e_nano_frame_status(link.rx.frame) == M6E_NANO_STATUS_NO_TAG);
+
+	m6e_nano_posix_close(&port);
+	m6e_nano_sim_close(&sim);
+}
+
+/**
+ * @brief A module that does not answer.
+ */
+static void test_timeout(void)
+{
+	struct m6e_nano_sim sim;
+	struct m6e_nano_posix port;
+	struct m6e_nano_link link;
+
+	// Nothing services the pty
+	CHECK(m6e_nano_sim_open(&sim, 0, 20) == 0);
+	CHECK(m6e_nano_posix_open(&port, sim.path, 115200) == 0);
+	m6e_nano_link_init(&link, &port.transport, NULL, NULL);
+
+	CHECK(m6e_nano_link_command(&link, TMR_SR_OPCODE_VERSION, NULL, 0, 50) == -ETIMEDOUT);
+
+	m6e_nano_posix_close(&port);
+	m6e_nano_sim_close(&sim);
+}
+
+int main(void)
+{
+	struct m6e_nano_posix port;
+
+	CHECK(m6e_nano_posix_open(&port, "/dev/null", 12345) == -EINVAL);
+
+	test_stream();
+	test_keepalive();
+	test_read_single();
+	test_timeout();
+
+	printf("test_link: OK\n");
+
+	return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "m6e_nano_proto.h"
+#include "m6e_nano_sim.h"
+
+static void test_frame_encode(void)
+{
+	uint8_t frame[8];
+
+	// The version command every host library sends first
+	CHECK(m6e_nano_frame_encode(frame, sizeof(frame), TMR_SR_OPCODE_VERSION, NULL, 0) == 5);
+	CHECK(memcmp(frame, "\xFF\x00\x03\x1D\x0C", 5) == 0);
+
+	CHECK(m6e_nano_frame_encode(frame, 4, TMR_SR_OPCODE_VERSION, NULL, 0) == -ENOMEM);
+}
+
+static void test_rx_split_and_garbage(void)
+{
+	uint8_t stream[3 + 2 * 47];
+	struct m6e_nano_rx rx;
+	size_t len = 0;
+	int frames = 0;
+
+	stream[len++] = 0x00;
+	stream[len++] = 0x12;
+	stream[len++] = 0x34;
+	len += m6e_nano_sim_tag_frame(&stream[len], 1, 100);
+	len += m6e_nano_sim_tag_frame(&stream[len], 2, 200);
+
+	m6e_nano_rx_reset(&rx);
+	rx.skipped = 0;
+	rx.crc_errors = 0;
+
+	// One byte at a time, as a slow serial port hands them over
+	for (size_t pos = 0; pos < len;) {
+		bool complete;
+
+		pos += m6e_nano_rx_feed(&rx, &stream[pos], 1, &complete);
+		if (complete) {
+			CHECK(m6e_nano_frame_crc_ok(rx.frame));
+			frames++;
+		}
+	}
+
+	CHECK(frames == 2);
+	CHECK(rx.skipped == 3);
+	CHECK(rx.crc_errors == 0);
+}
+
+static void test_rx_bad_crc(void)
+{
+	uint8_t stream[2 * 47];
+	struct m6e_nano_rx rx;
+	bool complete;
+	size_t pos;
+
+	m6e_nano_sim_tag_frame(stream, 1, 100);
+	m6e_nano_sim_tag_frame(&stream[47], 2, 200);
+	stream[40] ^= 0x01;
+
+	m6e_nano_rx_reset(&rx);
+	rx.skipped = 0;
+	rx.crc_errors = 0;
+
+	// The corrupted frame is dropped and the next one still comes through
+	pos = m6e_nano_rx_feed(&rx, stream, sizeof(stream), &complete);
+	CHECK(complete);
+	CHECK(pos == sizeof(stream));
+	CHECK(rx.crc_errors == 1);
+	CHECK(rx.frame[42] == 2);
+}
+
+static void test_tap(void)
+{
+	uint8_t rate[] = {0x00, 0x0E, 0x10, 0x00};
+	uint8_t stream[64];
+	struct m6e_nano_tap tap;
+	bool complete;
+	size_t len = 0;
+	size_t pos = 0;
+	int frames = 0;
+
+	// Commands in both directions of a bridge, with a stray byte and a corrupted command
+	len += m6e_nano_frame_encode(&stream[len], sizeof(stream) - len,
+				     TMR_SR_OPCODE_SET_BAUD_RATE, rate, sizeof(rate));
+	stream[len++] = 0x55;
+	len += m6e_nano_frame_encode(&stream[len], sizeof(stream) - len,
+				     TMR_SR_OPCODE_SET_BAUD_RATE, rate, sizeof(rate));
+	stream[len - 1] ^= 0x01;
+	len += m6e_nano_frame_encode(&stream[len], sizeof(stream) - len, TMR_SR_OPCODE_VERSION,
+				     NULL, 0);
+
+	m6e_nano_tap_init(&tap, M6E_NANO_COMMAND_OVERHEAD);
+	while (pos < len) {
+		pos += m6e_nano_tap_feed(&tap, &stream[pos], len - pos, &complete);
+		if (complete) {
+			CHECK(tap.frame[2] == (frames == 0 ? TMR_SR_OPCODE_SET_BAUD_RATE
+							   : TMR_SR_OPCODE_VERSION));
+			frames++;
+		}
+	}
+
+	CHECK(frames == 2);
+	CHECK(tap.frames == 2 && tap.crc_errors == 1 && tap.skipped == 1);
+	CHECK(tap.bytes == len);
+
+	// Frames from the module carry a status
+	m6e_nano_tap_init(&tap, M6E_NANO_FRAME_OVERHEAD);
+	len = m6e_nano_sim_tag_frame(stream, 1, 100);
+	CHECK(m6e_nano_tap_feed(&tap, stream, len, &complete) == len);
+	CHECK(complete && tap.frames == 1);
+}
+
+static void test_decode_tag(void)
+{
+	uint8_t frame[M6E_NANO_FRAME_MAX];
+	struct m6e_nano_tag tag;
+
+	m6e_nano_sim_tag_frame(frame, 0x01020304, 12345);
+
+	CHECK(m6e_nano_decode_tag(frame, &tag) == 0);
+	CHECK(tag.epc_len == 12);
+	CHECK(memcmp(&tag.epc[8], "\x01\x02\x03\x04", 4) == 0);
+	CHECK(tag.timestamp == 12345);
+	CHECK(tag.antenna == 0x11);
+	CHECK(tag.protocol == TMR_TAG_PROTOCOL_GEN2);
+	CHECK(tag.freq >= 902750 && tag.freq < 927750);
+
+	// An EPC length running past the frame
+	frame[28] = 0xF0;
+	CHECK(m6e_nano_decode_tag(frame, &tag) == -EBADMSG);
+}
+
+static void test_decode_version(void)
+{
+	static const uint8_t frame[] = {
+		0xFF, 0x14, 0x03, 0x00, 0x00, 0x12, 0x03, 0x00, 0x00, 0x30, 0x00, 0x00, 0x02, 0x20,
+		0x23, 0x01, 0x16, 0x01, 0x09, 0x01, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00};
+	struct m6e_nano_version version;
+
+	CHECK(m6e_nano_decode_version(frame, &version) == 0);
+	CHECK(version.hardware == 0x30000002);
+	CHECK(version.fw_version == 0x01090100);
+	CHECK(version.protocols == 0x00000010);
+}
+
+static void test_start_search(void)
+{
+	uint8_t data[M6E_NANO_START_SEARCH_LEN];
+
+	CHECK(m6e_nano_encode_start_search(data, TMR_SR_TM_OPTION_CONTINUOUS) == sizeof(data));
+	CHECK(data[2] == TMR_SR_TM_OPTION_CONTINUOUS);
+	CHECK(data[3] == TMR_SR_OPCODE_READ_TAG_ID_MULTIPLE);
+}
+
+static void test_read_single(void)
+{
+	// RSSI and antenna metadata, then the PC, EPC and EPC CRC of a 96-bit EPC
+	static const uint8_t frame[] = {
+		0xFF, 0x15, 0x21, 0x00, 0x00, 0x10, 0x00, 0x06, 0xC4, 0x11, 0x30, 0x00, 0xE2, 0x00,
+		0x68, 0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x15, 0x45, 0xE9, 0x0C, 0xA7, 0x7A};
+	static const uint8_t mask[] = {0xE2, 0x80};
+	struct m6e_nano_select select = {.target = M6E_NANO_SELECT_EPC, .bit_len = 12, .mask = mask};
+	struct m6e_nano_tag tag;
+	uint8_t data[32];
+	uint8_t bad[sizeof(frame)];
+
+	CHECK(m6e_nano_encode_read_single(data, sizeof(data), 500, M6E_NANO_METADATA_RSSI, NULL) ==
+	      5);
+	CHECK(memcmp(data, "\x01\xF4\x10\x00\x02", 5) == 0);
+
+	// Access password, EPC length in bits, mask
+	CHECK(m6e_nano_encode_read_single(data, sizeof(data), 500, 0, &select) == 12);
+	CHECK(data[2] == 0x11);
+	CHECK(data[9] == 12);
+	CHECK(memcmp(&data[10], mask, 2) == 0);
+
+	// Bank address of other targets, inverted
+	select.target = M6E_NANO_SELECT_TID;
+	select.invert = true;
+	select.bit_pointer = 0x20;
+	CHECK(m6e_nano_encode_read_single(data, sizeof(data), 500, 0, &select) == 16);
+	CHECK(data[2] == 0x1A);
+	CHECK(memcmp(&data[9], "\x00\x00\x00\x20\x0C\xE2\x80", 7) == 0);
+
+	CHECK(m6e_nano_encode_read_single(data, 10, 500, 0, &select) == -ENOMEM);
+	select.target = 0;
+	CHECK(m6e_nano_encode_read_single(data, sizeof(data), 500, 0, &select) == -EINVAL);
+
+	CHECK(m6e_nano_frame_crc_ok(frame));
+	CHECK(m6e_nano_decode_single(frame, &tag) == 0);
+	CHECK(tag.rssi == -60);
+	CHECK(tag.antenna == 0x11);
+	CHECK(tag.freq == 0);
+	CHECK(tag.epc_len == 12);
+	CHECK(memcmp(&tag.epc[10], "\x15\x45", 2) == 0);
+
+	// Metadata announced but not in the frame
+	memcpy(bad, frame, sizeof(bad));
+	bad[6] = 0x0F;
+	bad[7] = 0x7F;
+	CHECK(m6e_nano_decode_single(bad, &tag) == -EBADMSG);
+}
+
+int main(void)
+{
+	test_frame_encode();
+	test_rx_split_and_garbage();
+	test_rx_bad_crc();
+	test_tap();
+	test_decode_tag();
+	test_decode_version();
+	test_start_search();
+	test_read_single();
+
+	printf("test_proto: OK\n");
+
+	return 0;
+}
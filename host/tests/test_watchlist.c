@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "check.h"
+#include "m6e_nano_index.h"
+
+#define EPC_LEN 12
+#define COUNT   50000
+
+/**
+ * @brief EPC of tag n of a batch, like the simulator reads.
+ */
+static void _epc(uint8_t *epc, uint32_t n)
+{
+	static const uint8_t prefix[] = {0xE2, 0x00, 0x68, 0x16, 0x00, 0x00, 0x00, 0x00};
+
+	memcpy(epc, prefix, sizeof(prefix));
+	epc[8] = n >> 24;
+	epc[9] = n >> 16;
+	epc[10] = n >> 8;
+	epc[11] = n;
+}
+
+/**
+ * @brief Every listed EPC is found with its value, the others are not.
+ */
+static void test_lookup(void)
+{
+	uint8_t *epcs = malloc((size_t)COUNT * EPC_LEN);
+	uint32_t *data = malloc(COUNT * sizeof(*data));
+	struct m6e_nano_watchlist list;
+	struct timespec start, end;
+	uint8_t epc[EPC_LEN];
+	uint32_t value;
+	void *index;
+	size_t size;
+	double ns;
+
+	// Every other tag of the batch, in reverse
+	for (uint32_t i = 0; i < COUNT; i++) {
+		_epc(&epcs[i * EPC_LEN], 2 * (COUNT - 1 - i));
+		data[i] = i;
+	}
+
+	CHECK(m6e_nano_index_build(epcs, data, COUNT, EPC_LEN, &index, &size) == 0);
+	CHECK(size == m6e_nano_watchlist_size(COUNT, EPC_LEN, 15));
+	CHECK(m6e_nano_watchlist_open(&list, index, size) == 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (uint32_t n = 0; n < 2 * COUNT; n++) {
+		int ret;
+
+		_epc(epc, n);
+		ret = m6e_nano_watchlist_find(&list, epc, EPC_LEN, &value);
+		if (n % 2 == 0) {
+			CHECK(ret == 0);
+			CHECK(value == COUNT - 1 - n / 2);
+		} else {
+			CHECK(ret == -ENOENT);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / (2 * COUNT);
+	printf("%u EPCs, %zu bytes, %.0f ns per lookup\n", COUNT, size, ns);
+
+	// Other EPC lengths never match
+	CHECK(m6e_nano_watchlist_find(&list, epc, EPC_LEN - 2, NULL) == -ENOENT);
+
+	free(index);
+	free(epcs);
+	free(data);
+}
+
+/**
+ * @brief Indexes that must not be used.
+ */
+static void test_invalid(void)
+{
+	uint8_t epcs[3 * EPC_LEN];
+	struct m6e_nano_watchlist list;
+	struct m6e_nano_watchlist_header *header;
+	uint32_t *offsets;
+	void *index;
+	size_t size;
+
+	_epc(&epcs[0], 1);
+	_epc(&epcs[EPC_LEN], 2);
+	_epc(&epcs[2 * EPC_LEN], 1);
+	CHECK(m6e_nano_index_build(epcs, NULL, 3, EPC_LEN, &index, &size) == -EEXIST);
+	CHECK(m6e_nano_index_build(epcs, NULL, 2, 0, &index, &size) == -EINVAL);
+
+	CHECK(m6e_nano_index_build(epcs, NULL, 2, EPC_LEN, &index, &size) == 0);
+	header = index;
+	offsets = (uint32_t *)(header + 1);
+	CHECK(m6e_nano_watchlist_open(&list, index, size) == 0);
+	CHECK(m6e_nano_watchlist_find(&list, &epcs[EPC_LEN], EPC_LEN, NULL) == 0);
+
+	CHECK(m6e_nano_watchlist_open(&list, index, size - 1) == -EINVAL);
+	CHECK(m6e_nano_watchlist_open(&list, (uint8_t *)index + 1, size - 1) == -EINVAL);
+	CHECK(list.header == NULL);
+	CHECK(m6e_nano_watchlist_find(&list, &epcs[EPC_LEN], EPC_LEN, NULL) == -ENOENT);
+
+	// Buckets that do not cover the entries
+	offsets[1] = 3;
+	CHECK(m6e_nano_watchlist_open(&list, index, size) == -EINVAL);
+	offsets[1] = 2;
+
+	header->magic = __builtin_bswap32(M6E_NANO_WATCHLIST_MAGIC);
+	CHECK(m6e_nano_watchlist_open(&list, index, size) == -EINVAL);
+
+	free(index);
+}
+
+int main(void)
+{
+	test_lookup();
+	test_invalid();
+
+	printf("test_watchlist: OK\n");
+
+	return 0;
+}
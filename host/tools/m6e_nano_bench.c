@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "m6e_nano_proto.h"
+#include "m6e_nano_sim.h"
+
+// Size of the chunks the stream is fed in, like reads from a serial port
+#define BENCH_CHUNK 64
+
+/**
+ * @brief Monotonic time in ns.
+ *
+ * @return uint64_t Time in ns.
+ */
+static uint64_t _bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t frames = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+	struct m6e_nano_rx rx;
+	struct m6e_nano_tag tag;
+	uint8_t *stream;
+	size_t len = 0;
+	uint32_t decoded = 0;
+	uint64_t start;
+	uint64_t elapsed;
+
+	stream = malloc((size_t)frames * 47);
+	if (stream == NULL) {
+		return 1;
+	}
+	for (uint32_t i = 0; i < frames; i++) {
+		len += m6e_nano_sim_tag_frame(&stream[len], i % 1000, i);
+	}
+
+	m6e_nano_rx_reset(&rx);
+	start = _bench_now_ns();
+	for (size_t pos = 0; pos < len;) {
+		size_t end = pos + BENCH_CHUNK < len ? pos + BENCH_CHUNK : len;
+
+		while (pos < end) {
+			bool complete;
+
+			pos += m6e_nano_rx_feed(&rx, &stream[pos], end - pos, &complete);
+			if (complete && m6e_nano_decode_tag(rx.frame, &tag) == 0) {
+				decoded++;
+			}
+		}
+	}
+	elapsed = _bench_now_ns() - start;
+
+	printf("%u frames decoded in %.1f ms: %.0f ns/frame, %.1f MB/s, %u CRC errors\n", decoded,
+	       elapsed / 1e6, (double)elapsed / frames, len * 1e3 / elapsed, rx.crc_errors);
+	free(stream);
+
+	return decoded == frames ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "m6e_nano_fw.h"
+
+int main(int argc, char **argv)
+{
+	struct m6e_nano_posix port;
+	struct m6e_nano_link link;
+	struct m6e_nano_fw_stats stats;
+	uint8_t stop[] = {0x00, 0x00, 0x02};
+	uint32_t baud = argc > 3 ? strtoul(argv[3], NULL, 0) : 115200;
+	uint32_t fast = argc > 4 ? strtoul(argv[4], NULL, 0) : 921600;
+	int fd;
+	int ret;
+
+	if (argc < 3 || argc > 5) {
+		fprintf(stderr, "usage: %s <serial port> <image> [baud] [transfer baud]\n",
+			argv[0]);
+		return 2;
+	}
+
+	fd = open(argv[2], O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", argv[2], strerror(errno));
+		return 1;
+	}
+
+	ret = m6e_nano_posix_open(&port, argv[1], baud);
+	if (ret < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", argv[1], strerror(-ret));
+		close(fd);
+		return 1;
+	}
+	m6e_nano_link_init(&link, &port.transport, NULL, NULL);
+
+	// The module may have been left reading, the bootloader answers this with an error
+	m6e_nano_link_command(&link, TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP, stop, sizeof(stop), 1000);
+
+	ret = m6e_nano_fw_update(&port, &link, fd, fast, &stats);
+	if (ret < 0) {
+		fprintf(stderr, "Update failed: %s\n", strerror(-ret));
+	} else {
+		printf("%u bytes at %u baud: erase %u ms, write %u ms, %u bytes/s, CRC %08x\n",
+		       stats.bytes, stats.baud, stats.erase_ms, stats.write_ms, stats.bytes_per_s,
+		       stats.crc);
+	}
+
+	m6e_nano_posix_close(&port);
+	close(fd);
+
+	return ret < 0 ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "m6e_nano_index.h"
+#include "m6e_nano_proto.h"
+
+/**
+ * @brief Parse an EPC in hex.
+ *
+ * @param text Hex digits, up to a comma, space or the end of the line.
+ * @param epc Destination, M6E_NANO_EPC_MAX_LEN bytes.
+ * @param end First character after the EPC.
+ * @return int EPC length in bytes, -EINVAL if it is not whole bytes of hex.
+ */
+static int _parse_epc(const char *text, uint8_t *epc, const char **end)
+{
+	int len = 0;
+
+	while (isxdigit((unsigned char)text[0]) && isxdigit((unsigned char)text[1])) {
+		unsigned int byte;
+
+		if (len == M6E_NANO_EPC_MAX_LEN) {
+			return -EINVAL;
+		}
+		sscanf(text, "%2x", &byte);
+		epc[len++] = byte;
+		text += 2;
+	}
+	*end = text;
+
+	return len > 0 && !isxdigit((unsigned char)*text) ? len : -EINVAL;
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t *epcs = NULL;
+	uint32_t *data = NULL;
+	uint32_t count = 0;
+	uint32_t capacity = 0;
+	int epc_len = 0;
+	unsigned int line_no = 0;
+	char line[256];
+	void *index;
+	size_t size;
+	FILE *in;
+	FILE *out;
+	int ret;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s <EPC list> <index>\n", argv[0]);
+		fprintf(stderr, "One EPC in hex per line, optionally followed by a comma and the\n"
+				"value returned on a match. Lines starting with # are skipped.\n");
+		return 2;
+	}
+
+	in = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+	if (in == NULL) {
+		fprintf(stderr, "Failed to open %s: %s\n", argv[1], strerror(errno));
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), in) != NULL) {
+		uint8_t epc[M6E_NANO_EPC_MAX_LEN];
+		const char *text = line;
+		const char *end;
+		int len;
+
+		line_no++;
+		while (isspace((unsigned char)*text)) {
+			text++;
+		}
+		if (*text == '\0' || *text == '#') {
+			continue;
+		}
+
+		len = _parse_epc(text, epc, &end);
+		if (len < 0 || (epc_len != 0 && len != epc_len)) {
+			fprintf(stderr, "%s:%u: EPC of %d bytes expected\n", argv[1], line_no,
+				epc_len);
+			return 1;
+		}
+		epc_len = len;
+
+		if (count == capacity) {
+			capacity = capacity != 0 ? capacity * 2 : 1024;
+			epcs = realloc(epcs, (size_t)capacity * epc_len);
+			data = realloc(data, (size_t)capacity * sizeof(*data));
+			if (epcs == NULL || data == NULL) {
+				fprintf(stderr, "Out of memory\n");
+				return 1;
+			}
+		}
+		memcpy(&epcs[(size_t)count * epc_len], epc, epc_len);
+		data[count] = *end == ',' ? strtoul(end + 1, NULL, 0) : 0;
+		count++;
+	}
+	if (in != stdin) {
+		fclose(in);
+	}
+	if (count == 0) {
+		fprintf(stderr, "No EPCs in %s\n", argv[1]);
+		return 1;
+	}
+
+	ret = m6e_nano_index_build(epcs, data, count, epc_len, &index, &size);
+	if (ret == -EEXIST) {
+		fprintf(stderr, "An EPC is listed twice\n");
+		return 1;
+	} else if (ret < 0) {
+		fprintf(stderr, "Failed to build the index: %s\n", strerror(-ret));
+		return 1;
+	}
+
+	out = fopen(argv[2], "wb");
+	if (out == NULL || fwrite(index, 1, size, out) != size || fclose(out) != 0) {
+		fprintf(stderr, "Failed to write %s: %s\n", argv[2], strerror(errno));
+		return 1;
+	}
+
+	printf("%u EPCs of %d bytes, %u buckets, %zu bytes\n", count, epc_len,
+	       1U << ((struct m6e_nano_watchlist_header *)index)->bucket_bits, size);
+
+	free(index);
+	free(epcs);
+	free(data);
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023 Arribada Initiative CIC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "m6e_nano_posix.h"
+
+/**
+ * @brief Print a tag read.
+ *
+ * @param frame Frame, from the header to the CRC.
+ * @param user_data Number of tags printed.
+ */
+static void _print_frame(const uint8_t *frame, void *user_data)
+{
+	unsigned int *count = user_data;
+	struct m6e_nano_tag tag;
+
+	if (frame[2] != TMR_SR_OPCODE_READ_TAG_ID_MULTIPLE ||
+	    m6e_nano_frame_status(frame) != 0 || m6e_nano_decode_tag(frame, &tag) < 0) {
+		return;
+	}
+
+	printf("%10u ms  ant %02x  %4d dBm  %6u kHz  ", tag.timestamp, tag.antenna, tag.rssi,
+	       tag.freq);
+	for (uint8_t i = 0; i < tag.epc_len; i++) {
+		printf("%02X", tag.epc[i]);
+	}
+	printf("\n");
+	(*count)++;
+}
+
+int main(int argc, char **argv)
+{
+	struct m6e_nano_posix port;
+	struct m6e_nano_link link;
+	struct m6e_nano_version version;
+	uint8_t search[M6E_NANO_START_SEARCH_LEN];
+	uint8_t stop[] = {0x00, 0x00, 0x02};
+	unsigned int count = 0;
+	uint32_t baud = argc > 2 ? strtoul(argv[2], NULL, 0) : 115200;
+	int seconds = argc > 3 ? atoi(argv[3]) : 5;
+	int ret;
+
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, "usage: %s <serial port> [baud] [seconds]\n", argv[0]);
+		return 2;
+	}
+
+	ret = m6e_nano_posix_open(&port, argv[1], baud);
+	if (ret < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", argv[1], strerror(-ret));
+		return 1;
+	}
+	m6e_nano_link_init(&link, &port.transport, _print_frame, &count);
+
+	ret = m6e_nano_link_command(&link, TMR_SR_OPCODE_VERSION, NULL, 0, 1000);
+	if (ret == 0) {
+		ret = m6e_nano_decode_version(link.rx.frame, &version);
+	}
+	if (ret < 0) {
+		fprintf(stderr, "No answer from the module: %s\n", strerror(-ret));
+		goto out;
+	}
+	printf("Hardware %08x, firmware %08x\n", version.hardware, version.fw_version);
+
+	ret = m6e_nano_link_command(&link, TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP, search,
+				    m6e_nano_encode_start_search(search, TMR_SR_TM_OPTION_CONTINUOUS), 1000);
+	if (ret < 0) {
+		fprintf(stderr, "Failed to start reading: %s\n", strerror(-ret));
+		goto out;
+	}
+
+	ret = m6e_nano_link_poll(&link, seconds * 1000);
+	m6e_nano_link_command(&link, TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP, stop, sizeof(stop), 1000);
+	printf("%u tags in %ds, %u bad frames\n", count, seconds, link.rx.crc_errors);
+
+out:
+	m6e_nano_posix_close(&port);
+
+	return ret < 0 ? 1 : 0;
+}
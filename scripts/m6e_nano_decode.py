@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2023 Arribada Initiative CIC
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Decode M6E Nano frames captured with CONFIG_M6E_NANO_CAPTURE.
+
+Reads the output of the `m6e capture dump` shell command or of the capture log
+backend, from files or stdin, and prints one decoded line per frame. Lines that
+do not hold a captured frame, such as log prefixes or prompts, are skipped.
+
+    m6e_nano_decode.py console.log
+"""
+
+import argparse
+import re
+import sys
+
+LINE_RE = re.compile(r"(\d+) (RX|TX)(!?) ([0-9a-fA-F]+)\s*$")
+
+CRC_TABLE = [
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+]
+
+OPCODES = {
+    0x03: "VERSION",
+    0x04: "VERSION_STARTUP",
+    0x06: "SET_BAUD_RATE",
+    0x21: "READ_TAG_ID_SINGLE",
+    0x22: "READ_TAG_ID_MULTIPLE",
+    0x23: "WRITE_TAG_ID",
+    0x24: "WRITE_TAG_DATA",
+    0x26: "KILL_TAG",
+    0x28: "READ_TAG_DATA",
+    0x2A: "CLEAR_TAG_ID_BUFFER",
+    0x2F: "MULTI_PROTOCOL_TAG_OP",
+    0x62: "GET_READ_TX_POWER",
+    0x64: "GET_WRITE_TX_POWER",
+    0x65: "GET_FREQ_HOP_TABLE",
+    0x66: "GET_USER_GPIO_INPUTS",
+    0x67: "GET_REGION",
+    0x68: "GET_POWER_MODE",
+    0x6A: "GET_READER_OPTIONAL_PARAMS",
+    0x6B: "GET_PROTOCOL_PARAM",
+    0x91: "SET_ANTENNA_PORT",
+    0x92: "SET_READ_TX_POWER",
+    0x93: "SET_TAG_PROTOCOL",
+    0x94: "SET_WRITE_TX_POWER",
+    0x95: "SET_FREQ_HOP_TABLE",
+    0x96: "SET_USER_GPIO_OUTPUTS",
+    0x97: "SET_REGION",
+    0x98: "SET_POWER_MODE",
+    0x9A: "SET_READER_OPTIONAL_PARAMS",
+    0x9B: "SET_PROTOCOL_PARAM",
+}
+
+
+def crc(data):
+    """CRC of a frame without its header, as computed by the module."""
+    value = 0xFFFF
+    for byte in data:
+        value = (((value << 4) | (byte >> 4)) ^ CRC_TABLE[value >> 12]) & 0xFFFF
+        value = (((value << 4) | (byte & 0x0F)) ^ CRC_TABLE[value >> 12]) & 0xFFFF
+    return value
+
+
+def decode_tag(frame):
+    """Fields of a tag found in a READ_TAG_ID_MULTIPLE stream frame."""
+    embedded = ((frame[24] << 8 | frame[25]) + 7) // 8
+    epc_offset = 31 + embedded
+    epc_bits = frame[27 + embedded] << 8 | frame[28 + embedded]
+    epc_len = epc_bits // 8 - 4
+    rssi = frame[12] - 256 if frame[12] > 127 else frame[12]
+    return "rssi=%ddBm ant=%02x freq=%ukHz t=%ums phase=%u epc=%s" % (
+        rssi,
+        frame[13],
+        int.from_bytes(frame[14:17], "big"),
+        int.from_bytes(frame[17:21], "big"),
+        int.from_bytes(frame[21:23], "big"),
+        frame[epc_offset:epc_offset + epc_len].hex(),
+    )
+
+
+def decode_frame(direction, frame):
+    """One line description of a frame."""
+    if len(frame) < 5 or frame[0] != 0xFF:
+        return "not a frame: %s" % frame.hex()
+
+    opcode = frame[2]
+    name = OPCODES.get(opcode, "0x%02X" % opcode)
+    expected = frame[1] + (7 if direction == "RX" else 5)
+    if len(frame) != expected:
+        return "%s length %u, expected %u: %s" % (name, len(frame), expected, frame.hex())
+    if int.from_bytes(frame[-2:], "big") != crc(frame[1:-2]):
+        return "%s CRC error: %s" % (name, frame.hex())
+
+    if direction == "TX":
+        return "%s %s" % (name, frame[3:-2].hex())
+
+    status = frame[3] << 8 | frame[4]
+    data = frame[5:-2]
+    if opcode == 0x22 and frame[1] > 0x0A and status == 0:
+        try:
+            return "%s tag %s" % (name, decode_tag(frame))
+        except IndexError:
+            pass
+    if opcode == 0x22 and status == 0x0400:
+        return "%s keep-alive" % name
+    if status != 0:
+        return "%s status 0x%04X %s" % (name, status, data.hex())
+    return "%s %s" % (name, data.hex())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("files", nargs="*", type=argparse.FileType("r"), default=[sys.stdin],
+                        help="captured output, stdin by default")
+    args = parser.parse_args()
+
+    previous = None
+    for file in args.files:
+        for line in file:
+            match = LINE_RE.search(line)
+            if match is None:
+                continue
+            time_us = int(match.group(1))
+            direction = match.group(2)
+            frame = bytes.fromhex(match.group(4))
+            # Timestamps wrap every 2^32 us
+            delta = 0 if previous is None else (time_us - previous) % (1 << 32)
+            previous = time_us
+            truncated = " truncated" if match.group(3) else ""
+            print("%10u +%8uus %s%s %s" % (time_us, delta, direction, truncated,
+                                            decode_frame(direction, frame)))
+
+
+if __name__ == "__main__":
+    main()
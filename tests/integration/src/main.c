@@ -24,13 +24,14 @@ static int cmd_test_version(const struct shell *sh, size_t argc, char **argv)
 	ARG_UNUSED(argc);
 	ARG_UNUSED(argv);
 
-    if(m6e_nano_get_version(dev)) {
+    struct m6e_nano_version version;
+
+    if(m6e_nano_get_version(dev, &version)) {
         shell_print(sh, "Error getting version");
         return ENODATA;
-    } else {	
-        struct m6e_nano_data *data = (struct m6e_nano_data *)dev->data;
-        uint8_t *msg = data->response.data;
-        shell_print(sh, "v%d.%d.%d", msg[0], msg[1], msg[2]);
+    } else {
+        shell_print(sh, "v%x.%x.%x.%x", version.fw_version >> 24, (version.fw_version >> 16) & 0xFF,
+                    (version.fw_version >> 8) & 0xFF, version.fw_version & 0xFF);
         return 0;
     }
 }
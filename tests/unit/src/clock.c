@@ -0,0 +1,107 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include <../../drivers/m6e-nano/m6e_nano_clock.h>
+
+#include <zephyr/ztest.h>
+
+ZTEST_SUITE(m6enano_clock_tests, NULL, NULL, NULL, NULL, NULL);
+
+#define KEEPALIVE_US 1000000
+#define MIN_LATENCY  2000
+
+/**
+ * @brief Serial latency of a frame, at its minimum every 13 frames
+ *
+ */
+static int64_t frame_latency(uint32_t i)
+{
+	return MIN_LATENCY + (i * 7919 % 13) * 300;
+}
+
+/**
+ * @brief Test a keep-alive anchors the tag timestamps
+ *
+ */
+ZTEST(m6enano_clock_tests, test_keepalive_anchor)
+{
+	struct m6e_nano_clock clock = {0};
+
+	m6e_nano_clock_init(&clock);
+	m6e_nano_clock_keepalive(&clock, KEEPALIVE_US);
+
+	zassert_equal(m6e_nano_clock_tag(&clock, 250, KEEPALIVE_US + 253000),
+		      KEEPALIVE_US + 250000);
+	zassert_equal(m6e_nano_clock_tag(&clock, 70000, KEEPALIVE_US + 70004000),
+		      KEEPALIVE_US + 70000000, "timestamp beyond 16 bits truncated");
+	zassert_equal(clock.reanchors, 0);
+}
+
+/**
+ * @brief Test the drift of a slow module clock is corrected
+ *
+ * The module clock runs 100 ppm slow and tags are read for a minute without keep-alives, so
+ * uncorrected timestamps end up 6 ms early. Frames arrive with a varying latency.
+ *
+ */
+ZTEST(m6enano_clock_tests, test_drift)
+{
+	struct m6e_nano_clock clock = {0};
+	int64_t read_us = 0;
+	int64_t time_us = 0;
+
+	m6e_nano_clock_init(&clock);
+	m6e_nano_clock_keepalive(&clock, KEEPALIVE_US + MIN_LATENCY);
+
+	for (uint32_t i = 1; i <= 3000; i++) {
+		uint32_t ts = i * 20;
+
+		read_us = KEEPALIVE_US + (int64_t)ts * 1000 + (int64_t)ts / 10;
+		time_us = m6e_nano_clock_tag(&clock, ts, read_us + frame_latency(i));
+		zassert_true(time_us <= read_us + frame_latency(i), "read after its frame");
+	}
+
+	zassert_within(clock.drift_ppm, 100, 10, "drift %d ppm", clock.drift_ppm);
+	zassert_within(time_us - read_us, MIN_LATENCY, 1000, "error %lld us",
+		       time_us - read_us - MIN_LATENCY);
+}
+
+/**
+ * @brief Test timestamps are anchored on the tags themselves without keep-alives
+ *
+ * Before the first keep-alive, and when a new stream restarts the count, the anchor is taken
+ * from the tag frame.
+ *
+ */
+ZTEST(m6enano_clock_tests, test_reanchor)
+{
+	struct m6e_nano_clock clock = {0};
+
+	m6e_nano_clock_init(&clock);
+
+	zassert_equal(m6e_nano_clock_tag(&clock, 500, 2000000), 2000000);
+	zassert_equal(m6e_nano_clock_tag(&clock, 600, 2100000), 2100000);
+	zassert_equal(clock.reanchors, 1);
+
+	// Count restarted without a keep-alive
+	zassert_equal(m6e_nano_clock_tag(&clock, 10, 5000000), 5000000);
+	zassert_equal(m6e_nano_clock_tag(&clock, 110, 5100000), 5100000);
+	zassert_equal(clock.reanchors, 2);
+}
+
+/**
+ * @brief Test the reader offset is applied and survives a reset
+ *
+ */
+ZTEST(m6enano_clock_tests, test_offset)
+{
+	struct m6e_nano_clock clock = {0};
+
+	m6e_nano_clock_init(&clock);
+	clock.offset_us = -1500;
+	m6e_nano_clock_init(&clock);
+	m6e_nano_clock_keepalive(&clock, KEEPALIVE_US);
+
+	zassert_equal(m6e_nano_clock_tag(&clock, 100, KEEPALIVE_US + 102000),
+		      KEEPALIVE_US + 100000 - 1500);
+}
@@ -0,0 +1,107 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include <../../drivers/m6e-nano/m6e_nano_codec.h>
+
+#include <zephyr/ztest.h>
+
+#ifdef CONFIG_M6E_NANO_CODEC
+
+ZTEST_SUITE(m6enano_codec_tests, NULL, NULL, NULL, NULL, NULL);
+
+static struct m6e_nano_codec_tag make_tag(uint64_t time_ms, uint8_t sku, uint8_t serial)
+{
+	struct m6e_nano_codec_tag tag = {
+		.time_ms = time_ms,
+		.rssi = -60 - serial,
+		.antenna = 1,
+		.epc_len = 12,
+		.epc = {0x30, 0x14, 0x25, 0x7B, 0xF7, 0x19, 0x4E, sku, 0x00, 0x00, 0x00, serial},
+	};
+
+	return tag;
+}
+
+/**
+ * @brief Test round trip of tag events and summaries
+ *
+ * Encodes tags sharing an EPC prefix, a tag from another SKU range and a summary, and checks
+ * that decoding yields the same records and that repeated prefixes are compressed.
+ *
+ */
+ZTEST(m6enano_codec_tests, test_round_trip)
+{
+	struct m6e_nano_codec_tag tags[] = {
+		make_tag(1000, 0x01, 1), make_tag(1005, 0x01, 2), make_tag(1005, 0x02, 3),
+		make_tag(1300, 0x01, 4), make_tag(70000, 0x02, 5),
+	};
+	struct m6e_nano_codec_summary summary = {
+		.time_ms = 70010, .unique = 5, .reads = 42, .duration_ms = 69010};
+	struct m6e_nano_encoder enc;
+	struct m6e_nano_decoder dec;
+	struct m6e_nano_codec_record record;
+	uint8_t buf[128];
+
+	zassert_ok(m6e_nano_encoder_init(&enc, buf, sizeof(buf), 8, 1000));
+	for (size_t i = 0; i < ARRAY_SIZE(tags); i++) {
+		zassert_ok(m6e_nano_encode_tag(&enc, &tags[i]));
+	}
+	zassert_ok(m6e_nano_encode_summary(&enc, &summary));
+
+	// A dictionary hit costs header, delta, RSSI, index and the 4 byte suffix
+	/*
+	 * Header 4, two DEFINE records of 16 bytes, three REF records of 8 to 10 bytes depending
+	 * on the time delta and a 7 byte summary. The 5 EPCs alone are 60 bytes.
+	 */
+	zassert_equal(enc.len, 70, "unexpected batch size %zu", enc.len);
+
+	zassert_ok(m6e_nano_decoder_init(&dec, buf, enc.len));
+	for (size_t i = 0; i < ARRAY_SIZE(tags); i++) {
+		zassert_ok(m6e_nano_decode_next(&dec, &record));
+		zassert_not_equal(record.type, M6E_NANO_CODEC_SUMMARY);
+		zassert_equal(record.tag.time_ms, tags[i].time_ms);
+		zassert_equal(record.tag.rssi, tags[i].rssi);
+		zassert_equal(record.tag.antenna, tags[i].antenna);
+		zassert_equal(record.tag.epc_len, tags[i].epc_len);
+		zassert_mem_equal(record.tag.epc, tags[i].epc, tags[i].epc_len);
+	}
+	zassert_equal(record.type, M6E_NANO_CODEC_REF, "last tag should hit the dictionary");
+
+	zassert_ok(m6e_nano_decode_next(&dec, &record));
+	zassert_equal(record.type, M6E_NANO_CODEC_SUMMARY);
+	zassert_equal(record.summary.time_ms, summary.time_ms);
+	zassert_equal(record.summary.unique, summary.unique);
+	zassert_equal(record.summary.reads, summary.reads);
+	zassert_equal(record.summary.duration_ms, summary.duration_ms);
+
+	zassert_equal(m6e_nano_decode_next(&dec, &record), -ENODATA);
+}
+
+/**
+ * @brief Test a full batch
+ *
+ * A record that does not fit leaves the batch intact and decodable.
+ *
+ */
+ZTEST(m6enano_codec_tests, test_full_batch)
+{
+	struct m6e_nano_codec_tag tag = make_tag(0, 0x01, 1);
+	struct m6e_nano_encoder enc;
+	struct m6e_nano_decoder dec;
+	struct m6e_nano_codec_record record;
+	uint8_t buf[20];
+	size_t len;
+
+	zassert_ok(m6e_nano_encoder_init(&enc, buf, sizeof(buf), 8, 0));
+	zassert_ok(m6e_nano_encode_tag(&enc, &tag));
+	len = enc.len;
+	zassert_equal(m6e_nano_encode_tag(&enc, &tag), -ENOMEM);
+	zassert_equal(enc.len, len);
+
+	zassert_ok(m6e_nano_decoder_init(&dec, buf, enc.len));
+	zassert_ok(m6e_nano_decode_next(&dec, &record));
+	zassert_equal(m6e_nano_decode_next(&dec, &record), -ENODATA);
+	zassert_equal(m6e_nano_decoder_init(&dec, buf, 1), -EBADMSG);
+}
+
+#endif // CONFIG_M6E_NANO_CODEC
@@ -0,0 +1,84 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include <../../drivers/m6e-nano/m6e_nano.h>
+
+#include "fake_module.h"
+
+#ifdef CONFIG_UART_EMUL
+
+#include <zephyr/drivers/serial/uart_emul.h>
+
+static const struct device *fake_uart;
+static fake_module_handler_t fake_handler;
+static uint8_t cmd[M6E_NANO_BUF_SIZE];
+static size_t cmd_len;
+
+void fake_module_send(uint8_t opcode, uint16_t status, const uint8_t *data, uint8_t len)
+{
+	static uint8_t frame[M6E_NANO_FRAME_MAX];
+	size_t frame_len = len + M6E_NANO_FRAME_OVERHEAD;
+	uint16_t crc;
+
+	frame[0] = 0xFF;
+	frame[1] = len;
+	frame[2] = opcode;
+	frame[3] = status >> 8;
+	frame[4] = status & 0xFF;
+	if (len > 0) {
+		memcpy(&frame[5], data, len);
+	}
+	crc = m6e_nano_crc(&frame[1], frame_len - 3);
+	frame[frame_len - 2] = crc >> 8;
+	frame[frame_len - 1] = crc & 0xFF;
+
+	// Let the emulated interrupt run between chunks
+	for (size_t i = 0; i < frame_len; i += FAKE_MODULE_CHUNK) {
+		uart_emul_put_rx_data(fake_uart, &frame[i], MIN(FAKE_MODULE_CHUNK, frame_len - i));
+		k_msleep(1);
+	}
+}
+
+/**
+ * @brief Collect command bytes and answer each complete command through the handler
+ *
+ */
+static void fake_module_tx_ready(const struct device *uart, size_t size, void *user_data)
+{
+	static uint8_t data[M6E_NANO_BUF_SIZE];
+	uint16_t status = 0;
+	int len;
+
+	ARG_UNUSED(user_data);
+
+	while (size > 0 && cmd_len < sizeof(cmd)) {
+		size_t read = uart_emul_get_tx_data(uart, &cmd[cmd_len], sizeof(cmd) - cmd_len);
+
+		if (read == 0) {
+			break;
+		}
+		cmd_len += read;
+		size -= MIN(size, read);
+	}
+
+	// Header, length, opcode, data and CRC
+	if (cmd_len < 2 || cmd_len < (size_t)cmd[1] + M6E_NANO_COMMAND_OVERHEAD) {
+		return;
+	}
+	cmd_len = 0;
+
+	len = fake_handler(cmd, data, &status);
+	if (len >= 0) {
+		fake_module_send(cmd[2], status, data, len);
+	}
+}
+
+void fake_module_start(const struct device *uart, fake_module_handler_t handler)
+{
+	fake_uart = uart;
+	fake_handler = handler;
+	cmd_len = 0;
+	uart_emul_callback_tx_data_ready_set(uart, fake_module_tx_ready, NULL);
+}
+
+#endif // CONFIG_UART_EMUL
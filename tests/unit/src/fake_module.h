@@ -0,0 +1,33 @@
+#ifndef FAKE_MODULE_H
+#define FAKE_MODULE_H
+
+#include <zephyr/device.h>
+#include <stdint.h>
+
+// Bytes of a response per emulated UART interrupt, so frames span several of them
+#define FAKE_MODULE_CHUNK 3
+
+/**
+ * @brief Answer a command sent to the fake module
+ *
+ * @param cmd Command frame, from the header to the CRC.
+ * @param data Response data, M6E_NANO_BUF_SIZE bytes.
+ * @param status Status of the response, 0 unless set.
+ * @return int Length of the response data, negative to send no response.
+ */
+typedef int (*fake_module_handler_t)(const uint8_t *cmd, uint8_t *data, uint16_t *status);
+
+/**
+ * @brief Fake the module on an emulated UART: collect each command the driver sends and answer
+ * it through the handler
+ *
+ */
+void fake_module_start(const struct device *uart, fake_module_handler_t handler);
+
+/**
+ * @brief Send a frame to the driver, as the module would, a few bytes at a time
+ *
+ */
+void fake_module_send(uint8_t opcode, uint16_t status, const uint8_t *data, uint8_t len);
+
+#endif // FAKE_MODULE_H
@@ -0,0 +1,226 @@
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+#include <../../drivers/m6e-nano/m6e_nano.h>
+
+#include "fake_module.h"
+
+#include <zephyr/ztest.h>
+
+#ifdef CONFIG_M6E_NANO_FIRMWARE
+
+ZTEST_SUITE(m6enano_firmware_tests, NULL, NULL, NULL, NULL, NULL);
+
+// Header of a 0x1234-byte application image
+static const uint8_t header[M6E_NANO_FW_HEADER_LEN] = {0x54, 0x4D, 0x2D, 0x53, 0x50, 0x61,
+						       0x69, 0x6B, 0x00, 0x00, 0x00, 0x02,
+						       0x00, 0x00, 0x12, 0x34};
+
+/**
+ * @brief Test the CRC-32 check value, whole and in parts
+ *
+ */
+ZTEST(m6enano_firmware_tests, test_crc32)
+{
+	const uint8_t check[] = "123456789";
+
+	zassert_equal(m6e_nano_crc32(0, check, 9), 0xCBF43926);
+	zassert_equal(m6e_nano_crc32(m6e_nano_crc32(0, check, 4), &check[4], 5), 0xCBF43926);
+	zassert_equal(m6e_nano_crc32(0, check, 0), 0);
+}
+
+/**
+ * @brief Test checking image headers
+ *
+ */
+ZTEST(m6enano_firmware_tests, test_header)
+{
+	uint8_t bad[M6E_NANO_FW_HEADER_LEN];
+	uint32_t len;
+
+	zassert_equal(m6e_nano_fw_header(header, &len), 0);
+	zassert_equal(len, 0x1234);
+
+	memcpy(bad, header, sizeof(bad));
+	bad[0] = 'X';
+	zassert_equal(m6e_nano_fw_header(bad, &len), -EBADMSG);
+
+	// Empty image
+	memcpy(bad, header, sizeof(bad));
+	memset(&bad[12], 0, 4);
+	zassert_equal(m6e_nano_fw_header(bad, &len), -EBADMSG);
+}
+
+/**
+ * @brief Test encoding the erase and write commands and decoding the verify response
+ *
+ */
+ZTEST(m6enano_firmware_tests, test_commands)
+{
+	uint8_t erase[M6E_NANO_FW_ERASE_LEN];
+	uint8_t write[M6E_NANO_FW_WRITE_PREFIX_LEN];
+	const uint8_t verify[] = {0xFF, 0x04, TMR_SR_OPCODE_VERIFY_IMAGE_CRC, 0x00, 0x00,
+				  0xCB, 0xF4, 0x39, 0x26};
+	const uint8_t short_verify[] = {0xFF, 0x00, TMR_SR_OPCODE_VERIFY_IMAGE_CRC, 0x00, 0x00};
+	uint32_t crc;
+
+	zassert_equal(m6e_nano_encode_erase_flash(erase), sizeof(erase));
+	zassert_equal(erase[4], 0x02);
+
+	zassert_equal(m6e_nano_encode_write_flash(write, 0x00012345), sizeof(write));
+	zassert_equal(write[4], 0x00);
+	zassert_equal(write[5], 0x01);
+	zassert_equal(write[6], 0x23);
+	zassert_equal(write[7], 0x45);
+	zassert_equal(write[8], 0x02);
+
+	zassert_equal(m6e_nano_decode_image_crc(verify, &crc), 0);
+	zassert_equal(crc, 0xCBF43926);
+	zassert_equal(m6e_nano_decode_image_crc(short_verify, &crc), -EBADMSG);
+}
+
+#if FIXED_PARTITION_EXISTS(slot1_partition)
+
+#define FW_AREA FIXED_PARTITION_ID(slot1_partition)
+
+/**
+ * @brief Erase the image partition, then write bytes at its start
+ *
+ */
+static void write_area(const uint8_t *buf, size_t len)
+{
+	const struct flash_area *fa;
+
+	zassert_equal(flash_area_open(FW_AREA, &fa), 0);
+	zassert_equal(flash_area_erase(fa, 0, fa->fa_size), 0);
+	if (len > 0) {
+		zassert_equal(flash_area_write(fa, 0, buf, len), 0);
+	}
+	flash_area_close(fa);
+}
+
+/**
+ * @brief Test that partitions without a complete image never reach the module
+ *
+ */
+ZTEST(m6enano_firmware_tests, test_bad_partition)
+{
+	const struct device *dev = DEVICE_DT_GET_ONE(thingmagic_m6enano);
+	const struct flash_area *fa;
+	uint8_t big[M6E_NANO_FW_HEADER_LEN];
+	uint32_t len;
+
+	// Erased
+	write_area(NULL, 0);
+	zassert_equal(m6e_nano_update_firmware(dev, FW_AREA, NULL), -EBADMSG);
+
+	// Longer than the partition
+	zassert_equal(flash_area_open(FW_AREA, &fa), 0);
+	len = fa->fa_size;
+	flash_area_close(fa);
+	memcpy(big, header, sizeof(big));
+	big[12] = len >> 24;
+	big[13] = len >> 16;
+	big[14] = len >> 8;
+	big[15] = len;
+	write_area(big, sizeof(big));
+	zassert_equal(m6e_nano_update_firmware(dev, FW_AREA, NULL), -EBADMSG);
+}
+
+#if DT_NODE_EXISTS(DT_NODELABEL(uart_emul0))
+
+// Application image of the update, five chunks with a short last one
+#define IMAGE_LEN (4 * M6E_NANO_FW_CHUNK_LEN + 40)
+
+static uint8_t image[M6E_NANO_FW_HEADER_LEN + IMAGE_LEN];
+
+// Module faked on the emulated UART: the application until told to start the bootloader, which
+// keeps the image it is sent
+static bool bootloader;
+static uint8_t image_rx[IMAGE_LEN];
+static uint32_t image_rx_len;
+
+/**
+ * @brief Answer a command as the module and its bootloader would
+ *
+ */
+static int bootloader_handler(const uint8_t *cmd, uint8_t *data, uint16_t *status)
+{
+	const uint8_t *args = &cmd[3];
+	uint32_t address;
+	uint32_t len;
+
+	switch (cmd[2]) {
+	case TMR_SR_OPCODE_GET_CURRENT_PROGRAM:
+		data[0] = bootloader ? M6E_NANO_PROGRAM_BOOTLOADER : M6E_NANO_PROGRAM_APP;
+		return 1;
+	case TMR_SR_OPCODE_BOOT_BOOTLOADER:
+		bootloader = true;
+		return 0;
+	case TMR_SR_OPCODE_ERASE_FLASH:
+		image_rx_len = 0;
+		return 0;
+	case TMR_SR_OPCODE_WRITE_FLASH_SECTOR:
+		address = sys_get_be32(&args[4]);
+		len = cmd[1] - M6E_NANO_FW_WRITE_PREFIX_LEN;
+		if (!bootloader || address + len > sizeof(image_rx)) {
+			*status = 0x0101;
+			return 0;
+		}
+		memcpy(&image_rx[address], &args[M6E_NANO_FW_WRITE_PREFIX_LEN], len);
+		image_rx_len = MAX(image_rx_len, address + len);
+		return 0;
+	case TMR_SR_OPCODE_VERIFY_IMAGE_CRC:
+		sys_put_be32(m6e_nano_crc32(0, image_rx, image_rx_len), data);
+		return 4;
+	case TMR_SR_OPCODE_BOOT_FIRMWARE:
+		// The application answers with its startup message, the version
+		bootloader = false;
+		memset(data, 0, 20);
+		return 20;
+	case TMR_SR_OPCODE_VERSION:
+		// Bootloader, hardware, firmware date and version, protocols
+		memset(data, 0, 20);
+		return 20;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Test a whole update against the faked module, its responses spread over several
+ * interrupts: into the bootloader, the image written and verified, the startup message of the
+ * new application as the answer to the boot
+ *
+ */
+ZTEST(m6enano_firmware_tests, test_update)
+{
+	const struct device *dev = DEVICE_DT_GET_ONE(thingmagic_m6enano);
+	struct m6e_nano_fw_stats stats;
+
+	memcpy(image, header, M6E_NANO_FW_HEADER_LEN);
+	sys_put_be32(IMAGE_LEN, &image[12]);
+	for (size_t i = M6E_NANO_FW_HEADER_LEN; i < sizeof(image); i++) {
+		image[i] = i * 7;
+	}
+	write_area(image, sizeof(image));
+
+	bootloader = false;
+	fake_module_start(DEVICE_DT_GET(DT_NODELABEL(uart_emul0)), bootloader_handler);
+
+	zassert_equal(m6e_nano_update_firmware(dev, FW_AREA, &stats), 0);
+	zassert_false(bootloader);
+	zassert_equal(stats.chunks, 5);
+	zassert_equal(stats.bytes, IMAGE_LEN);
+	zassert_equal(image_rx_len, IMAGE_LEN);
+	zassert_mem_equal(image_rx, &image[M6E_NANO_FW_HEADER_LEN], IMAGE_LEN);
+	zassert_equal(stats.crc, m6e_nano_crc32(0, &image[M6E_NANO_FW_HEADER_LEN], IMAGE_LEN));
+}
+
+#endif // DT_NODE_EXISTS(DT_NODELABEL(uart_emul0))
+
+#endif // FIXED_PARTITION_EXISTS(slot1_partition)
+
+#endif // CONFIG_M6E_NANO_FIRMWARE
@@ -0,0 +1,74 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include <../../drivers/m6e-nano/m6e_nano_gs1.h>
+
+#include <zephyr/ztest.h>
+
+#ifdef CONFIG_M6E_NANO_GS1
+
+ZTEST_SUITE(m6enano_gs1_tests, NULL, NULL, NULL, NULL, NULL);
+
+// SGTIN-96 example of the GS1 EPC Tag Data Standard, urn:epc:id:sgtin:0614141.812345.6789
+static const uint8_t sgtin[] = {0x30, 0x74, 0x25, 0x7B, 0xF7, 0x19,
+				0x4E, 0x40, 0x00, 0x00, 0x1A, 0x85};
+
+/**
+ * @brief Test decoding an SGTIN-96 into its fields and GTIN
+ *
+ */
+ZTEST(m6enano_gs1_tests, test_sgtin)
+{
+	struct m6e_nano_gs1 gs1;
+
+	zassert_equal(m6e_nano_gs1_decode(sgtin, sizeof(sgtin), &gs1), 0);
+	zassert_equal(gs1.header, M6E_NANO_GS1_SGTIN_96);
+	zassert_equal(gs1.filter, 3);
+	zassert_equal(gs1.company, 614141);
+	zassert_equal(gs1.company_digits, 7);
+	zassert_equal(gs1.reference, 812345);
+	zassert_equal(gs1.serial, 6789);
+	zassert_equal(m6e_nano_gs1_key(&gs1), 80614141123458ULL);
+}
+
+/**
+ * @brief Test rejecting EPCs that are not GS1 or out of range
+ *
+ */
+ZTEST(m6enano_gs1_tests, test_invalid)
+{
+	uint8_t epc[sizeof(sgtin)];
+	struct m6e_nano_gs1 gs1;
+
+	memcpy(epc, sgtin, sizeof(epc));
+	zassert_equal(m6e_nano_gs1_decode(epc, 8, &gs1), -ENOTSUP);
+
+	epc[0] = 0xE2;
+	zassert_equal(m6e_nano_gs1_decode(epc, sizeof(epc), &gs1), -ENOTSUP);
+	epc[0] = M6E_NANO_GS1_SGTIN_96;
+
+	// Partition 7 does not exist
+	epc[1] |= 0x1C;
+	zassert_equal(m6e_nano_gs1_decode(epc, sizeof(epc), &gs1), -EBADMSG);
+}
+
+/**
+ * @brief Test counting reads per GTIN until the table is full
+ *
+ */
+ZTEST(m6enano_gs1_tests, test_skus)
+{
+	struct m6e_nano_sku skus[8] = {0};
+
+	for (uint64_t key = 1; key <= 8; key++) {
+		zassert_equal(m6e_nano_sku_count(skus, 8, key), 0);
+	}
+	zassert_equal(m6e_nano_sku_count(skus, 8, 3), 0);
+	zassert_equal(m6e_nano_sku_count(skus, 8, 9), -ENOSPC);
+
+	for (int i = 0; i < 8; i++) {
+		zassert_equal(skus[i].reads, skus[i].key == 3 ? 2 : 1);
+	}
+}
+
+#endif // CONFIG_M6E_NANO_GS1
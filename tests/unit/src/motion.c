@@ -0,0 +1,88 @@
+#include <zephyr/kernel.h>
+
+#include <../../drivers/m6e-nano/m6e_nano_motion.h>
+
+#include <zephyr/ztest.h>
+
+#ifdef CONFIG_M6E_NANO_MOTION
+
+ZTEST_SUITE(m6enano_motion_tests, NULL, NULL, NULL, NULL, NULL);
+
+#define FREQ_A 915250
+#define FREQ_B 902750
+
+/**
+ * @brief Feed reads of a tag moving at a constant radial velocity
+ *
+ * Reads arrive every 10 ms and hop channel every 200 ms, the phase follows the distance with a
+ * different offset per channel.
+ *
+ */
+static uint8_t feed(struct m6e_nano_motion *motion, int64_t *um, int32_t velocity,
+		    uint32_t start_ms, uint32_t duration_ms)
+{
+	uint8_t state = M6E_NANO_MOTION_UNKNOWN;
+
+	for (uint32_t t = start_ms; t < start_ms + duration_ms; t += 10) {
+		uint32_t freq = (t / 200) % 2 ? FREQ_B : FREQ_A;
+		int32_t offset = (t / 200) % 2 ? 37 : 0;
+		// Degrees of round trip phase modulo 180
+		int32_t deg = (int32_t)(*um * freq / 416378414) + offset;
+
+		state = m6e_nano_motion_update(motion, -60, deg % 180, freq, t);
+		*um += velocity * 10;
+	}
+
+	return state;
+}
+
+/**
+ * @brief Test a tag walking past the antenna
+ *
+ * The tag approaches at 0.5 m/s, then recedes. The estimator unwraps the phase across channel
+ * hops and reports the pass.
+ *
+ */
+ZTEST(m6enano_motion_tests, test_walk_through)
+{
+	struct m6e_nano_motion motion;
+	int64_t um = 1000000;
+
+	m6e_nano_motion_init(&motion);
+
+	zassert_equal(feed(&motion, &um, -500, 0, 1000), M6E_NANO_MOTION_APPROACHING);
+	zassert_within(motion.velocity, -500, 50, "velocity %d", motion.velocity);
+	zassert_false(motion.passed);
+
+	zassert_equal(feed(&motion, &um, 500, 1000, 1500), M6E_NANO_MOTION_RECEDING);
+	zassert_within(motion.velocity, 500, 50, "velocity %d", motion.velocity);
+	zassert_true(motion.passed);
+	zassert_equal(motion.dwell_ms, 0);
+}
+
+/**
+ * @brief Test a tag that stays put
+ *
+ * A static tag is classified as such and accumulates dwell time. RSSI is smoothed.
+ *
+ */
+ZTEST(m6enano_motion_tests, test_dwell)
+{
+	struct m6e_nano_motion motion;
+	int64_t um = 1000000;
+
+	m6e_nano_motion_init(&motion);
+
+	zassert_equal(feed(&motion, &um, 0, 0, 2000), M6E_NANO_MOTION_STATIC);
+	zassert_within(motion.velocity, 0, 10);
+	zassert_false(motion.passed);
+	zassert_between_inclusive(motion.dwell_ms, 1500, 2000);
+	zassert_equal(motion.rssi_q8, -60 * 256);
+	zassert_equal(motion.rssi_peak, -60);
+
+	m6e_nano_motion_update(&motion, -40, 0, FREQ_A, 2000);
+	zassert_equal(motion.rssi_peak, -40);
+	zassert_equal(motion.rssi_q8, (-60 * 256) + (20 * 256 / 4));
+}
+
+#endif // CONFIG_M6E_NANO_MOTION
@@ -0,0 +1,81 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include <../../drivers/m6e-nano/m6e_nano.h>
+
+#include <zephyr/ztest.h>
+
+#ifdef CONFIG_M6E_NANO_ROUNDS
+
+ZTEST_SUITE(m6enano_round_tests, NULL, NULL, NULL, NULL, NULL);
+
+static struct m6e_nano_tag_set set;
+
+static void make_epc(uint8_t *epc, uint32_t serial)
+{
+	static const uint8_t prefix[] = {0x30, 0x14, 0x25, 0x7B, 0xF7, 0x19, 0x4E, 0x01};
+
+	memcpy(epc, prefix, sizeof(prefix));
+	for (uint8_t x = 0; x < 4; x++) {
+		epc[8 + x] = serial >> (8 * (3 - x));
+	}
+}
+
+/**
+ * @brief Test distinct tag counting
+ *
+ * Repeated reads of the same EPC are only counted once, and clearing starts a new round.
+ *
+ */
+ZTEST(m6enano_round_tests, test_tag_set_unique)
+{
+	uint8_t epc[12];
+
+	m6e_nano_tag_set_clear(&set);
+
+	for (uint32_t i = 0; i < 3; i++) {
+		for (uint32_t serial = 0; serial < 20; serial++) {
+			make_epc(epc, serial);
+			zassert_equal(m6e_nano_tag_set_add(&set, epc, sizeof(epc)), i == 0);
+		}
+	}
+	zassert_equal(set.count, 20);
+	zassert_equal(set.stored, 20);
+
+	// Same trailing bytes, different length
+	zassert_true(m6e_nano_tag_set_add(&set, &epc[4], 8));
+	zassert_equal(set.count, 21);
+
+	m6e_nano_tag_set_clear(&set);
+	zassert_true(m6e_nano_tag_set_add(&set, epc, sizeof(epc)));
+	zassert_equal(set.count, 1);
+}
+
+/**
+ * @brief Test a full tag set
+ *
+ * Distinct EPCs beyond the stored maximum are still counted through the bloom filter.
+ *
+ */
+ZTEST(m6enano_round_tests, test_tag_set_overflow)
+{
+	uint32_t total = CONFIG_M6E_NANO_ROUND_MAX_TAGS + 50;
+	uint8_t epc[12];
+
+	m6e_nano_tag_set_clear(&set);
+
+	for (uint32_t serial = 0; serial < total; serial++) {
+		make_epc(epc, serial);
+		m6e_nano_tag_set_add(&set, epc, sizeof(epc));
+	}
+	zassert_equal(set.stored, CONFIG_M6E_NANO_ROUND_MAX_TAGS);
+	// Bloom filter false positives can only hide a few of the untracked tags
+	zassert_within(set.count, total, 5);
+
+	for (uint32_t serial = 0; serial < total; serial++) {
+		make_epc(epc, serial);
+		zassert_false(m6e_nano_tag_set_add(&set, epc, sizeof(epc)));
+	}
+}
+
+#endif // CONFIG_M6E_NANO_ROUNDS
@@ -0,0 +1,153 @@
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+#if defined(CONFIG_M6E_NANO_STORE) && FIXED_PARTITION_EXISTS(storage_partition)
+
+#include <../../drivers/m6e-nano/m6e_nano_store.h>
+
+#define STORE_AREA FIXED_PARTITION_ID(storage_partition)
+
+static struct m6e_nano_store store;
+
+struct store_count {
+	uint32_t batches;
+	uint32_t tags;
+	uint32_t summaries;
+	uint64_t last_ms;
+};
+
+/**
+ * @brief Decode every record of a batch
+ *
+ */
+static int count_batch(const uint8_t *batch, size_t len, void *user_data)
+{
+	struct store_count *count = user_data;
+	struct m6e_nano_decoder dec;
+	struct m6e_nano_codec_record record;
+	int ret;
+
+	zassert_equal(m6e_nano_decoder_init(&dec, batch, len), 0);
+	while ((ret = m6e_nano_decode_next(&dec, &record)) == 0) {
+		if (record.type == M6E_NANO_CODEC_SUMMARY) {
+			count->summaries++;
+			count->last_ms = record.summary.time_ms;
+		} else {
+			count->tags++;
+			count->last_ms = record.tag.time_ms;
+		}
+	}
+	zassert_equal(ret, -ENODATA);
+	count->batches++;
+
+	return 0;
+}
+
+static void store_tags(uint32_t first, uint32_t count)
+{
+	struct m6e_nano_codec_tag tag = {
+		.rssi = -55,
+		.antenna = 1,
+		.epc_len = 12,
+		.epc = {0xE2, 0x00, 0x68, 0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+	};
+
+	for (uint32_t i = first; i < first + count; i++) {
+		tag.time_ms = 1000 + i * 10;
+		tag.epc[11] = i;
+		tag.epc[10] = i >> 8;
+		zassert_equal(m6e_nano_store_tag(&store, &tag), 0);
+	}
+}
+
+static void *store_setup(void)
+{
+	zassert_equal(m6e_nano_store_init(&store, STORE_AREA, 8), 0);
+
+	return NULL;
+}
+
+static void store_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	zassert_equal(m6e_nano_store_init(&store, STORE_AREA, 8), 0);
+	zassert_equal(m6e_nano_store_clear(&store), 0);
+}
+
+ZTEST_SUITE(m6enano_store_tests, NULL, store_setup, store_before, NULL, NULL);
+
+/**
+ * @brief Test records are staged and written in batches
+ *
+ * Records stay in RAM until the batch is full, then go to flash as a single entry.
+ *
+ */
+ZTEST(m6enano_store_tests, test_batches)
+{
+	struct store_count count = {0};
+	struct m6e_nano_codec_summary summary = {.time_ms = 20000, .unique = 200, .reads = 400};
+
+	store_tags(0, 10);
+	zassert_equal(store.batches, 0, "records written before the batch is full");
+
+	store_tags(10, 390);
+	zassert_true(store.batches > 0);
+	zassert_true(store.batches < 40, "%u batches for 400 records", store.batches);
+
+	zassert_equal(m6e_nano_store_summary(&store, &summary), 0);
+	zassert_equal(m6e_nano_store_walk(&store, count_batch, &count), 0);
+	zassert_equal(count.tags, 400);
+	zassert_equal(count.summaries, 1);
+	zassert_equal(count.last_ms, 20000);
+	zassert_equal(count.batches, store.batches);
+	zassert_equal(store.dropped, 0);
+}
+
+/**
+ * @brief Test the log is recovered after a power loss
+ *
+ * Reopening the log finds every batch written before, only staged records are lost.
+ *
+ */
+ZTEST(m6enano_store_tests, test_power_loss)
+{
+	struct store_count count = {0};
+	uint32_t batches;
+
+	store_tags(0, 100);
+	zassert_equal(m6e_nano_store_flush(&store), 0);
+	batches = store.batches;
+	store_tags(100, 5);
+
+	// Power loss: the RAM state is gone
+	zassert_equal(m6e_nano_store_init(&store, STORE_AREA, 8), 0);
+	zassert_equal(m6e_nano_store_walk(&store, count_batch, &count), 0);
+	zassert_equal(count.batches, batches);
+	zassert_equal(count.tags, 100);
+
+	// Appending carries on after the recovered batches
+	store_tags(105, 10);
+	memset(&count, 0, sizeof(count));
+	zassert_equal(m6e_nano_store_walk(&store, count_batch, &count), 0);
+	zassert_equal(count.tags, 110);
+}
+
+/**
+ * @brief Test the staged records are written after the flush interval
+ *
+ */
+ZTEST(m6enano_store_tests, test_flush_interval)
+{
+	store_tags(0, 3);
+	zassert_equal(store.batches, 0);
+
+	k_msleep(CONFIG_M6E_NANO_STORE_FLUSH_MS + 100);
+	zassert_equal(store.batches, 1);
+	zassert_equal(store.staged, 0);
+}
+
+#endif
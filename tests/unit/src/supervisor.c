@@ -0,0 +1,91 @@
+#include <zephyr/kernel.h>
+
+#include <../../drivers/m6e-nano/m6e_nano.h>
+
+#include "fake_module.h"
+
+#include <zephyr/ztest.h>
+
+#if defined(CONFIG_M6E_NANO_SUPERVISOR) && DT_NODE_EXISTS(DT_NODELABEL(uart_emul0))
+
+#define UART_NODE DT_NODELABEL(uart_emul0)
+
+// Module faked on the emulated UART: every command succeeds and its opcode is logged
+static uint8_t opcodes[16];
+static size_t opcode_count;
+
+static K_SEM_DEFINE(recovered, 0, 1);
+
+/**
+ * @brief Answer each command with an empty response
+ *
+ */
+static int module_handler(const uint8_t *cmd, uint8_t *data, uint16_t *status)
+{
+	ARG_UNUSED(data);
+	ARG_UNUSED(status);
+
+	// Stopping the read stream comes before the settings, only they are logged
+	if (cmd[2] != TMR_SR_OPCODE_MULTI_PROTOCOL_TAG_OP && opcode_count < ARRAY_SIZE(opcodes)) {
+		opcodes[opcode_count++] = cmd[2];
+	}
+
+	return 0;
+}
+
+static void event_callback(const struct device *dev, uint8_t event, void *user_data)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(user_data);
+
+	if (event == M6E_NANO_EVENT_RECOVERED) {
+		k_sem_give(&recovered);
+	}
+}
+
+static void *supervisor_setup(void)
+{
+	fake_module_start(DEVICE_DT_GET(UART_NODE), module_handler);
+
+	return NULL;
+}
+
+ZTEST_SUITE(m6enano_supervisor_tests, NULL, supervisor_setup, NULL, NULL, NULL);
+
+/**
+ * @brief Test that a module reset brings back the remembered settings, the baud rate first
+ *
+ */
+ZTEST(m6enano_supervisor_tests, test_restore_after_reset)
+{
+	const struct device *dev = DEVICE_DT_GET_ONE(thingmagic_m6enano);
+
+	zassert_equal(m6e_nano_set_region(dev, REGION_EUROPE), 0);
+	zassert_equal(m6e_nano_set_read_power(dev, 1500), 0);
+	m6e_nano_set_baud(dev, 57600);
+
+	m6e_nano_set_event_callback(dev, event_callback, NULL);
+	zassert_equal(m6e_nano_set_supervised(dev, true), 0);
+
+	opcode_count = 0;
+	k_sem_reset(&recovered);
+	fake_module_send(TMR_SR_OPCODE_VERSION_STARTUP, 0, NULL, 0);
+
+	zassert_equal(k_sem_take(&recovered, K_SECONDS(5)), 0);
+#ifdef CONFIG_UART_USE_RUNTIME_CONFIGURE
+	zassert_equal(opcode_count, 3);
+	zassert_equal(opcodes[0], TMR_SR_OPCODE_SET_BAUD_RATE);
+	zassert_equal(opcodes[1], TMR_SR_OPCODE_SET_REGION);
+	zassert_equal(opcodes[2], TMR_SR_OPCODE_SET_READ_TX_POWER);
+#else
+	// The UART cannot follow a baud rate change, so it is not sent again
+	zassert_equal(opcode_count, 2);
+	zassert_equal(opcodes[0], TMR_SR_OPCODE_SET_REGION);
+	zassert_equal(opcodes[1], TMR_SR_OPCODE_SET_READ_TX_POWER);
+#endif
+
+	m6e_nano_set_supervised(dev, false);
+	m6e_nano_set_event_callback(dev, NULL, NULL);
+}
+
+#endif // CONFIG_M6E_NANO_SUPERVISOR && DT_NODE_EXISTS(DT_NODELABEL(uart_emul0))
@@ -0,0 +1,97 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include <../../drivers/m6e-nano/m6e_nano.h>
+
+#include <zephyr/ztest.h>
+
+ZTEST_SUITE(m6enano_tag_tests, NULL, NULL, NULL, NULL, NULL);
+
+// Continuous read frame of a 96-bit EPC, without embedded data
+static const uint8_t tag_frame[] = {
+	0xFF, 0x28, 0x22, 0x00, 0x00, 0x10, 0x00, 0x1B, 0x01, 0xFF, 0x01, 0x01,
+	0xC4, 0x11, 0x0E, 0x16, 0x40, 0x00, 0x00, 0x01, 0x27, 0x00, 0x5A, 0x05,
+	0x00, 0x00, 0x0F, 0x00, 0x80, 0x30, 0x00, 0xE2, 0x00, 0x68, 0x16, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x15, 0x45, 0x45, 0xE9, 0x0C, 0x3F,
+};
+
+/**
+ * @brief Test decoding a tag read frame
+ *
+ * Every metadata field and the EPC are taken from the frame rather than the driver's response
+ * buffer, as done for frames completed through RTIO.
+ *
+ */
+ZTEST(m6enano_tag_tests, test_decode_tag)
+{
+	static const uint8_t epc[] = {0xE2, 0x00, 0x68, 0x16, 0x00, 0x00,
+				      0x00, 0x00, 0x00, 0x00, 0x15, 0x45};
+	struct m6e_nano_tag tag;
+
+	zassert_equal(m6e_nano_decode_tag(tag_frame, &tag), 0);
+	zassert_equal(tag.rssi, -60);
+	zassert_equal(tag.antenna, 0x11);
+	zassert_equal(tag.freq, 923200);
+	zassert_equal(tag.timestamp, 295);
+	zassert_equal(tag.phase, 90);
+	zassert_equal(tag.protocol, TMR_TAG_PROTOCOL_GEN2);
+	zassert_equal(tag.epc_len, sizeof(epc));
+	zassert_mem_equal(tag.epc, epc, sizeof(epc));
+}
+
+/**
+ * @brief Test rejecting EPC lengths that do not fit the frame
+ *
+ */
+ZTEST(m6enano_tag_tests, test_decode_tag_bad_length)
+{
+	uint8_t frame[sizeof(tag_frame)];
+	struct m6e_nano_tag tag;
+
+	memcpy(frame, tag_frame, sizeof(frame));
+
+	// 256 bits of PC, EPC and CRC in a frame holding 128
+	frame[28] = 0x00;
+	frame[27] = 0x01;
+	zassert_equal(m6e_nano_decode_tag(frame, &tag), -EBADMSG);
+
+	// Shorter than the PC and CRC words
+	frame[27] = 0x00;
+	frame[28] = 0x10;
+	zassert_equal(m6e_nano_decode_tag(frame, &tag), -EBADMSG);
+}
+
+// Single tag read response with RSSI and antenna metadata, of the same EPC
+static const uint8_t single_frame[] = {
+	0xFF, 0x15, 0x21, 0x00, 0x00, 0x10, 0x00, 0x06, 0xC4, 0x11, 0x30, 0x00, 0xE2, 0x00,
+	0x68, 0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x15, 0x45, 0xE9, 0x0C, 0xA7, 0x7A,
+};
+
+/**
+ * @brief Test decoding the response to a single tag read
+ *
+ * Only the metadata fields flagged in the response are present, the others are left at 0.
+ *
+ */
+ZTEST(m6enano_tag_tests, test_decode_single)
+{
+	static const uint8_t epc[] = {0xE2, 0x00, 0x68, 0x16, 0x00, 0x00,
+				      0x00, 0x00, 0x00, 0x00, 0x15, 0x45};
+	uint8_t frame[sizeof(single_frame)];
+	struct m6e_nano_tag tag;
+
+	zassert_true(m6e_nano_frame_crc_ok(single_frame));
+	zassert_equal(m6e_nano_decode_single(single_frame, &tag), 0);
+	zassert_equal(tag.rssi, -60);
+	zassert_equal(tag.antenna, 0x11);
+	zassert_equal(tag.freq, 0);
+	zassert_equal(tag.timestamp, 0);
+	zassert_equal(tag.epc_len, sizeof(epc));
+	zassert_mem_equal(tag.epc, epc, sizeof(epc));
+
+	// Every metadata field but embedded data flagged, leaving no room for the EPC
+	memcpy(frame, single_frame, sizeof(frame));
+	frame[6] = 0x0F;
+	frame[7] = 0x7F;
+	zassert_equal(m6e_nano_decode_single(frame, &tag), -EBADMSG);
+}
@@ -0,0 +1,67 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include <../../drivers/m6e-nano/m6e_nano_watchlist.h>
+
+#include <zephyr/ztest.h>
+
+#ifdef CONFIG_M6E_NANO_WATCHLIST
+
+ZTEST_SUITE(m6enano_watchlist_tests, NULL, NULL, NULL, NULL, NULL);
+
+// Output of m6e_nano_index for two EPCs with values 7 and 0x10, in a single bucket
+static const uint8_t index_bin[] __aligned(4) = {
+	0x4D, 0x36, 0x57, 0x4C, 0x01, 0x0C, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x10, 0x00,
+	0x00, 0x00, 0xE2, 0x00, 0x68, 0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x01, 0xE2, 0x00, 0x68, 0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+};
+
+/**
+ * @brief Test matching EPCs against an index
+ *
+ */
+ZTEST(m6enano_watchlist_tests, test_find)
+{
+	uint8_t epc[] = {0xE2, 0x00, 0x68, 0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02};
+	struct m6e_nano_watchlist list;
+	uint32_t data = 0;
+
+	zassert_equal(m6e_nano_watchlist_open(&list, index_bin, sizeof(index_bin)), 0);
+	zassert_equal(list.header->count, 2);
+
+	zassert_equal(m6e_nano_watchlist_find(&list, epc, sizeof(epc), &data), 0);
+	zassert_equal(data, 0x10);
+	epc[11] = 0x01;
+	zassert_equal(m6e_nano_watchlist_find(&list, epc, sizeof(epc), &data), 0);
+	zassert_equal(data, 7);
+
+	// Unlisted EPC, and a listed one cut short
+	epc[11] = 0x03;
+	zassert_equal(m6e_nano_watchlist_find(&list, epc, sizeof(epc), &data), -ENOENT);
+	zassert_equal(m6e_nano_watchlist_find(&list, epc, 8, &data), -ENOENT);
+}
+
+/**
+ * @brief Test rejecting truncated and corrupt indexes
+ *
+ */
+ZTEST(m6enano_watchlist_tests, test_invalid)
+{
+	uint8_t copy[sizeof(index_bin)] __aligned(4);
+	struct m6e_nano_watchlist list;
+
+	zassert_equal(m6e_nano_watchlist_open(&list, index_bin, sizeof(index_bin) - 1), -EINVAL);
+	zassert_is_null(list.header);
+
+	// Bucket table ending past the entries
+	memcpy(copy, index_bin, sizeof(copy));
+	copy[16] = 0x03;
+	zassert_equal(m6e_nano_watchlist_open(&list, copy, sizeof(copy)), -EINVAL);
+
+	memcpy(copy, index_bin, sizeof(copy));
+	copy[0] = 0x4C;
+	zassert_equal(m6e_nano_watchlist_open(&list, copy, sizeof(copy)), -EINVAL);
+}
+
+#endif // CONFIG_M6E_NANO_WATCHLIST
@@ -0,0 +1,42 @@
+#include <zephyr/kernel.h>
+#include <zephyr/zbus/zbus.h>
+
+#include <../../drivers/m6e-nano/m6e_nano.h>
+
+#include <zephyr/ztest.h>
+
+#ifdef CONFIG_M6E_NANO_ZBUS
+
+ZTEST_SUITE(m6enano_zbus_tests, NULL, NULL, NULL, NULL, NULL);
+
+M6E_NANO_SUBSCRIBER_DEFINE(test_fast, m6e_nano_tag_chan, struct m6e_nano_tag_msg, 4);
+M6E_NANO_SUBSCRIBER_DEFINE(test_slow, m6e_nano_tag_chan, struct m6e_nano_tag_msg, 2);
+
+/**
+ * @brief Test that a full subscriber queue drops its own messages only
+ *
+ */
+ZTEST(m6enano_zbus_tests, test_subscribers)
+{
+	struct m6e_nano_tag_msg msg = {0};
+
+	for (uint8_t i = 0; i < 3; i++) {
+		msg.tag.epc_len = i + 1;
+		zassert_equal(zbus_chan_pub(&m6e_nano_tag_chan, &msg, K_NO_WAIT), 0);
+	}
+
+	zassert_equal(m6e_nano_subscriber_dropped(&test_fast), 0);
+	zassert_equal(m6e_nano_subscriber_dropped(&test_slow), 1);
+
+	for (uint8_t i = 0; i < 3; i++) {
+		zassert_equal(m6e_nano_subscriber_get(&test_fast, &msg, K_NO_WAIT), 0);
+		zassert_equal(msg.tag.epc_len, i + 1);
+	}
+	for (uint8_t i = 0; i < 2; i++) {
+		zassert_equal(m6e_nano_subscriber_get(&test_slow, &msg, K_NO_WAIT), 0);
+		zassert_equal(msg.tag.epc_len, i + 1);
+	}
+	zassert_equal(m6e_nano_subscriber_get(&test_slow, &msg, K_NO_WAIT), -ENOMSG);
+}
+
+#endif // CONFIG_M6E_NANO_ZBUS